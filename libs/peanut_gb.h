@@ -316,6 +316,7 @@ typedef struct StateHeader
 
 typedef struct PGB_VERSIONED(gb_s) gb_s;
 typedef struct PGB_VERSIONED(gb_breakpoint) gb_breakpoint;
+typedef struct PGB_VERSIONED(gb_arena) gb_arena;
 typedef struct PGB_VERSIONED(audio_data) audio_data;
 typedef struct PGB_VERSIONED(chan_len_ctr) chan_len_ctr;
 typedef struct PGB_VERSIONED(chan_vol_env) chan_vol_env;
@@ -327,6 +328,12 @@ void gb_step_cpu(gb_s* gb);
 enum cgb_support_e gb_get_models_supported(uint8_t* gb_rom);
 bool gb_get_rom_uses_battery(uint8_t* gb_rom);
 
+// Paged ROM backend (see src/rom_pager.h). NULL if the whole ROM is in gb_rom;
+// otherwise gb_rom holds only bank 0, and other banks are mapped through this.
+// region is 0 for 0x0000-0x3FFF, 1 for 0x4000-0x7FFF.
+extern uint8_t* (*gb_rom_bank_mapper)(void* ud, unsigned bank, unsigned region);
+extern void* gb_rom_bank_mapper_ud;
+
 #ifdef TARGET_SIMULATOR
 // Debug: when nonzero, gb_run_frame logs every instruction for this many frames
 // (decremented per frame). Triggered from the simulator by pressing 'T'.
@@ -580,14 +587,26 @@ __section__(".text.cb") static void __gb_timer_edge_tick(gb_s* gb)
     }
 }
 
+uint8_t* (*gb_rom_bank_mapper)(void* ud, unsigned bank, unsigned region) = NULL;
+void* gb_rom_bank_mapper_ud = NULL;
+
 __section__(".text.cb") static void __gb_update_selected_bank_addr(gb_s* gb)
 {
     // swappable cartridge ROM bank
-    int32_t offset = ((int)(gb->selected_rom_bank & gb->num_rom_banks_mask) - 1) * ROM_BANK_SIZE;
+    int bank = gb->selected_rom_bank & gb->num_rom_banks_mask;
+    uint8_t* rom_base;
+    if unlikely (gb_rom_bank_mapper)
+    {
+        rom_base = gb_rom_bank_mapper(gb_rom_bank_mapper_ud, bank, 1) - ROM_BANK_SIZE;
+    }
+    else
+    {
+        rom_base = gb->gb_rom + (bank - 1) * ROM_BANK_SIZE;
+    }
 
     for (int i = 0; i < 4; ++i)
     {
-        gb->rom_bank_base[1][i] = gb->gb_rom + offset;
+        gb->rom_bank_base[1][i] = rom_base;
     }
 
     // swappable cgb wram bank
@@ -607,9 +626,16 @@ __section__(".text.cb") static void __gb_update_selected_bank_addr(gb_s* gb)
 
 __section__(".text.cb") static void __gb_update_zero_bank_addr(gb_s* gb)
 {
+    uint8_t* rom_base = gb->gb_rom + gb->zero_bank_base;
+    if unlikely (gb_rom_bank_mapper && gb->zero_bank_base != 0)
+    {
+        rom_base =
+            gb_rom_bank_mapper(gb_rom_bank_mapper_ud, gb->zero_bank_base / ROM_BANK_SIZE, 0);
+    }
+
     for (int i = 0; i < 4; ++i)
     {
-        gb->rom_bank_base[0][i] = gb->gb_rom + gb->zero_bank_base - 0x0000;
+        gb->rom_bank_base[0][i] = rom_base - 0x0000;
     }
 }
 
@@ -675,8 +701,17 @@ __section__(".rare") static uint8_t __gb_detect_mbc1m(const gb_s* gb)
     for (int i = 0; i < 3; i++)
     {
         size_t off = (size_t)banks_to_check[i] * ROM_BANK_SIZE + 0x0104;
-        if (off + sizeof(logo) <= gb->gb_rom_size &&
-            memcmp(&gb->gb_rom[off], logo, sizeof(logo)) == 0)
+        if (off + sizeof(logo) > gb->gb_rom_size)
+            continue;
+
+        const uint8_t* bank_logo = &gb->gb_rom[off];
+        if (gb_rom_bank_mapper)
+        {
+            // (remapped properly by gb_reset)
+            bank_logo = gb_rom_bank_mapper(gb_rom_bank_mapper_ud, banks_to_check[i], 1) + 0x0104;
+        }
+
+        if (memcmp(bank_logo, logo, sizeof(logo)) == 0)
         {
             return 1;
         }
@@ -4663,41 +4698,48 @@ __section__(".rare") const char* gb_state_load(gb_s* gb, const char* const in, s
         return "State is for a different device (Playdate vs Simulator).";
     }
 
+    // only the head (StateHeader + gb_s) is rewritten when upgrading;
+    // the payload is read straight from `in`.
+    StateView view;
     if (header->version < PGB_VERSION)
     {
-        char* upgraded_in;
-        size_t upgraded_in_size;
-        const char* result =
-            PGB_VERSIONED(savestate_upgrade_to)(&upgraded_in, &upgraded_in_size, (char*)in, size);
+        const char* result = PGB_VERSIONED(savestate_upgrade_to)(&view, (char*)in, size);
         if (result)
             return result;
-        if (upgraded_in != in)
-        {
-            result = gb_state_load(gb, upgraded_in, upgraded_in_size);
-            cb_free(upgraded_in);
+    }
+    else
+    {
+        const char* result = PGB_VERSIONED(gb_state_view)(&view, (char*)in, size);
+        if (result)
             return result;
-        }
     }
+    header = (struct StateHeader*)view.head;
 
+    const char* result = NULL;
     if (header->gb_s_size != sizeof(gb_s))
     {
-        return "State is from an incompatible build (struct size mismatch).";
+        result = "State is from an incompatible build (struct size mismatch).";
     }
-
 #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
-    if (!header->big_endian)
+    else if (!header->big_endian)
 #else
-    if (header->big_endian)
+    else if (header->big_endian)
 #endif
     {
-        return "State endianness incorrect";
+        result = "State endianness incorrect";
+    }
+    else
+    {
+        result = PGB_VERSIONED(gb_state_load)(gb, &view);
     }
 
-    const char* result = PGB_VERSIONED(gb_state_load)(gb, in, size);
+    state_view_free_head(&view, in);
     if (result)
         return result;
 
     // re-compute precomputed fields
+    __gb_init_memory_pointers(gb);
+    __gb_update_map_pointers(gb);
     __gb_update_selected_bank_addr(gb);
     __gb_update_selected_cart_bank_addr(gb);
     __gb_update_zero_bank_addr(gb);
@@ -4976,7 +5018,7 @@ __section__(".rare") void gb_reset(gb_s* gb, bool cgb_mode)
  * the CPU.
  */
 __section__(".rare") enum gb_init_error_e gb_init(
-    gb_s* gb, uint8_t* wram, uint8_t* vram, uint8_t* lcd, uint8_t* gb_rom, size_t rom_size,
+    gb_s* gb, gb_arena* arena, uint8_t* gb_rom, size_t rom_size,
     void (*gb_error)(gb_s*, const enum gb_error_e, const uint16_t), void* priv, bool cgb_mode
 )
 {
@@ -5015,16 +5057,12 @@ __section__(".rare") enum gb_init_error_e gb_init(
     };
     /* clang-format on */
 
-    static uint8_t xram[XRAM_SIZE];
-
-    memset(xram, 0, XRAM_SIZE);
-
-    gb->xram = xram;
-
-    gb->wram = wram;
-    gb->vram = vram;
+    // all of gb's memory regions come from the arena, at fixed offsets
+    gb->wram = arena->wram;
+    gb->vram = arena->vram;
+    gb->xram = arena->xram;
     memset(gb->xram, 0, XRAM_SIZE);
-    gb->lcd = lcd;
+    gb->lcd = arena->lcd;
     gb->gb_rom = gb_rom;
     gb->gb_rom_size = rom_size;
     gb->gb_error = gb_error;
@@ -5032,9 +5070,8 @@ __section__(".rare") enum gb_init_error_e gb_init(
 
     __gb_init_memory_pointers(gb);
 
-    static gb_breakpoint breakpoints[MAX_BREAKPOINTS];
-    memset(breakpoints, 0xFF, sizeof(breakpoints));
-    gb->breakpoints = breakpoints;
+    memset(arena->breakpoints, 0xFF, sizeof(arena->breakpoints));
+    gb->breakpoints = arena->breakpoints;
 
     /* Initialise serial transfer function to NULL. If the front-end does
      * not provide serial support, Peanut-GB will emulate no cable connected
@@ -5117,6 +5154,10 @@ __section__(".rare") int set_hw_breakpoint(gb_s* gb, uint32_t rom_addr)
     if (rom_addr > rom_size)
         return -2;
 
+    // paged banks are re-read from disk, which would lose the patch
+    if (gb_rom_bank_mapper && rom_addr >= ROM_BANK_SIZE)
+        return -3;
+
     for (size_t i = 0; i < MAX_BREAKPOINTS; ++i)
     {
         if (gb->breakpoints[i].rom_addr != 0xFFFFFF)
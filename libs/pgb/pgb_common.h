@@ -29,4 +29,63 @@
 
 #define set_field(dst, src, field) dst->field = src->field
 
+// A save state, split into its fixed-size head (StateHeader immediately
+// followed by the gb_s of header->version) and its payload regions.
+// Upgrade steps only rewrite the head, into a small scratch buffer;
+// the payload pointers keep pointing into the original state buffer,
+// so upgrading never needs a second full-size copy of the state.
+typedef struct StateView
+{
+    // either the original state buffer, or a scratch buffer
+    // allocated by an upgrade step (see state_view_free_head).
+    char* head;
+
+    const uint8_t* rom_header;
+    const uint8_t* wram;
+    const uint8_t* vram;
+    const uint8_t* xram;
+    const uint8_t* cart_ram;
+    const uint8_t* breakpoints;
+
+    // wram and vram grew in v2; older payloads are zero-extended on load.
+    uint32_t wram_size;
+    uint32_t vram_size;
+    uint32_t cart_ram_size;
+} StateView;
+
+// Points view at a state laid out as
+// StateHeader | gb_s | rom header | wram | vram | xram | cart ram | breakpoints
+FORCE_INLINE void state_view_init(
+    StateView* view, char* in, size_t gb_s_size, uint32_t wram_size, uint32_t vram_size,
+    uint32_t cart_ram_size
+)
+{
+    const uint8_t* payload = (const uint8_t*)in + sizeof(StateHeader) + gb_s_size;
+
+    view->head = in;
+    view->wram_size = wram_size;
+    view->vram_size = vram_size;
+    view->cart_ram_size = cart_ram_size;
+
+    view->rom_header = payload;
+    payload += ROM_HEADER_SIZE;
+    view->wram = payload;
+    payload += wram_size;
+    view->vram = payload;
+    payload += vram_size;
+    view->xram = payload;
+    payload += XRAM_SIZE;
+    view->cart_ram = payload;
+    payload += cart_ram_size;
+    view->breakpoints = payload;
+}
+
+// frees view's head if it was allocated by an upgrade step.
+FORCE_INLINE void state_view_free_head(StateView* view, const char* in)
+{
+    if (view->head != in)
+        cb_free(view->head);
+    view->head = NULL;
+}
+
 #endif
\ No newline at end of file
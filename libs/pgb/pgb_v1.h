@@ -437,11 +437,29 @@ FORCE_INLINE uint32_t PGB_VERSIONED(gb_get_state_size)(const struct PGB_VERSIONE
     // skipped: lcd; rom
 }
 
-char* PGB_VERSIONED(gb_savestate_upgrade_to)(char** out, const char* in);
+// Note: used on unswizzled gb struct, so must not follow any pointers
+FORCE_INLINE const char* PGB_VERSIONED(gb_state_view)(StateView* view, char* in, size_t size)
+{
+    if (size < sizeof(StateHeader) + sizeof(struct PGB_VERSIONED(gb_s)))
+    {
+        return "State size too small.";
+    }
+
+    const struct PGB_VERSIONED(gb_s)* in_gb = (const void*)(in + sizeof(StateHeader));
+    if (size != PGB_VERSIONED(gb_get_state_size)(in_gb))
+    {
+        return "State size mismatch";
+    }
+
+    state_view_init(view, in, sizeof(*in_gb), WRAM_SIZE, VRAM_SIZE, in_gb->gb_cart_ram_size);
+    return NULL;
+}
+
+char* PGB_VERSIONED(savestate_upgrade_to)(StateView* view, char* in, size_t in_size);
 
 #ifdef PGB_SAVESTATE_UPGRADE_IMPL
 
-char* savestate_upgrade_to_v1(char** out, size_t* out_size, char* in, size_t in_size)
+char* savestate_upgrade_to_v1(StateView* view, char* in, size_t in_size)
 {
     const StateHeader* const in_header = (const void*)in;
     if (in_header->version > PGB_VERSION)
@@ -450,7 +468,9 @@ char* savestate_upgrade_to_v1(char** out, size_t* out_size, char* in, size_t in_
     }
 
     // Note: v1 and v0 are actually identical.
-    *out = in;
+    const char* result = gb_state_view_v1(view, in, in_size);
+    if (result)
+        return aprintf("%s", result);
     return NULL;
 }
 
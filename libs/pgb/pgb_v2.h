@@ -495,6 +495,26 @@ FORCE_INLINE uint32_t PGB_VERSIONED(gb_get_state_size)(const struct PGB_VERSIONE
     // skipped: lcd; rom
 }
 
+// Note: used on unswizzled gb struct, so must not follow any pointers
+FORCE_INLINE const char* PGB_VERSIONED(gb_state_view)(StateView* view, char* in, size_t size)
+{
+    if (size < sizeof(StateHeader) + sizeof(struct PGB_VERSIONED(gb_s)))
+    {
+        return "State size too small.";
+    }
+
+    const struct PGB_VERSIONED(gb_s)* in_gb = (const void*)(in + sizeof(StateHeader));
+    if (size != PGB_VERSIONED(gb_get_state_size)(in_gb))
+    {
+        return "State size mismatch";
+    }
+
+    state_view_init(
+        view, in, sizeof(*in_gb), WRAM_SIZE_CGB, VRAM_SIZE_CGB, in_gb->gb_cart_ram_size
+    );
+    return NULL;
+}
+
 FORCE_INLINE void PGB_VERSIONED(gb_state_save)(struct PGB_VERSIONED(gb_s) * gb, char* out)
 {
     // gb
@@ -637,23 +657,23 @@ FORCE_INLINE const char* PGB_VERSIONED(gb_state_load)(
     return NULL;
 }
 
-char* PGB_VERSIONED(gb_savestate_upgrade_to)(char** out, const char* in);
+char* PGB_VERSIONED(savestate_upgrade_to)(StateView* view, char* in, size_t in_size);
 
 #ifdef PGB_SAVESTATE_UPGRADE_IMPL
 
 #include "pgb_v1.h"
 
 // in: points to a StateHeader which is followed by the rest of the save state.
-// out: points to a StateHeader*, which will point to either:
+// view: on success, describes the state as v2. view->head is either
 //   (a) in, or
-//   (b) a freshly-malloc'd state header (which must be caller-free'd)
+//   (b) a freshly-malloc'd head (free with state_view_free_head)
+// the payload regions of view always point into `in`.
 
 // returns NULL if successful, caller-free'd string otherwise.
-// if NULL is returned, state version number MUST be up-to-date.
-// if NULL is returned, `out` MUST be non-null.
+// if NULL is returned, view->head's version number MUST be up-to-date.
 // if non-NULL is returned, caller needn't free anything.
 
-char* savestate_upgrade_to_v2(char** out, size_t* out_size, char* in, size_t in_size)
+char* savestate_upgrade_to_v2(StateView* view, char* in, size_t in_size)
 {
     const StateHeader* const in_header = (const void*)in;
     if (in_header->version > PGB_VERSION)
@@ -662,36 +682,33 @@ char* savestate_upgrade_to_v2(char** out, size_t* out_size, char* in, size_t in_
     }
     if (in_header->version == PGB_VERSION)
     {
-        *out = in;
-        return NULL;
-    }
-
-    // upgrade `in` to v1 if needed
-    char* const org_in = in;
-    size_t const org_in_size = in_size;
-    if (in_header->version < 1)
-    {
-        const char* result = savestate_upgrade_to_v1(&in, &in_size, org_in, org_in_size);
+        const char* result = PGB_VERSIONED(gb_state_view)(view, in, in_size);
         if (result)
             return aprintf("%s", result);
+        return NULL;
     }
-    char* const v1_in = in;
+
+    // upgrade `in` to v1 first
+    char* result = savestate_upgrade_to_v1(view, in, in_size);
+    if (result)
+        return result;
+    char* v1 = view->head;
 
 #define DEFINE(type, name, src)    \
     type* const name = (void*)src; \
     src += sizeof(type);
 
-    DEFINE(const StateHeader, v1_header, in);
-    DEFINE(const struct gb_s_v1, v1_gb, in);
+    DEFINE(const StateHeader, v1_header, v1);
+    DEFINE(const struct gb_s_v1, v1_gb, v1);
 
-    char* v2_org = mallocz(sizeof(StateHeader) + sizeof(struct gb_s_v2));
-    if (!v2_org)
+    // only the fixed-size head is rewritten; the payload is shared with `in`.
+    char* const v2_head = mallocz(sizeof(StateHeader) + sizeof(struct gb_s_v2));
+    if (!v2_head)
     {
-        if (v1_in != org_in)
-            cb_free(v1_in);
+        state_view_free_head(view, in);
         return aprintf("Out of memory");
     }
-    char* v2 = v2_org;
+    char* v2 = v2_head;
 
     DEFINE(StateHeader, v2_header, v2);
     DEFINE(struct gb_s_v2, v2_gb, v2);
@@ -738,49 +755,13 @@ char* savestate_upgrade_to_v2(char** out, size_t* out_size, char* in, size_t in_
     v2_gb->audio.capacitor_l = 0;
     v2_gb->audio.capacitor_r = 0;
 
-    // now that we have the data in the struct, we can resize
-    *out_size = gb_get_state_size_v2(v2_gb);
-    char* v2_realloc = cb_realloc(v2_org, *out_size);
-    if (!v2_realloc)
-    {
-        if (v1_in != org_in)
-            cb_free(v1_in);
-        cb_free(v2_org);
-        return aprintf("Out of memory");
-    }
-    v2_org = v2_realloc;
-
-    CB_ASSERT(
-        *out_size - sizeof(struct gb_s_v2) - WRAM_SIZE_CGB - VRAM_SIZE_CGB ==
-        gb_get_state_size_v1(v1_gb) - sizeof(struct gb_s_v1) - WRAM_SIZE - VRAM_SIZE
-    );
-
-    // copy rom header and wram (wram is resized in v2)
-    memcpy(
-        v2_org + sizeof(StateHeader) + sizeof(struct gb_s_v2),
-        org_in + sizeof(StateHeader) + sizeof(struct gb_s_v1), ROM_HEADER_SIZE + WRAM_SIZE
-    );
-
-    // copy vram (vram is resized in v2)
-    memcpy(
-        v2_org + sizeof(StateHeader) + sizeof(struct gb_s_v2) + ROM_HEADER_SIZE + WRAM_SIZE_CGB,
-        org_in + sizeof(StateHeader) + sizeof(struct gb_s_v1) + ROM_HEADER_SIZE + WRAM_SIZE,
-        VRAM_SIZE
-    );
-
-    // copy the remaning data (should be the same between v1 and v2)
-    memcpy(
-        v2_org + sizeof(StateHeader) + sizeof(struct gb_s_v2) + ROM_HEADER_SIZE + WRAM_SIZE_CGB +
-            VRAM_SIZE_CGB,
-        org_in + sizeof(StateHeader) + sizeof(struct gb_s_v1) + ROM_HEADER_SIZE + WRAM_SIZE +
-            VRAM_SIZE,
-        *out_size - sizeof(StateHeader) - sizeof(struct gb_s_v2) - ROM_HEADER_SIZE - WRAM_SIZE_CGB -
-            VRAM_SIZE_CGB
-    );
+    // wram and vram are resized in v2, but the payload is left as-is:
+    // view->wram_size and view->vram_size still describe the v1 sizes,
+    // and the loader zero-extends them.
+    CB_ASSERT(view->wram_size == WRAM_SIZE && view->vram_size == VRAM_SIZE);
 
-    *out = v2_org;
-    if (v1_in != org_in)
-        cb_free(v1_in);
+    state_view_free_head(view, in);
+    view->head = v2_head;
     return NULL;
 
 #undef DEFINE
@@ -504,6 +504,26 @@ FORCE_INLINE uint32_t PGB_VERSIONED(gb_get_state_size)(const struct PGB_VERSIONE
     // skipped: lcd; rom
 }
 
+// Note: used on unswizzled gb struct, so must not follow any pointers
+FORCE_INLINE const char* PGB_VERSIONED(gb_state_view)(StateView* view, char* in, size_t size)
+{
+    if (size < sizeof(StateHeader) + sizeof(struct PGB_VERSIONED(gb_s)))
+    {
+        return "State size too small.";
+    }
+
+    const struct PGB_VERSIONED(gb_s)* in_gb = (const void*)(in + sizeof(StateHeader));
+    if (size != PGB_VERSIONED(gb_get_state_size)(in_gb))
+    {
+        return "State size mismatch";
+    }
+
+    state_view_init(
+        view, in, sizeof(*in_gb), WRAM_SIZE_CGB, VRAM_SIZE_CGB, in_gb->gb_cart_ram_size
+    );
+    return NULL;
+}
+
 FORCE_INLINE void PGB_VERSIONED(gb_state_save)(struct PGB_VERSIONED(gb_s) * gb, char* out)
 {
     // gb
@@ -646,23 +666,23 @@ FORCE_INLINE const char* PGB_VERSIONED(gb_state_load)(
     return NULL;
 }
 
-char* PGB_VERSIONED(gb_savestate_upgrade_to)(char** out, const char* in);
+char* PGB_VERSIONED(savestate_upgrade_to)(StateView* view, char* in, size_t in_size);
 
 #ifdef PGB_SAVESTATE_UPGRADE_IMPL
 
 #include "pgb_v2.h"
 
 // in: points to a StateHeader which is followed by the rest of the save state.
-// out: points to a StateHeader*, which will point to either:
+// view: on success, describes the state as v3. view->head is either
 //   (a) in, or
-//   (b) a freshly-malloc'd state header (which must be caller-free'd)
+//   (b) a freshly-malloc'd head (free with state_view_free_head)
+// the payload regions of view always point into `in`.
 
 // returns NULL if successful, caller-free'd string otherwise.
-// if NULL is returned, state version number MUST be up-to-date.
-// if NULL is returned, `out` MUST be non-null.
+// if NULL is returned, view->head's version number MUST be up-to-date.
 // if non-NULL is returned, caller needn't free anything.
 
-char* savestate_upgrade_to_v3(char** out, size_t* out_size, char* in, size_t in_size)
+char* savestate_upgrade_to_v3(StateView* view, char* in, size_t in_size)
 {
     const StateHeader* const in_header = (const void*)in;
     if (in_header->version > PGB_VERSION)
@@ -671,36 +691,33 @@ char* savestate_upgrade_to_v3(char** out, size_t* out_size, char* in, size_t in_
     }
     if (in_header->version == PGB_VERSION)
     {
-        *out = in;
-        return NULL;
-    }
-
-    // upgrade `in` to v1 if needed
-    char* const org_in = in;
-    size_t const org_in_size = in_size;
-    if (in_header->version < 2)
-    {
-        const char* result = savestate_upgrade_to_v2(&in, &in_size, org_in, org_in_size);
+        const char* result = PGB_VERSIONED(gb_state_view)(view, in, in_size);
         if (result)
             return aprintf("%s", result);
+        return NULL;
     }
-    char* const v2_in = in;
+
+    // upgrade `in` to v2 first
+    char* result = savestate_upgrade_to_v2(view, in, in_size);
+    if (result)
+        return result;
+    char* v2 = view->head;
 
 #define DEFINE(type, name, src)    \
     type* const name = (void*)src; \
     src += sizeof(type);
 
-    DEFINE(const StateHeader, v2_header, in);
-    DEFINE(const struct gb_s_v2, v2_gb, in);
+    DEFINE(const StateHeader, v2_header, v2);
+    DEFINE(const struct gb_s_v2, v2_gb, v2);
 
-    char* v3_org = mallocz(sizeof(StateHeader) + sizeof(struct gb_s_v3));
-    if (!v3_org)
+    // only the fixed-size head is rewritten; the payload is shared with `in`.
+    char* const v3_head = mallocz(sizeof(StateHeader) + sizeof(struct gb_s_v3));
+    if (!v3_head)
     {
-        if (v2_in != org_in)
-            cb_free(v2_in);
+        state_view_free_head(view, in);
         return aprintf("Out of memory");
     }
-    char* v3 = v3_org;
+    char* v3 = v3_head;
 
     DEFINE(StateHeader, v3_header, v3);
     DEFINE(struct gb_s_v3, v3_gb, v3);
@@ -711,30 +728,8 @@ char* savestate_upgrade_to_v3(char** out, size_t* out_size, char* in, size_t in_
 
     set_fields(v3_gb, v2_gb, gb_rom, audio);
 
-    // now that we have the data in the struct, we can resize
-    *out_size = gb_get_state_size_v3(v3_gb);
-    char* v3_realloc = cb_realloc(v3_org, *out_size);
-    if (!v3_realloc)
-    {
-        if (v2_in != org_in)
-            cb_free(v2_in);
-        cb_free(v3_org);
-        return aprintf("Out of memory");
-    }
-    v3_org = v3_realloc;
-
-    // copy remaining data
-    memcpy(
-        v3_org + sizeof(StateHeader) + sizeof(struct gb_s_v3),
-        org_in + sizeof(StateHeader) + sizeof(struct gb_s_v1),
-        ROM_HEADER_SIZE  // for safe-keeping
-            + WRAM_SIZE_CGB + VRAM_SIZE_CGB + XRAM_SIZE + v2_gb->gb_cart_ram_size +
-            MAX_BREAKPOINTS * sizeof(struct PGB_VERSIONED(gb_breakpoint))
-    );
-
-    *out = v3_org;
-    if (v2_in != org_in)
-        cb_free(v2_in);
+    state_view_free_head(view, in);
+    view->head = v3_head;
     return NULL;
 
 #undef DEFINE
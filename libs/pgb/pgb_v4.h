@@ -16,6 +16,22 @@ struct PGB_VERSIONED(gb_breakpoint)
     char opcode;
 };
 
+// All emulated memory outside of gb_s, as one block at fixed offsets.
+// gb_s points into it, with wram at its base. wram, vram and xram are
+// adjacent and in the same order as in a state's payload, so they are
+// saved and restored as a single run.
+// (cart ram is not included; its size is only known once the save is read.)
+struct PGB_VERSIONED(gb_arena)
+{
+    uint8_t wram[WRAM_SIZE_CGB];
+    uint8_t vram[VRAM_SIZE_CGB];
+    uint8_t xram[XRAM_SIZE];
+    clalign uint8_t lcd[LCD_BUFFER_BYTES];
+    struct PGB_VERSIONED(gb_breakpoint) breakpoints[MAX_BREAKPOINTS];
+};
+
+#define GB_ARENA_STATE_RUN_SIZE (WRAM_SIZE_CGB + VRAM_SIZE_CGB + XRAM_SIZE)
+
 struct PGB_VERSIONED(cpu_registers_s)
 {
     union
@@ -385,7 +401,7 @@ struct PGB_VERSIONED(gb_s)
     uint8_t* vram_base;  // see note about vram
     uint8_t* selected_cart_bank_addr;
 
-    /* TODO: Allow implementation to allocate WRAM, VRAM and Frame Buffer. */
+    /* These point into the implementation-allocated gb_arena (wram is its base). */
     uint8_t* wram;  // wram[WRAM_SIZE_CGB];
     uint8_t* vram;  // vram[VRAM_SIZE_CGB]; /* NOTE: tile data (0-0x1800) is stored in reverse bit
                     // order. */
@@ -514,6 +530,26 @@ FORCE_INLINE uint32_t PGB_VERSIONED(gb_get_state_size)(const struct PGB_VERSIONE
     // skipped: lcd; rom
 }
 
+// Note: used on unswizzled gb struct, so must not follow any pointers
+FORCE_INLINE const char* PGB_VERSIONED(gb_state_view)(StateView* view, char* in, size_t size)
+{
+    if (size < sizeof(StateHeader) + sizeof(struct PGB_VERSIONED(gb_s)))
+    {
+        return "State size too small.";
+    }
+
+    const struct PGB_VERSIONED(gb_s)* in_gb = (const void*)(in + sizeof(StateHeader));
+    if (size != PGB_VERSIONED(gb_get_state_size)(in_gb))
+    {
+        return "State size mismatch";
+    }
+
+    state_view_init(
+        view, in, sizeof(*in_gb), WRAM_SIZE_CGB, VRAM_SIZE_CGB, in_gb->gb_cart_ram_size
+    );
+    return NULL;
+}
+
 FORCE_INLINE void PGB_VERSIONED(gb_state_save)(struct PGB_VERSIONED(gb_s) * gb, char* out)
 {
     // gb
@@ -524,17 +560,9 @@ FORCE_INLINE void PGB_VERSIONED(gb_state_save)(struct PGB_VERSIONED(gb_s) * gb,
     memcpy(out, gb->gb_rom + ROM_HEADER_START, ROM_HEADER_SIZE);
     out += ROM_HEADER_SIZE;
 
-    // wram
-    memcpy(out, gb->wram, WRAM_SIZE_CGB);
-    out += WRAM_SIZE_CGB;
-
-    // vram
-    memcpy(out, gb->vram, VRAM_SIZE_CGB);
-    out += VRAM_SIZE_CGB;
-
-    // xram
-    memcpy(out, gb->xram, XRAM_SIZE);
-    out += XRAM_SIZE;
+    // wram, vram, xram (adjacent in the arena)
+    memcpy(out, gb->wram, GB_ARENA_STATE_RUN_SIZE);
+    out += GB_ARENA_STATE_RUN_SIZE;
 
     // cart ram
     if (gb->gb_cart_ram_size > 0)
@@ -552,73 +580,43 @@ FORCE_INLINE void PGB_VERSIONED(gb_state_save)(struct PGB_VERSIONED(gb_s) * gb,
     // TODO: audio
 }
 
+// view: see gb_state_view; the size has already been validated there.
 FORCE_INLINE const char* PGB_VERSIONED(gb_state_load)(
-    struct PGB_VERSIONED(gb_s) * gb, const char* in, size_t size
+    struct PGB_VERSIONED(gb_s) * gb, const StateView* view
 )
 {
-    const StateHeader* header = (void*)in;
-    in += sizeof(*header);
+    const StateHeader* header = (void*)view->head;
     if (header->version != PGB_VERSION)
     {
         return "State comes from an incompatible version of CrankBoy.";
     }
 
-    struct PGB_VERSIONED(gb_s)* in_gb = (void*)in;
-    in += sizeof(*gb);
-    size_t state_size = PGB_VERSIONED(gb_get_state_size)(in_gb);
-
-    if (size != state_size)
-    {
-        return "State size mismatch";
-    }
+    const struct PGB_VERSIONED(gb_s)* in_gb = (void*)(view->head + sizeof(*header));
 
     if (gb->gb_cart_ram_size != in_gb->gb_cart_ram_size)
     {
         return "Cartridge RAM size mismatch";
     }
 
-    const uint8_t* in_rom_header = (const uint8_t*)in;
     const uint8_t* gb_rom_header = gb->gb_rom + ROM_HEADER_START;
-    if (memcmp(in_rom_header, gb_rom_header, 15))
+    if (memcmp(view->rom_header, gb_rom_header, 15))
     {
         return "State appears to be for a different ROM";
     }
-    in += ROM_HEADER_SIZE;
 
     // -- we're in the clear now --
 
+    // everything else that points outside of gb_s is derived from the
+    // arena (gb->wram) again below, or recomputed by gb_state_load.
     void* preserved_fields[] = {
         &gb->gb_rom,
         &gb->wram,
-        &gb->vram,
         &gb->gb_cart_ram,
-        &gb->breakpoints,
         &gb->direct.oam_ghost_buffer,
-        &gb->lcd,
         &gb->direct.priv,
         &gb->gb_error,
         &gb->gb_serial_tx,
         &gb->gb_serial_rx,
-        &gb->vram_base,
-        &gb->xram,
-        &gb->display.bg_map_base,
-        &gb->display.window_map_base,
-        &gb->ram_base[0],
-        &gb->ram_base[1],
-        &gb->ram_base[2],
-        &gb->ram_base[3],
-        &gb->ram_base[4],
-        &gb->ram_base[5],
-        &gb->ram_base[6],
-        &gb->ram_base[7],
-        &gb->ram_base[8],
-        &gb->ram_base[9],
-        &gb->ram_base[10],
-        &gb->ram_base[11],
-        &gb->ram_base[12],
-        &gb->ram_base[13],
-        &gb->ram_base[14],
-        &gb->ram_base[15],
     };
 
     void* preserved_data[sizeof(preserved_fields)];
@@ -635,30 +633,37 @@ FORCE_INLINE const char* PGB_VERSIONED(gb_state_load)(
         memcpy(preserved_fields[i], preserved_data + i, sizeof(void*));
     }
 
-    // wram
-    memcpy(gb->wram, in, WRAM_SIZE_CGB);
-    in += WRAM_SIZE_CGB;
+    struct PGB_VERSIONED(gb_arena)* arena = (void*)gb->wram;
+    gb->vram = arena->vram;
+    gb->xram = arena->xram;
+    gb->lcd = arena->lcd;
+    gb->breakpoints = arena->breakpoints;
 
-    // vram
-    memcpy(gb->vram, in, VRAM_SIZE_CGB);
-    in += VRAM_SIZE_CGB;
-
-    // xram
-    memcpy(gb->xram, in, XRAM_SIZE);
-    in += XRAM_SIZE;
+    if (view->wram_size == WRAM_SIZE_CGB && view->vram_size == VRAM_SIZE_CGB)
+    {
+        // wram, vram, xram in one run
+        memcpy(arena->wram, view->wram, GB_ARENA_STATE_RUN_SIZE);
+    }
+    else
+    {
+        // zero-extended, as the state predates CGB-sized wram/vram
+        memcpy(arena->wram, view->wram, view->wram_size);
+        memset(arena->wram + view->wram_size, 0, WRAM_SIZE_CGB - view->wram_size);
+        memcpy(arena->vram, view->vram, view->vram_size);
+        memset(arena->vram + view->vram_size, 0, VRAM_SIZE_CGB - view->vram_size);
+        memcpy(arena->xram, view->xram, XRAM_SIZE);
+    }
 
     // cartridge ram
     if (gb->gb_cart_ram_size > 0)
     {
-        memcpy(gb->gb_cart_ram, in, gb->gb_cart_ram_size);
-        in += gb->gb_cart_ram_size;
+        memcpy(gb->gb_cart_ram, view->cart_ram, gb->gb_cart_ram_size);
     }
 
     // breakpoints
     // NOTE: scripts should only set breakpoints on startup, so
     // we keep them as they are
-    // memcpy(gb->breakpoints, in, MAX_BREAKPOINTS * sizeof(gb_breakpoint));
-    in += MAX_BREAKPOINTS * sizeof(struct PGB_VERSIONED(gb_breakpoint));
+    // memcpy(gb->breakpoints, view->breakpoints, MAX_BREAKPOINTS * sizeof(gb_breakpoint));
 
     // clear caches and other presentation-layer data
     memset(gb->lcd, 0, LCD_BUFFER_BYTES);
@@ -668,23 +673,23 @@ FORCE_INLINE const char* PGB_VERSIONED(gb_state_load)(
     return NULL;
 }
 
-char* PGB_VERSIONED(gb_savestate_upgrade_to)(char** out, const char* in);
+char* PGB_VERSIONED(savestate_upgrade_to)(StateView* view, char* in, size_t in_size);
 
 #ifdef PGB_SAVESTATE_UPGRADE_IMPL
 
 #include "pgb_v3.h"
 
 // in: points to a StateHeader which is followed by the rest of the save state.
-// out: points to a StateHeader*, which will point to either:
+// view: on success, describes the state as v4. view->head is either
 //   (a) in, or
-//   (b) a freshly-malloc'd state header (which must be caller-free'd)
+//   (b) a freshly-malloc'd head (free with state_view_free_head)
+// the payload regions of view always point into `in`.
 
 // returns NULL if successful, caller-free'd string otherwise.
-// if NULL is returned, state version number MUST be up-to-date.
-// if NULL is returned, `out` MUST be non-null.
+// if NULL is returned, view->head's version number MUST be up-to-date.
 // if non-NULL is returned, caller needn't free anything.
 
-char* savestate_upgrade_to_v4(char** out, size_t* out_size, char* in, size_t in_size)
+char* savestate_upgrade_to_v4(StateView* view, char* in, size_t in_size)
 {
     const StateHeader* const in_header = (const void*)in;
     if (in_header->version > PGB_VERSION)
@@ -693,35 +698,33 @@ char* savestate_upgrade_to_v4(char** out, size_t* out_size, char* in, size_t in_
     }
     if (in_header->version == PGB_VERSION)
     {
-        *out = in;
-        return NULL;
-    }
-
-    char* const org_in = in;
-    size_t const org_in_size = in_size;
-    if (in_header->version < 3)
-    {
-        const char* result = savestate_upgrade_to_v3(&in, &in_size, org_in, org_in_size);
+        const char* result = PGB_VERSIONED(gb_state_view)(view, in, in_size);
         if (result)
             return aprintf("%s", result);
+        return NULL;
     }
-    char* const v3_in = in;
+
+    // upgrade `in` to v3 first
+    char* result = savestate_upgrade_to_v3(view, in, in_size);
+    if (result)
+        return result;
+    char* v3 = view->head;
 
 #define DEFINE(type, name, src)    \
     type* const name = (void*)src; \
     src += sizeof(type);
 
-    DEFINE(const StateHeader, v3_header, in);
-    DEFINE(const struct gb_s_v3, v3_gb, in);
+    DEFINE(const StateHeader, v3_header, v3);
+    DEFINE(const struct gb_s_v3, v3_gb, v3);
 
-    char* v4_org = mallocz(sizeof(StateHeader) + sizeof(struct gb_s_v4));
-    if (!v4_org)
+    // only the fixed-size head is rewritten; the payload is shared with `in`.
+    char* const v4_head = mallocz(sizeof(StateHeader) + sizeof(struct gb_s_v4));
+    if (!v4_head)
     {
-        if (v3_in != org_in)
-            cb_free(v3_in);
+        state_view_free_head(view, in);
         return aprintf("Out of memory");
     }
-    char* v4 = v4_org;
+    char* v4 = v4_head;
 
     DEFINE(StateHeader, v4_header, v4);
     DEFINE(struct gb_s_v4, v4_gb, v4);
@@ -751,27 +754,8 @@ char* savestate_upgrade_to_v4(char** out, size_t* out_size, char* in, size_t in_
     set_fields(v4_gb, v3_gb, num_rom_banks_mask, counter);
     set_fields(v4_gb, v3_gb, hram, audio);
 
-    *out_size = gb_get_state_size_v4(v4_gb);
-    char* v4_realloc = cb_realloc(v4_org, *out_size);
-    if (!v4_realloc)
-    {
-        if (v3_in != org_in)
-            cb_free(v3_in);
-        cb_free(v4_org);
-        return aprintf("Out of memory");
-    }
-    v4_org = v4_realloc;
-
-    memcpy(
-        v4_org + sizeof(StateHeader) + sizeof(struct gb_s_v4),
-        v3_in + sizeof(StateHeader) + sizeof(struct gb_s_v3),
-        ROM_HEADER_SIZE + WRAM_SIZE_CGB + VRAM_SIZE_CGB + XRAM_SIZE + v3_gb->gb_cart_ram_size +
-            MAX_BREAKPOINTS * sizeof(struct PGB_VERSIONED(gb_breakpoint))
-    );
-
-    *out = v4_org;
-    if (v3_in != org_in)
-        cb_free(v3_in);
+    state_view_free_head(view, in);
+    view->head = v4_head;
     return NULL;
 
 #undef DEFINE
@@ -0,0 +1,395 @@
+#!/usr/bin/env python3
+"""CrankBoy Serial Backup (bx - Bulk Export)
+Copies saves, save states and covers from a device to a local directory
+
+Features:
+  - One listing round trip for the whole tree, instead of cb:ls per directory
+  - Files stream from the device in base85 chunks, up to a window ahead of
+    the host's cumulative ACKs (the reverse of ft in xfer_test.py)
+  - CRC16 check per chunk, CRC32 check per file
+  - Resumable: an interrupted file is kept as <name>.part and continued from
+    its size on the next run; files already backed up are checked against
+    the device's CRC32 and skipped
+  - Artificial packet drop testing (--drop-rate option)
+
+Protocol:
+  bx:l:<dir>[:<dir>...]    - List every file below the directories
+  bx:o:<path>:<offset>     - Stream a file from <offset>
+  bx:a:<seq>               - Cumulative ACK (chunks 0 through seq received)
+  bx:r:<seq>               - Resend from seq
+  bx:c                     - Close
+
+Device responses:
+  bx:i:<size>:<path>       - A file in the listing
+  bx:omit                  - A file whose path didn't fit in a line
+  bx:k:<count>             - End of the listing
+  bx:h:<size>:<WWCC>       - Header: whole-file size, WW = window,
+                             CC = chunk size
+  bx:d:<seq>:<crc16>:<base85>
+                           - Chunk seq, holding the bytes at offset + seq * CC
+  bx:t:<crc32>             - Trailer: whole-file CRC32, after the last chunk
+  bx:x:<code>              - Error: filename, offset, notfound, io, nomem
+
+Testing:
+  --drop-rate N            - Artificially drop N%% of chunks to test recovery
+"""
+
+import sys
+import os
+import base64
+import zlib
+import time
+import serial
+import argparse
+import urllib.parse
+import random
+
+# Configuration
+SERIAL_PORT = "/dev/cu.usbmodemPDU1_Y0096921"
+BAUD_RATE = 115200
+TIMEOUT = 5
+DEFAULT_DIRS = ["saves", "states", "covers"]
+
+# the device goes back to the last ACK itself after 1 s; ask sooner
+RESEND_TIMEOUT = 0.5
+# the device reads the part of a file before the offset for its CRC at about
+# 16 KB per frame; allow for a slow frame rate
+HASH_BYTES_PER_SEC = 256 * 1024
+MAX_ATTEMPTS = 3
+
+# Global verbose flag
+VERBOSE = False
+
+
+def calculate_crc32(filepath):
+    """Calculate CRC32 of a file."""
+    with open(filepath, 'rb') as f:
+        data = f.read()
+    return zlib.crc32(data) & 0xFFFFFFFF
+
+
+def print_progress_bar(percent, width=40):
+    """Print a simple progress bar."""
+    filled = int(width * percent / 100)
+    bar = '=' * filled + '>' + ' ' * (width - filled - 1)
+    print(f"\r[{bar}] {percent:.1f}%", end='', flush=True)
+
+
+def send_command(ser, cmd):
+    """Send a command with 'msg' prefix."""
+    full_cmd = f"msg {cmd}\n"
+    ser.write(full_cmd.encode('utf-8'))
+    if VERBOSE:
+        print(f"  → {cmd[:70]}{'...' if len(cmd) > 70 else ''}")
+
+
+def read_response(ser, timeout=TIMEOUT):
+    """Read a bx: response line; other console output is skipped."""
+    ser.timeout = timeout
+    start = time.time()
+    while time.time() - start < timeout:
+        try:
+            line = ser.readline()
+        except serial.SerialException as e:
+            if VERBOSE:
+                print(f"  Serial error: {e}")
+            return None, None
+        if not line:
+            return None, None
+        decoded = line.decode('utf-8', errors='ignore').strip()
+        if not decoded.startswith("bx:"):
+            continue
+        parts = decoded.split(':', 2)
+        cmd = parts[1] if len(parts) > 1 else ""
+        params = parts[2] if len(parts) > 2 else ""
+        if VERBOSE and cmd != "d":
+            print(f"  ← {decoded[:70]}{'...' if len(decoded) > 70 else ''}")
+        return cmd, params
+    return None, None
+
+
+def list_files(ser, dirs):
+    """List the files below dirs. Returns [(path, size)], or None on failure."""
+    send_command(ser, "bx:l:" + ":".join(urllib.parse.quote(d, safe='') for d in dirs))
+
+    files = []
+    omitted = 0
+    while True:
+        cmd, params = read_response(ser)
+        if cmd is None:
+            print("ERROR: Timed out waiting for the file list")
+            return None
+        if cmd == "i":
+            size, path = params.split(':', 1)
+            files.append((path, int(size)))
+        elif cmd == "omit":
+            omitted += 1
+        elif cmd == "k":
+            break
+        elif cmd == "x":
+            print(f"ERROR: Device error listing files: {params}")
+            return None
+
+    if omitted:
+        print(f"WARNING: {omitted} file(s) skipped, their paths are too long to list")
+    return files
+
+
+def hash_timeout(offset):
+    """How long the device may take to read offset bytes for the CRC."""
+    return TIMEOUT + offset / HASH_BYTES_PER_SEC
+
+
+def open_file(ser, path, offset):
+    """Send bx:o and wait for the header. Returns (size, chunk_size) or None,
+    with the device's error code if it sent one."""
+    send_command(ser, f"bx:o:{urllib.parse.quote(path, safe='')}:{offset}")
+    while True:
+        cmd, params = read_response(ser)
+        if cmd is None:
+            return None, "timeout"
+        if cmd == "h":
+            size, code = params.split(':')
+            return (int(size), int(code, 16) & 0xFF), None
+        if cmd == "x":
+            return None, params
+        # stray chunks from a file that was being streamed before
+
+
+def read_trailer(ser, timeout):
+    """Wait for the trailer of a file opened at its size. Returns the CRC32,
+    or None."""
+    start = time.time()
+    while time.time() - start < timeout:
+        cmd, params = read_response(ser, timeout=timeout)
+        if cmd == "t":
+            return int(params, 16)
+        if cmd is None or cmd == "x":
+            return None
+    return None
+
+
+def receive_file(ser, path, part_path, offset, size, chunk_size, drop_rate):
+    """Append the chunks after offset to part_path. Returns (bytes received,
+    file CRC32 from the trailer), or None on failure."""
+    total_chunks = (size - offset + chunk_size - 1) // chunk_size
+    expected = 0
+    last_acked = -1
+    crc = None
+    reopens = 0
+    # the device reads the file up to offset before the first chunk
+    last_progress = time.time() + hash_timeout(offset) - TIMEOUT
+    resend_sent = None  # when bx:r was sent for the current gap
+    last_seq = -1
+    ack_every = 16
+    received = 0
+    last_percent = -1
+
+    with open(part_path, 'ab') as out:
+        while expected < total_chunks or crc is None:
+            cmd, params = read_response(ser, timeout=RESEND_TIMEOUT)
+            now = time.time()
+
+            if cmd is None:
+                if now - last_progress > TIMEOUT * 2:
+                    print(f"\nERROR: Device stopped sending {path}")
+                    return None
+                # with every chunk in but no trailer, the last chunk brings it again
+                if total_chunks > 0:
+                    send_command(ser, f"bx:r:{min(expected, total_chunks - 1):04X}")
+                elif now - last_progress > RESEND_TIMEOUT and reopens < MAX_ATTEMPTS:
+                    # with no chunks the device closes the file after the
+                    # trailer, so a lost trailer takes another bx:o
+                    send_command(ser, f"bx:o:{urllib.parse.quote(path, safe='')}:{offset}")
+                    last_progress = now + hash_timeout(offset) - TIMEOUT
+                    reopens += 1
+                continue
+
+            if cmd == "x":
+                print(f"\nERROR: Device error reading {path}: {params}")
+                return None
+            if cmd == "t":
+                crc = int(params, 16)
+                # the last ACK closes the file on the device, so it waits for this
+                if total_chunks > 0 and expected == total_chunks and last_acked < expected - 1:
+                    send_command(ser, f"bx:a:{expected - 1:04X}")
+                    last_acked = expected - 1
+                continue
+            if cmd != "d":
+                continue
+
+            seq_hex, crc_hex, text = params.split(':', 2)
+            seq = int(seq_hex, 16)
+
+            # Artificial packet drop for testing
+            if drop_rate > 0 and random.random() < (drop_rate / 100.0):
+                if VERBOSE:
+                    print(f"  [ARTIFICIAL DROP: chunk {seq:04X}]")
+                continue
+
+            # the device went back (for bx:r, or on its own timeout)
+            new_pass = seq <= last_seq
+            last_seq = seq
+
+            if seq < expected:
+                continue  # duplicate, from a resend
+
+            try:
+                data = base64.b85decode(text)
+            except ValueError:
+                data = None
+            if seq > expected or data is None or (zlib.crc32(data) & 0xFFFF) != int(crc_hex, 16):
+                # a gap or a bad chunk; the chunks already in flight behind it
+                # will be out of order too, so ask once per pass, or on timeout
+                if resend_sent is None or new_pass or now - resend_sent > RESEND_TIMEOUT:
+                    send_command(ser, f"bx:r:{expected:04X}")
+                    resend_sent = now
+                continue
+
+            # flushed as it goes, so an interrupted run leaves a valid prefix
+            out.write(data)
+            out.flush()
+            received += len(data)
+            expected += 1
+            last_progress = now
+            resend_sent = None
+
+            if (expected < total_chunks and expected - 1 - last_acked >= ack_every
+                    or expected == total_chunks and crc is not None):
+                send_command(ser, f"bx:a:{expected - 1:04X}")
+                last_acked = expected - 1
+
+            percent = 100 * (offset + received) // size
+            if not VERBOSE and size > 64 * 1024 and percent != last_percent:
+                print_progress_bar(percent)
+                last_percent = percent
+
+    if not VERBOSE and size > 64 * 1024:
+        print()
+    return received, crc
+
+
+def backup_file(ser, path, size, dest, drop_rate):
+    """Back up one file. Returns (bytes received, skipped), or None on failure."""
+    local_path = os.path.join(dest, *path.split('/'))
+    part_path = local_path + ".part"
+    os.makedirs(os.path.dirname(local_path), exist_ok=True)
+
+    # a copy of the same size is probably current; bx:o at its size only
+    # returns the header and the trailer, with the CRC32 to confirm that
+    if os.path.exists(local_path) and os.path.getsize(local_path) == size:
+        header, error = open_file(ser, path, size)
+        if header is None:
+            print(f"ERROR: {path}: {error}")
+            return None
+        if read_trailer(ser, hash_timeout(size)) == calculate_crc32(local_path):
+            return 0, True
+
+    received = 0
+    for attempt in range(MAX_ATTEMPTS):
+        offset = os.path.getsize(part_path) if os.path.exists(part_path) else 0
+        if offset > size:
+            os.remove(part_path)
+            offset = 0
+
+        header, error = open_file(ser, path, offset)
+        if header is None:
+            print(f"ERROR: {path}: {error}")
+            return None
+        size, chunk_size = header
+        if VERBOSE:
+            print(f"  {path}: {size} bytes from {offset}")
+
+        result = receive_file(ser, path, part_path, offset, size, chunk_size, drop_rate)
+        if result is None:
+            send_command(ser, "bx:c")
+            return None
+        n, crc = result
+        received += n
+
+        if calculate_crc32(part_path) == crc:
+            os.replace(part_path, local_path)
+            return received, False
+
+        # the file changed on the device, or the .part was from an older copy
+        print(f"WARNING: {path}: CRC mismatch, starting over")
+        os.remove(part_path)
+
+    print(f"ERROR: {path}: CRC mismatch after {MAX_ATTEMPTS} attempts")
+    return None
+
+
+def backup(dest, port=SERIAL_PORT, dirs=DEFAULT_DIRS, verbose=False, drop_rate=0):
+    """Back up dirs from the device into dest. Returns True on success."""
+    global VERBOSE
+    VERBOSE = verbose
+
+    print(f"Connecting to {port}...")
+    try:
+        ser = serial.Serial(port, BAUD_RATE, timeout=TIMEOUT)
+    except serial.SerialException as e:
+        print(f"ERROR: Could not open serial port: {e}")
+        return False
+
+    ser.reset_input_buffer()
+    ser.reset_output_buffer()
+
+    files = list_files(ser, dirs)
+    if files is None:
+        ser.close()
+        return False
+    total_size = sum(size for _, size in files)
+    print(f"{len(files)} files, {total_size / 1024:.1f} KB in {', '.join(dirs)}")
+
+    start_time = time.time()
+    received = 0
+    skipped = 0
+    failed = 0
+    for path, size in files:
+        if not VERBOSE:
+            print(path)
+        result = backup_file(ser, path, size, dest, drop_rate)
+        if result is None:
+            failed += 1
+            continue
+        n, was_current = result
+        received += n
+        skipped += was_current
+
+    ser.close()
+    elapsed = time.time() - start_time
+    rate = received / 1024 / elapsed if elapsed > 0 else 0
+
+    print(f"\n{'='*60}")
+    print(f"Backed up {len(files) - failed - skipped} files, {received / 1024:.1f} KB "
+          f"({skipped} already current, {failed} failed)")
+    print(f"Speed: {rate:.1f} KB/s")
+    print(f"{'='*60}\n")
+    return failed == 0
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Back up CrankBoy saves, save states and covers via serial (bx protocol). "
+                    "Interrupted backups resume where they stopped, and files that are "
+                    "already current are skipped."
+    )
+    parser.add_argument("dest", help="Directory to back up into")
+    parser.add_argument("--port", default=SERIAL_PORT, help=f"Serial port (default: {SERIAL_PORT})")
+    parser.add_argument("--dirs", nargs='+', default=DEFAULT_DIRS,
+                        help=f"Device directories to back up (default: {' '.join(DEFAULT_DIRS)})")
+    parser.add_argument("-v", "--verbose", action="store_true", help="Enable verbose output")
+    parser.add_argument("--drop-rate", type=int, default=0, help="Artificial packet drop rate %% for testing (0-100)")
+
+    args = parser.parse_args()
+
+    if len(args.dirs) > 6:
+        print("ERROR: At most 6 directories can be listed at once")
+        sys.exit(1)
+
+    if not backup(args.dest, args.port, args.dirs, verbose=args.verbose, drop_rate=args.drop_rate):
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,641 @@
+//
+//  jparse_bench.c
+//  CrankBoy
+//
+//  Host benchmark: json_get_table_value (src/jparse.c) with sorted table
+//  indexes, against the previous linear scan. Every key of every table in
+//  the document is looked up, plus one miss per table. Also compares heap
+//  and arena-backed trees (decode and free time, peak heap, heap calls),
+//  and optionally full against filtered decoding.
+//
+//  The SDK's JSON decoder isn't available on the host, so a minimal stand-in
+//  drives the same decoder callbacks. Build and run from the repository root
+//  (the SDK headers are needed for pd_api.h):
+//
+//    cc -O2 -I"$PLAYDATE_SDK_PATH/C_API" -DTARGET_EXTENSION=1 -o jparse_bench
+//        scripts/bench/jparse_bench.c && ./jparse_bench scripts/romhacks.json
+//
+//  For a larger document, try the romhack database:
+//
+//    gunzip -c scripts/rhdb.json.gz > rhdb.json && ./jparse_bench rhdb.json
+//
+//  Any further arguments are keep-paths; the document is then also decoded
+//  with parse_json_string_filtered, to compare time and peak heap:
+//
+//    ./jparse_bench rhdb.json 'hacks/*/title' 'lookup'
+//
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../src/jparse.c"
+
+#define ROUNDS 50
+
+PlaydateAPI* playdate;
+
+// jparse's allocations are counted, to compare peak heap use
+static size_t heap_current, heap_peak, heap_calls;
+
+void* cb_realloc(void* ptr, size_t size)
+{
+    heap_calls++;
+    size_t* block = ptr ? (size_t*)ptr - 1 : NULL;
+    if (block)
+        heap_current -= *block;
+    if (size == 0)
+    {
+        free(block);
+        return NULL;
+    }
+
+    block = realloc(block, sizeof(size_t) + size);
+    *block = size;
+    heap_current += size;
+    if (heap_current > heap_peak)
+        heap_peak = heap_current;
+    return block + 1;
+}
+
+void* cb_malloc(size_t size)
+{
+    return cb_realloc(NULL, size);
+}
+
+void cb_free(void* ptr)
+{
+    if (ptr)
+        cb_realloc(ptr, 0);
+}
+
+void* cb_calloc(size_t count, size_t size)
+{
+    void* ptr = cb_malloc(count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void* mallocz(size_t size)
+{
+    void* ptr = cb_malloc(size);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+char* cb_strdup(const char* s)
+{
+    size_t len = strlen(s) + 1;
+    return memcpy(cb_malloc(len), s, len);
+}
+
+char* aprintf(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    char* s = cb_malloc(len + 1);
+    va_start(args, fmt);
+    vsnprintf(s, len + 1, fmt, args);
+    va_end(args);
+    return s;
+}
+
+char* cb_read_entire_file_maybe_compressed(const char* path, size_t* o_size, unsigned flags)
+{
+    return NULL;
+}
+
+
+static void host_log(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+// --- minimal stand-in for the SDK decoder ---
+
+typedef struct
+{
+    const char* p;
+    json_decoder* decoder;
+    int error;
+} HostParser;
+
+static void skip_ws(HostParser* hp)
+{
+    while (*hp->p == ' ' || *hp->p == '\t' || *hp->p == '\n' || *hp->p == '\r')
+        hp->p++;
+}
+
+static char* parse_string(HostParser* hp)
+{
+    size_t cap = 32, len = 0;
+    char* s = malloc(cap);
+    hp->p++;  // opening quote
+    while (*hp->p && *hp->p != '"')
+    {
+        unsigned c = (unsigned char)*hp->p++;
+        if (c == '\\')
+        {
+            char e = *hp->p++;
+            switch (e)
+            {
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'u':
+            {
+                char hex[5] = {0};
+                memcpy(hex, hp->p, 4);
+                c = (unsigned)strtoul(hex, NULL, 16);
+                hp->p += 4;
+                break;
+            }
+            default:
+                c = e;
+            }
+        }
+
+        char utf8[3];
+        int n = 0;
+        if (c < 0x80 || c > 0xFF)
+        {
+            utf8[n++] = (char)(c < 0x80 ? c : '?');
+        }
+        else
+        {
+            utf8[n++] = (char)(0xC0 | (c >> 6));
+            utf8[n++] = (char)(0x80 | (c & 0x3F));
+        }
+
+        if (len + n + 1 > cap)
+        {
+            cap *= 2;
+            s = realloc(s, cap);
+        }
+        memcpy(s + len, utf8, n);
+        len += n;
+    }
+    if (*hp->p == '"')
+        hp->p++;
+    else
+        hp->error = 1;
+    s[len] = 0;
+    return s;
+}
+
+static json_value parse_value(HostParser* hp, const char* name);
+
+// skips a value the decoder doesn't want, without decoding it
+static void skip_value(HostParser* hp)
+{
+    int depth = 0;
+    skip_ws(hp);
+    do
+    {
+        char c = *hp->p;
+        if (c == '"')
+        {
+            free(parse_string(hp));
+            continue;
+        }
+        if (c == '{' || c == '[')
+            depth++;
+        else if (c == '}' || c == ']')
+            depth--;
+        else if (depth == 0 && (c == ',' || c == 0))
+            break;
+        hp->p++;
+    } while (depth > 0 || (*hp->p != ',' && *hp->p != '}' && *hp->p != ']' && *hp->p));
+}
+
+static json_value parse_sublist(HostParser* hp, const char* name, json_value_type type)
+{
+    json_decoder* decoder = hp->decoder;
+    void* parent_userdata = decoder->userdata;
+    decoder->willDecodeSublist(decoder, name, type);
+
+    char close = (type == kJSONTable) ? '}' : ']';
+    hp->p++;
+    skip_ws(hp);
+
+    int pos = 0;
+    while (!hp->error && *hp->p && *hp->p != close)
+    {
+        if (type == kJSONTable)
+        {
+            char* key = parse_string(hp);
+            skip_ws(hp);
+            if (*hp->p++ != ':')
+                hp->error = 1;
+            skip_ws(hp);
+
+            if (decoder->shouldDecodeTableValueForKey &&
+                !decoder->shouldDecodeTableValueForKey(decoder, key))
+            {
+                skip_value(hp);
+            }
+            else
+            {
+                json_value value = parse_value(hp, key);
+                decoder->didDecodeTableValue(decoder, key, value);
+                if (value.type == kJSONString)
+                    free(value.data.stringval);
+            }
+            free(key);
+        }
+        else
+        {
+            ++pos;
+            if (decoder->shouldDecodeArrayValueAtIndex &&
+                !decoder->shouldDecodeArrayValueAtIndex(decoder, pos))
+            {
+                skip_value(hp);
+            }
+            else
+            {
+                json_value value = parse_value(hp, name);
+                decoder->didDecodeArrayValue(decoder, pos, value);
+                if (value.type == kJSONString)
+                    free(value.data.stringval);
+            }
+        }
+
+        skip_ws(hp);
+        if (*hp->p == ',')
+        {
+            hp->p++;
+            skip_ws(hp);
+        }
+    }
+    hp->p++;
+
+    json_value result = {.type = type};
+    result.data.tableval = decoder->didDecodeSublist(decoder, name, type);
+    decoder->userdata = parent_userdata;
+    return result;
+}
+
+static json_value parse_value(HostParser* hp, const char* name)
+{
+    json_value v = {.type = kJSONNull};
+    skip_ws(hp);
+
+    switch (*hp->p)
+    {
+    case '{':
+        return parse_sublist(hp, name, kJSONTable);
+    case '[':
+        return parse_sublist(hp, name, kJSONArray);
+    case '"':
+        v.type = kJSONString;
+        v.data.stringval = parse_string(hp);
+        return v;
+    case 't':
+        hp->p += 4;
+        v.type = kJSONTrue;
+        return v;
+    case 'f':
+        hp->p += 5;
+        v.type = kJSONFalse;
+        return v;
+    case 'n':
+        hp->p += 4;
+        return v;
+    default:
+    {
+        char* end;
+        double d = strtod(hp->p, &end);
+        if (end == hp->p)
+        {
+            hp->error = 1;
+            return v;
+        }
+        if (d == (int)d && !memchr(hp->p, '.', end - hp->p))
+        {
+            v.type = kJSONInteger;
+            v.data.intval = (int)d;
+        }
+        else
+        {
+            v.type = kJSONFloat;
+            v.data.floatval = (float)d;
+        }
+        hp->p = end;
+        return v;
+    }
+    }
+}
+
+static int host_decode(json_decoder* decoder, json_reader reader, json_value* out)
+{
+    size_t cap = 1 << 16, len = 0;
+    char* text = malloc(cap);
+    int n;
+    while ((n = reader.read(reader.userdata, (uint8_t*)text + len, (int)(cap - len - 1))) > 0)
+    {
+        len += n;
+        if (cap - len - 1 == 0)
+        {
+            cap *= 2;
+            text = realloc(text, cap);
+        }
+    }
+    text[len] = 0;
+
+    HostParser hp = {.p = text, .decoder = decoder};
+    *out = parse_value(&hp, "_root");
+    free(text);
+    return !hp.error;
+}
+
+// --- benchmark ---
+
+typedef struct
+{
+    json_value table;
+    const char* key;
+} Lookup;
+
+static Lookup* lookups;
+static size_t lookup_count, lookup_capacity;
+
+static void add_lookup(json_value table, const char* key)
+{
+    if (lookup_count == lookup_capacity)
+    {
+        lookup_capacity = lookup_capacity ? lookup_capacity * 2 : 1024;
+        lookups = realloc(lookups, lookup_capacity * sizeof(Lookup));
+    }
+    lookups[lookup_count++] = (Lookup){table, key};
+}
+
+static size_t table_count, indexed_count;
+
+static void collect_lookups(json_value v)
+{
+    if (v.type == kJSONArray)
+    {
+        JsonArray* array = v.data.arrayval;
+        for (size_t i = 0; i < array->n; ++i)
+            collect_lookups(array->data[i]);
+    }
+    else if (v.type == kJSONTable)
+    {
+        JsonObject* obj = v.data.tableval;
+        table_count++;
+        indexed_count += (obj->index != NULL);
+        for (size_t i = 0; i < obj->n; ++i)
+        {
+            add_lookup(v, obj->data[i].key);
+            collect_lookups(obj->data[i].value);
+        }
+        add_lookup(v, "no such key");
+    }
+}
+
+// json_get_table_value before table indexes
+static json_value linear_get_table_value(json_value j, const char* key)
+{
+    JsonObject* obj = j.data.tableval;
+    for (size_t i = 0; i < obj->n; ++i)
+    {
+        if (!strcmp(obj->data[i].key, key))
+            return obj->data[i].value;
+    }
+    j.type = kJSONNull;
+    return j;
+}
+
+static bool json_equal(json_value a, json_value b)
+{
+    if (a.type != b.type)
+        return false;
+
+    switch (a.type)
+    {
+    case kJSONString:
+        return !strcmp(a.data.stringval, b.data.stringval);
+    case kJSONInteger:
+        return a.data.intval == b.data.intval;
+    case kJSONFloat:
+        return a.data.floatval == b.data.floatval;
+    case kJSONArray:
+    {
+        JsonArray* x = a.data.arrayval;
+        JsonArray* y = b.data.arrayval;
+        if (x->n != y->n)
+            return false;
+        for (size_t i = 0; i < x->n; ++i)
+        {
+            if (!json_equal(x->data[i], y->data[i]))
+                return false;
+        }
+        return true;
+    }
+    case kJSONTable:
+    {
+        JsonObject* x = a.data.tableval;
+        JsonObject* y = b.data.tableval;
+        if (x->n != y->n || (x->index == NULL) != (y->index == NULL))
+            return false;
+        for (size_t i = 0; i < x->n; ++i)
+        {
+            if (strcmp(x->data[i].key, y->data[i].key) ||
+                !json_equal(x->data[i].value, y->data[i].value))
+                return false;
+            if (x->index && x->index[i] - x->data != y->index[i] - y->data)
+                return false;
+        }
+        return true;
+    }
+    default:
+        return true;
+    }
+}
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* read_file(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* text = malloc(size + 1);
+    if (fread(text, 1, size, f) != (size_t)size)
+        size = 0;
+    text[size] = 0;
+    fclose(f);
+    return text;
+}
+
+int main(int argc, char** argv)
+{
+    const char* path = argc > 1 ? argv[1] : "scripts/romhacks.json";
+
+    static struct playdate_sys sys = {.realloc = cb_realloc, .logToConsole = host_log};
+    static struct playdate_json json = {.decode = host_decode};
+    static PlaydateAPI api = {.system = &sys, .json = &json};
+    playdate = &api;
+
+    char* text = read_file(path);
+    if (!text)
+    {
+        fprintf(stderr, "can't read %s\n", path);
+        return 1;
+    }
+
+    json_value root;
+    heap_peak = heap_current;
+    heap_calls = 0;
+    double t0 = now_seconds();
+    if (!parse_json_string(text, &root))
+    {
+        fprintf(stderr, "can't parse %s\n", path);
+        return 1;
+    }
+    double parse_s = now_seconds() - t0;
+    size_t parse_peak = heap_peak;
+    size_t parse_calls = heap_calls;
+
+    collect_lookups(root);
+    printf(
+        "%s: %zu tables (%zu indexed), %zu lookups, parsed in %.2f ms, peak heap %zu KB\n",
+        path, table_count, indexed_count, lookup_count, parse_s * 1000, parse_peak / 1024
+    );
+
+    unsigned sink = 0;
+    double linear_s = 0, indexed_s = 0;
+    for (int round = 0; round < ROUNDS; ++round)
+    {
+        t0 = now_seconds();
+        for (size_t i = 0; i < lookup_count; ++i)
+            sink += linear_get_table_value(lookups[i].table, lookups[i].key).type;
+        linear_s += now_seconds() - t0;
+
+        t0 = now_seconds();
+        for (size_t i = 0; i < lookup_count; ++i)
+            sink += json_get_table_value(lookups[i].table, lookups[i].key).type;
+        indexed_s += now_seconds() - t0;
+    }
+
+    for (size_t i = 0; i < lookup_count; ++i)
+    {
+        json_value a = linear_get_table_value(lookups[i].table, lookups[i].key);
+        json_value b = json_get_table_value(lookups[i].table, lookups[i].key);
+        if (a.type != b.type || memcmp(&a.data, &b.data, sizeof(a.data)) != 0)
+        {
+            fprintf(stderr, "mismatch for key \"%s\"\n", lookups[i].key);
+            return 1;
+        }
+    }
+
+    double n = (double)lookup_count * ROUNDS;
+    printf("linear:  %8.1f ns/lookup\n", linear_s / n * 1e9);
+    printf("indexed: %8.1f ns/lookup (%.1fx)\n", indexed_s / n * 1e9, linear_s / indexed_s);
+
+    // the same document in an arena
+    json_value arena_root;
+    JsonArena* arena;
+    size_t base = heap_current;
+    heap_peak = heap_current;
+    heap_calls = 0;
+    t0 = now_seconds();
+    if (!parse_json_string_arena(text, &arena_root, NULL, &arena))
+    {
+        fprintf(stderr, "can't parse %s into an arena\n", path);
+        return 1;
+    }
+    double arena_parse_s = now_seconds() - t0;
+    size_t arena_peak = heap_peak - base;
+    size_t arena_calls = heap_calls;
+
+    if (!json_equal(root, arena_root))
+    {
+        fprintf(stderr, "arena tree differs\n");
+        return 1;
+    }
+
+    heap_calls = 0;
+    t0 = now_seconds();
+    free_json_arena(arena);
+    double arena_free_s = now_seconds() - t0;
+    size_t arena_free_calls = heap_calls;
+
+    heap_calls = 0;
+    t0 = now_seconds();
+    free_json_data(root);
+    double free_s = now_seconds() - t0;
+    size_t free_calls = heap_calls;
+
+    printf(
+        "heap:  decode %7.2f ms, %8zu heap calls, peak %6zu KB; free %6.2f ms, %8zu heap calls\n",
+        parse_s * 1000, parse_calls, parse_peak / 1024, free_s * 1000, free_calls
+    );
+    printf(
+        "arena: decode %7.2f ms, %8zu heap calls, peak %6zu KB; free %6.2f ms, %8zu heap calls\n",
+        arena_parse_s * 1000, arena_calls, arena_peak / 1024, arena_free_s * 1000,
+        arena_free_calls
+    );
+    free(lookups);
+    lookups = NULL;
+    lookup_capacity = 0;
+
+    // any further arguments are keep-paths for a filtered decode
+    if (argc > 2)
+    {
+        const char** keep = calloc(argc - 1, sizeof(char*));
+        memcpy(keep, argv + 2, (argc - 2) * sizeof(char*));
+
+        heap_peak = heap_current;
+        t0 = now_seconds();
+        if (!parse_json_string_filtered(text, &root, keep))
+        {
+            fprintf(stderr, "can't parse %s\n", path);
+            return 1;
+        }
+        double filtered_s = now_seconds() - t0;
+
+        table_count = indexed_count = lookup_count = 0;
+        collect_lookups(root);
+        printf(
+            "filtered: %zu tables, parsed in %.2f ms, peak heap %zu KB\n", table_count,
+            filtered_s * 1000, heap_peak / 1024
+        );
+
+        free_json_data(root);
+        free(lookups);
+        free(keep);
+    }
+
+    free(text);
+    return sink == 0xFFFFFFFF;
+}
@@ -3,16 +3,27 @@
 Compress a Game Boy ROM into .gbz format.
 
 Output format:
-  [0:8]   Magic number: b'CRBKGBgz'
-  [8]     Compression scheme version: 1
+  [0:8]   Magic number: b'CB\\x00\\xFFGBgz'
+  [8]     Compression scheme version: 2 (or 1 with --v1)
   [9]     1 if original extension was .gbc, else 0
   [10:14]    CRC32 of original ROM (big-endian)
   [14:18]    Decompressed ROM size in bytes (little-endian uint32)
   [18:46]    ROM header bytes 0x134–0x14F (title + cartridge info, no Nintendo logo)
   [46:0x150] 0xFF padding
+
+Version 2 (default): each 16 KiB bank is compressed on its own, so the
+emulator can decode banks lazily.
+  [0x150:]   Block index: bank_count + 1 little-endian uint32 file offsets;
+             bank i's block spans [index[i], index[i+1]).
+  [...]      Blocks: raw LZ4 block data, or the bank stored as-is if it
+             doesn't compress (block size == bank size).
+
+Version 1:
   [0x150:]   gzip-compressed ROM data
-  
-Note: final 4 bytes of gzip data indicate size of decompressed rom.
+  Note: final 4 bytes of gzip data indicate size of decompressed rom.
+
+Uses the `lz4` package if installed (better ratio); otherwise a simple
+built-in LZ4 block compressor.
 """
 
 import sys
@@ -23,17 +34,112 @@ import zlib
 import struct
 
 MAGIC = b'CB\x00\xFFGBgz'
-VERSION = 1
 HEADER_START = 0x134  # not including logo
 HEADER_END = 0x14F    # inclusive
 GZ_OFFSET = 0x150
+INDEX_OFFSET = 0x150
+BANK_SIZE = 0x4000
+
+try:
+    import lz4.block as lz4_block
+except ImportError:
+    lz4_block = None
+
+
+def _lz4_write_length(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def _lz4_write_sequence(out, literals, offset=None, match_len=0):
+    lit = len(literals)
+    ml = match_len - 4
+    token = min(lit, 15) << 4
+    if offset is not None:
+        token |= min(ml, 15)
+    out.append(token)
+    if lit >= 15:
+        _lz4_write_length(out, lit - 15)
+    out += literals
+    if offset is not None:
+        out += struct.pack('<H', offset)
+        if ml >= 15:
+            _lz4_write_length(out, ml - 15)
+
+
+def lz4_compress_block(src):
+    """Greedy LZ4 block compressor (no frame, no size prefix)."""
+    if lz4_block is not None:
+        return lz4_block.compress(src, mode='high_compression', store_size=False)
+
+    n = len(src)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    # LZ4 rules: the last match starts >= 12 bytes before the end,
+    # and the last 5 bytes are always literals.
+    match_start_limit = n - 12
+    match_end_limit = n - 5
+    while i < match_start_limit:
+        key = src[i:i + 4]
+        candidate = table.get(key)
+        table[key] = i
+        if candidate is None or i - candidate > 0xFFFF:
+            i += 1
+            continue
+
+        match_len = 4
+        while i + match_len < match_end_limit and src[candidate + match_len] == src[i + match_len]:
+            match_len += 1
+
+        _lz4_write_sequence(out, src[anchor:i], i - candidate, match_len)
+        i += match_len
+        anchor = i
+
+    _lz4_write_sequence(out, src[anchor:])
+    return bytes(out)
+
+
+def compress_v1(rom_path):
+    gz_path = rom_path.with_suffix(rom_path.suffix + '.gz')
+    try:
+        subprocess.run(['gzip', '-k', str(rom_path)], check=True)
+        with open(gz_path, 'rb') as f:
+            return f.read()
+    finally:
+        if gz_path.exists():
+            gz_path.unlink()
+
+
+def compress_v2(rom_data):
+    bank_count = (len(rom_data) + BANK_SIZE - 1) // BANK_SIZE
+    offset = INDEX_OFFSET + 4 * (bank_count + 1)
+    index = []
+    blocks = []
+    for i in range(bank_count):
+        bank = rom_data[i * BANK_SIZE:(i + 1) * BANK_SIZE]
+        block = lz4_compress_block(bank)
+        if len(block) >= len(bank):
+            block = bank  # stored
+        index.append(offset)
+        blocks.append(block)
+        offset += len(block)
+    index.append(offset)
+    return b''.join(struct.pack('<I', o) for o in index) + b''.join(blocks)
+
 
 def main():
-    if len(sys.argv) != 2:
-        print(f"Usage: {sys.argv[0]} <rom.gb|rom.gbc>", file=sys.stderr)
+    args = [a for a in sys.argv[1:] if a != '--v1']
+    version = 1 if '--v1' in sys.argv[1:] else 2
+
+    if len(args) != 1:
+        print(f"Usage: {sys.argv[0]} [--v1] <rom.gb|rom.gbc>", file=sys.stderr)
         sys.exit(1)
 
-    rom_path = pathlib.Path(sys.argv[1])
+    rom_path = pathlib.Path(args[0])
     if not rom_path.exists():
         print(f"Error: file not found: {rom_path}", file=sys.stderr)
         sys.exit(1)
@@ -57,21 +163,15 @@ def main():
         print(f"Error: ROM file too small to contain header (got {len(header)} bytes from 0x{HEADER_START:x})", file=sys.stderr)
         sys.exit(1)
 
-    del rom_data  # free memory before compression
-
-    # Compress ROM with gzip
-    gz_path = rom_path.with_suffix(rom_path.suffix + '.gz')
-    try:
-        subprocess.run(['gzip', '-k', str(rom_path)], check=True)
-        with open(gz_path, 'rb') as f:
-            compressed = f.read()
-    finally:
-        if gz_path.exists():
-            gz_path.unlink()
+    if version == 2:
+        compressed = compress_v2(rom_data)
+    else:
+        del rom_data  # free memory before compression
+        compressed = compress_v1(rom_path)
 
     # Write output
     original_size = rom_path.stat().st_size
-    header_section = (MAGIC + bytes([VERSION, is_gbc])
+    header_section = (MAGIC + bytes([version, is_gbc])
                       + struct.pack('>I', crc)
                       + struct.pack('<I', original_size)
                       + header)
@@ -85,7 +185,7 @@ def main():
 
     compressed_size = out_path.stat().st_size
     ratio = compressed_size / original_size * 100
-    print(f"Written: {out_path}  ({original_size:,} → {compressed_size:,} bytes, {ratio:.1f}%)")
+    print(f"Written: {out_path}  v{version}  ({original_size:,} → {compressed_size:,} bytes, {ratio:.1f}%)")
 
 if __name__ == '__main__':
     main()
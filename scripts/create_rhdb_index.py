@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+Compile the romhack database (rhdb.json, optionally gzipped) into the binary
+index the patch download scene reads, so that opening the patch browser for
+a game only reads that game's records instead of parsing the whole database.
+
+Usage: create_rhdb_index.py [rhdb.json[.gz]] [output.bin]
+Defaults: scripts/rhdb.json.gz -> Source/db/rhdb.bin
+
+rhdb.json has these keys:
+  domain, prefix   where patch files are downloaded from
+  lookup           ROM header title -> game key
+  g2h              game key -> list of hack keys
+  hacks            hack key -> {title, author, reldate, rominfo, description, filekey}
+  fs               'z' + filekey -> file tree ({name: size or subtree})
+"""
+
+import gzip
+import json
+import os
+import re
+import struct
+import sys
+import zlib
+
+SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
+PROJECT_ROOT = os.path.dirname(SCRIPT_DIR)
+RHDB_MAGIC = b'CBRH'
+RHDB_VERSION = 1
+
+# Binary romhack index (db/rhdb.bin), all integers little-endian:
+#   [0:4]     magic b'CBRH'
+#   [4:8]     version
+#   [8:16]    title count, title table offset
+#   [16:24]   rom count, rom table offset
+#   [24:32]   game count, game table offset
+#   [32:36]   game hack list offset
+#   [36:44]   hack count, hack table offset
+#   [44:48]   domain (string pool offset)
+#   [48:52]   prefix (string pool offset)
+#   [52:56]   file offset of the string pool
+#
+#   title table, sorted by CRC32 of the ROM header title:
+#     uint32 title crc, uint32 title (pool offset), uint32 game index
+#   rom table, sorted by the base ROM CRC32s named in each hack's rominfo:
+#     uint32 rom crc, uint32 hack index
+#   game table: uint32 first, uint32 count; a range of the game hack list
+#   game hack list: uint32 hack indices, ascending
+#   hack table, sorted by hack key:
+#     uint32 key, uint32 title, uint32 author, uint32 reldate (pool offsets),
+#     uint32 blob offset, uint32 blob size, uint32 unpacked blob size
+#   hack blobs, raw deflate (or stored, if the two sizes are equal):
+#     NUL-terminated (empty if null) filekey, title, author, reldate, rominfo and description,
+#     then the file tree: uint16 entry count, then per entry a NUL-terminated
+#     name, a uint8 kind (0 file, 1 directory) and either a uint32 file size
+#     or the directory's own tree
+#   string pool: NUL-terminated UTF-8, identical strings shared
+
+HEADER_SIZE = 56
+HACK_FIELDS = ('filekey', 'title', 'author', 'reldate', 'rominfo', 'description')
+CRC32_RE = re.compile(r'CRC32:\s*([0-9a-fA-F]{8})')
+
+
+def load_rhdb(path):
+    opener = gzip.open if path.endswith('.gz') else open
+    with opener(path, 'rt', encoding='utf-8') as f:
+        return json.load(f)
+
+
+def text(hack, field):
+    # missing and null fields are stored as empty strings
+    value = hack.get(field)
+    return '' if value is None else str(value)
+
+
+def deflate(data):
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -15)
+    packed = compressor.compress(data) + compressor.flush()
+    return packed if len(packed) < len(data) else data
+
+
+def encode_tree(tree):
+    out = bytearray(struct.pack('<H', len(tree)))
+    for name, value in tree.items():
+        out += name.encode('utf-8') + b'\0'
+        if isinstance(value, dict):
+            out.append(1)
+            out += encode_tree(value)
+        else:
+            out.append(0)
+            out += struct.pack('<I', value if isinstance(value, int) else 0xFFFFFFFF)
+    return out
+
+
+def write_rhdb_index(rhdb, file_path):
+    pool = bytearray()
+    pool_offsets = {}
+
+    def intern(string):
+        if string not in pool_offsets:
+            pool_offsets[string] = len(pool)
+            pool.extend(string.encode('utf-8') + b'\0')
+        return pool_offsets[string]
+
+    hack_keys = sorted(int(k) for k in rhdb['hacks'])
+    hack_index = {key: i for i, key in enumerate(hack_keys)}
+
+    # games, in order of first appearance in the title lookup
+    game_keys = []
+    game_index = {}
+    titles = []
+    for title, game_key in rhdb['lookup'].items():
+        if game_key not in game_index:
+            game_index[game_key] = len(game_keys)
+            game_keys.append(game_key)
+        crc = zlib.crc32(title.encode('utf-8')) & 0xFFFFFFFF
+        titles.append((crc, intern(title), game_index[game_key]))
+    titles.sort()
+
+    game_table = bytearray()
+    game_list = bytearray()
+    list_count = 0
+    for game_key in game_keys:
+        hacks = sorted(
+            hack_index[h] for h in rhdb['g2h'].get(game_key, []) if h in hack_index
+        )
+        game_table += struct.pack('<II', list_count, len(hacks))
+        game_list += struct.pack(f'<{len(hacks)}I', *hacks)
+        list_count += len(hacks)
+
+    roms = set()
+    blobs = bytearray()
+    hack_table = bytearray()
+    for i, key in enumerate(hack_keys):
+        hack = rhdb['hacks'][str(key)]
+        for crc in CRC32_RE.findall(text(hack, 'rominfo')):
+            roms.add((int(crc, 16), i))
+
+        blob = bytearray()
+        for field in HACK_FIELDS:
+            blob += text(hack, field).encode('utf-8') + b'\0'
+        blob += encode_tree(rhdb['fs'].get('z' + text(hack, 'filekey'), {}))
+
+        packed = deflate(bytes(blob))
+        hack_table += struct.pack(
+            '<IIIIIII', key, intern(text(hack, 'title')), intern(text(hack, 'author')),
+            intern(text(hack, 'reldate')), len(blobs), len(packed), len(blob)
+        )
+        blobs += packed
+
+    rom_table = b''.join(struct.pack('<II', crc, i) for crc, i in sorted(roms))
+    title_table = b''.join(struct.pack('<III', *t) for t in titles)
+
+    domain = intern(rhdb.get('domain', ''))
+    prefix = intern(rhdb.get('prefix', ''))
+
+    title_offset = HEADER_SIZE
+    rom_offset = title_offset + len(title_table)
+    game_offset = rom_offset + len(rom_table)
+    list_offset = game_offset + len(game_table)
+    hack_offset = list_offset + len(game_list)
+    blob_offset = hack_offset + len(hack_table)
+    pool_offset = blob_offset + len(blobs)
+
+    # blob offsets were relative to the first blob
+    hack_table = bytearray(hack_table)
+    for i in range(len(hack_keys)):
+        at = 28 * i + 16
+        relative = struct.unpack_from('<I', hack_table, at)[0]
+        struct.pack_into('<I', hack_table, at, blob_offset + relative)
+
+    with open(file_path, 'wb') as f:
+        f.write(RHDB_MAGIC)
+        f.write(struct.pack(
+            '<13I', RHDB_VERSION, len(titles), title_offset, len(roms), rom_offset,
+            len(game_keys), game_offset, list_offset, len(hack_keys), hack_offset,
+            domain, prefix, pool_offset
+        ))
+        f.write(title_table)
+        f.write(rom_table)
+        f.write(game_table)
+        f.write(game_list)
+        f.write(hack_table)
+        f.write(blobs)
+        f.write(pool)
+
+    return len(hack_keys), len(game_keys), pool_offset + len(pool)
+
+
+def main():
+    in_path = sys.argv[1] if len(sys.argv) > 1 else os.path.join(SCRIPT_DIR, 'rhdb.json.gz')
+    out_path = (sys.argv[2] if len(sys.argv) > 2
+                else os.path.join(PROJECT_ROOT, 'Source', 'db', 'rhdb.bin'))
+
+    try:
+        rhdb = load_rhdb(in_path)
+    except (OSError, json.JSONDecodeError) as e:
+        print(f"Error: could not read '{in_path}'. Details: {e}", file=sys.stderr)
+        sys.exit(1)
+
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    hacks, games, size = write_rhdb_index(rhdb, out_path)
+    print(f"Wrote {hacks} hacks for {games} games to '{out_path}' ({size:,} bytes).")
+
+
+if __name__ == '__main__':
+    main()
@@ -5,13 +5,24 @@ import urllib.error
 import re
 import json
 import os
-import subprocess
+import struct
 import sys
 
 SCRIPT_DIR = os.path.dirname(os.path.abspath(__file__))
 PROJECT_ROOT = os.path.dirname(SCRIPT_DIR)
-COMPRESS = True
-MASK = 0xFC
+TITLE_DB_MAGIC = b'CBTD'
+TITLE_DB_VERSION = 1
+
+# Binary title database (db/titles.bin), all integers little-endian:
+#   [0:4]     magic b'CBTD'
+#   [4:8]     version
+#   [8:12]    entry count
+#   [12:16]   file offset of the string pool
+#   [16:1044] fanout: 257 uint32 entry indices; entries whose CRC's top byte
+#             is b are [fanout[b], fanout[b + 1])
+#   [1044:]   entries, sorted by CRC: uint32 crc, uint32 short, uint32 long
+#             (short/long are offsets into the string pool)
+#   [...]     string pool: NUL-terminated UTF-8, identical strings shared
 
 def integrate_json_file(all_games_dict, filename, script_dir, data_type_name):
     """
@@ -52,12 +63,51 @@ def integrate_json_file(all_games_dict, filename, script_dir, data_type_name):
         print(f"  -> '{file_basename}' not found. Skipping integration.")
 
 
-def create_split_game_json(mask):
+def write_title_db(all_games_dict, file_path):
+    """
+    Writes all games to the binary title database (format described above),
+    which the device searches with a few small reads instead of parsing JSON.
+    """
+    entries = sorted((int(crc, 16), data) for crc, data in all_games_dict.items())
+
+    pool = bytearray()
+    pool_offsets = {}
+
+    def intern(string):
+        if string not in pool_offsets:
+            pool_offsets[string] = len(pool)
+            pool.extend(string.encode('utf-8') + b'\0')
+        return pool_offsets[string]
+
+    fanout = [0] * 257
+    for crc, _ in entries:
+        fanout[(crc >> 24) + 1] += 1
+    for i in range(256):
+        fanout[i + 1] += fanout[i]
+
+    table = bytearray()
+    for crc, data in entries:
+        short_offset = intern(data.get("short", ""))
+        long_offset = intern(data.get("long", ""))
+        table += struct.pack('<III', crc, short_offset, long_offset)
+
+    header_size = 16 + 4 * len(fanout)
+    pool_offset = header_size + len(table)
+
+    with open(file_path, 'wb') as f:
+        f.write(TITLE_DB_MAGIC)
+        f.write(struct.pack('<III', TITLE_DB_VERSION, len(entries), pool_offset))
+        f.write(struct.pack(f'<{len(fanout)}I', *fanout))
+        f.write(table)
+        f.write(pool)
+
+    return len(entries), pool_offset + len(pool)
+
+
+def create_title_db():
     """
     Downloads and processes game DAT files, integrates local homebrew and romhack JSON files,
-    and then splits the final data into n separate JSON files (00-FF)
-    based on the first two characters of the ROM CRC. Files are saved in
-    the 'Source/db/' directory.
+    and then writes them all to the binary title database 'Source/db/titles.bin'.
     """
 
     headers = {
@@ -131,22 +181,11 @@ def create_split_game_json(mask):
     integrate_json_file(all_games_dict, "romhacks.json", SCRIPT_DIR, "romhacks")
     integrate_json_file(all_games_dict, "lsdj.json", SCRIPT_DIR, "LSDj versions")
 
-    # --- FILE SPLITTING AND OUTPUT (00-FF) ---
+    # --- OUTPUT ---
 
     output_dir = os.path.join(PROJECT_ROOT, "Source", "db")
 
-    hex_chars = "0123456789ABCDEF"
-    prefixes = [f"{i}{j}" for i in hex_chars for j in hex_chars]
-
-    split_data = {prefix: {} for prefix in prefixes}
-
-    for crc, game_data in all_games_dict.items():
-        prefix = f"{(int(crc, 16) >> 24) & mask:02X}"
-        if prefix in split_data:
-            split_data[prefix][crc] = game_data
-
     print(f"\nTotal unique games found: {len(all_games_dict)}")
-    print(f"Splitting data into up to n files in '{output_dir}/'...")
 
     # remove pre-existing
     try:
@@ -167,27 +206,15 @@ def create_split_game_json(mask):
         print(f"Error: Could not create directory '{output_dir}'. Details: {e}")
         return
 
-    files_written = 0
-    for prefix, games in split_data.items():
-        if games:
-            file_path = os.path.join(output_dir, f"{prefix.lower()}.json")
-            try:
-                with open(file_path, 'w', encoding='utf-8') as json_file:
-                    json.dump(games, json_file, indent=4, ensure_ascii=False)
-                if COMPRESS:
-                    try:
-                        subprocess.run(["gzip", file_path], check=True)
-                    except Exception as e:
-                        print("ERROR: Failed to compress")
-                        sys.exit(17)
-                    if os.path.exists(file_path):
-                        os.remove(file_path)
-                files_written += 1
-            except IOError as e:
-                print(f"Error: Could not write to file '{file_path}'. Details: {e}")
-
-    print(f"  -> Wrote {files_written} files.")
+    file_path = os.path.join(output_dir, "titles.bin")
+    try:
+        count, size = write_title_db(all_games_dict, file_path)
+    except IOError as e:
+        print(f"Error: Could not write to file '{file_path}'. Details: {e}")
+        sys.exit(17)
+
+    print(f"  -> Wrote {count} games to '{file_path}' ({size:,} bytes).")
     print("\nScript finished successfully.")
 
 if __name__ == "__main__":
-    create_split_game_json(MASK)
+    create_title_db()
@@ -14,18 +14,28 @@ Features:
   - Progress bar for non-verbose mode
   - Optional restart after transfer
   - Artificial packet drop testing (--drop-rate option)
+  - Packed (base85) chunks with a larger window when the device supports them
+    (--mode option; "both" transfers twice and compares KB/s)
+  - Optional write-behind (--write-behind): the device ACKs chunks before
+    writing them, and only ft:o means the file is saved
 
 Protocol:
-  ft:b:<filename>:<size>:<crc32>[:<orig_name>:<orig_crc>]  - Begin transfer
+  ft:b:<filename>:<size>:<crc32>[:<orig_name>:<orig_crc>][:<flags>]
+                                                           - Begin transfer
   ft:c:<seq>:<crc16>:<base64>                             - Send chunk
+  ft:p:<seq>:<crc16>:<base85>                             - Send packed chunk
   ft:e:<crc32>                                            - End transfer
   ft:s                                                      - Query status
   cb:restart                                               - Restart CrankBoy
 
 Device responses:
-  ft:r:<code>          - Ready (format: WWCC hex, WW=window, CC=chunk)
+  ft:r:<code>          - Ready (format: [PWPCFF]WWCC hex, WW=window, CC=chunk)
                          Example: ft:r:08B1 = window=8, chunk=177
-  ft:a:<seq>           - Cumulative ACK (acknowledges chunks 0 through seq)
+                         Newer devices prefix capability flags FF, packed chunk
+                         size PC and packed window PW, e.g. ft:r:20BC0110B1
+                         FF includes FT_CAP_WRITE_BEHIND if ft:b asked for it
+  ft:a:<seq>           - Cumulative ACK (acknowledges chunks 0 through seq;
+                         they are written on the device, unless write-behind)
   ft:n:<seq>:<code>    - NACK with error code (immediate, not batched):
                          "crc" = CRC mismatch (retry same chunk)
                          "seq" = wrong sequence (resync to seq)
@@ -51,6 +61,12 @@ Window Protocol:
   - NACKs are sent immediately on CRC/sequence errors (resets batch size to 3)
   - Default window size: 8 (configurable on device via FT_WINDOW_SIZE define)
 
+Packed Chunks:
+  - Serial messages are text lines split on ' ' and ':', so chunks can't be
+    raw binary. ft:p sends them as base85 (RFC 1924 alphabet, no separators),
+    fitting 188 bytes where base64 fits 177, with the device's larger window
+  - Used when the device sets FT_CAP_PACKED in ft:r; older devices get ft:c
+
 Testing:
   --drop-rate N        - Artificially drop N%% of packets to test error recovery
 """
@@ -71,11 +87,16 @@ import random
 SERIAL_PORT = "/dev/cu.usbmodemPDU1_Y0096921"
 BAUD_RATE = 115200
 TIMEOUT = 5
-# Note: Chunk size is fixed at 177 bytes (0xB1) by the device protocol
+# Note: Chunk size is advertised by the device (177 bytes for base64 chunks)
+FT_CAP_PACKED = 0x01
+FT_CAP_WRITE_BEHIND = 0x02
 
 # Global verbose flag
 VERBOSE = False
 
+# Whether chunks go out as ft:p (base85) rather than ft:c (base64)
+PACKED = False
+
 
 def calculate_crc32(filepath):
     """Calculate CRC32 of a file."""
@@ -219,30 +240,37 @@ def wait_for_response(ser, expected_cmd, timeout=TIMEOUT):
     return None, None
 
 
-def send_begin(ser, filename, filesize, file_crc, original_filename=None, original_crc=None):
+def send_begin(ser, filename, filesize, file_crc, original_filename=None, original_crc=None,
+               flags=0):
     """Send ft:b (begin) command."""
     encoded_filename = urllib.parse.quote(filename, safe='')
     # Size is decimal, CRC is hex (without leading zeros)
     crc_hex = f"{file_crc:08X}"
+    # Capability flags the host asks for; older devices ignore them
+    flags_suffix = f":{flags:X}" if flags else ""
 
     # Include original filename and CRC if provided (for GBZ files)
     if original_filename and original_crc is not None:
         encoded_original = urllib.parse.quote(original_filename, safe='')
         original_crc_hex = f"{original_crc:08X}"
-        send_command(ser, f"ft:b:{encoded_filename}:{filesize}:{crc_hex}:{encoded_original}:{original_crc_hex}")
+        send_command(ser, f"ft:b:{encoded_filename}:{filesize}:{crc_hex}:{encoded_original}:{original_crc_hex}{flags_suffix}")
     else:
-        send_command(ser, f"ft:b:{encoded_filename}:{filesize}:{crc_hex}")
+        send_command(ser, f"ft:b:{encoded_filename}:{filesize}:{crc_hex}{flags_suffix}")
 
 
 def send_chunk(ser, seq, chunk_data):
-    """Send ft:c (chunk) command with CRC16 verification."""
+    """Send ft:c (chunk) or ft:p (packed chunk) command with CRC16 verification."""
     seq_hex = f"{seq:04X}"
     # Calculate CRC32 and use lower 16 bits
     crc32 = zlib.crc32(chunk_data) & 0xFFFFFFFF
     crc16 = crc32 & 0xFFFF
     crc16_hex = f"{crc16:04X}"
-    b64_data = base64.b64encode(chunk_data).decode('ascii')
-    send_command(ser, f"ft:c:{seq_hex}:{crc16_hex}:{b64_data}")
+    if PACKED:
+        b85_data = base64.b85encode(chunk_data).decode('ascii')
+        send_command(ser, f"ft:p:{seq_hex}:{crc16_hex}:{b85_data}")
+    else:
+        b64_data = base64.b64encode(chunk_data).decode('ascii')
+        send_command(ser, f"ft:c:{seq_hex}:{crc16_hex}:{b64_data}")
 
 
 def send_end(ser, file_crc):
@@ -296,10 +324,19 @@ def parse_nack(params):
     return None, "unknown"
 
 
-def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop_rate=0):
-    """Transfer a single file to CrankBoy."""
-    global VERBOSE
+def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop_rate=0, mode="auto",
+                  write_behind=False):
+    """Transfer a single file to CrankBoy.
+
+    mode is "auto" (packed chunks if the device supports them), "base64" or
+    "base85". write_behind asks the device to ACK chunks before writing them.
+    Returns the transfer rate in KB/s, or None on failure.
+    """
+    global VERBOSE, PACKED
     VERBOSE = verbose
+    PACKED = False
+    flags = FT_CAP_WRITE_BEHIND if write_behind else 0
+    write_behind = False  # until the device grants it
 
     # Get original file info
     filename = os.path.basename(filepath)
@@ -360,7 +397,7 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
         ser = serial.Serial(port, BAUD_RATE, timeout=TIMEOUT)
     except serial.SerialException as e:
         print(f"ERROR: Could not open serial port: {e}")
-        return False
+        return None
 
     ser.reset_input_buffer()
     ser.reset_output_buffer()
@@ -370,30 +407,45 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
         print("\n[Phase 1: Initiating transfer...]")
     # Only pass original filename/CRC if we compressed the file (not for user-provided GBZ)
     if is_user_gbz:
-        send_begin(ser, gbz_filename, gbz_size, gbz_crc)
+        send_begin(ser, gbz_filename, gbz_size, gbz_crc, flags=flags)
     else:
-        send_begin(ser, gbz_filename, gbz_size, gbz_crc, original_filename, original_crc)
+        send_begin(ser, gbz_filename, gbz_size, gbz_crc, original_filename, original_crc,
+                   flags=flags)
 
     cmd, params = wait_for_response(ser, "r", timeout=5)
     if cmd != "r":
         print("ERROR: Did not receive ready response")
         ser.close()
-        return False
+        return None
 
-    # Parse window size and chunk size from 4-digit hex (format: WWCC)
+    # Parse window size and chunk size from hex (format: [PWPCFF]WWCC)
     # WW = window size (2 hex digits), CC = chunk size (2 hex digits)
+    # FF = capability flags, PC/PW = packed chunk size/window (newer devices only)
     try:
         ready_code = int(params, 16)
         window_size = (ready_code >> 8) & 0xFF  # High byte
         chunk_size = ready_code & 0xFF          # Low byte
+        caps = (ready_code >> 16) & 0xFF
+        if caps & FT_CAP_PACKED and mode != "base64":
+            PACKED = True
+            chunk_size = (ready_code >> 24) & 0xFF
+            window_size = (ready_code >> 32) & 0xFF
+        write_behind = bool(caps & FT_CAP_WRITE_BEHIND)
         if VERBOSE:
             print(f"  Device ready, window size: {window_size}, chunk size: {chunk_size} bytes")
+            if flags and not write_behind:
+                print("  Device does not support write-behind; ACKs wait for the writes")
     except ValueError:
         window_size = 4
         chunk_size = 177
         if VERBOSE:
             print(f"  Using defaults, window size: {window_size}, chunk size: {chunk_size}")
 
+    if mode == "base85" and not PACKED:
+        print("ERROR: Device does not support packed (base85) chunks")
+        ser.close()
+        return None
+
     # Transfer chunks with window-based pipelining
     if VERBOSE:
         print(f"\n[Phase 2: Transferring data (window size: {window_size})...]")
@@ -532,7 +584,7 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
                         else:
                             print(f"ERROR: Max retries exceeded for chunk {seq:04X}")
                             ser.close()
-                            return False
+                            return None
                 else:
                     # Repeated timeouts - use selective retransmit with status query
                     send_status(ser)
@@ -588,7 +640,7 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
                                 else:
                                     print(f"ERROR: Max retries exceeded for chunk {seq:04X}")
                                     ser.close()
-                                    return False
+                                    return None
                     else:
                         # Status query failed, fall back to retransmitting all timed out chunks
                         for seq, info in timeouts:
@@ -601,7 +653,7 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
                             else:
                                 print(f"ERROR: Max retries exceeded for chunk {seq:04X}")
                                 ser.close()
-                                return False
+                                return None
         else:
             # Window empty but not done - send more
             time.sleep(0.01)
@@ -638,13 +690,17 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
     if cmd != "o":
         print("ERROR: Transfer did not complete successfully")
         ser.close()
-        return False
+        return None
 
     # Get the filename from OK response (may be different for GBZ -> decompressed)
     # Device now sends decoded filename, so we use it as-is to detect any issues
     saved_filename = params if params else (original_filename if not is_user_gbz else gbz_filename)
 
     elapsed = time.time() - start_time
+    rate = bytes_sent / elapsed / 1024 if elapsed > 0 else 0
+    framing = "base85" if PACKED else "base64"
+    if write_behind:
+        framing += ", write-behind"
     print(f"\n{'='*60}")
     print("SUCCESS!")
     if VERBOSE:
@@ -654,7 +710,7 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
             compression_saved = original_size - bytes_sent
             print(f"Transferred {bytes_sent} bytes (compressed from {original_size} bytes)")
             print(f"Saved {compression_saved} bytes ({compression_ratio:.1f}% reduction)")
-        print(f"Time: {elapsed:.1f}s, Speed: {bytes_sent/elapsed/1024:.1f} KB/s")
+        print(f"Time: {elapsed:.1f}s, Speed: {rate:.1f} KB/s ({framing})")
     else:
         if is_user_gbz:
             print(f"Transferred: {saved_filename} (kept as GBZ)")
@@ -662,6 +718,7 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
             print(f"Transferred and decompressed: {saved_filename}")
         else:
             print(f"Transferred: {saved_filename}")
+        print(f"Speed: {rate:.1f} KB/s ({framing})")
     print(f"{'='*60}\n")
 
     # Restart CrankBoy if requested
@@ -673,10 +730,10 @@ def transfer_file(filepath, port=SERIAL_PORT, verbose=False, restart=False, drop
         send_restart(ser)
         # Device will restart, no response expected
         ser.close()
-        return True
+        return rate
 
     ser.close()
-    return True
+    return rate
 
 
 def main():
@@ -690,6 +747,12 @@ def main():
     parser.add_argument("-v", "--verbose", action="store_true", help="Enable verbose output")
     parser.add_argument("--restart", action="store_true", help="Restart CrankBoy after successful transfer")
     parser.add_argument("--drop-rate", type=int, default=0, help="Artificial packet drop rate %% for testing (0-100)")
+    parser.add_argument("--mode", choices=["auto", "base64", "base85", "both"], default="auto",
+                        help="Chunk framing (default: auto, base85 if the device supports it); "
+                             "'both' transfers once in each mode and compares KB/s")
+    parser.add_argument("--write-behind", action="store_true",
+                        help="Let the device ACK chunks before writing them (faster; only the "
+                             "final OK means the file is saved)")
 
     args = parser.parse_args()
 
@@ -708,8 +771,22 @@ def main():
         if response.lower() != 'y':
             sys.exit(1)
 
-    success = transfer_file(args.file, args.port, verbose=args.verbose, restart=args.restart, drop_rate=args.drop_rate)
-    sys.exit(0 if success else 1)
+    if args.mode == "both":
+        rates = {}
+        for mode in ("base64", "base85"):
+            rates[mode] = transfer_file(args.file, args.port, verbose=args.verbose,
+                                        restart=args.restart and mode == "base85",
+                                        drop_rate=args.drop_rate, mode=mode,
+                                        write_behind=args.write_behind)
+            if rates[mode] is None:
+                sys.exit(1)
+        print(f"base64: {rates['base64']:.1f} KB/s")
+        print(f"base85: {rates['base85']:.1f} KB/s ({rates['base85'] / rates['base64']:.2f}x)")
+        sys.exit(0)
+
+    rate = transfer_file(args.file, args.port, verbose=args.verbose, restart=args.restart,
+                         drop_rate=args.drop_rate, mode=args.mode, write_behind=args.write_behind)
+    sys.exit(0 if rate is not None else 1)
 
 
 if __name__ == "__main__":
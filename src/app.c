@@ -9,8 +9,12 @@
 #include "app.h"
 
 #include "../libs/pdnewlib/pdnewlib.h"  // IWYU pragma: keep
+#include "bx.h"
+#include "cover_atlas.h"
 #include "dtcm.h"
+#include "ft.h"
 #include "global.h"
+#include "http_sched.h"
 #include "jparse.h"
 #include "preferences.h"
 #include "scenes/file_copying_scene.h"
@@ -471,8 +475,7 @@ static void non_bundle_init(void)
     cb_draw_logo_screen_and_display(CB_App->subheadFont, "Initializing...");
     get_homebrew_hub_api();
 
-    CB_App->rhdb_present =
-        cb_file_exists_maybe_compressed(ROMHACK_DB_FILE, kFileReadData | kFileRead);
+    CB_App->rhdb_present = cb_file_exists(ROMHACK_DB_FILE, kFileReadData | kFileRead);
 
     global.shown_intro = true;
     save_global();
@@ -554,7 +557,7 @@ void CB_init(void)
 
     CB_App->gameNameCache = array_new();
     CB_App->gameListCache = array_new();
-    CB_App->coverCache = NULL;
+    CB_App->coverAtlas = NULL;
     CB_App->gameListCacheIsSorted = false;
     CB_App->scene = NULL;
 
@@ -734,6 +737,13 @@ __section__(".text.main") void CB_update(float dt)
     CB_App->buttons_suppress &= CB_App->buttons_down;
     CB_App->buttons_down &= ~CB_App->buttons_suppress;
 
+    ft_update();
+    bx_update();
+
+    // on the main stack, as they may open connections
+    http_update();
+    http_sched_update();
+
     if (CB_App->scene)
     {
         void* managedObject = CB_App->scene->managedObject;
@@ -928,17 +938,10 @@ void CB_quit(void)
         CB_App->gameListCache = NULL;
     }
 
-    if (CB_App->coverCache)
+    if (CB_App->coverAtlas)
     {
-        for (int i = 0; i < CB_App->coverCache->length; i++)
-        {
-            CB_CoverCacheEntry* entry = CB_App->coverCache->items[i];
-            cb_free(entry->rom_path);
-            cb_free(entry->compressed_data);
-            cb_free(entry);
-        }
-        array_free(CB_App->coverCache);
-        CB_App->coverCache = NULL;
+        cb_cover_atlas_free(CB_App->coverAtlas);
+        CB_App->coverAtlas = NULL;
     }
 
     if (CB_App->bundled_rom)
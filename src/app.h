@@ -105,18 +105,6 @@ typedef struct
     char* rom_path;
 } CB_GlobalCoverCache;
 
-typedef struct
-{
-    char* rom_path;
-    void* compressed_data;
-    int compressed_size;
-    int original_size;
-    int width;
-    int height;
-    int rowbytes;
-    bool has_mask;
-} CB_CoverCacheEntry;
-
 typedef struct CB_Application
 {
     float dt;
@@ -136,7 +124,7 @@ typedef struct CB_Application
     SoundSource* soundSource;
     CB_GlobalCoverCache coverArtCache;
     CB_Array* gameNameCache;
-    CB_Array* coverCache;
+    struct CB_CoverAtlas* coverAtlas;
     CB_Array* gameListCache;
     bool gameListCacheIsSorted;
     bool rhdb_present;
@@ -237,6 +225,7 @@ const char* get_pdboot_name_and_version(void);
 #define SAVE_SLOT_COUNT 10
 #define SAVE_STATE_THUMBNAIL_W 160
 #define SAVE_STATE_THUMBNAIL_H 144
+#define SAVE_STATE_THUMBNAIL_BYTES (SAVE_STATE_THUMBNAIL_H * ((SAVE_STATE_THUMBNAIL_W + 7) / 8))
 
 // indicates sram file version.
 // If not present at end of file, it's an old version or from another emulator.
@@ -254,7 +243,7 @@ const char* get_pdboot_name_and_version(void);
 #define PATCH_LIST_FILE "manifest.json"
 #define VERSION_INFO_FILE "version.json"
 #define BUNDLE_FILE "bundle.json"
-#define ROMHACK_DB_FILE "rhdb.json"
+#define ROMHACK_DB_FILE "db/rhdb.bin"
 #define DIRECTORY_POINTER "directory.txt"
 #define GLOBAL_FILE "global.json"
 #define LAST_SELECTED_FILE "library_last_selected.txt"
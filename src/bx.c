@@ -0,0 +1,481 @@
+//
+//  bx.c
+//  CrankBoy
+//
+//  Bulk Export Protocol (bx) implementation
+//
+
+#include "bx.h"
+
+#include "array.h"
+#include "crc32.h"
+#include "utility.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ============================================================================
+ * Bulk Export Protocol (bx) - ft in the other direction, for backups
+ * ============================================================================
+ *
+ * Protocol Specification:
+ *
+ * Host Commands (→ Device):
+ *   bx:l:<dir>[:<dir>...]   - List every file below the directories (up to 6)
+ *   bx:o:<path>:<offset>    - Open a file and stream it from <offset> (decimal)
+ *   bx:a:<seq>              - Cumulative ACK (chunks 0 through seq received)
+ *   bx:r:<seq>              - Resend from seq (chunks before it received)
+ *   bx:c                    - Close the file being streamed
+ *
+ * Device Responses (← Host):
+ *   bx:i:<size>:<path>      One per file found by bx:l; size is decimal, path
+ *                           is relative to the data directory, as given
+ *   bx:omit                 A file whose path won't fit in a 256B line
+ *   bx:k:<count>            End of the listing; count includes omitted files
+ *   bx:h:<size>:<WWCC>      Header for bx:o: the whole file's size, WW =
+ *                           window, CC = chunk size. Example: bx:h:32768:20BC
+ *   bx:d:<seq>:<crc16>:<base85>
+ *                           Chunk; seq counts from <offset>, so chunk n holds
+ *                           the bytes at offset + n * CC. crc16 is the lower
+ *                           16 bits of the chunk's CRC32, base85 as in ft:p
+ *   bx:t:<crc32>            Trailer: the whole file's CRC32 (not just the part
+ *                           after <offset>), sent after the last chunk each
+ *                           time it is sent
+ *   bx:x:<code>             Error with code:
+ *                           - "filename" = invalid path
+ *                           - "offset" = invalid offset
+ *                           - "notfound" = no such file
+ *                           - "io" = read error
+ *                           - "nomem" = out of memory
+ *
+ * Window-Based Pipelining:
+ *   The roles are the reverse of ft's: after bx:h the device sends up to
+ *   BX_WINDOW_SIZE chunks beyond the last one acknowledged, a few per frame
+ *   (bx_update), and the host sends cumulative ACKs. Rather than buffering,
+ *   the device goes back to the first unacknowledged chunk (go-back-N) when
+ *   the host sends bx:r, e.g. after a bad CRC or a gap, and when no ACK has
+ *   come for BX_RESEND_MS. The file is closed once its last chunk is
+ *   acknowledged, on bx:c, or when another file is opened. A host should
+ *   hold back that last ACK until it has the trailer; bx:r for the last
+ *   chunk sends both again.
+ *
+ * File CRC:
+ *   The CRC32 in bx:t is folded in as each chunk is first read, so the file
+ *   is only read once. The bytes before <offset> are read for it first, one
+ *   BX_HASH_BLOCK_SIZE block per frame, before chunk 0 goes out.
+ *
+ * Resuming:
+ *   A host that already holds the first N bytes of a file (from an earlier,
+ *   interrupted backup) opens it at offset N, and checks the result against
+ *   the CRC32 in bx:t; on a mismatch it starts over from 0. Opening at
+ *   offset == size only returns the header and the trailer (once the whole
+ *   file is read), so a host can also tell whether its copy is current
+ *   without transferring anything.
+ */
+
+// Export context
+static struct
+{
+    SDFile* file;
+    uint32_t offset;       // where chunk 0 starts
+    uint32_t length;       // bytes from offset to the end of the file
+    uint32_t chunk_count;  // chunks in length
+    uint32_t acked;        // chunks the host has acknowledged (all below this)
+    uint32_t next_seq;     // next chunk to send
+    uint32_t sent_seq;     // chunks sent at least once (all below this), for late ACKs
+    uint32_t read_seq;     // chunk the file position is at
+    unsigned last_progress_ms;
+
+    CB_CRC32 crc;          // of the bytes before offset, then of each chunk as first sent
+    uint32_t hashed;       // bytes before offset in crc so far
+    uint8_t* hash_buffer;  // while hashed < offset
+} bx_ctx;
+
+// Clean up export context
+void bx_cleanup(void)
+{
+    if (bx_ctx.file)
+    {
+        playdate->file->close(bx_ctx.file);
+        bx_ctx.file = NULL;
+    }
+    bx_ctx.offset = 0;
+    bx_ctx.length = 0;
+    bx_ctx.chunk_count = 0;
+    bx_ctx.acked = 0;
+    bx_ctx.next_seq = 0;
+    bx_ctx.sent_seq = 0;
+    bx_ctx.read_seq = 0;
+    bx_ctx.hashed = 0;
+    if (bx_ctx.hash_buffer)
+    {
+        cb_free(bx_ctx.hash_buffer);
+        bx_ctx.hash_buffer = NULL;
+    }
+}
+
+// ============================================================================
+// Listing
+// ============================================================================
+
+typedef struct
+{
+    CB_Array* names;
+    bool oom;
+} BxListCtx;
+
+static void bx_list_collect(const char* filename, void* userdata)
+{
+    BxListCtx* ctx = userdata;
+    char* dup = ctx->oom ? NULL : cb_strdup(filename);
+    if (!dup)
+    {
+        ctx->oom = true;
+        return;
+    }
+    array_push(ctx->names, dup);
+}
+
+// Sends bx:i for each file below dir (which ends in '/'), depth first.
+// Returns false if out of memory.
+static bool bx_list_dir(const char* dir, int depth, int* count)
+{
+    BxListCtx ctx = {.names = array_new(), .oom = false};
+    if (!ctx.names)
+    {
+        return false;
+    }
+
+    // a directory that doesn't exist (e.g. no states yet) has nothing to back up
+    playdate->file->listfiles(dir, bx_list_collect, &ctx, 0);
+
+    // "bx:i:" and a 10-digit size and ':' are 16 chars, of a 255 char line
+    const size_t budget = 255 - 16;
+
+    bool ok = !ctx.oom;
+    for (unsigned i = 0; i < ctx.names->length; i++)
+    {
+        const char* name = ctx.names->items[i];
+        if (*name == '/')
+            name++;
+
+        char* path = ok ? aprintf("%s%s", dir, name) : NULL;
+        if (!path)
+        {
+            ok = false;
+        }
+        else if (path[0] && path[strlen(path) - 1] == '/')
+        {
+            if (depth < BX_MAX_LIST_DEPTH)
+            {
+                ok = bx_list_dir(path, depth + 1, count);
+            }
+        }
+        else
+        {
+            FileStat st;
+            if (playdate->file->stat(path, &st) == 0 && !st.isdir)
+            {
+                if (strlen(path) > budget)
+                {
+                    serial_send_response("bx:omit");
+                }
+                else
+                {
+                    serial_send_response("bx:i:%u:%s", st.size, path);
+                }
+                (*count)++;
+            }
+        }
+
+        cb_free(path);
+    }
+
+    for (unsigned i = 0; i < ctx.names->length; i++)
+    {
+        cb_free(ctx.names->items[i]);
+    }
+    array_free(ctx.names);
+    return ok;
+}
+
+// Handle bx:l command - List files for export
+// Format: bx:l:<dir>[:<dir>...] (dirs %-escaped like cb:ls paths)
+bool bx_handle_list(const char* const* dirs)
+{
+    int count = 0;
+    for (int i = 0; dirs[i]; i++)
+    {
+        char dir[256];
+        int len = url_decode(dirs[i], dir, sizeof(dir) - 1);
+        if (len < 0 || strstr(dir, "..") != NULL)
+        {
+            serial_send_response("bx:x:filename");
+            return false;
+        }
+
+        // listfiles needs the trailing slash to list the directory itself
+        if (len == 0 || dir[len - 1] != '/')
+        {
+            dir[len++] = '/';
+            dir[len] = '\0';
+        }
+
+        if (!bx_list_dir(dir, 0, &count))
+        {
+            serial_send_response("bx:x:nomem");
+            return false;
+        }
+    }
+
+    serial_send_response("bx:k:%d", count);
+    return true;
+}
+
+// ============================================================================
+// Streaming
+// ============================================================================
+
+// Handle bx:o command - Open a file for export
+// Format: bx:o:<path>:<offset>
+bool bx_handle_open(const char* path_str, const char* offset_str)
+{
+    bx_cleanup();
+
+    char path[512];
+    if (url_decode(path_str, path, sizeof(path)) < 0 || strstr(path, "..") != NULL)
+    {
+        serial_send_response("bx:x:filename");
+        return false;
+    }
+
+    char* endptr = NULL;
+    unsigned long offset = strtoul(offset_str, &endptr, 10);
+    if (!endptr || *endptr != '\0')
+    {
+        serial_send_response("bx:x:offset");
+        return false;
+    }
+
+    FileStat st;
+    if (playdate->file->stat(path, &st) != 0 || st.isdir)
+    {
+        serial_send_response("bx:x:notfound");
+        return false;
+    }
+
+    if (offset > st.size)
+    {
+        serial_send_response("bx:x:offset");
+        return false;
+    }
+
+    // the bytes before offset are read from here for the CRC (bx_update),
+    // which leaves the file at offset for chunk 0
+    bx_ctx.file = playdate->file->open(path, kFileReadData);
+    if (!bx_ctx.file)
+    {
+        serial_send_response("bx:x:io");
+        return false;
+    }
+
+    if (offset > 0)
+    {
+        bx_ctx.hash_buffer = cb_malloc(BX_HASH_BLOCK_SIZE);
+        if (!bx_ctx.hash_buffer)
+        {
+            serial_send_response("bx:x:nomem");
+            bx_cleanup();
+            return false;
+        }
+    }
+
+    cb_crc32_init(&bx_ctx.crc);
+    bx_ctx.offset = offset;
+    bx_ctx.length = st.size - offset;
+    bx_ctx.chunk_count = (bx_ctx.length + BX_CHUNK_SIZE - 1) / BX_CHUNK_SIZE;
+    bx_ctx.last_progress_ms = playdate->system->getCurrentTimeMilliseconds();
+
+    serial_send_response("bx:h:%u:%02X%02X", st.size, BX_WINDOW_SIZE, BX_CHUNK_SIZE);
+    return true;
+}
+
+// Handle bx:a command - Cumulative ACK
+// Format: bx:a:<seq> (seq = 4-digit hex)
+bool bx_handle_ack(const char* seq_str)
+{
+    if (!bx_ctx.file)
+    {
+        // a late ACK for a file already closed
+        return true;
+    }
+
+    // after going back, next_seq is behind chunks the host may still be
+    // acknowledging, so check against what has ever been sent
+    uint32_t seq = (uint32_t)strtoul(seq_str, NULL, 16);
+    if (seq >= bx_ctx.sent_seq)
+    {
+        return false;
+    }
+
+    if (seq + 1 > bx_ctx.acked)
+    {
+        bx_ctx.acked = seq + 1;
+        bx_ctx.last_progress_ms = playdate->system->getCurrentTimeMilliseconds();
+    }
+    if (bx_ctx.next_seq < bx_ctx.acked)
+    {
+        bx_ctx.next_seq = bx_ctx.acked;
+    }
+
+    if (bx_ctx.acked == bx_ctx.chunk_count)
+    {
+        bx_cleanup();
+    }
+    return true;
+}
+
+// Handle bx:r command - Go back to a chunk
+// Format: bx:r:<seq> (seq = 4-digit hex)
+bool bx_handle_resend(const char* seq_str)
+{
+    if (!bx_ctx.file)
+    {
+        return false;
+    }
+
+    uint32_t seq = (uint32_t)strtoul(seq_str, NULL, 16);
+    if (seq > bx_ctx.sent_seq)
+    {
+        return false;
+    }
+
+    // everything before seq has arrived
+    if (seq > bx_ctx.acked)
+    {
+        bx_ctx.acked = seq;
+    }
+    bx_ctx.next_seq = bx_ctx.acked;
+    bx_ctx.last_progress_ms = playdate->system->getCurrentTimeMilliseconds();
+
+    if (bx_ctx.acked == bx_ctx.chunk_count)
+    {
+        bx_cleanup();
+    }
+    return true;
+}
+
+// Handle bx:c command - Stop streaming
+bool bx_handle_close(void)
+{
+    bx_cleanup();
+    return true;
+}
+
+// Reads and sends chunk seq. Returns false on a read error.
+static bool bx_send_chunk(uint32_t seq)
+{
+    uint32_t start = seq * BX_CHUNK_SIZE;
+    uint32_t length = MIN(BX_CHUNK_SIZE, bx_ctx.length - start);
+
+    if (seq != bx_ctx.read_seq &&
+        playdate->file->seek(bx_ctx.file, bx_ctx.offset + start, SEEK_SET) != 0)
+    {
+        return false;
+    }
+
+    uint8_t data[BX_CHUNK_SIZE];
+    if (playdate->file->read(bx_ctx.file, data, length) != (int)length)
+    {
+        return false;
+    }
+    bx_ctx.read_seq = seq + 1;
+
+    // chunks are first sent in order, so each is folded into the CRC once
+    if (seq == bx_ctx.sent_seq)
+    {
+        cb_crc32_update(&bx_ctx.crc, data, length);
+        bx_ctx.sent_seq++;
+    }
+
+    char text[BX_CHUNK_SIZE / 4 * 5 + 1];
+    base85_encode(data, length, text, sizeof(text));
+
+    uint16_t crc16 = (uint16_t)(cb_crc32(data, length) & 0xFFFF);
+    serial_send_response("bx:d:%04X:%04X:%s", seq, crc16, text);
+    return true;
+}
+
+// Folds the next block of the bytes before offset into the CRC. Returns
+// false on a read error.
+static bool bx_hash_prefix(void)
+{
+    uint32_t length = MIN(BX_HASH_BLOCK_SIZE, bx_ctx.offset - bx_ctx.hashed);
+    if (playdate->file->read(bx_ctx.file, bx_ctx.hash_buffer, length) != (int)length)
+    {
+        return false;
+    }
+    cb_crc32_update(&bx_ctx.crc, bx_ctx.hash_buffer, length);
+    bx_ctx.hashed += length;
+
+    if (bx_ctx.hashed == bx_ctx.offset)
+    {
+        cb_free(bx_ctx.hash_buffer);
+        bx_ctx.hash_buffer = NULL;
+    }
+    return true;
+}
+
+void bx_update(void)
+{
+    if (!bx_ctx.file)
+    {
+        return;
+    }
+
+    // a block a frame, so a large file doesn't stall the frame
+    if (bx_ctx.hashed < bx_ctx.offset)
+    {
+        if (!bx_hash_prefix())
+        {
+            serial_send_response("bx:x:io");
+            bx_cleanup();
+            return;
+        }
+        bx_ctx.last_progress_ms = playdate->system->getCurrentTimeMilliseconds();
+        return;
+    }
+
+    if (bx_ctx.chunk_count == 0)
+    {
+        // opened at its size, only to get the CRC
+        serial_send_response("bx:t:%08X", cb_crc32_final(&bx_ctx.crc));
+        bx_cleanup();
+        return;
+    }
+
+    unsigned now = playdate->system->getCurrentTimeMilliseconds();
+    if (bx_ctx.next_seq > bx_ctx.acked && now - bx_ctx.last_progress_ms >= BX_RESEND_MS)
+    {
+        // the host has gone quiet: its ACK, or the chunks, were lost
+        bx_ctx.next_seq = bx_ctx.acked;
+        bx_ctx.last_progress_ms = now;
+    }
+
+    while (bx_ctx.next_seq < bx_ctx.chunk_count &&
+           bx_ctx.next_seq - bx_ctx.acked < BX_WINDOW_SIZE)
+    {
+        if (!bx_send_chunk(bx_ctx.next_seq))
+        {
+            serial_send_response("bx:x:io");
+            bx_cleanup();
+            return;
+        }
+        bx_ctx.next_seq++;
+
+        if (bx_ctx.next_seq == bx_ctx.chunk_count)
+        {
+            serial_send_response("bx:t:%08X", cb_crc32_final(&bx_ctx.crc));
+        }
+    }
+}
@@ -0,0 +1,35 @@
+//
+//  bx.h
+//  CrankBoy
+//
+//  Bulk Export Protocol (bx) interface
+//
+
+#ifndef bx_h
+#define bx_h
+
+#include <stdbool.h>
+
+// Protocol constants
+#define BX_CHUNK_SIZE 188   // 235 base85 chars; same msg length as ft:p
+#define BX_WINDOW_SIZE 32   // chunks sent ahead of the host's ACK
+#define BX_RESEND_MS 1000   // unacknowledged chunks are sent again after this
+#define BX_MAX_LIST_DEPTH 8
+
+// read per frame for the CRC of the part of a file before the bx:o offset
+#define BX_HASH_BLOCK_SIZE (16 * 1024)
+
+// Cleanup (called internally and on error)
+void bx_cleanup(void);
+
+// Protocol command handlers (called by serial.c); dirs is NULL-terminated
+bool bx_handle_list(const char* const* dirs);
+bool bx_handle_open(const char* path_str, const char* offset_str);
+bool bx_handle_ack(const char* seq_str);
+bool bx_handle_resend(const char* seq_str);
+bool bx_handle_close(void);
+
+// Sends the chunks the window allows; call once per frame.
+void bx_update(void);
+
+#endif /* bx_h */
@@ -0,0 +1,572 @@
+//
+//  cover_atlas.c
+//  CrankBoy
+//
+
+#include "cover_atlas.h"
+
+#include "../libs/lz4/lz4.h"
+#include "utility.h"
+
+#include <string.h>
+
+#define COVER_ATLAS_MAGIC "CBCA"
+#define COVER_ATLAS_VERSION 1
+#define COVER_ATLAS_HEADER_SIZE 16
+#define COVER_ATLAS_LRU_SLOTS 64
+
+// compact once stale thumbnails are half the data file, and at least this much
+#define COVER_ATLAS_COMPACT_MIN (64 * 1024)
+
+typedef struct
+{
+    uint32_t crc;
+    uint32_t cover_mtime;
+    uint32_t offset;
+    uint32_t compressed_size;
+    uint32_t original_size;  // pixel data, followed by the mask if has_mask
+    uint16_t width;
+    uint16_t height;
+    uint16_t rowbytes;
+    uint8_t has_mask;
+    uint8_t reserved;
+} CB_CoverAtlasEntry;
+
+typedef struct
+{
+    uint32_t crc;
+    uint32_t offset;
+    uint8_t* data;
+    uint32_t size;
+    uint32_t last_used;
+} CB_CoverAtlasSlot;
+
+struct CB_CoverAtlas
+{
+    CB_CoverAtlasEntry* entries;  // sorted by crc
+    bool* live;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t data_size;
+    bool dirty;
+
+    SDFile* data_file;  // for reading; opened on demand
+
+    CB_CoverAtlasSlot slots[COVER_ATLAS_LRU_SLOTS];
+    uint32_t lru_bytes;
+    uint32_t tick;
+
+    void* lz4_state;
+    uint8_t* scratch;
+    size_t scratch_size;
+};
+
+static bool cover_atlas_reserve(CB_CoverAtlas* atlas, uint32_t capacity)
+{
+    if (capacity <= atlas->capacity)
+        return true;
+
+    capacity = MAX(capacity, atlas->capacity * 2);
+    CB_CoverAtlasEntry* entries =
+        cb_realloc(atlas->entries, capacity * sizeof(CB_CoverAtlasEntry));
+    if (!entries)
+        return false;
+    atlas->entries = entries;
+
+    bool* live = cb_realloc(atlas->live, capacity * sizeof(bool));
+    if (!live)
+        return false;
+    atlas->live = live;
+
+    atlas->capacity = capacity;
+    return true;
+}
+
+CB_CoverAtlas* cb_cover_atlas_open(void)
+{
+    CB_CoverAtlas* atlas = allocz(CB_CoverAtlas);
+    if (!atlas)
+        return NULL;
+
+    size_t size;
+    uint8_t* data = (uint8_t*)cb_read_entire_file(COVER_ATLAS_INDEX_FILE, &size, kFileReadData);
+    if (!data)
+    {
+        // nothing refers to the data file's contents, and new entries must
+        // start at its real end, so start it over
+        playdate->file->unlink(COVER_ATLAS_DATA_FILE, 0);
+        return atlas;
+    }
+
+    bool loaded = false;
+    FileStat stat;
+    uint16_t version, entry_size;
+    uint32_t count, data_size;
+    if (size >= COVER_ATLAS_HEADER_SIZE && memcmp(data, COVER_ATLAS_MAGIC, 4) == 0)
+    {
+        memcpy(&version, data + 4, 2);
+        memcpy(&entry_size, data + 6, 2);
+        memcpy(&count, data + 8, 4);
+        memcpy(&data_size, data + 12, 4);
+
+        // the data file must hold at least what the index refers to
+        if (version == COVER_ATLAS_VERSION && entry_size == sizeof(CB_CoverAtlasEntry) &&
+            count <= (size - COVER_ATLAS_HEADER_SIZE) / sizeof(CB_CoverAtlasEntry) &&
+            playdate->file->stat(COVER_ATLAS_DATA_FILE, &stat) == 0 &&
+            stat.size >= data_size && cover_atlas_reserve(atlas, MAX(count, 16)))
+        {
+            const CB_CoverAtlasEntry* entries =
+                (const CB_CoverAtlasEntry*)(data + COVER_ATLAS_HEADER_SIZE);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                if (entries[i].offset + entries[i].compressed_size <= data_size)
+                {
+                    atlas->entries[atlas->count] = entries[i];
+                    atlas->live[atlas->count] = false;
+                    atlas->count++;
+                }
+            }
+            atlas->data_size = stat.size;
+            loaded = true;
+        }
+    }
+
+    // an index from another version, or a damaged one
+    if (!loaded)
+        playdate->file->unlink(COVER_ATLAS_DATA_FILE, 0);
+
+    cb_free(data);
+    return atlas;
+}
+
+static void cover_atlas_close_data(CB_CoverAtlas* atlas)
+{
+    if (atlas->data_file)
+    {
+        playdate->file->close(atlas->data_file);
+        atlas->data_file = NULL;
+    }
+}
+
+static void cover_atlas_clear_lru(CB_CoverAtlas* atlas)
+{
+    for (int i = 0; i < COVER_ATLAS_LRU_SLOTS; ++i)
+    {
+        cb_free(atlas->slots[i].data);
+        atlas->slots[i].data = NULL;
+    }
+    atlas->lru_bytes = 0;
+}
+
+void cb_cover_atlas_free(CB_CoverAtlas* atlas)
+{
+    if (!atlas)
+        return;
+
+    cover_atlas_close_data(atlas);
+    cover_atlas_clear_lru(atlas);
+    cb_free(atlas->entries);
+    cb_free(atlas->live);
+    cb_free(atlas->lz4_state);
+    cb_free(atlas->scratch);
+    cb_free(atlas);
+}
+
+// index of the entry for crc, or where it would be inserted (as ~index)
+static int cover_atlas_find(const CB_CoverAtlas* atlas, uint32_t crc)
+{
+    uint32_t lo = 0, hi = atlas->count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (atlas->entries[mid].crc < crc)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < atlas->count && atlas->entries[lo].crc == crc)
+        return lo;
+    return ~(int)lo;
+}
+
+static uint8_t* cover_atlas_scratch(CB_CoverAtlas* atlas, size_t size)
+{
+    if (size > atlas->scratch_size)
+    {
+        uint8_t* scratch = cb_realloc(atlas->scratch, size);
+        if (!scratch)
+            return NULL;
+        atlas->scratch = scratch;
+        atlas->scratch_size = size;
+    }
+    return atlas->scratch;
+}
+
+bool cb_cover_atlas_validate(CB_CoverAtlas* atlas, uint32_t crc, uint32_t cover_mtime)
+{
+    int i = cover_atlas_find(atlas, crc);
+    if (i < 0 || atlas->entries[i].cover_mtime != cover_mtime)
+        return false;
+
+    atlas->live[i] = true;
+    return true;
+}
+
+static void cover_atlas_drop_slot(CB_CoverAtlas* atlas, uint32_t crc)
+{
+    for (int i = 0; i < COVER_ATLAS_LRU_SLOTS; ++i)
+    {
+        CB_CoverAtlasSlot* slot = &atlas->slots[i];
+        if (slot->data && slot->crc == crc)
+        {
+            atlas->lru_bytes -= slot->size;
+            cb_free(slot->data);
+            slot->data = NULL;
+        }
+    }
+}
+
+bool cb_cover_atlas_add(
+    CB_CoverAtlas* atlas, uint32_t crc, uint32_t cover_mtime, LCDBitmap* thumbnail
+)
+{
+    int width, height, rowbytes;
+    uint8_t *mask_data, *pixel_data;
+    playdate->graphics->getBitmapData(
+        thumbnail, &width, &height, &rowbytes, &mask_data, &pixel_data
+    );
+
+    bool has_mask = (mask_data != NULL);
+    size_t plane_size = rowbytes * height;
+    size_t original_size = has_mask ? plane_size * 2 : plane_size;
+    int max_dst_size = LZ4_compressBound(original_size);
+
+    if (!atlas->lz4_state)
+    {
+        atlas->lz4_state = cb_malloc(LZ4_sizeofState());
+        if (!atlas->lz4_state)
+            return false;
+    }
+
+    // uncompressed planes, then the compressed output
+    uint8_t* uncompressed = cover_atlas_scratch(atlas, original_size + max_dst_size);
+    if (!uncompressed)
+        return false;
+    char* compressed = (char*)uncompressed + original_size;
+
+    memcpy(uncompressed, pixel_data, plane_size);
+    if (has_mask)
+    {
+        memcpy(uncompressed + plane_size, mask_data, plane_size);
+    }
+
+    int compressed_size = LZ4_compress_fast_extState(
+        atlas->lz4_state, (const char*)uncompressed, compressed, original_size, max_dst_size, 1
+    );
+    if (compressed_size <= 0)
+        return false;
+
+    cover_atlas_close_data(atlas);
+    SDFile* file = playdate->file->open(COVER_ATLAS_DATA_FILE, kFileAppend);
+    if (!file)
+        return false;
+    bool ok = playdate->file->write(file, compressed, compressed_size) == compressed_size;
+    playdate->file->close(file);
+    if (!ok)
+    {
+        // part of it may have been written; the next entry goes after that,
+        // and the rest counts as stale bytes until the next compaction
+        FileStat stat;
+        if (playdate->file->stat(COVER_ATLAS_DATA_FILE, &stat) == 0 &&
+            stat.size != atlas->data_size)
+        {
+            atlas->data_size = stat.size;
+            atlas->dirty = true;
+        }
+        return false;
+    }
+
+    CB_CoverAtlasEntry entry = {
+        .crc = crc,
+        .cover_mtime = cover_mtime,
+        .offset = atlas->data_size,
+        .compressed_size = compressed_size,
+        .original_size = original_size,
+        .width = width,
+        .height = height,
+        .rowbytes = rowbytes,
+        .has_mask = has_mask,
+    };
+    atlas->data_size += compressed_size;
+    atlas->dirty = true;
+
+    int i = cover_atlas_find(atlas, crc);
+    if (i >= 0)
+    {
+        cover_atlas_drop_slot(atlas, crc);
+    }
+    else
+    {
+        if (!cover_atlas_reserve(atlas, atlas->count + 1))
+            return false;
+
+        i = ~i;
+        memmove(
+            &atlas->entries[i + 1], &atlas->entries[i],
+            (atlas->count - i) * sizeof(CB_CoverAtlasEntry)
+        );
+        memmove(&atlas->live[i + 1], &atlas->live[i], (atlas->count - i) * sizeof(bool));
+        atlas->count++;
+    }
+
+    atlas->entries[i] = entry;
+    atlas->live[i] = true;
+    return true;
+}
+
+void cb_cover_atlas_remove(CB_CoverAtlas* atlas, uint32_t crc)
+{
+    int i = cover_atlas_find(atlas, crc);
+    if (i < 0)
+        return;
+
+    atlas->live[i] = false;
+    atlas->dirty = true;
+    cover_atlas_drop_slot(atlas, crc);
+}
+
+// Returns the compressed thumbnail, from the LRU or read in from disk.
+static CB_CoverAtlasSlot* cover_atlas_fetch(CB_CoverAtlas* atlas, int index)
+{
+    const CB_CoverAtlasEntry* entry = &atlas->entries[index];
+    atlas->tick++;
+
+    CB_CoverAtlasSlot* victim = NULL;
+    for (int i = 0; i < COVER_ATLAS_LRU_SLOTS; ++i)
+    {
+        CB_CoverAtlasSlot* slot = &atlas->slots[i];
+        if (slot->data && slot->crc == entry->crc && slot->offset == entry->offset)
+        {
+            slot->last_used = atlas->tick;
+            return slot;
+        }
+        if (!victim || !slot->data || (victim->data && slot->last_used < victim->last_used))
+            victim = slot;
+    }
+
+    // evict until there is room (and a free slot)
+    while (victim->data || atlas->lru_bytes + entry->compressed_size > COVER_ATLAS_LRU_BYTES)
+    {
+        CB_CoverAtlasSlot* oldest = NULL;
+        for (int i = 0; i < COVER_ATLAS_LRU_SLOTS; ++i)
+        {
+            CB_CoverAtlasSlot* slot = &atlas->slots[i];
+            if (slot->data && (!oldest || slot->last_used < oldest->last_used))
+                oldest = slot;
+        }
+        if (!oldest)
+            break;
+
+        atlas->lru_bytes -= oldest->size;
+        cb_free(oldest->data);
+        oldest->data = NULL;
+        victim = oldest;
+    }
+
+    if (!atlas->data_file)
+    {
+        atlas->data_file = playdate->file->open(COVER_ATLAS_DATA_FILE, kFileReadData);
+        if (!atlas->data_file)
+            return NULL;
+    }
+
+    uint8_t* data = cb_malloc(entry->compressed_size);
+    if (!data)
+        return NULL;
+
+    if (playdate->file->seek(atlas->data_file, entry->offset, SEEK_SET) != 0 ||
+        playdate->file->read(atlas->data_file, data, entry->compressed_size) !=
+            (int)entry->compressed_size)
+    {
+        cb_free(data);
+        return NULL;
+    }
+
+    victim->crc = entry->crc;
+    victim->offset = entry->offset;
+    victim->data = data;
+    victim->size = entry->compressed_size;
+    victim->last_used = atlas->tick;
+    atlas->lru_bytes += victim->size;
+    return victim;
+}
+
+void cb_cover_atlas_prefetch(CB_CoverAtlas* atlas, uint32_t crc)
+{
+    int i = cover_atlas_find(atlas, crc);
+    if (i >= 0 && atlas->live[i])
+        cover_atlas_fetch(atlas, i);
+}
+
+LCDBitmap* cb_cover_atlas_load(CB_CoverAtlas* atlas, uint32_t crc)
+{
+    int i = cover_atlas_find(atlas, crc);
+    if (i < 0 || !atlas->live[i])
+        return NULL;
+
+    CB_CoverAtlasSlot* slot = cover_atlas_fetch(atlas, i);
+    if (!slot)
+        return NULL;
+
+    const CB_CoverAtlasEntry* entry = &atlas->entries[i];
+    uint8_t* pixels = cover_atlas_scratch(atlas, entry->original_size);
+    if (!pixels)
+        return NULL;
+
+    int decompressed_size = LZ4_decompress_safe(
+        (const char*)slot->data, (char*)pixels, entry->compressed_size, entry->original_size
+    );
+    if (decompressed_size != (int)entry->original_size)
+    {
+        playdate->system->logToConsole("LZ4 decompression failed for cover %08X", (unsigned)crc);
+        return NULL;
+    }
+
+    LCDBitmap* bitmap = playdate->graphics->newBitmap(
+        entry->width, entry->height, entry->has_mask ? kColorClear : kColorWhite
+    );
+    if (!bitmap)
+        return NULL;
+
+    int new_rowbytes;
+    uint8_t *new_pixel_data, *new_mask_data;
+    playdate->graphics->getBitmapData(
+        bitmap, NULL, NULL, &new_rowbytes, &new_mask_data, &new_pixel_data
+    );
+    size_t copy_bytes = MIN(entry->rowbytes, (size_t)new_rowbytes);
+
+    const uint8_t* src_ptr = pixels;
+    uint8_t* dst_ptr = new_pixel_data;
+    for (int y = 0; y < entry->height; ++y)
+    {
+        memcpy(dst_ptr, src_ptr, copy_bytes);
+        src_ptr += entry->rowbytes;
+        dst_ptr += new_rowbytes;
+    }
+
+    if (entry->has_mask && new_mask_data)
+    {
+        dst_ptr = new_mask_data;
+        for (int y = 0; y < entry->height; ++y)
+        {
+            memcpy(dst_ptr, src_ptr, copy_bytes);
+            src_ptr += entry->rowbytes;
+            dst_ptr += new_rowbytes;
+        }
+    }
+
+    return bitmap;
+}
+
+// Rewrites the data file with only the live thumbnails.
+static bool cover_atlas_compact(CB_CoverAtlas* atlas)
+{
+    cover_atlas_close_data(atlas);
+    cover_atlas_clear_lru(atlas);
+
+    SDFile* in = playdate->file->open(COVER_ATLAS_DATA_FILE, kFileReadData);
+    SDFile* out = playdate->file->open(COVER_ATLAS_DATA_FILE ".tmp", kFileWrite);
+    bool ok = in && out;
+
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < atlas->count && ok; ++i)
+    {
+        if (!atlas->live[i])
+            continue;
+
+        CB_CoverAtlasEntry* entry = &atlas->entries[i];
+        uint8_t* data = cover_atlas_scratch(atlas, entry->compressed_size);
+        ok = data && playdate->file->seek(in, entry->offset, SEEK_SET) == 0 &&
+             playdate->file->read(in, data, entry->compressed_size) ==
+                 (int)entry->compressed_size &&
+             playdate->file->write(out, data, entry->compressed_size) ==
+                 (int)entry->compressed_size;
+        entry->offset = offset;
+        offset += entry->compressed_size;
+    }
+
+    if (in)
+        playdate->file->close(in);
+    if (out)
+        playdate->file->close(out);
+
+    if (!ok || playdate->file->rename(COVER_ATLAS_DATA_FILE ".tmp", COVER_ATLAS_DATA_FILE) != 0)
+    {
+        // the offsets no longer match either file; start over next time
+        playdate->file->unlink(COVER_ATLAS_DATA_FILE ".tmp", 0);
+        playdate->file->unlink(COVER_ATLAS_DATA_FILE, 0);
+        playdate->file->unlink(COVER_ATLAS_INDEX_FILE, 0);
+        atlas->count = 0;
+        atlas->data_size = 0;
+        return false;
+    }
+
+    atlas->data_size = offset;
+    return true;
+}
+
+bool cb_cover_atlas_save(CB_CoverAtlas* atlas)
+{
+    // drop the entries that weren't used this session
+    uint32_t live_bytes = 0;
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < atlas->count; ++i)
+    {
+        if (atlas->live[i])
+        {
+            atlas->entries[n] = atlas->entries[i];
+            atlas->live[n] = true;
+            live_bytes += atlas->entries[i].compressed_size;
+            n++;
+        }
+    }
+    if (n != atlas->count)
+        atlas->dirty = true;
+    atlas->count = n;
+
+    if (!atlas->dirty)
+        return true;
+
+    uint32_t stale_bytes = atlas->data_size - live_bytes;
+    if (stale_bytes >= COVER_ATLAS_COMPACT_MIN && stale_bytes * 2 >= atlas->data_size)
+    {
+        if (!cover_atlas_compact(atlas))
+            return false;
+    }
+
+    size_t size = COVER_ATLAS_HEADER_SIZE + atlas->count * sizeof(CB_CoverAtlasEntry);
+    uint8_t* data = cb_malloc(size);
+    if (!data)
+        return false;
+
+    uint16_t version = COVER_ATLAS_VERSION;
+    uint16_t entry_size = sizeof(CB_CoverAtlasEntry);
+    memcpy(data, COVER_ATLAS_MAGIC, 4);
+    memcpy(data + 4, &version, 2);
+    memcpy(data + 6, &entry_size, 2);
+    memcpy(data + 8, &atlas->count, 4);
+    memcpy(data + 12, &atlas->data_size, 4);
+    memcpy(
+        data + COVER_ATLAS_HEADER_SIZE, atlas->entries,
+        atlas->count * sizeof(CB_CoverAtlasEntry)
+    );
+
+    bool ok = cb_write_entire_file(COVER_ATLAS_INDEX_FILE ".tmp", data, size) &&
+              playdate->file->rename(COVER_ATLAS_INDEX_FILE ".tmp", COVER_ATLAS_INDEX_FILE) == 0;
+    cb_free(data);
+
+    if (ok)
+        atlas->dirty = false;
+    return ok;
+}
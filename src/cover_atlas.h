@@ -0,0 +1,64 @@
+//
+//  cover_atlas.h
+//  CrankBoy
+//
+//  Persistent store of library cover thumbnails: each cover is decoded and
+//  scaled once, then kept LZ4-compressed on disk, keyed by the ROM's CRC and
+//  the cover file's mtime. Only the index is resident; thumbnails are read
+//  in on demand into a small LRU, so RAM use doesn't grow with the library.
+//
+//  Files:
+//    cover_atlas.idx  header ("CBCA", u16 version, u16 entry size, u32 count,
+//                     u32 data size) followed by the entries, sorted by CRC.
+//                     Rewritten whole on save.
+//    cover_atlas.dat  thumbnail data. Appended to; rewritten without the
+//                     stale thumbnails once those make up half of it.
+//
+
+#ifndef cover_atlas_h
+#define cover_atlas_h
+
+#include "pd_api.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COVER_ATLAS_INDEX_FILE "cover_atlas.idx"
+#define COVER_ATLAS_DATA_FILE "cover_atlas.dat"
+
+// compressed thumbnails kept in memory
+#define COVER_ATLAS_LRU_BYTES (256 * 1024)
+
+// rows above and below the selection whose thumbnails are prefetched
+#define COVER_ATLAS_PREFETCH_ROWS 2
+
+typedef struct CB_CoverAtlas CB_CoverAtlas;
+
+// Loads the index. Missing or invalid files give an empty atlas.
+CB_CoverAtlas* cb_cover_atlas_open(void);
+
+void cb_cover_atlas_free(CB_CoverAtlas* atlas);
+
+// True if a thumbnail for this cover version is stored; it is then marked
+// as in use, so cb_cover_atlas_save keeps it.
+bool cb_cover_atlas_validate(CB_CoverAtlas* atlas, uint32_t crc, uint32_t cover_mtime);
+
+// Compresses the (already scaled) thumbnail and appends it.
+bool cb_cover_atlas_add(
+    CB_CoverAtlas* atlas, uint32_t crc, uint32_t cover_mtime, LCDBitmap* thumbnail
+);
+
+// The cover has been deleted or replaced.
+void cb_cover_atlas_remove(CB_CoverAtlas* atlas, uint32_t crc);
+
+// Writes the index, dropping thumbnails that weren't validated or added
+// since the atlas was opened, and compacts the data file if due.
+bool cb_cover_atlas_save(CB_CoverAtlas* atlas);
+
+// Returns a new bitmap (caller-freed), or NULL if there's no thumbnail.
+LCDBitmap* cb_cover_atlas_load(CB_CoverAtlas* atlas, uint32_t crc);
+
+// Reads the thumbnail into the LRU ahead of time, e.g. for a neighbouring row.
+void cb_cover_atlas_prefetch(CB_CoverAtlas* atlas, uint32_t crc);
+
+#endif /* cover_atlas_h */
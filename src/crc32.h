@@ -0,0 +1,45 @@
+//
+//  crc32.h
+//  CrankBoy
+//
+//  CRC-32 as used by zip/gzip/png (and by the ROM database and gbz).
+//  Can be computed in one go, or fed incrementally through a CB_CRC32:
+//
+//    CB_CRC32 crc;
+//    cb_crc32_init(&crc);
+//    cb_crc32_update(&crc, chunk, chunk_size);  // as often as needed
+//    uint32_t value = cb_crc32_final(&crc);
+//
+//  Has no dependencies, so it can be built on the host as well.
+//
+
+#ifndef crc32_h
+#define crc32_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t crc;
+} CB_CRC32;
+
+static inline void cb_crc32_init(CB_CRC32* ctx)
+{
+    ctx->crc = 0xFFFFFFFF;
+}
+
+void cb_crc32_update(CB_CRC32* ctx, const void* data, size_t len);
+
+static inline uint32_t cb_crc32_final(const CB_CRC32* ctx)
+{
+    return ctx->crc ^ 0xFFFFFFFF;
+}
+
+// CRC of a whole buffer.
+uint32_t cb_crc32(const void* data, size_t len);
+
+// Updates a raw (pre-/post-conditioned by the caller) CRC register.
+uint32_t cb_crc32_update_raw(uint32_t crc, const void* data, size_t len);
+
+#endif /* crc32_h */
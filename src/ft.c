@@ -7,6 +7,7 @@
 
 #include "ft.h"
 
+#include "crc32.h"
 #include "gbz.h"
 #include "utility.h"
 
@@ -20,22 +21,34 @@
  * Protocol Specification:
  *
  * Host Commands (→ Device):
- *   ft:b:<filename>:<size>:<crc32>[:<orig_name>:<orig_crc>]  - Begin transfer
+ *   ft:b:<filename>:<size>:<crc32>[:<orig_name>:<orig_crc>][:<flags>]
+ *                                                            - Begin transfer
  *   ft:c:<seq>:<crc16>:<base64>                              - Send chunk
+ *   ft:p:<seq>:<crc16>:<base85>                              - Send packed chunk
  *   ft:e:<crc32>                                             - End transfer
  *   ft:s                                                     - Query status
  *
  * Device Responses (← Host):
- *   ft:r:<code>            Ready (format: WWCC hex, WW=window, CC=chunk)
+ *   ft:r:<code>            Ready (format: [PWPCFF]WWCC hex, WW=window, CC=chunk)
  *                           Example: ft:r:08B1 = window=8, chunk=177
- *   ft:a:<seq>             Cumulative ACK (chunks 0 through seq acknowledged)
+ *                           The optional high bytes advertise packed chunks:
+ *                           FF = capability flags (FT_CAP_PACKED), PC = packed
+ *                           chunk size, PW = packed window size. Example:
+ *                           ft:r:20BC0110B1 = base64 window=16, chunk=177;
+ *                           packed window=32, chunk=188. Older hosts only
+ *                           look at the low 16 bits, and keep using ft:c.
+ *                           FT_CAP_WRITE_BEHIND is only set if the host asked
+ *                           for it in ft:b (see Write-Behind below).
+ *   ft:a:<seq>             Cumulative ACK (chunks 0 through seq written to
+ *                           the temp file, unless write-behind is on)
  *   ft:n:<seq>:<code>      NACK with error code (immediate, not batched):
  *                           - "crc" = CRC mismatch (retry same chunk)
  *                           - "seq" = wrong sequence (resync to seq)
  *                           - "write" = write error (fatal)
  *                           - "size" = size exceeded (fatal)
  *   ft:d:<base>:<bitmap>   Status response: window_base + bitmap of received
- *                           chunks (bit 0 = window_base, bit 1 = window_base+1)
+ *                           chunks (bit 0 = window_base, bit 1 = window_base+1),
+ *                           8 hex digits
  *   ft:o:<filename>        OK - transfer complete (original name if decompressed)
  *   ft:x:<code>            Error with code:
  *                           - "busy" = transfer in progress
@@ -43,7 +56,8 @@
  *                           - "filename" = invalid filename
  *                           - "extension" = invalid extension
  *                           - "toobig" = file too big
- *                           - "write" = write error
+ *                           - "write" = write error, or the written file
+ *                                       reads back with the wrong CRC
  *                           - "crc" = CRC mismatch
  *                           - "nomem" = out of memory
  *                           - "gbz_header" = invalid GBZ header
@@ -56,7 +70,8 @@
  * Supported File Types:
  *   - .gb  - Game Boy ROMs (saved to games/)
  *   - .gbc - Game Boy Color ROMs (saved to games/)
- *   - .gbz - Compressed GB/GBC files (saved to games/, decompressed on device)
+ *   - .gbz - Compressed GB/GBC files (saved to games/, decompressed on device
+ *            as the chunks arrive, when <orig_name> is given)
  *   - .pdi - Playdate cover images (saved to covers/ automatically)
  *
  * Target Directory Selection:
@@ -71,6 +86,7 @@
  * Temp File Naming:
  *   Temporary files during transfer: .ft_<filename>.tmp in target directory
  *   Backup of existing files: .ft_<filename>.bak in target directory
+ *   Decompressed gbz output: .ft_<orig_name>.tmp in games/
  *
  * Window-Based Pipelining with Adaptive Batching:
  *   - Device advertises window size in ft:r response (WW field)
@@ -82,10 +98,40 @@
  *   - On any timeout or NACK, batch size resets to 3
  *   - Host can query status (ft:s) to get bitmap of received chunks
  *   - Default window size: 16 (configurable via FT_WINDOW_SIZE define)
+ *
+ * Packed Chunks:
+ *   A serial message is one text line of at most 256 characters, split on
+ *   ' ' and ':', so raw binary can't be sent. ft:p carries the chunk in
+ *   base85 (RFC 1924 alphabet, which has neither separator) instead of
+ *   base64: 188 bytes in the line length that holds 177 as base64. A host
+ *   that sends ft:p also gets the larger window (FT_PACKED_WINDOW_SIZE) and
+ *   ACK batches of up to window-2. Both kinds may be mixed in one transfer.
+ *
+ * Write-Behind:
+ *   In-order chunks are gathered in a buffer and written to the temp file
+ *   together, rather than a few hundred bytes at a time. By default the
+ *   buffer is written out before each ACK, so an ACK still means the chunks
+ *   are in the file, and writes are one ACK batch long.
+ *   A host that only relies on ft:o (sent once all data is written and the
+ *   file is in place) can set FT_CAP_WRITE_BEHIND in the optional <flags>
+ *   (hex) of ft:b. ACKs then only mean the chunks passed their CRC check and
+ *   are in sequence, and the buffer is written in FT_WRITE_BUFFER_SIZE
+ *   blocks, and on ft:e, on ft:s (the host is waiting on something), and
+ *   when no chunk has arrived for FT_IDLE_FLUSH_MS (ft_update). The device
+ *   confirms it by setting the same flag in ft:r; older devices ignore it.
+ *   A failed write ends the transfer: ft:n:<seq>:write while receiving,
+ *   ft:x:write on ft:e or ft:s.
  */
 
 // FT_CHUNK_SIZE, FT_MAX_FILE_SIZE, FT_MAX_CHUNKS, FT_WINDOW_SIZE are defined in ft.h
 
+#define FT_WRITE_BUFFER_SIZE (16 * 1024)
+#define FT_IDLE_FLUSH_MS 500
+
+// chunks are buffered for the larger (packed) window whichever kind arrives
+#define FT_BUFFER_CHUNK_SIZE MAX(FT_CHUNK_SIZE, FT_PACKED_CHUNK_SIZE)
+#define FT_BUFFER_SLOTS MAX(FT_WINDOW_SIZE, FT_PACKED_WINDOW_SIZE)
+
 // Transfer states
 typedef enum
 {
@@ -96,7 +142,7 @@ typedef enum
 // Chunk buffer entry for window-based pipelining
 typedef struct
 {
-    uint8_t data[FT_CHUNK_SIZE];
+    uint8_t data[FT_BUFFER_CHUNK_SIZE];
     uint16_t length;
     uint32_t seq;
     bool valid;
@@ -114,14 +160,28 @@ static struct
     uint32_t expected_size;
     uint32_t received_size;
     uint32_t expected_crc;
+    CB_CRC32 received_crc;
     SDFile* file;
     char* original_filename;
     uint32_t original_crc;
-    FtChunkBuffer chunk_buffer[FT_WINDOW_SIZE];
+    GBZ_Stream* gbz_stream;
+    SDFile* decoded_file;
+    char* decoded_path;
+    const char* decode_error;
+    FtChunkBuffer chunk_buffer[FT_BUFFER_SLOTS];
     uint32_t window_base;
     uint32_t last_ack_sent;
     uint8_t batch_size;
     uint8_t successful_batches;
+    bool packed;        // the host has sent ft:p chunks
+    bool write_behind;  // ACKs needn't wait for the write buffer (FT_CAP_WRITE_BEHIND)
+
+    // in-order data not yet written to file; NULL if it couldn't be allocated,
+    // in which case chunks are written directly
+    uint8_t* write_buffer;
+    uint32_t write_buffer_len;
+    uint32_t written_size;  // file offset the write buffer starts at
+    unsigned last_chunk_ms;
 } ft_ctx;
 
 // Sanitize filename: minimal safety - only prevent path traversal
@@ -160,6 +220,13 @@ void ft_cleanup(void)
         playdate->file->close(ft_ctx.file);
         ft_ctx.file = NULL;
     }
+    if (ft_ctx.write_buffer)
+    {
+        cb_free(ft_ctx.write_buffer);
+        ft_ctx.write_buffer = NULL;
+    }
+    ft_ctx.write_buffer_len = 0;
+    ft_ctx.written_size = 0;
     if (ft_ctx.temp_path)
     {
         playdate->file->unlink(ft_ctx.temp_path, 0);
@@ -186,6 +253,23 @@ void ft_cleanup(void)
         cb_free(ft_ctx.original_filename);
         ft_ctx.original_filename = NULL;
     }
+    if (ft_ctx.gbz_stream)
+    {
+        gbz_stream_free(ft_ctx.gbz_stream);
+        ft_ctx.gbz_stream = NULL;
+    }
+    if (ft_ctx.decoded_file)
+    {
+        playdate->file->close(ft_ctx.decoded_file);
+        ft_ctx.decoded_file = NULL;
+    }
+    if (ft_ctx.decoded_path)
+    {
+        playdate->file->unlink(ft_ctx.decoded_path, 0);
+        cb_free(ft_ctx.decoded_path);
+        ft_ctx.decoded_path = NULL;
+    }
+    ft_ctx.decode_error = NULL;
     ft_ctx.state = FT_STATE_IDLE;
     ft_ctx.expected_size = 0;
     ft_ctx.received_size = 0;
@@ -194,27 +278,31 @@ void ft_cleanup(void)
     ft_ctx.window_base = 0;
     ft_ctx.last_ack_sent = 0;
 
-    for (int i = 0; i < FT_WINDOW_SIZE; i++)
+    for (int i = 0; i < FT_BUFFER_SLOTS; i++)
     {
         ft_ctx.chunk_buffer[i].valid = false;
     }
 
     ft_ctx.batch_size = FT_INITIAL_BATCH_SIZE;
     ft_ctx.successful_batches = 0;
+    ft_ctx.packed = false;
+    ft_ctx.write_behind = false;
 }
 
 // ============================================================================
 // Window-based Pipelining Support
 // ============================================================================
 
-// Get buffer slot for a sequence number (returns -1 if out of window)
+// Get buffer slot for a sequence number (returns -1 if out of window). The
+// buffer is a ring indexed by seq, so a chunk that arrived early stays in its
+// slot as the window moves up to it.
 static int ft_get_buffer_slot(uint32_t seq)
 {
-    if (seq < ft_ctx.window_base || seq >= ft_ctx.window_base + FT_WINDOW_SIZE)
+    if (seq < ft_ctx.window_base || seq >= ft_ctx.window_base + FT_BUFFER_SLOTS)
     {
         return -1;
     }
-    return (int)(seq - ft_ctx.window_base);
+    return (int)(seq % FT_BUFFER_SLOTS);
 }
 
 // Store chunk in buffer
@@ -235,6 +323,48 @@ static bool ft_buffer_chunk(uint32_t seq, const uint8_t* data, uint16_t length,
     return true;
 }
 
+// Writes out the write buffer. Returns false on a write error.
+static bool ft_write_flush(void)
+{
+    if (ft_ctx.write_buffer_len == 0)
+    {
+        return true;
+    }
+
+    int written = playdate->file->write(ft_ctx.file, ft_ctx.write_buffer, ft_ctx.write_buffer_len);
+    bool ok = written == (int)ft_ctx.write_buffer_len;
+    ft_ctx.written_size += ft_ctx.write_buffer_len;
+    ft_ctx.write_buffer_len = 0;
+    return ok;
+}
+
+// Appends in-order data to the write buffer, writing it out each time it
+// reaches a block boundary in the file, so writes stay block-aligned even
+// after an early flush. Returns false on a write error.
+static bool ft_write(const uint8_t* data, uint32_t length)
+{
+    if (!ft_ctx.write_buffer)
+    {
+        return playdate->file->write(ft_ctx.file, data, length) == (int)length;
+    }
+
+    while (length > 0)
+    {
+        uint32_t block_end = FT_WRITE_BUFFER_SIZE - ft_ctx.written_size % FT_WRITE_BUFFER_SIZE;
+        uint32_t n = MIN(length, block_end - ft_ctx.write_buffer_len);
+        memcpy(ft_ctx.write_buffer + ft_ctx.write_buffer_len, data, n);
+        ft_ctx.write_buffer_len += n;
+        data += n;
+        length -= n;
+
+        if (ft_ctx.write_buffer_len == block_end && !ft_write_flush())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 // Flush consecutive chunks from window buffer to file
 // Returns true if any chunks were written
 static bool ft_flush_buffer(void)
@@ -258,14 +388,23 @@ static bool ft_flush_buffer(void)
             return false;
         }
 
-        int written = playdate->file->write(ft_ctx.file, buf->data, buf->length);
-        if (written != buf->length)
+        if (!ft_write(buf->data, buf->length))
         {
             serial_send_response("ft:n:%04X:write", ft_ctx.window_base);
             ft_cleanup();
             return false;
         }
 
+        // gbz: decode as we go; a failure is reported at ft:e
+        if (ft_ctx.gbz_stream && !ft_ctx.decode_error &&
+            gbz_stream_feed(ft_ctx.gbz_stream, buf->data, buf->length) < 0 &&
+            !ft_ctx.decode_error)
+        {
+            ft_ctx.decode_error = gbz_stream_header(ft_ctx.gbz_stream) ? "ft:x:decompress"
+                                                                       : "ft:x:gbz_header";
+        }
+
+        cb_crc32_update(&ft_ctx.received_crc, buf->data, buf->length);
         ft_ctx.received_size += buf->length;
         buf->valid = false;
         ft_ctx.window_base++;
@@ -306,13 +445,21 @@ static void ft_send_cumulative_ack(bool force, bool is_error)
 
     if (should_ack && ft_ctx.window_base > ft_ctx.last_ack_sent)
     {
+        if (!ft_ctx.write_behind && !ft_write_flush())
+        {
+            serial_send_response("ft:n:%04X:write", highest_acked);
+            ft_cleanup();
+            return;
+        }
+
         serial_send_response("ft:a:%04X", highest_acked);
         ft_ctx.last_ack_sent = ft_ctx.window_base;
 
         if (!is_error)
         {
+            uint8_t max_batch_size = ft_ctx.packed ? FT_PACKED_MAX_BATCH_SIZE : FT_MAX_BATCH_SIZE;
             ft_ctx.successful_batches++;
-            if (ft_ctx.successful_batches >= 5 && ft_ctx.batch_size < FT_MAX_BATCH_SIZE)
+            if (ft_ctx.successful_batches >= 5 && ft_ctx.batch_size < max_batch_size)
             {
                 ft_ctx.batch_size++;
                 ft_ctx.successful_batches = 0;
@@ -321,6 +468,17 @@ static void ft_send_cumulative_ack(bool force, bool is_error)
     }
 }
 
+// Writes decoded gbz output to the .ft_<orig_name>.tmp file.
+static bool ft_gbz_sink(void* ud, const uint8_t* data, size_t size)
+{
+    if (playdate->file->write(ft_ctx.decoded_file, data, size) != (int)size)
+    {
+        ft_ctx.decode_error = "ft:x:write";
+        return false;
+    }
+    return true;
+}
+
 // Check if extension is valid (.gb, .gbc, .gbz, .pdi)
 static bool is_valid_extension(const char* filename)
 {
@@ -334,10 +492,10 @@ static bool is_valid_extension(const char* filename)
 }
 
 // Handle ft:b command - Begin transfer
-// Format: ft:b:<filename>:<size>:<crc32>[:<original_filename>:<original_crc>]
+// Format: ft:b:<filename>:<size>:<crc32>[:<original_filename>:<original_crc>][:<flags>]
 bool ft_handle_begin(
     const char* filename, const char* size_str, const char* crc_str, const char* original_filename,
-    const char* original_crc_str
+    const char* original_crc_str, const char* flags_str
 )
 {
     // Ensure clean state - cleanup any stale transfer
@@ -481,17 +639,20 @@ bool ft_handle_begin(
 
     ft_ctx.expected_size = size;
     ft_ctx.expected_crc = crc;
+    cb_crc32_init(&ft_ctx.received_crc);
     ft_ctx.received_size = 0;
     ft_ctx.window_base = 0;
     ft_ctx.last_ack_sent = 0;
 
-    for (int i = 0; i < FT_WINDOW_SIZE; i++)
+    for (int i = 0; i < FT_BUFFER_SLOTS; i++)
     {
         ft_ctx.chunk_buffer[i].valid = false;
     }
 
     ft_ctx.batch_size = FT_INITIAL_BATCH_SIZE;
     ft_ctx.successful_batches = 0;
+    ft_ctx.packed = false;
+    ft_ctx.write_behind = flags_str && (strtoul(flags_str, NULL, 16) & FT_CAP_WRITE_BEHIND);
 
     if (original_filename && original_crc_str)
     {
@@ -526,6 +687,29 @@ bool ft_handle_begin(
             return false;
         }
         ft_ctx.original_crc = (uint32_t)strtoul(original_crc_str, NULL, 16);
+
+        const char* ext = get_extension(basename_ptr);
+        if (ext && strcasecmp(ext, ".gbz") == 0)
+        {
+            ft_ctx.decoded_path = aprintf(
+                "%s/.ft_%s.tmp", cb_gb_directory_path(CB_gamesPath), ft_ctx.original_filename
+            );
+            ft_ctx.gbz_stream = gbz_stream_new(NULL, 0, ft_gbz_sink, NULL);
+            if (!ft_ctx.decoded_path || !ft_ctx.gbz_stream)
+            {
+                serial_send_response("ft:x:nomem");
+                ft_cleanup();
+                return false;
+            }
+
+            ft_ctx.decoded_file = playdate->file->open(ft_ctx.decoded_path, kFileWrite);
+            if (!ft_ctx.decoded_file)
+            {
+                serial_send_response("ft:x:write");
+                ft_cleanup();
+                return false;
+            }
+        }
     }
     else
     {
@@ -541,17 +725,26 @@ bool ft_handle_begin(
         return false;
     }
 
+    ft_ctx.write_buffer = cb_malloc(FT_WRITE_BUFFER_SIZE);
+    ft_ctx.write_buffer_len = 0;
+    ft_ctx.written_size = 0;
+    ft_ctx.last_chunk_ms = playdate->system->getCurrentTimeMilliseconds();
+
     ft_ctx.state = FT_STATE_RECEIVING;
     // Send ready with window size (high byte) and chunk size (low byte) in 4-digit hex
-    // Format: WWCC where WW = window size (2 hex digits), CC = chunk size (2 hex digits)
+    // Format: WWCC where WW = window size (2 hex digits), CC = chunk size (2 hex digits),
+    // preceded by the packed window and chunk size and the capability flags
     uint16_t ready_code = (FT_WINDOW_SIZE << 8) | FT_CHUNK_SIZE;
-    serial_send_response("ft:r:%04X", ready_code);
+    uint8_t caps = FT_CAP_PACKED | (ft_ctx.write_behind ? FT_CAP_WRITE_BEHIND : 0);
+    serial_send_response(
+        "ft:r:%02X%02X%02X%04X", FT_PACKED_WINDOW_SIZE, FT_PACKED_CHUNK_SIZE, caps, ready_code
+    );
     return true;
 }
 
-// Handle ft:c command - Send chunk with window-based pipelining
-// Format: ft:c:<seq>:<crc16>:<base64> (seq = 4-digit hex, crc16 = lower 16 bits of CRC32)
-bool ft_handle_chunk(const char* seq_str, const char* crc16_str, const char* base64_data)
+static bool ft_receive_chunk(
+    const char* seq_str, const char* crc16_str, const char* text, bool packed
+)
 {
     if (ft_ctx.state != FT_STATE_RECEIVING)
     {
@@ -563,15 +756,16 @@ bool ft_handle_chunk(const char* seq_str, const char* crc16_str, const char* bas
 
     uint16_t expected_crc16 = (uint16_t)strtoul(crc16_str, NULL, 16);
 
-    uint8_t decoded[FT_CHUNK_SIZE];
-    int decoded_len = base64_decode(base64_data, strlen(base64_data), decoded, sizeof(decoded));
+    uint8_t decoded[FT_BUFFER_CHUNK_SIZE];
+    int decoded_len = packed ? base85_decode(text, strlen(text), decoded, FT_PACKED_CHUNK_SIZE)
+                             : base64_decode(text, strlen(text), decoded, FT_CHUNK_SIZE);
     if (decoded_len < 0)
     {
         serial_send_response("ft:n:%04X:crc", seq);
         return false;
     }
 
-    uint32_t full_crc = crc32_for_buffer(decoded, decoded_len);
+    uint32_t full_crc = cb_crc32(decoded, decoded_len);
     uint16_t actual_crc16 = (uint16_t)(full_crc & 0xFFFF);
     if (actual_crc16 != expected_crc16)
     {
@@ -588,7 +782,7 @@ bool ft_handle_chunk(const char* seq_str, const char* crc16_str, const char* bas
     }
 
     // Check if chunk is within receive window
-    if (seq >= ft_ctx.window_base + FT_WINDOW_SIZE)
+    if (seq >= ft_ctx.window_base + FT_BUFFER_SLOTS)
     {
         // Chunk is ahead of window - send NACK to request resync
         serial_send_response("ft:n:%04X:seq", ft_ctx.window_base);
@@ -601,6 +795,12 @@ bool ft_handle_chunk(const char* seq_str, const char* crc16_str, const char* bas
         return false;
     }
 
+    if (packed)
+    {
+        ft_ctx.packed = true;
+    }
+    ft_ctx.last_chunk_ms = playdate->system->getCurrentTimeMilliseconds();
+
     ft_flush_buffer();
 
     // Send cumulative ACK (with adaptive batching)
@@ -611,6 +811,20 @@ bool ft_handle_chunk(const char* seq_str, const char* crc16_str, const char* bas
     return true;
 }
 
+// Handle ft:c command - Send chunk with window-based pipelining
+// Format: ft:c:<seq>:<crc16>:<base64> (seq = 4-digit hex, crc16 = lower 16 bits of CRC32)
+bool ft_handle_chunk(const char* seq_str, const char* crc16_str, const char* base64_data)
+{
+    return ft_receive_chunk(seq_str, crc16_str, base64_data, false);
+}
+
+// Handle ft:p command - Send packed chunk
+// Format: ft:p:<seq>:<crc16>:<base85> (as ft:c, up to FT_PACKED_CHUNK_SIZE bytes)
+bool ft_handle_packed_chunk(const char* seq_str, const char* crc16_str, const char* base85_data)
+{
+    return ft_receive_chunk(seq_str, crc16_str, base85_data, true);
+}
+
 // Handle ft:e command - End transfer
 // Format: ft:e:<crc32>
 bool ft_handle_end(const char* crc_str)
@@ -621,9 +835,17 @@ bool ft_handle_end(const char* crc_str)
         return false;
     }
 
+    bool flushed = ft_write_flush();
     playdate->file->close(ft_ctx.file);
     ft_ctx.file = NULL;
 
+    if (!flushed)
+    {
+        serial_send_response("ft:x:write");
+        ft_cleanup();
+        return false;
+    }
+
     if (ft_ctx.received_size != ft_ctx.expected_size)
     {
         serial_send_response("ft:x:size");
@@ -631,90 +853,50 @@ bool ft_handle_end(const char* crc_str)
         return false;
     }
 
-    uint32_t actual_crc;
-    if (cb_calculate_crc32(ft_ctx.temp_path, kFileReadData, &actual_crc))
+    // computed over the chunks as they were written
+    if (cb_crc32_final(&ft_ctx.received_crc) != ft_ctx.expected_crc)
     {
-        if (actual_crc != ft_ctx.expected_crc)
-        {
-            serial_send_response("ft:x:crc");
-            ft_cleanup();
-            return false;
-        }
+        serial_send_response("ft:x:crc");
+        ft_cleanup();
+        return false;
     }
 
-    // Check if this is a GBZ file that needs decompression
-    const char* ext = get_extension(ft_ctx.filename);
-    bool is_gbz = ext && strcasecmp(ext, ".gbz") == 0;
-
-    if (is_gbz && ft_ctx.original_filename)
+    // and again over what reached the card
+    uint32_t written_crc;
+    if (!cb_calculate_crc32(ft_ctx.temp_path, kFileReadData, &written_crc) ||
+        written_crc != ft_ctx.expected_crc)
     {
-        SDFile* gbz_file = playdate->file->open(ft_ctx.temp_path, kFileReadData);
-        if (!gbz_file)
-        {
-            serial_send_response("ft:x:read");
-            ft_cleanup();
-            return false;
-        }
-
-        playdate->file->seek(gbz_file, 0, SEEK_END);
-        int gbz_size = playdate->file->tell(gbz_file);
-        playdate->file->seek(gbz_file, 0, SEEK_SET);
-
-        uint8_t* gbz_data = cb_malloc(gbz_size);
-        if (!gbz_data)
-        {
-            playdate->file->close(gbz_file);
-            serial_send_response("ft:x:nomem");
-            ft_cleanup();
-            return false;
-        }
-
-        int bytes_read = playdate->file->read(gbz_file, gbz_data, gbz_size);
-        playdate->file->close(gbz_file);
-
-        if (bytes_read != gbz_size)
-        {
-            cb_free(gbz_data);
-            serial_send_response("ft:x:read");
-            ft_cleanup();
-            return false;
-        }
-
-        GBZ_Header header;
-        if (!gbz_parse_header(&header, gbz_data, gbz_size))
-        {
-            cb_free(gbz_data);
-            serial_send_response("ft:x:gbz_header");
-            ft_cleanup();
-            return false;
-        }
+        serial_send_response("ft:x:write");
+        ft_cleanup();
+        return false;
+    }
 
-        uint8_t* decompressed = cb_malloc(header.original_size);
-        if (!decompressed)
-        {
-            cb_free(gbz_data);
-            serial_send_response("ft:x:nomem");
-            ft_cleanup();
-            return false;
-        }
+    if (ft_ctx.gbz_stream)
+    {
+        // already decoded as the chunks arrived; just check and move it into place
+        const char* error = ft_ctx.decode_error;
+        const GBZ_Header* header = gbz_stream_header(ft_ctx.gbz_stream);
+        if (!error && !header)
+            error = "ft:x:gbz_header";
+        else if (!error && (gbz_stream_feed(ft_ctx.gbz_stream, NULL, 0) != GBZ_STREAM_DONE ||
+                            gbz_stream_total_out(ft_ctx.gbz_stream) != header->original_size))
+            error = "ft:x:decompress";
+        else if (!error && gbz_stream_crc32(ft_ctx.gbz_stream) != ft_ctx.original_crc)
+            error = "ft:x:orig_crc";
 
-        int decompressed_size =
-            gbz_decompress(gbz_data, gbz_size, decompressed, header.original_size);
-        cb_free(gbz_data);
+        playdate->file->close(ft_ctx.decoded_file);
+        ft_ctx.decoded_file = NULL;
 
-        if (decompressed_size != (int)header.original_size)
+        uint32_t decoded_crc;
+        if (!error && (!cb_calculate_crc32(ft_ctx.decoded_path, kFileReadData, &decoded_crc) ||
+                       decoded_crc != ft_ctx.original_crc))
         {
-            cb_free(decompressed);
-            serial_send_response("ft:x:decompress");
-            ft_cleanup();
-            return false;
+            error = "ft:x:write";
         }
 
-        uint32_t decompressed_crc = crc32_for_buffer(decompressed, decompressed_size);
-        if (decompressed_crc != ft_ctx.original_crc)
+        if (error)
         {
-            cb_free(decompressed);
-            serial_send_response("ft:x:orig_crc");
+            serial_send_response("%s", error);
             ft_cleanup();
             return false;
         }
@@ -729,22 +911,7 @@ bool ft_handle_end(const char* crc_str)
             playdate->file->rename(original_path, orig_bak_path);
         }
 
-        SDFile* out_file = playdate->file->open(original_path, kFileWrite);
-        if (!out_file)
-        {
-            cb_free(decompressed);
-            cb_free(original_path);
-            cb_free(orig_bak_path);
-            serial_send_response("ft:x:write");
-            ft_cleanup();
-            return false;
-        }
-
-        int written = playdate->file->write(out_file, decompressed, decompressed_size);
-        playdate->file->close(out_file);
-        cb_free(decompressed);
-
-        if (written != decompressed_size)
+        if (playdate->file->rename(ft_ctx.decoded_path, original_path) != 0)
         {
             if (cb_file_exists(orig_bak_path, kFileReadData))
             {
@@ -800,21 +967,51 @@ bool ft_handle_end(const char* crc_str)
 //   Example: window_base=0, bitmap=0F means chunks 0,1,2,3 received
 bool ft_handle_status(void)
 {
+    // the host has stopped to ask, so this is as good a time as any to write
+    if (ft_ctx.state == FT_STATE_RECEIVING && !ft_write_flush())
+    {
+        serial_send_response("ft:x:write");
+        ft_cleanup();
+        return false;
+    }
+
     if (ft_ctx.state == FT_STATE_RECEIVING)
     {
-        uint16_t bitmap = 0;
-        for (int i = 0; i < FT_WINDOW_SIZE; i++)
+        uint32_t bitmap = 0;
+        for (int i = 0; i < FT_BUFFER_SLOTS; i++)
         {
-            if (ft_ctx.chunk_buffer[i].valid)
+            uint32_t seq = ft_ctx.window_base + i;
+            const FtChunkBuffer* buf = &ft_ctx.chunk_buffer[seq % FT_BUFFER_SLOTS];
+            if (buf->valid && buf->seq == seq)
             {
-                bitmap |= (1 << i);
+                bitmap |= (1u << i);
             }
         }
-        serial_send_response("ft:d:%04X:%04X", ft_ctx.window_base, bitmap);
+        serial_send_response("ft:d:%04X:%08X", ft_ctx.window_base, (unsigned)bitmap);
     }
     else
     {
-        serial_send_response("ft:d:0000:0000");
+        serial_send_response("ft:d:0000:00000000");
     }
     return true;
 }
+
+void ft_update(void)
+{
+    if (ft_ctx.state != FT_STATE_RECEIVING || ft_ctx.write_buffer_len == 0)
+    {
+        return;
+    }
+
+    unsigned now = playdate->system->getCurrentTimeMilliseconds();
+    if (now - ft_ctx.last_chunk_ms < FT_IDLE_FLUSH_MS)
+    {
+        return;
+    }
+
+    if (!ft_write_flush())
+    {
+        serial_send_response("ft:x:write");
+        ft_cleanup();
+    }
+}
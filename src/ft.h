@@ -18,16 +18,30 @@
 #define FT_INITIAL_BATCH_SIZE 3             // Starting batch size for adaptive batching
 #define FT_MAX_BATCH_SIZE 14  // Max batch size (leaves headroom for out-of-order chunks)
 
+// Packed (base85) chunks, for hosts that see FT_CAP_PACKED in the ready response
+#define FT_CAP_PACKED 0x01
+#define FT_PACKED_CHUNK_SIZE 188  // 235 base85 chars; same msg length
+#define FT_PACKED_WINDOW_SIZE 32  // also the size of the receive buffer
+#define FT_PACKED_MAX_BATCH_SIZE (FT_PACKED_WINDOW_SIZE - 2)
+
+// ACKs ahead of the file writes (see Write-Behind in ft.c); a host asks for it
+// with this flag in ft:b, and it is set in ft:r if granted
+#define FT_CAP_WRITE_BEHIND 0x02
+
 // Cleanup (called internally and on error)
 void ft_cleanup(void);
 
 // Protocol command handlers (called by serial.c)
 bool ft_handle_begin(
     const char* filename, const char* size_str, const char* crc_str, const char* original_filename,
-    const char* original_crc_str
+    const char* original_crc_str, const char* flags_str
 );
 bool ft_handle_chunk(const char* seq_str, const char* crc16_str, const char* base64_data);
+bool ft_handle_packed_chunk(const char* seq_str, const char* crc16_str, const char* base85_data);
 bool ft_handle_end(const char* crc_str);
 bool ft_handle_status(void);
 
+// Writes out buffered chunks once a transfer has gone idle; call once per frame.
+void ft_update(void);
+
 #endif /* ft_h */
@@ -5,7 +5,11 @@
 
 #include "gbz.h"
 
+#include "../libs/lz4/lz4.h"
 #include "../libs/miniz/mini_gzip.h"
+#include "../libs/miniz/miniz.h"
+#include "crc32.h"
+#include "utility.h"
 
 #include <string.h>
 
@@ -20,7 +24,7 @@ bool gbz_parse_header(GBZ_Header* out_header, const uint8_t* data, size_t size)
         return false;
 
     uint8_t version = p[8];
-    if (version != 1)
+    if (version != 1 && version != 2)
         return false;
 
     for (size_t i = GBZ_FF_CHECK_START; i < GBZ_FF_CHECK_END; i++)
@@ -40,6 +44,37 @@ bool gbz_parse_header(GBZ_Header* out_header, const uint8_t* data, size_t size)
 
     memcpy(out_header->gb_header, p + 18, GBZ_ROM_HDR_SIZE);
 
+    out_header->gz_data = NULL;
+    out_header->gz_size = 0;
+    out_header->bank_count = 0;
+    out_header->block_index = NULL;
+
+    if (version == 2)
+    {
+        out_header->bank_count =
+            (out_header->original_size + GBZ_BANK_SIZE - 1) / GBZ_BANK_SIZE;
+
+        if (size < gbz_index_end(out_header))
+        {
+            // only a prefix of the file; index not available
+            return true;
+        }
+
+        out_header->block_index = p + GBZ_INDEX_OFFSET;
+
+        // blocks must follow the index, in order
+        uint32_t offset, block_size;
+        for (unsigned i = 0; i < out_header->bank_count; ++i)
+        {
+            if (!gbz_get_block(out_header, i, &offset, &block_size))
+                return false;
+            if (i == 0 && offset != gbz_index_end(out_header))
+                return false;
+        }
+
+        return true;
+    }
+
     if (size == GBZ_GZ_OFFSET)
     {
         // Header-only file: no gz data
@@ -65,6 +100,63 @@ bool gbz_parse_header(GBZ_Header* out_header, const uint8_t* data, size_t size)
     return true;
 }
 
+static uint32_t read_u32_le(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+size_t gbz_index_end(const GBZ_Header* header)
+{
+    return GBZ_INDEX_OFFSET + 4 * ((size_t)header->bank_count + 1);
+}
+
+bool gbz_get_block(const GBZ_Header* header, unsigned bank, uint32_t* o_offset, uint32_t* o_size)
+{
+    if (!header->block_index || bank >= header->bank_count)
+        return false;
+
+    uint32_t start = read_u32_le(header->block_index + 4 * bank);
+    uint32_t end = read_u32_le(header->block_index + 4 * (bank + 1));
+    if (end < start || end - start > GBZ_BANK_SIZE + GBZ_BANK_SIZE / 255 + 16)
+        return false;
+
+    *o_offset = start;
+    *o_size = end - start;
+    return true;
+}
+
+size_t gbz_bank_size(const GBZ_Header* header, unsigned bank)
+{
+    size_t start = (size_t)bank * GBZ_BANK_SIZE;
+    if (start >= header->original_size)
+        return 0;
+    size_t remaining = header->original_size - start;
+    return remaining < GBZ_BANK_SIZE ? remaining : GBZ_BANK_SIZE;
+}
+
+int gbz_decompress_bank(
+    const GBZ_Header* header, unsigned bank, const uint8_t* block, size_t block_size,
+    uint8_t* out, size_t out_max
+)
+{
+    size_t bank_size = gbz_bank_size(header, bank);
+    if (bank_size == 0 || bank_size > out_max)
+        return -2;
+
+    // stored
+    if (block_size == bank_size)
+    {
+        memcpy(out, block, bank_size);
+        return (int)bank_size;
+    }
+
+    int decoded = LZ4_decompress_safe((const char*)block, (char*)out, block_size, bank_size);
+    if (decoded != (int)bank_size)
+        return -4;
+
+    return decoded;
+}
+
 uint8_t gbz_read_header_byte(const GBZ_Header* header, uint16_t rom_address)
 {
     if (rom_address < GBZ_ROM_HDR_START || rom_address > GBZ_ROM_HDR_END)
@@ -81,6 +173,29 @@ int gbz_decompress(const uint8_t* data, size_t size, uint8_t* out_buf, size_t ou
     if (header.original_size > out_max)
         return -2;
 
+    if (header.version == 2)
+    {
+        if (!header.block_index)
+            return -3;
+
+        for (unsigned i = 0; i < header.bank_count; ++i)
+        {
+            uint32_t offset, block_size;
+            if (!gbz_get_block(&header, i, &offset, &block_size) ||
+                offset + block_size > size)
+                return -3;
+
+            int status = gbz_decompress_bank(
+                &header, i, data + offset, block_size, out_buf + (size_t)i * GBZ_BANK_SIZE,
+                out_max - (size_t)i * GBZ_BANK_SIZE
+            );
+            if (status < 0)
+                return status;
+        }
+
+        return (int)header.original_size;
+    }
+
     struct mini_gzip gz;
     int status = mini_gz_start(&gz, (void*)header.gz_data, header.gz_size);
     if (status != 0)
@@ -92,3 +207,478 @@ int gbz_decompress(const uint8_t* data, size_t size, uint8_t* out_buf, size_t ou
 
     return (int)header.original_size;
 }
+
+// ============================================================================
+// Streaming decoder
+// ============================================================================
+
+// inflate output window, when decoding to a sink
+#define GBZ_STREAM_WINDOW 4096
+
+// largest v2 block gbz_get_block accepts
+#define GBZ_MAX_BLOCK_SIZE (GBZ_BANK_SIZE + GBZ_BANK_SIZE / 255 + 16)
+
+// gzip header flags
+#define GZ_FHCRC 0x02
+#define GZ_FEXTRA 0x04
+#define GZ_FNAME 0x08
+#define GZ_FCOMMENT 0x10
+
+typedef enum
+{
+    GBZ_PHASE_HEADER,  // gbz header (and, for v2, the block index)
+    GBZ_PHASE_GZ_HEADER,
+    GBZ_PHASE_INFLATE,
+    GBZ_PHASE_BLOCKS,
+    GBZ_PHASE_DONE,
+    GBZ_PHASE_ERROR,
+} GBZ_StreamPhase;
+
+typedef enum
+{
+    GZ_FIXED,
+    GZ_EXTRA_LEN,
+    GZ_EXTRA,
+    GZ_NAME,
+    GZ_COMMENT,
+    GZ_HCRC,
+} GZ_HeaderField;
+
+struct GBZ_Stream
+{
+    GBZ_StreamPhase phase;
+    GBZ_Header header;
+    bool header_valid;
+
+    // gbz header + v2 block index, accumulated until complete
+    uint8_t* head;
+    size_t head_size;
+    size_t head_need;
+
+    uint8_t* out;
+    size_t out_max;
+    size_t total_out;
+    CB_CRC32 crc;
+    gbz_sink_fn sink;
+    void* ud;
+
+    // sink mode: inflate window, or one decoded bank
+    uint8_t* window;
+
+    // v1
+    GZ_HeaderField gz_field;
+    uint8_t gz_fixed[10];
+    size_t gz_pos;
+    size_t gz_skip;
+    mz_stream z;
+    bool z_init;
+
+    // v2
+    unsigned bank;
+    uint8_t* block;
+    uint32_t block_size;
+    uint32_t block_fill;
+};
+
+GBZ_Stream* gbz_stream_new(uint8_t* out, size_t out_max, gbz_sink_fn sink, void* ud)
+{
+    if (!out && !sink)
+        return NULL;
+
+    GBZ_Stream* stream = allocz(GBZ_Stream);
+    if (!stream)
+        return NULL;
+
+    stream->head = cb_malloc(GBZ_INDEX_OFFSET);
+    if (!stream->head)
+    {
+        cb_free(stream);
+        return NULL;
+    }
+
+    cb_crc32_init(&stream->crc);
+    stream->phase = GBZ_PHASE_HEADER;
+    stream->head_need = GBZ_INDEX_OFFSET;
+    stream->out = out;
+    stream->out_max = out_max;
+    stream->sink = sink;
+    stream->ud = ud;
+    return stream;
+}
+
+void gbz_stream_free(GBZ_Stream* stream)
+{
+    if (!stream)
+        return;
+
+    if (stream->z_init)
+        mz_inflateEnd(&stream->z);
+
+    cb_free(stream->head);
+    cb_free(stream->window);
+    cb_free(stream->block);
+    cb_free(stream);
+}
+
+const GBZ_Header* gbz_stream_header(const GBZ_Stream* stream)
+{
+    return stream->header_valid ? &stream->header : NULL;
+}
+
+size_t gbz_stream_total_out(const GBZ_Stream* stream)
+{
+    return stream->total_out;
+}
+
+uint32_t gbz_stream_crc32(const GBZ_Stream* stream)
+{
+    return cb_crc32_final(&stream->crc);
+}
+
+// data has been decoded (in place, if decoding to the caller's buffer)
+static bool gbz_stream_emit(GBZ_Stream* stream, const uint8_t* data, size_t size)
+{
+    if (stream->total_out + size > stream->header.original_size)
+        return false;
+
+    cb_crc32_update(&stream->crc, data, size);
+
+    if (!stream->out && !stream->sink(stream->ud, data, size))
+        return false;
+
+    stream->total_out += size;
+    return true;
+}
+
+// the whole ROM is out; check it against the header
+static bool gbz_stream_finish(GBZ_Stream* stream)
+{
+    if (stream->total_out != stream->header.original_size ||
+        gbz_stream_crc32(stream) != stream->header.crc32)
+        return false;
+
+    stream->phase = GBZ_PHASE_DONE;
+    return true;
+}
+
+static bool gbz_stream_start_blocks(GBZ_Stream* stream)
+{
+    // re-parse with the whole index present, which also validates it
+    if (!gbz_parse_header(&stream->header, stream->head, stream->head_size) ||
+        !stream->header.block_index)
+        return false;
+
+    stream->block = cb_malloc(GBZ_MAX_BLOCK_SIZE);
+    if (!stream->block)
+        return false;
+
+    stream->bank = 0;
+    stream->block_fill = 0;
+    if (stream->header.bank_count == 0)
+        return gbz_stream_finish(stream);
+
+    uint32_t offset;
+    if (!gbz_get_block(&stream->header, 0, &offset, &stream->block_size))
+        return false;
+
+    stream->phase = GBZ_PHASE_BLOCKS;
+    return true;
+}
+
+static bool gbz_stream_parsed_head(GBZ_Stream* stream)
+{
+    if (stream->head_size == GBZ_INDEX_OFFSET)
+    {
+        if (!gbz_parse_header(&stream->header, stream->head, stream->head_size))
+            return false;
+
+        if (stream->out && stream->header.original_size > stream->out_max)
+            return false;
+
+        stream->header_valid = true;
+
+        if (stream->header.version == 2)
+        {
+            size_t index_end = gbz_index_end(&stream->header);
+            uint8_t* head = cb_realloc(stream->head, index_end);
+            if (!head)
+                return false;
+            stream->head = head;
+            stream->head_need = index_end;
+
+            if (!stream->out)
+            {
+                stream->window = cb_malloc(GBZ_BANK_SIZE);
+                if (!stream->window)
+                    return false;
+            }
+        }
+        else
+        {
+            stream->phase = GBZ_PHASE_GZ_HEADER;
+            stream->gz_field = GZ_FIXED;
+            stream->gz_pos = 0;
+
+            if (!stream->out)
+            {
+                stream->window = cb_malloc(GBZ_STREAM_WINDOW);
+                if (!stream->window)
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    if (stream->head_size == stream->head_need)
+        return gbz_stream_start_blocks(stream);
+
+    return true;
+}
+
+// Consumes gzip header bytes; returns the number used.
+static size_t gbz_stream_gz_header(GBZ_Stream* stream, const uint8_t* data, size_t size)
+{
+    size_t i = 0;
+    uint8_t flags = stream->gz_fixed[3];
+
+    while (i < size && stream->phase == GBZ_PHASE_GZ_HEADER)
+    {
+        uint8_t c = data[i++];
+        switch (stream->gz_field)
+        {
+        case GZ_FIXED:
+            stream->gz_fixed[stream->gz_pos++] = c;
+            if (stream->gz_pos < sizeof(stream->gz_fixed))
+                break;
+
+            flags = stream->gz_fixed[3];
+            if (stream->gz_fixed[0] != 0x1F || stream->gz_fixed[1] != 0x8B ||
+                stream->gz_fixed[2] != 8)
+            {
+                stream->phase = GBZ_PHASE_ERROR;
+                break;
+            }
+            stream->gz_pos = 0;
+            stream->gz_skip = 0;
+            stream->gz_field = GZ_EXTRA_LEN;
+            goto next_field;
+
+        case GZ_EXTRA_LEN:
+            stream->gz_skip |= (size_t)c << (8 * stream->gz_pos++);
+            if (stream->gz_pos == 2)
+            {
+                stream->gz_field = GZ_EXTRA;
+                if (stream->gz_skip == 0)
+                    goto next_field;
+            }
+            break;
+
+        case GZ_EXTRA:
+            if (--stream->gz_skip == 0)
+            {
+                stream->gz_field = GZ_NAME;
+                goto next_field;
+            }
+            break;
+
+        case GZ_NAME:
+            if (c == 0)
+            {
+                stream->gz_field = GZ_COMMENT;
+                goto next_field;
+            }
+            break;
+
+        case GZ_COMMENT:
+            if (c == 0)
+            {
+                stream->gz_field = GZ_HCRC;
+                goto next_field;
+            }
+            break;
+
+        case GZ_HCRC:
+            if (++stream->gz_pos == 2)
+            {
+                stream->phase = GBZ_PHASE_INFLATE;
+            }
+            break;
+        }
+        continue;
+
+    next_field:
+        // skip over the optional fields that aren't present
+        if (stream->gz_field == GZ_EXTRA_LEN && !(flags & GZ_FEXTRA))
+            stream->gz_field = GZ_NAME;
+        if (stream->gz_field == GZ_NAME && !(flags & GZ_FNAME))
+            stream->gz_field = GZ_COMMENT;
+        if (stream->gz_field == GZ_COMMENT && !(flags & GZ_FCOMMENT))
+            stream->gz_field = GZ_HCRC;
+        // whichever field came before, the CRC16 is counted from 0
+        if (stream->gz_field == GZ_HCRC)
+            stream->gz_pos = 0;
+        if (stream->gz_field == GZ_HCRC && !(flags & GZ_FHCRC))
+            stream->phase = GBZ_PHASE_INFLATE;
+    }
+
+    if (stream->phase == GBZ_PHASE_INFLATE)
+    {
+        memset(&stream->z, 0, sizeof(stream->z));
+        if (mz_inflateInit2(&stream->z, -MZ_DEFAULT_WINDOW_BITS) != MZ_OK)
+            stream->phase = GBZ_PHASE_ERROR;
+        else
+            stream->z_init = true;
+    }
+
+    return i;
+}
+
+static bool gbz_stream_inflate(GBZ_Stream* stream, const uint8_t* data, size_t size)
+{
+    mz_stream* z = &stream->z;
+    z->next_in = data;
+    z->avail_in = size;
+
+    for (;;)
+    {
+        size_t produced;
+        if (stream->out)
+        {
+            z->next_out = stream->out + stream->total_out;
+            z->avail_out = stream->header.original_size - stream->total_out;
+        }
+        else
+        {
+            z->next_out = stream->window;
+            z->avail_out = GBZ_STREAM_WINDOW;
+        }
+        size_t avail_out = z->avail_out;
+
+        int status = mz_inflate(z, MZ_SYNC_FLUSH);
+        produced = avail_out - z->avail_out;
+
+        if (produced && !gbz_stream_emit(stream, z->next_out - produced, produced))
+            return false;
+
+        if (status == MZ_STREAM_END)
+        {
+            // the gzip trailer is left unread; the ROM CRC is checked instead
+            return gbz_stream_finish(stream);
+        }
+
+        // called with no input left: wait for more
+        if (status == MZ_BUF_ERROR)
+            return true;
+
+        if (status != MZ_OK)
+            return false;
+
+        if (z->avail_in == 0 && (z->avail_out > 0 || stream->out))
+            return true;
+
+        // input left but nothing came out: the ROM is longer than its header says
+        if (produced == 0)
+            return false;
+    }
+}
+
+static size_t gbz_stream_blocks(GBZ_Stream* stream, const uint8_t* data, size_t size)
+{
+    size_t used = 0;
+    while (used < size && stream->phase == GBZ_PHASE_BLOCKS)
+    {
+        size_t n = MIN(size - used, stream->block_size - stream->block_fill);
+        memcpy(stream->block + stream->block_fill, data + used, n);
+        stream->block_fill += n;
+        used += n;
+
+        if (stream->block_fill < stream->block_size)
+            break;
+
+        unsigned bank = stream->bank;
+        uint8_t* dst = stream->out ? stream->out + (size_t)bank * GBZ_BANK_SIZE : stream->window;
+        int decoded = gbz_decompress_bank(
+            &stream->header, bank, stream->block, stream->block_size, dst, GBZ_BANK_SIZE
+        );
+        if (decoded < 0)
+        {
+            stream->phase = GBZ_PHASE_ERROR;
+            break;
+        }
+
+        if (!gbz_stream_emit(stream, dst, decoded))
+        {
+            stream->phase = GBZ_PHASE_ERROR;
+            break;
+        }
+
+        stream->bank++;
+        stream->block_fill = 0;
+        if (stream->bank == stream->header.bank_count)
+        {
+            if (!gbz_stream_finish(stream))
+                stream->phase = GBZ_PHASE_ERROR;
+        }
+        else
+        {
+            uint32_t offset;
+            if (!gbz_get_block(&stream->header, stream->bank, &offset, &stream->block_size))
+                stream->phase = GBZ_PHASE_ERROR;
+        }
+    }
+    return used;
+}
+
+int gbz_stream_feed(GBZ_Stream* stream, const uint8_t* data, size_t size)
+{
+    while (size > 0)
+    {
+        size_t used = 0;
+        switch (stream->phase)
+        {
+        case GBZ_PHASE_HEADER:
+            used = MIN(size, stream->head_need - stream->head_size);
+            memcpy(stream->head + stream->head_size, data, used);
+            stream->head_size += used;
+            if (stream->head_size == stream->head_need || stream->head_size == GBZ_INDEX_OFFSET)
+            {
+                if (!gbz_stream_parsed_head(stream))
+                    stream->phase = GBZ_PHASE_ERROR;
+            }
+            break;
+
+        case GBZ_PHASE_GZ_HEADER:
+            used = gbz_stream_gz_header(stream, data, size);
+            break;
+
+        case GBZ_PHASE_INFLATE:
+            if (!gbz_stream_inflate(stream, data, size))
+                stream->phase = GBZ_PHASE_ERROR;
+            used = size;
+            break;
+
+        case GBZ_PHASE_BLOCKS:
+            used = gbz_stream_blocks(stream, data, size);
+            break;
+
+        case GBZ_PHASE_DONE:
+            return GBZ_STREAM_DONE;
+
+        case GBZ_PHASE_ERROR:
+            return -1;
+        }
+
+        data += used;
+        size -= used;
+    }
+
+    switch (stream->phase)
+    {
+    case GBZ_PHASE_DONE:
+        return GBZ_STREAM_DONE;
+    case GBZ_PHASE_ERROR:
+        return -1;
+    default:
+        return GBZ_STREAM_MORE;
+    }
+}
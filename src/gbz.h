@@ -2,14 +2,23 @@
 //
 //  File layout:
 //    [0:8]   Magic: CB 00 FF 47 42 67 7A
-//    [8]     Compression scheme version (currently 1)
+//    [8]     Compression scheme version (1 or 2)
 //    [9]     1 if original file was .gbc, 0 if .gb
 //    [10:14] CRC32 of original ROM (big-endian)
 //    [14:18] Decompressed ROM size in bytes (little-endian uint32)
 //    [18:46] ROM header bytes 0x134–0x14F (title + cartridge info, no Nintendo logo)
 //    [46:0x150] 0xFF padding (bytes 0x100–0x14F are validated on parse)
+//
+//  Version 1:
 //    [0x150:]   gzip-compressed ROM data (absent if file is exactly 0x150 bytes)
 //
+//  Version 2 (block-compressed; each 16 KiB bank can be decoded on its own):
+//    [0x150:]   Block index: bank_count + 1 little-endian uint32 file offsets,
+//               where bank_count = ceil(size / 0x4000). Bank i's block spans
+//               [index[i], index[i + 1]).
+//    [...]      Blocks: raw LZ4 block data, or the bank stored as-is if the
+//               block is exactly the bank's size (compression didn't help).
+//
 
 #ifndef gbz_h
 #define gbz_h
@@ -26,6 +35,8 @@
 #define GBZ_FF_CHECK_START 0x100
 #define GBZ_FF_CHECK_END 0x150 /* exclusive */
 #define GBZ_GZ_OFFSET 0x150
+#define GBZ_INDEX_OFFSET 0x150
+#define GBZ_BANK_SIZE 0x4000
 
 typedef struct
 {
@@ -39,21 +50,77 @@ typedef struct
     // decompressed ROM size (from file header field)
     size_t original_size;
 
-    // pointer into source buffer, not owned
+    // v1: pointer into source buffer, not owned
     const uint8_t* gz_data;
     size_t gz_size;
+
+    // v2: number of 16 KiB banks, and the block index (bank_count + 1 offsets).
+    // block_index points into the source buffer (not owned), and is NULL
+    // if the buffer given to gbz_parse_header was too short to contain it.
+    uint32_t bank_count;
+    const uint8_t* block_index;
 } GBZ_Header;
 
 // Parse the gbz header from memory.
 // Returns false if the data is too short, magic is wrong, or version is unsupported.
+// For v2, data may be just a prefix of the file; the block index is then
+// only checked for consistency if it is fully contained in it.
 bool gbz_parse_header(GBZ_Header* o_gbz, const uint8_t* data, size_t size);
 
+// v2: bytes of file needed to read the header and the whole block index.
+size_t gbz_index_end(const GBZ_Header* header);
+
+// v2: locates bank's block in the file. Requires header->block_index.
+// Returns false if the bank is out of range or the index is inconsistent.
+bool gbz_get_block(const GBZ_Header* header, unsigned bank, uint32_t* o_offset, uint32_t* o_size);
+
+// v2: decoded size of the bank (only the last one can be short).
+size_t gbz_bank_size(const GBZ_Header* header, unsigned bank);
+
+// v2: decode one bank's block into out (capacity out_max).
+// Returns the number of bytes written, or negative on failure.
+int gbz_decompress_bank(
+    const GBZ_Header* header, unsigned bank, const uint8_t* block, size_t block_size,
+    uint8_t* out, size_t out_max
+);
+
 // Return the byte at rom_address from the embedded ROM header blob,
 // if rom_address falls within 0x134–0x14F. Otherwise, returns 0.
 uint8_t gbz_read_header_byte(const GBZ_Header* header, uint16_t rom_address);
 
-// Decompress the gbz ROM data into out_buf (capacity out_max).
+// Decompress the whole gbz ROM (either version) into out_buf (capacity out_max).
 // Returns the number of bytes written, or negative on failure.
 int gbz_decompress(const uint8_t* data, size_t size, uint8_t* out_buf, size_t out_max);
 
+// Streaming decoder: the gbz file (either version) is fed in arbitrarily
+// sized pieces from its first byte, and decoded as it arrives, so the whole
+// compressed file never has to be resident.
+typedef struct GBZ_Stream GBZ_Stream;
+
+// Receives decoded ROM bytes, in order. Return false to abort.
+typedef bool (*gbz_sink_fn)(void* ud, const uint8_t* data, size_t size);
+
+// If out is given, the ROM is decoded straight into it (capacity out_max).
+// Otherwise it is passed to sink a window (at most one bank) at a time.
+GBZ_Stream* gbz_stream_new(uint8_t* out, size_t out_max, gbz_sink_fn sink, void* ud);
+
+#define GBZ_STREAM_MORE 0
+#define GBZ_STREAM_DONE 1
+
+// Returns GBZ_STREAM_MORE while more input is needed, GBZ_STREAM_DONE once
+// the whole ROM has been decoded and verified (any further input is ignored),
+// or negative on failure.
+int gbz_stream_feed(GBZ_Stream* stream, const uint8_t* data, size_t size);
+
+// NULL until the file header has been fed.
+const GBZ_Header* gbz_stream_header(const GBZ_Stream* stream);
+
+size_t gbz_stream_total_out(const GBZ_Stream* stream);
+
+// CRC32 of the output so far. A stream only reaches GBZ_STREAM_DONE if this
+// matches the CRC in the header.
+uint32_t gbz_stream_crc32(const GBZ_Stream* stream);
+
+void gbz_stream_free(GBZ_Stream* stream);
+
 #endif /* gbz_h */
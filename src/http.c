@@ -1,11 +1,17 @@
 #include "http.h"
 
+#include "crc32.h"
+#include "http_cache.h"
 #include "utility.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #define MAX_HTTP 16
 
+// read size when streaming a body to a file
+#define HTTP_FILE_CHUNK 4096
+
 static enable_cb_t _cb;
 static void* _ud;
 char* _domain = NULL;
@@ -17,6 +23,7 @@ enum HttpHandleState
     Complete,
     Permission,
     Get,
+    Cached,  // waiting for http_update to deliver a cached response
 };
 
 struct HTTPUD
@@ -30,11 +37,39 @@ struct HTTPUD
     char* contentType;
     char* data;
     size_t data_len;
+    size_t data_capacity;
+    size_t content_length;  // 0 if not given
     int timeout;
+
+    // when streaming to a file: data is only a read buffer, and data_len counts
+    // the bytes written to temp_path
+    HTTPFileSink* sink;
+    char* file_path;
+    char* temp_path;
+    SDFile* file;
+    CB_CRC32 crc;
+
+    // for http_get_cached and revalidation: a successful response is stored
+    // with its validators. headers are sent with the request
+    bool cache_store;
+    char* etag;
+    char* last_modified;
+    char* headers;
+    struct HTTPUD* next_cached;
+
     unsigned flags;
     void* ud;
 };
 
+// a cached response to be checked with the server
+struct HTTPRevalidation
+{
+    char* domain;
+    char* path;
+    char* headers;
+    struct HTTPRevalidation* next;
+};
+
 struct HttpHandleInfo
 {
     http_handle_t handle;
@@ -50,6 +85,12 @@ struct HttpHandleInfo
 static http_handle_t next_handle = 1;
 struct HttpHandleInfo handle_info[MAX_HTTP];
 
+static struct HTTPUD* cached_pending = NULL;
+
+// checked one at a time, so they never crowd out requests someone is waiting on
+static struct HTTPRevalidation* revalidations = NULL;
+static bool revalidating = false;
+
 static void CB_Permission(unsigned flags, void* ud);
 
 struct HttpHandleInfo* get_handle_info(http_handle_t handle)
@@ -98,7 +139,8 @@ struct HttpHandleInfo* push_handle(void)
 
 static void http_get_(
     struct HTTPUD* httpud, struct HttpHandleInfo* info, const char* domain, const char* path,
-    const char* reason, http_result_cb cb, int timeout, void* ud
+    const char* reason, HTTPFileSink* sink, bool cache_store, const char* headers,
+    http_result_cb cb, int timeout, void* ud
 )
 {
     info->state = Permission;
@@ -114,6 +156,18 @@ static void http_get_(
     httpud->path = cb_strdup(path);
     httpud->location = NULL;
 
+    if (sink)
+    {
+        httpud->sink = sink;
+        httpud->file_path = cb_strdup(sink->path);
+        httpud->temp_path = aprintf("%s.tmp", sink->path);
+        cb_crc32_init(&httpud->crc);
+    }
+
+    httpud->cache_store = cache_store;
+    if (headers)
+        httpud->headers = cb_strdup(headers);
+
     enable_http(domain, reason, CB_Permission, httpud);
 }
 
@@ -144,8 +198,19 @@ static void http_cleanup(HTTPConnection* connection)
             httpud->cb(httpud->flags, NULL, 0, httpud->ud);
         }
 
+        if (httpud->file)
+        {
+            // not committed; drop the partial download
+            playdate->file->close(httpud->file);
+            playdate->file->unlink(httpud->temp_path, 0);
+        }
+
         if (httpud->data)
             cb_free(httpud->data);
+        if (httpud->file_path)
+            cb_free(httpud->file_path);
+        if (httpud->temp_path)
+            cb_free(httpud->temp_path);
         if (httpud->location)
             cb_free(httpud->location);
         if (httpud->contentType)
@@ -154,6 +219,12 @@ static void http_cleanup(HTTPConnection* connection)
             cb_free(httpud->domain);
         if (httpud->path)
             cb_free(httpud->path);
+        if (httpud->etag)
+            cb_free(httpud->etag);
+        if (httpud->last_modified)
+            cb_free(httpud->last_modified);
+        if (httpud->headers)
+            cb_free(httpud->headers);
 
         cb_free(httpud);
     }
@@ -177,6 +248,38 @@ static void CB_Header(HTTPConnection* connection, const char* key, const char* v
     {
         httpud->location = cb_strdup(value);
     }
+    else if (strcasecmp(key, "Content-Length") == 0)
+    {
+        httpud->content_length = strtoul(value, NULL, 10);
+    }
+    else if (httpud->cache_store && strcasecmp(key, "ETag") == 0)
+    {
+        cb_free(httpud->etag);
+        httpud->etag = cb_strdup(value);
+    }
+    else if (httpud->cache_store && strcasecmp(key, "Last-Modified") == 0)
+    {
+        cb_free(httpud->last_modified);
+        httpud->last_modified = cb_strdup(value);
+    }
+}
+
+// Makes room for a body of `size` bytes plus a terminator. The buffer at least
+// doubles each time, so a large response is copied a few times in total rather
+// than once per packet.
+static bool http_reserve(struct HTTPUD* httpud, size_t size)
+{
+    if (size < httpud->data_capacity)
+        return true;
+
+    size_t capacity = MAX(size + 1, MAX(httpud->data_capacity * 2, 1024));
+    char* data = cb_realloc(httpud->data, capacity);
+    if (!data)
+        return false;
+
+    httpud->data = data;
+    httpud->data_capacity = capacity;
+    return true;
 }
 
 static void CB_HeadersRead(HTTPConnection* connection)
@@ -187,11 +290,20 @@ static void CB_HeadersRead(HTTPConnection* connection)
 
     int status = playdate->network->http->getResponseStatus(connection);
 
-    if (httpud->location)
+    if (status == 304)
+    {
+        httpud->flags |= HTTP_NOT_MODIFIED;
+    }
+    else if (httpud->location)
     {
         playdate->system->logToConsole("Redirect detected to: %s", httpud->location);
         httpud->flags |= HTTP_REDIRECT;
     }
+    else if (!httpud->sink && httpud->content_length > 0)
+    {
+        // a failure here will show up when the data arrives
+        http_reserve(httpud, httpud->content_length);
+    }
 }
 
 static void CB_Closed(HTTPConnection* connection)
@@ -199,6 +311,56 @@ static void CB_Closed(HTTPConnection* connection)
     http_cleanup(connection);
 }
 
+// these return 0, or the error flag
+
+static unsigned read_to_memory(HTTPConnection* connection, struct HTTPUD* httpud, size_t available)
+{
+    if (!http_reserve(httpud, httpud->data_len + available))
+        return HTTP_MEM_ERROR;
+
+    int read =
+        playdate->network->http->read(connection, httpud->data + httpud->data_len, available);
+    if (read <= 0)
+        return HTTP_ERROR;
+
+    httpud->data_len += read;
+    httpud->data[httpud->data_len] = 0;
+    return 0;
+}
+
+static unsigned read_to_file(HTTPConnection* connection, struct HTTPUD* httpud, size_t available)
+{
+    if (!httpud->file)
+    {
+        if (!httpud->data)
+        {
+            httpud->data = cb_malloc(HTTP_FILE_CHUNK);
+            if (!httpud->data)
+                return HTTP_MEM_ERROR;
+        }
+
+        if (!httpud->file_path || !httpud->temp_path)
+            return HTTP_MEM_ERROR;
+
+        httpud->file = playdate->file->open(httpud->temp_path, kFileWrite);
+        if (!httpud->file)
+            return HTTP_FILE_ERROR;
+    }
+
+    int read = playdate->network->http->read(
+        connection, httpud->data, MIN(available, (size_t)HTTP_FILE_CHUNK)
+    );
+    if (read <= 0)
+        return HTTP_ERROR;
+
+    if (playdate->file->write(httpud->file, httpud->data, read) != read)
+        return HTTP_FILE_ERROR;
+
+    cb_crc32_update(&httpud->crc, httpud->data, read);
+    httpud->data_len += read;
+    return 0;
+}
+
 static void readAllData(HTTPConnection* connection)
 {
     struct HTTPUD* httpud = playdate->network->http->getUserdata(connection);
@@ -211,7 +373,7 @@ static void readAllData(HTTPConnection* connection)
         if (httpud->cb)
         {
             int response = playdate->network->http->getResponseStatus(connection);
-            if (response != 0 && response != 200)
+            if (response != 0 && response != 200 && response != 304)
             {
                 if (response == 404)
                 {
@@ -247,33 +409,14 @@ static void readAllData(HTTPConnection* connection)
         }
         else if (httpud && httpud->cb)
         {
-            struct HttpHandleInfo* info = get_handle_info(httpud->handle);
+            unsigned error = httpud->sink ? read_to_file(connection, httpud, available)
+                                          : read_to_memory(connection, httpud, available);
 
-            httpud->data = cb_realloc(httpud->data, httpud->data_len + available + 1);
-            if (httpud->data == NULL)
+            if (error)
             {
-                httpud->flags |= HTTP_MEM_ERROR;
-                if (info)
-                {
-                    info->state = Complete;
-                    info->flags = httpud->flags;
-                }
-                httpud->cb(httpud->flags, NULL, 0, httpud->ud);
-                httpud->cb = NULL;
-                return;
-            }
-            int read = playdate->network->http->read(
-                connection, httpud->data + httpud->data_len, available
-            );
+                struct HttpHandleInfo* info = get_handle_info(httpud->handle);
 
-            if (read > 0)
-            {
-                httpud->data_len += read;
-                httpud->data[httpud->data_len] = 0;
-            }
-            else if (read <= 0)
-            {
-                httpud->flags |= HTTP_ERROR;
+                httpud->flags |= error;
                 if (info)
                 {
                     info->state = Complete;
@@ -322,16 +465,46 @@ static void CB_RequestComplete(HTTPConnection* connection)
 
     bool is_redirect = (saved_flags & HTTP_REDIRECT) && location_copy;
     bool is_html_error = httpud->contentType && strstr(httpud->contentType, "text/html");
-    bool is_success = !is_redirect && !is_html_error && httpud->data && httpud->data_len > 0;
+    bool is_success =
+        saved_cb && !is_redirect && !is_html_error && httpud->data && httpud->data_len > 0;
 
-    if (is_success)
+    if (is_success && httpud->sink)
     {
+        playdate->file->close(httpud->file);
+        httpud->file = NULL;
+
+        if (playdate->file->rename(httpud->temp_path, httpud->file_path) == 0)
+        {
+            httpud->sink->size = httpud->data_len;
+            httpud->sink->crc32 = cb_crc32_final(&httpud->crc);
+            data_len = httpud->data_len;
+        }
+        else
+        {
+            playdate->file->unlink(httpud->temp_path, 0);
+            saved_flags |= HTTP_FILE_ERROR;
+            is_success = false;
+        }
+    }
+    else if (is_success)
+    {
+        if (httpud->cache_store)
+        {
+            http_cache_store(
+                httpud->domain, httpud->path, httpud->data, httpud->data_len, httpud->etag,
+                httpud->last_modified
+            );
+        }
+
         data_stolen = httpud->data;
         data_len = httpud->data_len;
         httpud->data = NULL;
         // FIXME: when is this freed?
     }
 
+    if ((saved_flags & HTTP_NOT_MODIFIED) && httpud->cache_store)
+        http_cache_mark_checked(httpud->domain, httpud->path);
+
     if (info)
     {
         info->state = Complete;
@@ -361,7 +534,9 @@ static void CB_RequestComplete(HTTPConnection* connection)
         else
         {
             unsigned err_flags = saved_flags;
-            if (!(err_flags & (HTTP_ERROR | HTTP_NOT_FOUND | HTTP_CANCELLED)))
+            const unsigned explained =
+                HTTP_ERROR | HTTP_NOT_FOUND | HTTP_CANCELLED | HTTP_FILE_ERROR | HTTP_NOT_MODIFIED;
+            if (!(err_flags & explained))
             {
                 err_flags |= HTTP_ERROR;
             }
@@ -407,7 +582,10 @@ static void CB_Permission(unsigned flags, void* ud)
         playdate->network->http->setRequestCompleteCallback(connection, CB_RequestComplete);
         playdate->network->http->setConnectTimeout(connection, httpud->timeout);
 
-        PDNetErr err = playdate->network->http->get(connection, httpud->path, NULL, 0);
+        PDNetErr err = playdate->network->http->get(
+            connection, httpud->path, httpud->headers,
+            httpud->headers ? strlen(httpud->headers) : 0
+        );
         if (err != NET_OK)
         {
             flags |= HTTP_ERROR;
@@ -439,15 +617,21 @@ static void CB_Permission(unsigned flags, void* ud)
             cb_free(httpud->data);
         if (httpud->contentType)
             cb_free(httpud->contentType);
+        if (httpud->file_path)
+            cb_free(httpud->file_path);
+        if (httpud->temp_path)
+            cb_free(httpud->temp_path);
+        if (httpud->headers)
+            cb_free(httpud->headers);
         cb_free(httpud->domain);
         cb_free(httpud->path);
         cb_free(httpud);
     }
 }
 
-http_handle_t http_get(
-    const char* domain, const char* path, const char* reason, http_result_cb cb, int timeout,
-    void* ud
+static http_handle_t http_request(
+    const char* domain, const char* path, const char* reason, HTTPFileSink* sink,
+    bool cache_store, const char* headers, http_result_cb cb, int timeout, void* ud
 )
 {
     struct HTTPUD* httpud = cb_malloc(sizeof(struct HTTPUD));
@@ -460,11 +644,27 @@ http_handle_t http_get(
     struct HttpHandleInfo* info = push_handle();
     CB_ASSERT(info);
 
-    http_get_(httpud, info, domain, path, reason, cb, timeout, ud);
+    http_get_(httpud, info, domain, path, reason, sink, cache_store, headers, cb, timeout, ud);
 
     return info->handle;
 }
 
+http_handle_t http_get_to_file(
+    const char* domain, const char* path, const char* reason, HTTPFileSink* sink,
+    http_result_cb cb, int timeout, void* ud
+)
+{
+    return http_request(domain, path, reason, sink, false, NULL, cb, timeout, ud);
+}
+
+http_handle_t http_get(
+    const char* domain, const char* path, const char* reason, http_result_cb cb, int timeout,
+    void* ud
+)
+{
+    return http_get_to_file(domain, path, reason, NULL, cb, timeout, ud);
+}
+
 struct CB_UserData_EnableHTTP
 {
     enable_cb_t cb;
@@ -611,6 +811,158 @@ void enable_http(const char* domain, const char* reason, enable_cb_t cb, void* u
     playdate->network->setEnabled(true, CB_CheckWifiStatus);
 }
 
+static void queue_revalidation(const char* domain, const char* path, const HTTPCacheRecord* record)
+{
+    for (struct HTTPRevalidation* r = revalidations; r; r = r->next)
+    {
+        if (!strcmp(r->path, path) && !strcmp(r->domain, domain))
+            return;
+    }
+
+    struct HTTPRevalidation* revalidation = allocz(struct HTTPRevalidation);
+    if (!revalidation)
+        return;
+
+    revalidation->domain = cb_strdup(domain);
+    revalidation->path = cb_strdup(path);
+    if (record->etag[0])
+        revalidation->headers = aprintf("If-None-Match: %s\r\n", record->etag);
+    else if (record->last_modified[0])
+        revalidation->headers = aprintf("If-Modified-Since: %s\r\n", record->last_modified);
+
+    struct HTTPRevalidation** link = &revalidations;
+    while (*link)
+        link = &(*link)->next;
+    *link = revalidation;
+}
+
+static void revalidate_cb(unsigned flags, char* data, size_t data_len, void* ud)
+{
+    revalidating = false;
+
+    // a new body has been stored by now; a redirect's location belongs to http.c
+    if (data && !(flags & HTTP_REDIRECT))
+        cb_free(data);
+}
+
+http_handle_t http_get_cached(
+    const char* domain, const char* path, const char* reason, http_result_cb cb, int timeout,
+    void* ud
+)
+{
+    size_t size;
+    HTTPCacheRecord record;
+    char* body = http_cache_load(domain, path, &size, &record);
+    if (!body)
+        return http_request(domain, path, reason, NULL, true, NULL, cb, timeout, ud);
+
+    struct HTTPUD* httpud = allocz(struct HTTPUD);
+    if (!httpud)
+    {
+        cb_free(body);
+        cb(HTTP_MEM_ERROR, NULL, 0, ud);
+        return 0;
+    }
+
+    struct HttpHandleInfo* info = push_handle();
+    CB_ASSERT(info);
+
+    info->state = Cached;
+    info->httpud = httpud;
+    httpud->handle = info->handle;
+    httpud->cb = cb;
+    httpud->ud = ud;
+    httpud->data = body;
+    httpud->data_len = size;
+
+    struct HTTPUD** link = &cached_pending;
+    while (*link)
+        link = &(*link)->next_cached;
+    *link = httpud;
+
+    uint32_t now = playdate->system->getSecondsSinceEpoch(NULL);
+    if (now - record.checked >= HTTP_CACHE_FRESH_SECONDS)
+        queue_revalidation(domain, path, &record);
+
+    return info->handle;
+}
+
+void http_update(void)
+{
+    // cached responses are delivered from here rather than from http_get_cached,
+    // so that the caller always has its handle before the callback runs
+    while (cached_pending)
+    {
+        struct HTTPUD* httpud = cached_pending;
+        cached_pending = httpud->next_cached;
+
+        struct HttpHandleInfo* info = get_handle_info(httpud->handle);
+        if (info)
+        {
+            info->state = Complete;
+            info->flags = 0;
+        }
+
+        // the callee owns the data
+        httpud->cb(0, httpud->data, httpud->data_len, httpud->ud);
+        cb_free(httpud);
+    }
+
+    http_cache_flush();
+}
+
+bool http_start_revalidation(void)
+{
+    // never prompts for permission on its own; a stale copy is better than
+    // an unexpected dialog
+    if (!revalidations || revalidating || !skip_enable_check)
+        return false;
+
+    struct HTTPRevalidation* revalidation = revalidations;
+    revalidations = revalidation->next;
+
+    playdate->system->logToConsole(
+        "Revalidating cached %s%s", revalidation->domain, revalidation->path
+    );
+
+    revalidating = true;
+    http_request(
+        revalidation->domain, revalidation->path, "to refresh cached data", NULL, true,
+        revalidation->headers, revalidate_cb, 15000, NULL
+    );
+
+    cb_free(revalidation->domain);
+    cb_free(revalidation->path);
+    cb_free(revalidation->headers);
+    cb_free(revalidation);
+    return true;
+}
+
+bool http_revalidating(void)
+{
+    return revalidating;
+}
+
+bool http_split_url(const char* url, char** o_domain, char** o_path)
+{
+    const char* domain_start = strstr(url, "://");
+    if (!domain_start)
+        return false;
+    domain_start += 3;
+
+    const char* path_start = strchr(domain_start, '/');
+    if (!path_start)
+        return false;
+
+    size_t domain_len = path_start - domain_start;
+    *o_domain = cb_malloc(domain_len + 1);
+    strncpy(*o_domain, domain_start, domain_len);
+    (*o_domain)[domain_len] = '\0';
+
+    *o_path = cb_strdup(path_start);
+    return true;
+}
+
 void http_cancel(http_handle_t handle)
 {
     struct HttpHandleInfo* info = get_handle_info(handle);
@@ -630,6 +982,25 @@ void http_cancel(http_handle_t handle)
             // httpud will be cleaned up later, in CB_Permission()
         }
         break;
+    case Cached:
+    {
+        struct HTTPUD* httpud = info->httpud;
+        for (struct HTTPUD** link = &cached_pending; *link; link = &(*link)->next_cached)
+        {
+            if (*link == httpud)
+            {
+                *link = httpud->next_cached;
+                break;
+            }
+        }
+
+        info->state = Complete;
+        info->flags = HTTP_CANCELLED;
+        httpud->cb(info->flags, NULL, 0, httpud->ud);
+        cb_free(httpud->data);
+        cb_free(httpud);
+        break;
+    }
     case Get:
         info->state = Complete;
         info->httpud->flags |= HTTP_CANCELLED;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -19,6 +20,8 @@
 #define HTTP_WIFI_NOT_AVAILABLE 512
 #define HTTP_CANCELLED 1024
 #define HTTP_REDIRECT 2048
+#define HTTP_FILE_ERROR 4096
+#define HTTP_NOT_MODIFIED 8192 /* only seen when revalidating the response cache */
 
 typedef void (*enable_cb_t)(unsigned flags, void* ud);
 
@@ -39,6 +42,49 @@ http_handle_t http_get(
     void* ud
 );
 
+// Where http_get_to_file puts the response body: it is written to path + ".tmp"
+// as it arrives, and renamed over path once the request has succeeded (the
+// temporary file is removed otherwise). path is copied when the request is
+// made; the sink itself must stay valid until the callback.
+typedef struct
+{
+    const char* path;
+
+    // set before the callback is invoked on success
+    size_t size;
+    uint32_t crc32;
+} HTTPFileSink;
+
+// like http_get, but the body goes to a file rather than to memory, so its size
+// isn't bounded by free heap. On success, cb receives data == NULL and data_len
+// the number of bytes written (also in sink->size).
+http_handle_t http_get_to_file(
+    const char* domain, const char* path, const char* reason, HTTPFileSink* sink,
+    http_result_cb cb, int timeout_ms, void* ud
+);
+
+// like http_get, but answers from the response cache (see http_cache.h) when
+// it has the URL: cb then receives the cached body from http_update, without
+// waiting for the network, and the cached copy is revalidated in the
+// background for next time. Otherwise the request is made as usual and its
+// response is cached.
+http_handle_t http_get_cached(
+    const char* domain, const char* path, const char* reason, http_result_cb cb, int timeout_ms,
+    void* ud
+);
+
+// delivers cached responses; must be called once per frame
+void http_update(void);
+
+// Background revalidation of the response cache, one URL at a time. It is
+// started by http_sched_update, which counts it against its connections like
+// a background request. Returns true if a revalidation was started.
+bool http_start_revalidation(void);
+bool http_revalidating(void);
+
 // Manually cancels the given HTTP connection, if it has not already completed.
 // cb is invoked with error code HTTP_CANCELLED
 void http_cancel(http_handle_t);
+
+// splits e.g. a redirect's "https://domain/path" into caller-freed parts
+bool http_split_url(const char* url, char** o_domain, char** o_path);
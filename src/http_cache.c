@@ -0,0 +1,283 @@
+#include "http_cache.h"
+
+#include "crc32.h"
+#include "utility.h"
+
+#include <string.h>
+
+#define HTTP_CACHE_INDEX HTTP_CACHE_DIR "/index.bin"
+#define HTTP_CACHE_MAGIC "CBHC"
+#define HTTP_CACHE_VERSION 1
+#define HTTP_CACHE_HEADER_SIZE 12
+
+// lookups only refresh last_used, so the index is rewritten for them lazily
+#define HTTP_CACHE_FLUSH_INTERVAL_MS 5000
+
+static HTTPCacheRecord* records = NULL;
+static uint32_t record_count = 0;
+static uint32_t record_capacity = 0;
+static bool loaded = false;
+static bool dirty = false;
+static unsigned last_flush_ms = 0;
+
+static uint32_t http_cache_key(const char* domain, const char* path)
+{
+    CB_CRC32 crc;
+    cb_crc32_init(&crc);
+    cb_crc32_update(&crc, domain, strlen(domain));
+    cb_crc32_update(&crc, path, strlen(path));
+    return cb_crc32_final(&crc);
+}
+
+static char* http_cache_body_path(uint32_t key)
+{
+    return aprintf(HTTP_CACHE_DIR "/%08x", (unsigned)key);
+}
+
+static void http_cache_load_index(void)
+{
+    if (loaded)
+        return;
+    loaded = true;
+
+    size_t size;
+    uint8_t* data = (uint8_t*)cb_read_entire_file(HTTP_CACHE_INDEX, &size, kFileReadData);
+    if (!data)
+        return;
+
+    uint16_t version, record_size;
+    uint32_t count;
+    if (size >= HTTP_CACHE_HEADER_SIZE && memcmp(data, HTTP_CACHE_MAGIC, 4) == 0)
+    {
+        memcpy(&version, data + 4, 2);
+        memcpy(&record_size, data + 6, 2);
+        memcpy(&count, data + 8, 4);
+
+        if (version == HTTP_CACHE_VERSION && record_size == sizeof(HTTPCacheRecord) &&
+            count <= (size - HTTP_CACHE_HEADER_SIZE) / sizeof(HTTPCacheRecord) && count > 0)
+        {
+            records = cb_malloc(count * sizeof(HTTPCacheRecord));
+            if (records)
+            {
+                memcpy(records, data + HTTP_CACHE_HEADER_SIZE, count * sizeof(HTTPCacheRecord));
+                record_count = count;
+                record_capacity = count;
+            }
+        }
+    }
+
+    cb_free(data);
+}
+
+static void http_cache_write_index(void)
+{
+    size_t size = HTTP_CACHE_HEADER_SIZE + record_count * sizeof(HTTPCacheRecord);
+    uint8_t* data = cb_malloc(size);
+    if (!data)
+        return;
+
+    uint16_t version = HTTP_CACHE_VERSION;
+    uint16_t record_size = sizeof(HTTPCacheRecord);
+    memcpy(data, HTTP_CACHE_MAGIC, 4);
+    memcpy(data + 4, &version, 2);
+    memcpy(data + 6, &record_size, 2);
+    memcpy(data + 8, &record_count, 4);
+    if (record_count > 0)
+        memcpy(data + HTTP_CACHE_HEADER_SIZE, records, record_count * sizeof(HTTPCacheRecord));
+
+    // on failure, retried at the next flush interval
+    if (cb_write_entire_file(HTTP_CACHE_INDEX, data, size))
+        dirty = false;
+    last_flush_ms = playdate->system->getCurrentTimeMilliseconds();
+
+    cb_free(data);
+}
+
+static int http_cache_find(uint32_t key)
+{
+    for (uint32_t i = 0; i < record_count; ++i)
+    {
+        if (records[i].key == key)
+            return i;
+    }
+    return -1;
+}
+
+// deletes the body too
+static void http_cache_remove_at(uint32_t index)
+{
+    char* body_path = http_cache_body_path(records[index].key);
+    playdate->file->unlink(body_path, 0);
+    cb_free(body_path);
+
+    records[index] = records[--record_count];
+    dirty = true;
+}
+
+static void http_cache_evict(size_t incoming)
+{
+    for (;;)
+    {
+        size_t total = incoming;
+        int oldest = -1;
+        for (uint32_t i = 0; i < record_count; ++i)
+        {
+            total += records[i].size;
+            if (oldest < 0 || records[i].last_used < records[oldest].last_used)
+                oldest = i;
+        }
+
+        if (total <= HTTP_CACHE_MAX_BYTES || oldest < 0)
+            return;
+
+        http_cache_remove_at(oldest);
+    }
+}
+
+static void copy_validator(char* dst, size_t dst_size, const char* value)
+{
+    if (value && strlen(value) < dst_size)
+        strcpy(dst, value);
+    else
+        dst[0] = 0;
+}
+
+char* http_cache_load(
+    const char* domain, const char* path, size_t* o_size, HTTPCacheRecord* o_record
+)
+{
+    http_cache_load_index();
+
+    uint32_t key = http_cache_key(domain, path);
+    int index = http_cache_find(key);
+    if (index < 0)
+        return NULL;
+
+    char* body_path = http_cache_body_path(key);
+    size_t file_size;
+    char* data = cb_read_entire_file(body_path, &file_size, kFileReadData);
+    cb_free(body_path);
+
+    // the URL guards against CRC collisions, the size against a torn write
+    size_t domain_len = strlen(domain);
+    size_t path_len = strlen(path);
+    uint32_t url_len = 0;
+    if (data && file_size >= 4)
+        memcpy(&url_len, data, 4);
+
+    size_t header_size = 4 + (size_t)url_len;
+    if (!data || file_size < 4 || url_len != domain_len + path_len ||
+        file_size != header_size + records[index].size ||
+        memcmp(data + 4, domain, domain_len) != 0 ||
+        memcmp(data + 4 + domain_len, path, path_len) != 0)
+    {
+        cb_free(data);
+        http_cache_remove_at(index);
+        return NULL;
+    }
+
+    size_t size = records[index].size;
+    memmove(data, data + header_size, size);
+    data[size] = 0;
+
+    records[index].last_used = playdate->system->getSecondsSinceEpoch(NULL);
+    dirty = true;
+
+    if (o_size)
+        *o_size = size;
+    if (o_record)
+        *o_record = records[index];
+    return data;
+}
+
+void http_cache_store(
+    const char* domain, const char* path, const char* data, size_t size, const char* etag,
+    const char* last_modified
+)
+{
+    http_cache_load_index();
+
+    uint32_t key = http_cache_key(domain, path);
+    int index = http_cache_find(key);
+    if (index >= 0)
+        http_cache_remove_at(index);
+
+    if (size > HTTP_CACHE_MAX_ENTRY_BYTES)
+    {
+        if (dirty)
+            http_cache_write_index();
+        return;
+    }
+
+    if (record_count == record_capacity)
+    {
+        uint32_t capacity = MAX(16, record_capacity * 2);
+        HTTPCacheRecord* grown = cb_realloc(records, capacity * sizeof(HTTPCacheRecord));
+        if (!grown)
+            return;
+        records = grown;
+        record_capacity = capacity;
+    }
+
+    http_cache_evict(size);
+
+    playdate->file->mkdir(HTTP_CACHE_DIR);
+
+    char* body_path = http_cache_body_path(key);
+    SDFile* file = playdate->file->open(body_path, kFileWrite);
+    bool ok = file != NULL;
+    if (ok)
+    {
+        size_t domain_len = strlen(domain);
+        size_t path_len = strlen(path);
+        uint32_t url_len = domain_len + path_len;
+
+        ok = playdate->file->write(file, &url_len, 4) == 4 &&
+             playdate->file->write(file, domain, domain_len) == (int)domain_len &&
+             playdate->file->write(file, path, path_len) == (int)path_len &&
+             playdate->file->write(file, data, size) == (int)size;
+        playdate->file->close(file);
+
+        if (!ok)
+            playdate->file->unlink(body_path, 0);
+    }
+    cb_free(body_path);
+
+    if (ok)
+    {
+        uint32_t now = playdate->system->getSecondsSinceEpoch(NULL);
+
+        HTTPCacheRecord* record = &records[record_count++];
+        memset(record, 0, sizeof(*record));
+        record->key = key;
+        record->size = size;
+        record->last_used = now;
+        record->checked = now;
+        copy_validator(record->etag, sizeof(record->etag), etag);
+        copy_validator(record->last_modified, sizeof(record->last_modified), last_modified);
+    }
+
+    http_cache_write_index();
+}
+
+void http_cache_mark_checked(const char* domain, const char* path)
+{
+    http_cache_load_index();
+
+    int index = http_cache_find(http_cache_key(domain, path));
+    if (index < 0)
+        return;
+
+    records[index].checked = playdate->system->getSecondsSinceEpoch(NULL);
+    dirty = true;
+}
+
+void http_cache_flush(void)
+{
+    if (!dirty)
+        return;
+
+    unsigned now = playdate->system->getCurrentTimeMilliseconds();
+    if (now - last_flush_ms >= HTTP_CACHE_FLUSH_INTERVAL_MS)
+        http_cache_write_index();
+}
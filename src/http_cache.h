@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Keeps the bodies of successful GET responses in the data directory, so that
+// catalogs and screenshots can be shown without waiting for the network. Each
+// response keeps the validators the server sent (ETag, Last-Modified) so it
+// can be revalidated with a conditional request. The least recently used
+// responses are dropped once the total exceeds HTTP_CACHE_MAX_BYTES.
+//
+// Layout:
+//   http_cache/index.bin   "CBHC", u16 version, u16 record size, u32 count,
+//                          then the records
+//   http_cache/XXXXXXXX    u32 URL length, the URL, then the body; the name is
+//                          the record's key in hex
+
+#define HTTP_CACHE_DIR "http_cache"
+#define HTTP_CACHE_MAX_BYTES (2 * 1024 * 1024)
+#define HTTP_CACHE_MAX_ENTRY_BYTES (256 * 1024)
+
+// a response the server confirmed this recently isn't revalidated again
+#define HTTP_CACHE_FRESH_SECONDS (60 * 60)
+
+typedef struct
+{
+    uint32_t key;        // CRC32 of domain and path
+    uint32_t size;       // of the body
+    uint32_t last_used;  // seconds since epoch
+    uint32_t checked;    // when the server last sent or confirmed it
+
+    // "" if the server gave none (or one too long to keep)
+    char etag[64];
+    char last_modified[40];
+} HTTPCacheRecord;
+
+// Returns the caller-freed, NUL-terminated body of the cached response, or
+// NULL. If o_record is given it receives the entry's metadata.
+char* http_cache_load(
+    const char* domain, const char* path, size_t* o_size, HTTPCacheRecord* o_record
+);
+
+// Stores or replaces the response for the URL; etag and last_modified may be
+// NULL.
+void http_cache_store(
+    const char* domain, const char* path, const char* data, size_t size, const char* etag,
+    const char* last_modified
+);
+
+// Records that the server answered 304 Not Modified for the URL.
+void http_cache_mark_checked(const char* domain, const char* path);
+
+// Writes out the index if lookups have changed it; cheap to call often.
+void http_cache_flush(void);
@@ -4,27 +4,6 @@
 
 #include <string.h>
 
-// Helper to parse the redirect URL
-static bool parse_url_safe(const char* url, char** domain, char** path)
-{
-    const char* domain_start = strstr(url, "://");
-    if (!domain_start)
-        return false;
-    domain_start += 3;
-
-    const char* path_start = strchr(domain_start, '/');
-    if (!path_start)
-        return false;
-
-    size_t domain_len = path_start - domain_start;
-    *domain = cb_malloc(domain_len + 1);
-    strncpy(*domain, domain_start, domain_len);
-    (*domain)[domain_len] = '\0';
-
-    *path = cb_strdup(path_start);
-    return true;
-}
-
 // allow network stack to flush
 static void busy_wait(float seconds)
 {
@@ -40,6 +19,11 @@ HTTPSafe* http_safe_new(void)
     return allocz(HTTPSafe);
 }
 
+static void http_safe_replace_get_(
+    HTTPSafe* safe, const char* domain, const char* path, const char* reason, HTTPFileSink* sink,
+    bool cached, http_result_cb cb, int timeout_ms, void* ud
+);
+
 void http_safe_free(HTTPSafe* safe)
 {
     if (safe->handle == 0)
@@ -64,7 +48,7 @@ void http_safe_cb(unsigned flags, char* data, size_t data_len, HTTPSafe* safe)
         char* new_domain = NULL;
         char* new_path = NULL;
 
-        if (data && parse_url_safe(data, &new_domain, &new_path))
+        if (data && http_split_url(data, &new_domain, &new_path))
         {
             safe->handle = 0;
 
@@ -73,7 +57,9 @@ void http_safe_cb(unsigned flags, char* data, size_t data_len, HTTPSafe* safe)
             playdate->system->logToConsole("HTTPSafe: Waiting 200ms to flush network stack...");
             busy_wait(0.2f);
 
-            http_safe_replace_get(safe, new_domain, new_path, reason, cb, 15000, ud);
+            http_safe_replace_get_(
+                safe, new_domain, new_path, reason, safe->sink, safe->cached, cb, 15000, ud
+            );
 
             cb_free(new_domain);
             cb_free(new_path);
@@ -97,6 +83,8 @@ void http_safe_cb(unsigned flags, char* data, size_t data_len, HTTPSafe* safe)
     safe->handle = 0;
     safe->cb = NULL;
     safe->ud = NULL;
+    safe->sink = NULL;
+    safe->cached = false;
 
     if (!safe->enqueued && !safe->tombstone)
     {
@@ -115,7 +103,9 @@ void http_safe_cb(unsigned flags, char* data, size_t data_len, HTTPSafe* safe)
 
             if (!safe->tombstone)
             {
-                http_safe_replace_get(safe, q.domain, q.path, q.reason, q.cb, q.timeout_ms, q.ud);
+                http_safe_replace_get_(
+                    safe, q.domain, q.path, q.reason, q.sink, q.cached, q.cb, q.timeout_ms, q.ud
+                );
             }
 
             cb(HTTP_CANCELLED, NULL, 0, ud);
@@ -141,13 +131,49 @@ void http_safe_replace_get(
     HTTPSafe* safe, const char* domain, const char* path, const char* reason, http_result_cb cb,
     int timeout_ms, void* ud
 )
+{
+    http_safe_replace_get_to_file(safe, domain, path, reason, NULL, cb, timeout_ms, ud);
+}
+
+void http_safe_replace_get_to_file(
+    HTTPSafe* safe, const char* domain, const char* path, const char* reason, HTTPFileSink* sink,
+    http_result_cb cb, int timeout_ms, void* ud
+)
+{
+    http_safe_replace_get_(safe, domain, path, reason, sink, false, cb, timeout_ms, ud);
+}
+
+void http_safe_replace_get_cached(
+    HTTPSafe* safe, const char* domain, const char* path, const char* reason, http_result_cb cb,
+    int timeout_ms, void* ud
+)
+{
+    http_safe_replace_get_(safe, domain, path, reason, NULL, true, cb, timeout_ms, ud);
+}
+
+static void http_safe_replace_get_(
+    HTTPSafe* safe, const char* domain, const char* path, const char* reason, HTTPFileSink* sink,
+    bool cached, http_result_cb cb, int timeout_ms, void* ud
+)
 {
     if (safe->handle == 0)
     {
         safe->cb = cb;
         safe->ud = ud;
+        safe->sink = sink;
+        safe->cached = cached;
 
-        safe->handle = http_get(domain, path, reason, (void*)http_safe_cb, timeout_ms, safe);
+        if (cached)
+        {
+            safe->handle =
+                http_get_cached(domain, path, reason, (void*)http_safe_cb, timeout_ms, safe);
+        }
+        else
+        {
+            safe->handle = http_get_to_file(
+                domain, path, reason, sink, (void*)http_safe_cb, timeout_ms, safe
+            );
+        }
     }
     else
     {
@@ -155,6 +181,8 @@ void http_safe_replace_get(
 
         safe->queued.cb = cb;
         safe->queued.ud = ud;
+        safe->queued.sink = sink;
+        safe->queued.cached = cached;
         safe->queued.timeout_ms = timeout_ms;
 
         safe->queued.domain = cb_strdup(domain);
@@ -173,6 +201,8 @@ void http_safe_cancel(HTTPSafe* safe)
     safe->enqueued = false;
     safe->cb = NULL;
     safe->ud = NULL;
+    safe->sink = NULL;
+    safe->cached = false;
 
     // Clear any queued request
     if (safe->queued.domain)
@@ -192,6 +222,8 @@ void http_safe_cancel(HTTPSafe* safe)
     }
     safe->queued.cb = NULL;
     safe->queued.ud = NULL;
+    safe->queued.sink = NULL;
+    safe->queued.cached = false;
 }
 
 bool http_safe_in_progress(HTTPSafe* safe)
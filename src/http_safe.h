@@ -13,6 +13,8 @@ typedef struct HTTPSafe
     http_handle_t handle;
     http_result_cb cb;
     void* ud;
+    HTTPFileSink* sink;  // NULL unless downloading to a file
+    bool cached;         // through http_get_cached
 
     bool enqueued;
     bool tombstone;  // slate for deletion
@@ -25,6 +27,8 @@ typedef struct HTTPSafe
         char* reason;
         http_result_cb cb;
         void* ud;
+        HTTPFileSink* sink;
+        bool cached;
         unsigned timeout_ms;
     } queued;
 } HTTPSafe;
@@ -37,6 +41,18 @@ void http_safe_replace_get(
     int timeout_ms, void* ud
 );
 
+// see http_get_to_file
+void http_safe_replace_get_to_file(
+    HTTPSafe* safe, const char* domain, const char* path, const char* reason, HTTPFileSink* sink,
+    http_result_cb cb, int timeout_ms, void* ud
+);
+
+// see http_get_cached
+void http_safe_replace_get_cached(
+    HTTPSafe* safe, const char* domain, const char* path, const char* reason, http_result_cb cb,
+    int timeout_ms, void* ud
+);
+
 void http_safe_cancel(HTTPSafe* safe);
 
 bool http_safe_in_progress(HTTPSafe* safe);
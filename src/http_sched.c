@@ -0,0 +1,445 @@
+#include "http_sched.h"
+
+#include "array.h"
+#include "utility.h"
+
+#include <string.h>
+
+// connections open at once; background requests always leave one free
+#define HTTP_SCHED_MAX_IN_FLIGHT 2
+#define HTTP_SCHED_MAX_REDIRECTS 4
+
+// a redirect is followed after a pause, to let the network stack flush (see
+// http_safe.c); a request refused because permission is being asked for by
+// another one is retried shortly
+#define HTTP_SCHED_REDIRECT_DELAY_MS 200
+#define HTTP_SCHED_RETRY_DELAY_MS 100
+
+typedef struct HTTPSchedWaiter
+{
+    uint32_t id;
+    HTTPPriority priority;
+    const void* group;
+    http_result_cb cb;
+    void* ud;
+    struct HTTPSchedWaiter* next;
+} HTTPSchedWaiter;
+
+// one per distinct URL; its priority is the best of its waiters'
+typedef struct HTTPSchedEntry
+{
+    uint32_t serial;
+    uint32_t seq;  // arrival order, for requests of equal priority
+
+    // as requested (for de-duplication), and after redirects
+    char* domain;
+    char* path;
+    char* url_domain;
+    char* url_path;
+
+    char* reason;
+    int timeout_ms;
+    int redirects;
+    unsigned not_before;  // ms
+    bool cached;          // through the response cache (http_get_cached)
+
+    bool in_flight;
+    http_handle_t handle;
+
+    HTTPSchedWaiter* waiters;
+} HTTPSchedEntry;
+
+static CB_Array* entries = NULL;
+static uint32_t next_waiter_id = 1;
+static uint32_t next_serial = 1;
+static uint32_t next_seq = 0;
+
+static uint32_t take_id(uint32_t* counter)
+{
+    uint32_t id = (*counter)++;
+    if (*counter == 0)
+        *counter = 1;
+    return id;
+}
+
+static HTTPPriority entry_priority(const HTTPSchedEntry* entry)
+{
+    HTTPPriority priority = HTTP_PRIORITY_COUNT;
+    for (const HTTPSchedWaiter* w = entry->waiters; w; w = w->next)
+    {
+        priority = MIN(priority, w->priority);
+    }
+    return priority;
+}
+
+static HTTPSchedEntry* find_entry(const char* domain, const char* path)
+{
+    for (unsigned i = 0; entries && i < entries->length; ++i)
+    {
+        HTTPSchedEntry* entry = entries->items[i];
+        if (!strcmp(entry->path, path) && !strcmp(entry->domain, domain))
+            return entry;
+    }
+    return NULL;
+}
+
+static HTTPSchedEntry* find_entry_by_serial(uint32_t serial, unsigned* o_index)
+{
+    for (unsigned i = 0; entries && i < entries->length; ++i)
+    {
+        HTTPSchedEntry* entry = entries->items[i];
+        if (entry->serial == serial)
+        {
+            if (o_index)
+                *o_index = i;
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// returns the entry, and the link pointing at the waiter
+static HTTPSchedEntry* find_waiter(uint32_t id, HTTPSchedWaiter*** o_link)
+{
+    for (unsigned i = 0; entries && i < entries->length; ++i)
+    {
+        HTTPSchedEntry* entry = entries->items[i];
+        for (HTTPSchedWaiter** link = &entry->waiters; *link; link = &(*link)->next)
+        {
+            if ((*link)->id == id)
+            {
+                *o_link = link;
+                return entry;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void free_entry(HTTPSchedEntry* entry)
+{
+    cb_free(entry->domain);
+    cb_free(entry->path);
+    cb_free(entry->url_domain);
+    cb_free(entry->url_path);
+    cb_free(entry->reason);
+    cb_free(entry);
+}
+
+static void remove_entry(HTTPSchedEntry* entry)
+{
+    for (unsigned i = 0; i < entries->length; ++i)
+    {
+        if (entries->items[i] == entry)
+        {
+            array_remove_at(entries, i);
+            break;
+        }
+    }
+}
+
+static void http_sched_cb(unsigned flags, char* data, size_t data_len, void* ud)
+{
+    unsigned index;
+    HTTPSchedEntry* entry = find_entry_by_serial((uintptr_t)ud, &index);
+
+    // on a redirect, data is the location, which http.c frees
+    bool owns_data = data && !(flags & HTTP_REDIRECT);
+
+    if (!entry)
+    {
+        if (owns_data)
+            cb_free(data);
+        return;
+    }
+
+    entry->in_flight = false;
+    entry->handle = 0;
+
+    if (entry->waiters)
+    {
+        unsigned now = playdate->system->getCurrentTimeMilliseconds();
+
+        if ((flags & ~HTTP_ENABLE_ASKED) == HTTP_ENABLE_IN_PROGRESS)
+        {
+            entry->not_before = now + HTTP_SCHED_RETRY_DELAY_MS;
+            return;
+        }
+
+        char* domain;
+        char* path;
+        if ((flags & HTTP_REDIRECT) && data && entry->redirects < HTTP_SCHED_MAX_REDIRECTS &&
+            http_split_url(data, &domain, &path))
+        {
+            playdate->system->logToConsole("HTTPSched: following redirect to %s", data);
+            cb_free(entry->url_domain);
+            cb_free(entry->url_path);
+            entry->url_domain = domain;
+            entry->url_path = path;
+            entry->redirects++;
+            entry->not_before = now + HTTP_SCHED_REDIRECT_DELAY_MS;
+            return;
+        }
+    }
+
+    array_remove_at(entries, index);
+
+    // callbacks may queue or cancel other requests
+    HTTPSchedWaiter* waiter = entry->waiters;
+    entry->waiters = NULL;
+    while (waiter)
+    {
+        HTTPSchedWaiter* next = waiter->next;
+        waiter->cb(flags, data, data_len, waiter->ud);
+        cb_free(waiter);
+        waiter = next;
+    }
+
+    if (owns_data)
+        cb_free(data);
+    free_entry(entry);
+}
+
+static void start_entry(HTTPSchedEntry* entry)
+{
+    uint32_t serial = entry->serial;
+    entry->in_flight = true;
+
+    http_handle_t handle = (entry->cached ? http_get_cached : http_get)(
+        entry->url_domain, entry->url_path, entry->reason, http_sched_cb, entry->timeout_ms,
+        (void*)(uintptr_t)serial
+    );
+
+    // the callback may have run already
+    entry = find_entry_by_serial(serial, NULL);
+    if (entry && entry->in_flight)
+        entry->handle = handle;
+}
+
+static uint32_t http_sched_get_(
+    const char* domain, const char* path, const char* reason, HTTPPriority priority,
+    int timeout_ms, bool cached, const void* group, http_result_cb cb, void* ud
+)
+{
+    if (!entries)
+        entries = array_new();
+
+    HTTPSchedWaiter* waiter = allocz(HTTPSchedWaiter);
+    HTTPSchedEntry* entry = find_entry(domain, path);
+
+    if (waiter && !entry)
+    {
+        entry = allocz(HTTPSchedEntry);
+        if (entry)
+        {
+            entry->domain = cb_strdup(domain);
+            entry->path = cb_strdup(path);
+            entry->url_domain = cb_strdup(domain);
+            entry->url_path = cb_strdup(path);
+            entry->reason = cb_strdup(reason);
+
+            if (!entry->domain || !entry->path || !entry->url_domain || !entry->url_path ||
+                !entry->reason)
+            {
+                free_entry(entry);
+                entry = NULL;
+            }
+        }
+
+        if (entry)
+        {
+            entry->serial = take_id(&next_serial);
+            entry->seq = next_seq++;
+            entry->timeout_ms = timeout_ms;
+            entry->cached = cached;
+            entry->not_before = playdate->system->getCurrentTimeMilliseconds();
+            array_push(entries, entry);
+        }
+    }
+
+    if (!waiter || !entry)
+    {
+        cb_free(waiter);
+        cb(HTTP_MEM_ERROR, NULL, 0, ud);
+        return 0;
+    }
+
+    waiter->id = take_id(&next_waiter_id);
+    waiter->priority = priority;
+    waiter->group = group;
+    waiter->cb = cb;
+    waiter->ud = ud;
+
+    HTTPSchedWaiter** link = &entry->waiters;
+    while (*link)
+        link = &(*link)->next;
+    *link = waiter;
+
+    return waiter->id;
+}
+
+uint32_t http_sched_get(
+    const char* domain, const char* path, const char* reason, HTTPPriority priority,
+    int timeout_ms, const void* group, http_result_cb cb, void* ud
+)
+{
+    return http_sched_get_(domain, path, reason, priority, timeout_ms, false, group, cb, ud);
+}
+
+uint32_t http_sched_get_cached(
+    const char* domain, const char* path, const char* reason, HTTPPriority priority,
+    int timeout_ms, const void* group, http_result_cb cb, void* ud
+)
+{
+    return http_sched_get_(domain, path, reason, priority, timeout_ms, true, group, cb, ud);
+}
+
+void http_sched_set_priority(uint32_t id, HTTPPriority priority)
+{
+    HTTPSchedWaiter** link;
+    if (find_waiter(id, &link))
+        (*link)->priority = priority;
+}
+
+static void cancel_waiter(HTTPSchedEntry* entry, HTTPSchedWaiter** link)
+{
+    HTTPSchedWaiter* waiter = *link;
+    *link = waiter->next;
+
+    if (!entry->waiters)
+    {
+        if (!entry->in_flight)
+        {
+            remove_entry(entry);
+            free_entry(entry);
+        }
+        else if (entry->handle)
+        {
+            // the entry is dropped by http_sched_cb
+            http_cancel(entry->handle);
+        }
+    }
+
+    waiter->cb(HTTP_CANCELLED, NULL, 0, waiter->ud);
+    cb_free(waiter);
+}
+
+void http_sched_cancel(uint32_t id)
+{
+    HTTPSchedWaiter** link;
+    HTTPSchedEntry* entry = find_waiter(id, &link);
+    if (entry)
+        cancel_waiter(entry, link);
+}
+
+void http_sched_cancel_group(const void* group)
+{
+    // start over after each cancellation, as callbacks may change the list
+    for (unsigned i = 0; entries && i < entries->length;)
+    {
+        HTTPSchedEntry* entry = entries->items[i];
+        HTTPSchedWaiter** link = &entry->waiters;
+        while (*link && (*link)->group != group)
+            link = &(*link)->next;
+
+        if (*link)
+        {
+            cancel_waiter(entry, link);
+            i = 0;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void http_sched_cancel_queued(const void* group)
+{
+    for (unsigned i = 0; entries && i < entries->length;)
+    {
+        HTTPSchedEntry* entry = entries->items[i];
+        HTTPSchedWaiter** link = &entry->waiters;
+        while (!entry->in_flight && *link && (*link)->group != group)
+            link = &(*link)->next;
+
+        if (!entry->in_flight && *link)
+        {
+            cancel_waiter(entry, link);
+            i = 0;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+int http_sched_in_flight(const void* group)
+{
+    int count = 0;
+    for (unsigned i = 0; entries && i < entries->length; ++i)
+    {
+        HTTPSchedEntry* entry = entries->items[i];
+        if (!entry->in_flight)
+            continue;
+
+        for (HTTPSchedWaiter* w = entry->waiters; w; w = w->next)
+        {
+            if (w->group == group)
+            {
+                ++count;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+void http_sched_update(void)
+{
+    unsigned now = playdate->system->getCurrentTimeMilliseconds();
+
+    for (;;)
+    {
+        // the response cache's revalidation is a background request too
+        int in_flight = http_revalidating() ? 1 : 0;
+        HTTPSchedEntry* best = NULL;
+        HTTPPriority best_priority = HTTP_PRIORITY_COUNT;
+
+        for (unsigned i = 0; entries && i < entries->length; ++i)
+        {
+            HTTPSchedEntry* entry = entries->items[i];
+            if (entry->in_flight)
+            {
+                ++in_flight;
+                continue;
+            }
+
+            if ((int)(now - entry->not_before) < 0)
+                continue;
+
+            HTTPPriority priority = entry_priority(entry);
+            if (priority < best_priority ||
+                (priority == best_priority && best && entry->seq < best->seq))
+            {
+                best = entry;
+                best_priority = priority;
+            }
+        }
+
+        if (!best)
+        {
+            // revalidation only runs once nothing else is waiting
+            if (in_flight < HTTP_SCHED_MAX_IN_FLIGHT - 1 && http_start_revalidation())
+                continue;
+            return;
+        }
+        if (in_flight >= HTTP_SCHED_MAX_IN_FLIGHT)
+            return;
+        if (best_priority == HTTP_PRIORITY_BACKGROUND && in_flight >= HTTP_SCHED_MAX_IN_FLIGHT - 1)
+            return;
+
+        start_entry(best);
+    }
+}
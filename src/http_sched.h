@@ -0,0 +1,53 @@
+#pragma once
+
+#include "http.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Queues GET requests for small resources (covers, screenshots) and runs a
+// few of them at a time, most important first. Requests for the same URL
+// share one connection. http_sched_update must be called once per frame.
+
+typedef enum
+{
+    HTTP_PRIORITY_VISIBLE = 0,     // shown on screen right now
+    HTTP_PRIORITY_NEXT = 1,        // likely to be shown next (neighbouring rows)
+    HTTP_PRIORITY_BACKGROUND = 2,  // prefetch; never takes the last free connection
+    HTTP_PRIORITY_COUNT
+} HTTPPriority;
+
+// Returns a request id, which is never 0 except on a memory error (cb is then
+// invoked immediately). cb is invoked exactly once, with HTTP_CANCELLED if the
+// request is cancelled. Unlike http_get, data is only valid during the
+// callback. group identifies the requester for http_sched_cancel_group.
+uint32_t http_sched_get(
+    const char* domain, const char* path, const char* reason, HTTPPriority priority,
+    int timeout_ms, const void* group, http_result_cb cb, void* ud
+);
+
+// the same, through http_get_cached (for responses worth keeping, like
+// screenshots)
+uint32_t http_sched_get_cached(
+    const char* domain, const char* path, const char* reason, HTTPPriority priority,
+    int timeout_ms, const void* group, http_result_cb cb, void* ud
+);
+
+// Moves a request that has not completed yet to another priority class.
+void http_sched_set_priority(uint32_t id, HTTPPriority priority);
+
+// If no other request is waiting for the same URL, its connection (if any)
+// is closed with http_cancel.
+void http_sched_cancel(uint32_t id);
+void http_sched_cancel_group(const void* group);
+
+// the same for the group's requests that are still queued; those with a
+// connection open are left to finish
+void http_sched_cancel_queued(const void* group);
+
+// number of the group's requests that currently have a connection open
+int http_sched_in_flight(const void* group);
+
+// starts queued requests as connections become available, and the response
+// cache's background revalidation (http_start_revalidation) when none wait
+void http_sched_update(void);
@@ -22,13 +22,20 @@ __section__(".rare") void SI_didDecodeArrayValue(json_decoder* decoder, int pos,
 {
     --pos;  // one-indexed (!!)
     JsonArray* array = decoder->userdata;
-    int n = array ? array->n : 0;
+    int old_n = array ? array->n : 0;
+    int n = old_n;
     if (pos >= n)
         n = pos + 1;
     size_t p2n = next_pow2(n);
 
     array = playdate->system->realloc(array, sizeof(JsonArray) + p2n * sizeof(json_value));
 
+    // a filtered decode may skip elements; leave null in their place
+    for (int i = old_n; i < pos; ++i)
+    {
+        array->data[i].type = kJSONNull;
+    }
+
     if (value.type == kJSONString)
     {
         // we need to own the string
@@ -66,10 +73,47 @@ __section__(".rare") void SI_didDecodeTableValue(
     return;
 }
 
+static int compare_key_pair_ptrs(const void* a, const void* b)
+{
+    const TableKeyPair* pair_a = *(const TableKeyPair* const*)a;
+    const TableKeyPair* pair_b = *(const TableKeyPair* const*)b;
+    int cmp = strcmp(pair_a->key, pair_b->key);
+    if (cmp != 0)
+        return cmp;
+
+    // keep duplicate keys in document order, so the first one is found
+    return (pair_a > pair_b) - (pair_a < pair_b);
+}
+
+static void* json_arena_alloc(JsonArena* arena, size_t size);
+
+// Builds obj->index, if the table is large enough to benefit; in the arena,
+// if there is one.
+__section__(".rare") static void json_index_table(JsonObject* obj, JsonArena* arena)
+{
+    if (!obj || obj->n < JSON_INDEX_MIN_KEYS)
+        return;
+
+    size_t size = obj->n * sizeof(TableKeyPair*);
+    obj->index = arena ? json_arena_alloc(arena, size) : cb_malloc(size);
+    if (!obj->index)
+        return;
+
+    for (size_t i = 0; i < obj->n; ++i)
+    {
+        obj->index[i] = &obj->data[i];
+    }
+    qsort(obj->index, obj->n, sizeof(TableKeyPair*), compare_key_pair_ptrs);
+}
+
 __section__(".rare") void* SI_didDecodeSublist(
     json_decoder* decoder, const char* name, json_value_type type
 )
 {
+    if (type == kJSONTable)
+    {
+        json_index_table(decoder->userdata, NULL);
+    }
     return decoder->userdata;
 }
 
@@ -92,6 +136,8 @@ __section__(".rare") void free_json_data(json_value v)
             cb_free(obj->data[i].key);
             free_json_data(obj->data[i].value);
         }
+        if (obj->index)
+            cb_free(obj->index);
         cb_free(obj);
     }
     else if (v.type == kJSONString)
@@ -100,6 +146,320 @@ __section__(".rare") void free_json_data(json_value v)
     }
 }
 
+/*
+ * Arena-backed trees. While a container is being decoded, its members are
+ * kept on a scratch stack shared by all open containers; once it is complete
+ * it is copied into the arena at its final size. Strings are copied into the
+ * arena too, and keys are interned, so repeated keys are stored once. The
+ * tree is released with the arena, a chunk at a time.
+ */
+
+#define JSON_ARENA_CHUNK_SIZE (16 * 1024)
+#define JSON_ARENA_ALIGN 8
+
+typedef struct JsonArenaChunk
+{
+    struct JsonArenaChunk* next;
+    size_t used;
+    size_t size;
+} JsonArenaChunk;
+
+typedef struct JsonArenaFrame
+{
+    size_t start;  // first member on the scratch stack
+} JsonArenaFrame;
+
+struct JsonArena
+{
+    JsonArenaChunk* chunks;  // the first is the one being filled
+    bool failed;
+
+    // only while decoding
+    JsonArenaFrame* frames;
+    int depth;
+    int frame_capacity;
+    TableKeyPair* scratch;  // (key is NULL for array elements)
+    size_t scratch_count;
+    size_t scratch_capacity;
+    const char** keys;  // interned keys (open addressing)
+    size_t key_count;
+    size_t key_capacity;
+};
+
+#define JSON_ARENA_CHUNK_HEADER \
+    ((sizeof(JsonArenaChunk) + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1))
+
+__section__(".rare") static void* json_arena_alloc(JsonArena* arena, size_t size)
+{
+    size = (size + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1);
+
+    JsonArenaChunk* chunk = arena->chunks;
+    if (!chunk || chunk->size - chunk->used < size)
+    {
+        // large allocations get a chunk of their own, behind the current one
+        bool dedicated = chunk && size > JSON_ARENA_CHUNK_SIZE / 4;
+        size_t chunk_size = dedicated ? size : MAX(size, JSON_ARENA_CHUNK_SIZE);
+
+        JsonArenaChunk* fresh = cb_malloc(JSON_ARENA_CHUNK_HEADER + chunk_size);
+        if (!fresh)
+        {
+            arena->failed = true;
+            return NULL;
+        }
+        fresh->used = 0;
+        fresh->size = chunk_size;
+
+        if (dedicated)
+        {
+            fresh->next = chunk->next;
+            chunk->next = fresh;
+        }
+        else
+        {
+            fresh->next = chunk;
+            arena->chunks = fresh;
+        }
+        chunk = fresh;
+    }
+
+    void* ptr = (uint8_t*)chunk + JSON_ARENA_CHUNK_HEADER + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+__section__(".rare") static char* json_arena_strdup(JsonArena* arena, const char* s)
+{
+    size_t len = strlen(s) + 1;
+    char* copy = json_arena_alloc(arena, len);
+    if (copy)
+        memcpy(copy, s, len);
+    return copy;
+}
+
+static uint32_t json_key_hash(const char* key)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (; *key; ++key)
+    {
+        hash = (hash ^ (uint8_t)*key) * 16777619u;
+    }
+    return hash;
+}
+
+__section__(".rare") static const char* json_arena_intern(JsonArena* arena, const char* key)
+{
+    if (arena->key_count * 4 >= arena->key_capacity * 3)
+    {
+        size_t capacity = arena->key_capacity ? arena->key_capacity * 2 : 64;
+        const char** keys = cb_calloc(capacity, sizeof(const char*));
+        if (!keys)
+            return json_arena_strdup(arena, key);
+
+        for (size_t i = 0; i < arena->key_capacity; ++i)
+        {
+            const char* k = arena->keys[i];
+            if (!k)
+                continue;
+            size_t j = json_key_hash(k) & (capacity - 1);
+            while (keys[j])
+                j = (j + 1) & (capacity - 1);
+            keys[j] = k;
+        }
+        cb_free(arena->keys);
+        arena->keys = keys;
+        arena->key_capacity = capacity;
+    }
+
+    size_t i = json_key_hash(key) & (arena->key_capacity - 1);
+    for (; arena->keys[i]; i = (i + 1) & (arena->key_capacity - 1))
+    {
+        if (!strcmp(arena->keys[i], key))
+            return arena->keys[i];
+    }
+
+    const char* interned = json_arena_strdup(arena, key);
+    if (interned)
+    {
+        arena->keys[i] = interned;
+        arena->key_count++;
+    }
+    return interned;
+}
+
+// ensures the scratch stack has room for `count` members
+__section__(".rare") static bool json_arena_reserve(JsonArena* arena, size_t count)
+{
+    if (count <= arena->scratch_capacity)
+        return true;
+
+    size_t capacity = MAX(next_pow2(count), 64);
+    TableKeyPair* scratch = cb_realloc(arena->scratch, capacity * sizeof(TableKeyPair));
+    if (!scratch)
+    {
+        arena->failed = true;
+        return false;
+    }
+    arena->scratch = scratch;
+    arena->scratch_capacity = capacity;
+    return true;
+}
+
+__section__(".rare") static void AR_willDecodeSublist(
+    json_decoder* decoder, const char* name, json_value_type type
+)
+{
+    JsonArena* arena = decoder->userdata;
+    if (arena->depth == arena->frame_capacity)
+    {
+        int capacity = arena->frame_capacity ? arena->frame_capacity * 2 : 16;
+        JsonArenaFrame* frames = cb_realloc(arena->frames, capacity * sizeof(JsonArenaFrame));
+        if (!frames)
+        {
+            // (the decode is failed; keep the depth balanced regardless)
+            arena->failed = true;
+            arena->depth++;
+            return;
+        }
+        arena->frames = frames;
+        arena->frame_capacity = capacity;
+    }
+
+    arena->frames[arena->depth++].start = arena->scratch_count;
+}
+
+__section__(".rare") static void AR_didDecodeTableValue(
+    json_decoder* decoder, const char* key, json_value value
+)
+{
+    JsonArena* arena = decoder->userdata;
+    if (arena->failed || !json_arena_reserve(arena, arena->scratch_count + 1))
+        return;
+
+    if (value.type == kJSONString)
+        value.data.stringval = json_arena_strdup(arena, value.data.stringval);
+
+    TableKeyPair* pair = &arena->scratch[arena->scratch_count++];
+    pair->key = (char*)json_arena_intern(arena, key);
+    pair->value = value;
+}
+
+__section__(".rare") static void AR_didDecodeArrayValue(
+    json_decoder* decoder, int pos, json_value value
+)
+{
+    JsonArena* arena = decoder->userdata;
+    if (arena->failed)
+        return;
+
+    size_t index = arena->frames[arena->depth - 1].start + pos - 1;  // one-indexed
+    if (!json_arena_reserve(arena, index + 1))
+        return;
+
+    // a filtered decode may skip elements; leave null in their place
+    for (; arena->scratch_count <= index; ++arena->scratch_count)
+    {
+        arena->scratch[arena->scratch_count].key = NULL;
+        arena->scratch[arena->scratch_count].value.type = kJSONNull;
+    }
+
+    if (value.type == kJSONString)
+        value.data.stringval = json_arena_strdup(arena, value.data.stringval);
+    arena->scratch[index].value = value;
+}
+
+__section__(".rare") static void* AR_didDecodeSublist(
+    json_decoder* decoder, const char* name, json_value_type type
+)
+{
+    JsonArena* arena = decoder->userdata;
+    arena->depth--;
+    if (arena->failed)
+        return NULL;
+
+    size_t start = arena->frames[arena->depth].start;
+
+    size_t n = arena->scratch_count - start;
+    TableKeyPair* members = arena->scratch + start;
+    arena->scratch_count = start;
+
+    if (type == kJSONArray)
+    {
+        JsonArray* array = json_arena_alloc(arena, sizeof(JsonArray) + n * sizeof(json_value));
+        if (!array)
+            return NULL;
+        array->n = n;
+        for (size_t i = 0; i < n; ++i)
+        {
+            array->data[i] = members[i].value;
+        }
+        return array;
+    }
+
+    JsonObject* obj = json_arena_alloc(arena, sizeof(JsonObject) + n * sizeof(TableKeyPair));
+    if (!obj)
+        return NULL;
+    obj->n = n;
+    obj->index = NULL;
+    memcpy(obj->data, members, n * sizeof(TableKeyPair));
+    json_index_table(obj, arena);
+    return obj;
+}
+
+// the scratch state is only needed while decoding
+__section__(".rare") static void json_arena_end_decode(JsonArena* arena)
+{
+    cb_free(arena->frames);
+    cb_free(arena->scratch);
+    cb_free(arena->keys);
+    arena->frames = NULL;
+    arena->scratch = NULL;
+    arena->keys = NULL;
+    arena->depth = arena->frame_capacity = 0;
+    arena->scratch_count = arena->scratch_capacity = 0;
+    arena->key_count = arena->key_capacity = 0;
+}
+
+__section__(".rare") void free_json_arena(JsonArena* arena)
+{
+    if (!arena)
+        return;
+
+    json_arena_end_decode(arena);
+    for (JsonArenaChunk* chunk = arena->chunks; chunk;)
+    {
+        JsonArenaChunk* next = chunk->next;
+        cb_free(chunk);
+        chunk = next;
+    }
+    cb_free(arena);
+}
+
+// Tree-building callbacks, for the heap or for an arena. Either way, the
+// decoder's userdata is the one the builder maintains: the container being
+// decoded, or the arena.
+typedef struct JsonBuilder
+{
+    void (*willDecodeSublist)(json_decoder* decoder, const char* name, json_value_type type);
+    void (*didDecodeTableValue)(json_decoder* decoder, const char* key, json_value value);
+    void (*didDecodeArrayValue)(json_decoder* decoder, int pos, json_value value);
+    void* (*didDecodeSublist)(json_decoder* decoder, const char* name, json_value_type type);
+} JsonBuilder;
+
+static const JsonBuilder heap_builder = {
+    SI_willDecodeSublist,
+    SI_didDecodeTableValue,
+    SI_didDecodeArrayValue,
+    SI_didDecodeSublist,
+};
+
+static const JsonBuilder arena_builder = {
+    AR_willDecodeSublist,
+    AR_didDecodeTableValue,
+    AR_didDecodeArrayValue,
+    AR_didDecodeSublist,
+};
+
 __section__(".rare") static void decodeError(
     struct json_decoder* decoder, const char* error, int linenum
 )
@@ -167,6 +527,13 @@ bool json_set_table_value(json_value* table, const char* key, json_value value)
     if (!key2)
         return false;
 
+    // the index would be invalidated; lookups fall back to a linear scan
+    if (obj->index)
+    {
+        cb_free(obj->index);
+        obj->index = NULL;
+    }
+
     // add new key
     obj = cb_realloc(obj, sizeof(*obj) + sizeof(obj->data[0]) * (obj->n + 1));
     if (!obj)
@@ -183,8 +550,14 @@ done:
     return true;
 }
 
+typedef struct JsonFilter JsonFilter;
+static int parse_json_string_with(
+    const char* text, json_value* out, JsonFilter* filter, JsonArena* arena
+);
+static int decode_with(json_reader reader, json_value* out, JsonFilter* filter, JsonArena* arena);
+
 static __section__(".rare") int parse_json_compressed(
-    const char* path, json_value* out, FileOptions opts
+    const char* path, json_value* out, FileOptions opts, JsonFilter* filter, JsonArena* arena
 )
 {
     size_t size;
@@ -199,7 +572,7 @@ static __section__(".rare") int parse_json_compressed(
         return 0;
     }
 
-    int result = parse_json_string(s, out);
+    int result = parse_json_string_with(s, out, filter, arena);
 
     cb_free(s);
 
@@ -251,7 +624,9 @@ __section__(".rare") static int read_workaround_decode_u(
     return w;
 }
 
-__section__(".rare") int parse_json(const char* path, json_value* out, FileOptions opts)
+__section__(".rare") static int parse_json_with(
+    const char* path, json_value* out, FileOptions opts, JsonFilter* filter, JsonArena* arena
+)
 {
     if (!out)
         return 0;
@@ -260,20 +635,7 @@ __section__(".rare") int parse_json(const char* path, json_value* out, FileOptio
     SDFile* file = playdate->file->open(path, opts);
     if (!file)
     {
-        return parse_json_compressed(path, out, opts);
-    };
-
-    struct json_decoder decoder = {
-        .decodeError = decodeError,
-        .willDecodeSublist = SI_willDecodeSublist,
-        .shouldDecodeTableValueForKey = NULL,
-        .didDecodeTableValue = SI_didDecodeTableValue,
-        .shouldDecodeArrayValueAtIndex = NULL,
-        .didDecodeArrayValue = SI_didDecodeArrayValue,
-        .didDecodeSublist = SI_didDecodeSublist,
-        .userdata = NULL,
-        .returnString = 0,
-        .path = NULL
+        return parse_json_compressed(path, out, opts, filter, arena);
     };
 
     // (gets binary data for json file)
@@ -282,16 +644,14 @@ __section__(".rare") int parse_json(const char* path, json_value* out, FileOptio
         .read = (int (*)(void*, uint8_t*, int))read_workaround_decode_u, .userdata = &ud
     };
 
-    int ok = playdate->json->decode(&decoder, reader, out);
+    int ok = decode_with(reader, out, filter, arena);
     playdate->file->close(file);
+    return ok;
+}
 
-    if (!ok)
-    {
-        free_json_data(*out);
-        out->type = kJSONNull;
-        return 0;
-    }
-    return 1;
+__section__(".rare") int parse_json(const char* path, json_value* out, FileOptions opts)
+{
+    return parse_json_with(path, out, opts, NULL, NULL);
 }
 
 __section__(".rare") void encode_json(json_encoder* e, json_value j)
@@ -371,6 +731,25 @@ __section__(".rare") json_value json_get_table_value(json_value j, const char* k
     if (!obj)
         goto ret_null;
 
+    if (obj->index)
+    {
+        // leftmost match
+        size_t lo = 0, hi = obj->n;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (strcmp(obj->index[mid]->key, key) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo < obj->n && !strcmp(obj->index[lo]->key, key))
+        {
+            return obj->index[lo]->value;
+        }
+        goto ret_null;
+    }
+
     for (size_t i = 0; i < obj->n; ++i)
     {
         if (!strcmp(obj->data[i].key, key))
@@ -401,42 +780,449 @@ __section__(".rare") int compare_key_pairs(const void* a, const void* b)
     return strcmp(pair_a->key, pair_b->key);
 }
 
-__section__(".rare") int parse_json_string(const char* text, json_value* out)
+__section__(".rare") static int parse_json_string_with(
+    const char* text, json_value* out, JsonFilter* filter, JsonArena* arena
+)
 {
     if (!out)
         return 0;
     out->type = kJSONNull;
 
+    // (gets binary data for json file)
+    struct reader_ud ud = {.read = (int (*)(void*, uint8_t*, int))read_string, .ud = &text};
+    json_reader reader = {
+        .read = (int (*)(void*, uint8_t*, int))read_workaround_decode_u, .userdata = &ud
+    };
+
+    return decode_with(reader, out, filter, arena);
+}
+
+__section__(".rare") int parse_json_string(const char* text, json_value* out)
+{
+    return parse_json_string_with(text, out, NULL, NULL);
+}
+
+/*
+ * Filtered decoding. The decoder's userdata is a JsonFrame per open table or
+ * array (the SDK restores the parent's when a sublist ends), which tracks
+ * which keep-patterns still match the path to it. A pattern is a bitmask
+ * bit; the each_path, if any, takes the bit after the last keep-pattern.
+ */
+
+#define JSON_FILTER_MAX_PATTERNS 31
+
+struct JsonFilter
+{
+    const char* const* keep;  // NULL: keep everything
+    int keep_count;
+    const char* each_path;
+    json_each_fn each;
+    void* each_ud;
+    bool each_stopped;
+    const JsonBuilder* build;
+
+    // innermost open frame, so that those left open by a decode error can be
+    // freed; a sublist that no frame could be allocated for fails the decode
+    struct JsonFrame* top;
+    int dead_depth;
+    bool failed;
+};
+
+typedef struct JsonFrame
+{
+    void* container;  // the builder's userdata, as for the unfiltered decoder
+    json_value_type type;
+    struct JsonFrame* parent;
+    JsonFilter* filter;
+    int depth;
+    uint32_t live;  // patterns matching the path so far
+    bool keep_all;  // a keep-pattern matched this node (or an ancestor) fully
+    bool each;      // this is the each_path container
+
+    // set by the shouldDecode hooks for the value about to be decoded
+    uint32_t pending_live;
+    bool pending_keep_all;
+    bool pending_each;
+} JsonFrame;
+
+static const char* filter_pattern(const JsonFilter* filter, int i)
+{
+    return (i < filter->keep_count) ? filter->keep[i] : filter->each_path;
+}
+
+// Compares segment `depth` of pattern (segments are separated by '/') with
+// key. Returns -1 if the pattern has no such segment, 0 on mismatch, 1 on
+// a match, or 2 if it matches and is the pattern's last segment.
+static int match_segment(const char* pattern, int depth, const char* key)
+{
+    for (int d = 0; d < depth; ++d)
+    {
+        pattern = strchr(pattern, '/');
+        if (!pattern)
+            return -1;
+        pattern++;
+    }
+
+    const char* end = strchr(pattern, '/');
+    size_t len = end ? (size_t)(end - pattern) : strlen(pattern);
+
+    bool match = (len == 1 && pattern[0] == '*') ||
+                 (strlen(key) == len && !memcmp(pattern, key, len));
+    if (!match)
+        return 0;
+    return end ? 1 : 2;
+}
+
+__section__(".rare") static int filter_should_decode(json_decoder* decoder, const char* key)
+{
+    JsonFrame* frame = decoder->userdata;
+    JsonFilter* filter = frame->filter;
+
+    if (filter->failed)
+        return 0;
+
+    frame->pending_live = 0;
+    frame->pending_keep_all = frame->keep_all;
+    frame->pending_each = false;
+
+    if (frame->each)
+    {
+        if (filter->each_stopped)
+            return 0;
+
+        // each member is decoded, filtered by any keep-patterns below it
+        if (!filter->keep)
+            frame->pending_keep_all = true;
+    }
+
+    int count = filter->keep_count + (filter->each_path ? 1 : 0);
+    for (int i = 0; i < count; ++i)
+    {
+        if (!(frame->live & (1u << i)))
+            continue;
+
+        int m = match_segment(filter_pattern(filter, i), frame->depth, key);
+        if (m == 1)
+        {
+            frame->pending_live |= 1u << i;
+        }
+        else if (m == 2)
+        {
+            if (i < filter->keep_count)
+                frame->pending_keep_all = true;
+            else
+                frame->pending_each = true;
+        }
+    }
+
+    return frame->each || frame->pending_keep_all || frame->pending_each ||
+           frame->pending_live != 0;
+}
+
+__section__(".rare") static int filter_should_decode_table_value(
+    json_decoder* decoder, const char* key
+)
+{
+    return filter_should_decode(decoder, key);
+}
+
+__section__(".rare") static int filter_should_decode_array_value(json_decoder* decoder, int pos)
+{
+    char index[12];
+    snprintf(index, sizeof(index), "%d", pos - 1);  // one-indexed
+    return filter_should_decode(decoder, index);
+}
+
+__section__(".rare") static void filter_will_decode_sublist(
+    json_decoder* decoder, const char* name, json_value_type type
+)
+{
+    JsonFrame* parent = decoder->userdata;
+    JsonFrame* frame = allocz(JsonFrame);
+    if (!frame)
+    {
+        // nothing more is decoded (see filter_should_decode), and the
+        // sublist ends without a container (see is_dead_sublist)
+        parent->filter->failed = true;
+        parent->filter->dead_depth++;
+        return;
+    }
+
+    frame->type = type;
+    frame->parent = parent;
+    frame->filter = parent->filter;
+    frame->filter->top = frame;
+    frame->depth = parent->depth + 1;
+    frame->live = parent->pending_live;
+    frame->keep_all = parent->pending_keep_all;
+    frame->each = parent->pending_each;
+
+    decoder->userdata = parent->container;
+    frame->filter->build->willDecodeSublist(decoder, name, type);
+    frame->container = decoder->userdata;
+    decoder->userdata = frame;
+}
+
+static bool is_dead_sublist(json_value value)
+{
+    return (value.type == kJSONArray || value.type == kJSONTable) && !value.data.tableval;
+}
+
+// Passes a value to the each_path callback, which doesn't take ownership.
+__section__(".rare") static void filter_emit(
+    JsonFrame* frame, const char* key, int index, json_value value
+)
+{
+    JsonFilter* filter = frame->filter;
+    if (!filter->each(filter->each_ud, key, index, value))
+    {
+        filter->each_stopped = true;
+    }
+
+    if (value.type == kJSONArray || value.type == kJSONTable)
+    {
+        free_json_data(value);
+    }
+}
+
+__section__(".rare") static void filter_did_decode_table_value(
+    json_decoder* decoder, const char* key, json_value value
+)
+{
+    JsonFrame* frame = decoder->userdata;
+    if (is_dead_sublist(value))
+        return;
+    if (frame->each)
+    {
+        filter_emit(frame, key, -1, value);
+        return;
+    }
+
+    decoder->userdata = frame->container;
+    frame->filter->build->didDecodeTableValue(decoder, key, value);
+    frame->container = decoder->userdata;
+    decoder->userdata = frame;
+}
+
+__section__(".rare") static void filter_did_decode_array_value(
+    json_decoder* decoder, int pos, json_value value
+)
+{
+    JsonFrame* frame = decoder->userdata;
+    if (is_dead_sublist(value))
+        return;
+    if (frame->each)
+    {
+        filter_emit(frame, NULL, pos - 1, value);
+        return;
+    }
+
+    decoder->userdata = frame->container;
+    frame->filter->build->didDecodeArrayValue(decoder, pos, value);
+    frame->container = decoder->userdata;
+    decoder->userdata = frame;
+}
+
+__section__(".rare") static void* filter_did_decode_sublist(
+    json_decoder* decoder, const char* name, json_value_type type
+)
+{
+    JsonFrame* frame = decoder->userdata;
+    if (frame->filter->dead_depth > 0)
+    {
+        // the innermost sublist, opened without a frame
+        frame->filter->dead_depth--;
+        return NULL;
+    }
+
+    frame->filter->top = frame->parent;
+    decoder->userdata = frame->container;
+    void* container = frame->filter->build->didDecodeSublist(decoder, name, type);
+    cb_free(frame);
+    return container;
+}
+
+__section__(".rare") static int decode_with(
+    json_reader reader, json_value* out, JsonFilter* filter, JsonArena* arena
+)
+{
+    const JsonBuilder* build = arena ? &arena_builder : &heap_builder;
+
     struct json_decoder decoder = {
         .decodeError = decodeError,
-        .willDecodeSublist = SI_willDecodeSublist,
+        .willDecodeSublist = build->willDecodeSublist,
         .shouldDecodeTableValueForKey = NULL,
-        .didDecodeTableValue = SI_didDecodeTableValue,
+        .didDecodeTableValue = build->didDecodeTableValue,
         .shouldDecodeArrayValueAtIndex = NULL,
-        .didDecodeArrayValue = SI_didDecodeArrayValue,
-        .didDecodeSublist = SI_didDecodeSublist,
-        .userdata = NULL,
+        .didDecodeArrayValue = build->didDecodeArrayValue,
+        .didDecodeSublist = build->didDecodeSublist,
+        .userdata = arena,
         .returnString = 0,
         .path = NULL
     };
 
-    // (gets binary data for json file)
-    struct reader_ud ud = {.read = (int (*)(void*, uint8_t*, int))read_string, .ud = &text};
-    json_reader reader = {
-        .read = (int (*)(void*, uint8_t*, int))read_workaround_decode_u, .userdata = &ud
-    };
+    // stands in for the root's parent
+    JsonFrame root_parent;
+    if (filter)
+    {
+        filter->build = build;
+
+        memset(&root_parent, 0, sizeof(root_parent));
+        root_parent.container = arena;
+        root_parent.filter = filter;
+        root_parent.depth = -1;
+        root_parent.pending_live = (1u << (filter->keep_count + (filter->each_path ? 1 : 0))) - 1;
+        root_parent.pending_keep_all = !filter->keep;
+        root_parent.pending_each = filter->each_path && !filter->each_path[0];
+        filter->top = &root_parent;
+
+        decoder.userdata = &root_parent;
+        decoder.willDecodeSublist = filter_will_decode_sublist;
+        decoder.shouldDecodeTableValueForKey = filter_should_decode_table_value;
+        decoder.didDecodeTableValue = filter_did_decode_table_value;
+        decoder.shouldDecodeArrayValueAtIndex = filter_should_decode_array_value;
+        decoder.didDecodeArrayValue = filter_did_decode_array_value;
+        decoder.didDecodeSublist = filter_did_decode_sublist;
+    }
 
     int ok = playdate->json->decode(&decoder, reader, out);
 
+    if (filter)
+    {
+        // after a decode error, the sublists still open were never passed to
+        // their parents
+        while (filter->top != &root_parent)
+        {
+            JsonFrame* frame = filter->top;
+            filter->top = frame->parent;
+            if (!arena && frame->container)
+            {
+                json_value open = {.type = frame->type, .data.tableval = frame->container};
+                free_json_data(open);
+            }
+            cb_free(frame);
+        }
+        ok = ok && !filter->failed;
+    }
+
+    if (arena)
+    {
+        json_arena_end_decode(arena);
+        ok = ok && !arena->failed;
+    }
+
     if (!ok)
     {
-        free_json_data(*out);
+        // (an arena's tree is freed with the arena)
+        if (!arena && !is_dead_sublist(*out))
+            free_json_data(*out);
         out->type = kJSONNull;
         return 0;
     }
     return 1;
 }
 
+static bool filter_init(
+    JsonFilter* filter, const char* const* keep, const char* each_path, json_each_fn each,
+    void* ud
+)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->keep = keep;
+    for (const char* const* k = keep; k && *k; ++k)
+        filter->keep_count++;
+    filter->each_path = each_path;
+    filter->each = each;
+    filter->each_ud = ud;
+
+    if (filter->keep_count + (each_path ? 1 : 0) > JSON_FILTER_MAX_PATTERNS)
+    {
+        playdate->system->logToConsole("Too many JSON filter patterns");
+        return false;
+    }
+    return true;
+}
+
+__section__(".rare") int parse_json_filtered(
+    const char* path, json_value* out, FileOptions opts, const char* const* keep
+)
+{
+    JsonFilter filter;
+    if (!filter_init(&filter, keep, NULL, NULL, NULL))
+        return 0;
+    return parse_json_with(path, out, opts, &filter, NULL);
+}
+
+__section__(".rare") int parse_json_string_filtered(
+    const char* text, json_value* out, const char* const* keep
+)
+{
+    JsonFilter filter;
+    if (!filter_init(&filter, keep, NULL, NULL, NULL))
+        return 0;
+    return parse_json_string_with(text, out, &filter, NULL);
+}
+
+__section__(".rare") int parse_json_each(
+    const char* path, FileOptions opts, const char* each_path, const char* const* keep,
+    json_each_fn fn, void* ud
+)
+{
+    JsonFilter filter;
+    if (!filter_init(&filter, keep, each_path, fn, ud))
+        return 0;
+
+    json_value out;
+    int ok = parse_json_with(path, &out, opts, &filter, NULL);
+    free_json_data(out);
+    return ok;
+}
+
+__section__(".rare") int parse_json_arena(
+    const char* path, json_value* out, FileOptions opts, const char* const* keep,
+    JsonArena** o_arena
+)
+{
+    *o_arena = NULL;
+    JsonFilter filter;
+    if (keep && !filter_init(&filter, keep, NULL, NULL, NULL))
+        return 0;
+
+    JsonArena* arena = allocz(JsonArena);
+    if (!arena)
+        return 0;
+
+    if (!parse_json_with(path, out, opts, keep ? &filter : NULL, arena))
+    {
+        free_json_arena(arena);
+        return 0;
+    }
+    *o_arena = arena;
+    return 1;
+}
+
+__section__(".rare") int parse_json_string_arena(
+    const char* text, json_value* out, const char* const* keep, JsonArena** o_arena
+)
+{
+    *o_arena = NULL;
+    JsonFilter filter;
+    if (keep && !filter_init(&filter, keep, NULL, NULL, NULL))
+        return 0;
+
+    JsonArena* arena = allocz(JsonArena);
+    if (!arena)
+        return 0;
+
+    if (!parse_json_string_with(text, out, keep ? &filter : NULL, arena))
+    {
+        free_json_arena(arena);
+        return 0;
+    }
+    *o_arena = arena;
+    return 1;
+}
+
 const char* json_as_string(json_value j)
 {
     return (j.type == kJSONString) ? j.data.stringval : NULL;
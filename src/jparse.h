@@ -8,9 +8,17 @@ typedef struct TableKeyPair
     json_value value;
 } TableKeyPair;
 
+// tables with at least this many keys get a sorted index when decoded
+#define JSON_INDEX_MIN_KEYS 8
+
 typedef struct JsonObject
 {
     size_t n;
+
+    // if not NULL, pointers into data sorted by key (ties in document order),
+    // so that json_get_table_value can binary-search. data itself is left in
+    // document order.
+    TableKeyPair** index;
     TableKeyPair data[];
 } JsonObject;
 
@@ -29,11 +37,54 @@ int parse_json(const char* file, json_value* out, FileOptions opts);
 // returns 0 on failure
 int parse_json_string(const char* text, json_value* out);
 
+// Filtered decoding: only the parts of the document matching one of the
+// keep paths (a NULL-terminated list) are decoded; everything else is
+// skipped without being allocated. A path is a '/'-separated list of table
+// keys or (zero-based) array indices, where "*" matches any one, e.g.
+// "entries/*/title". A path ending at a table or array keeps all of it.
+// A NULL keep list keeps everything.
+int parse_json_filtered(
+    const char* path, json_value* out, FileOptions opts, const char* const* keep
+);
+int parse_json_string_filtered(const char* text, json_value* out, const char* const* keep);
+
+// Called with each member of the each_path container, as it is decoded:
+// key is NULL (and index set) for array elements, index -1 for table values.
+// The value is freed afterwards. Return false to skip the remaining members.
+typedef bool (*json_each_fn)(void* ud, const char* key, int index, json_value value);
+
+// Streams the table or array at each_path ("" for the root) to fn, one
+// member at a time, so the whole container is never resident. Members are
+// filtered by keep as for parse_json_filtered (paths are still from the root).
+// returns 0 on failure
+int parse_json_each(
+    const char* path, FileOptions opts, const char* each_path, const char* const* keep,
+    json_each_fn fn, void* ud
+);
+
+// Arena-backed decoding, for large documents that are only read. The tree is
+// bump-allocated in a few large chunks (containers at their final size, with
+// repeated keys stored once) and released all at once by free_json_arena.
+// It must not be passed to free_json_data or json_set_table_value.
+// keep is as for parse_json_filtered (NULL keeps everything).
+// returns 0 on failure, in which case *o_arena is NULL.
+typedef struct JsonArena JsonArena;
+
+int parse_json_arena(
+    const char* path, json_value* out, FileOptions opts, const char* const* keep,
+    JsonArena** o_arena
+);
+int parse_json_string_arena(
+    const char* text, json_value* out, const char* const* keep, JsonArena** o_arena
+);
+void free_json_arena(JsonArena* arena);
+
 // returns 0 on success
 int write_json_to_disk(const char* path, json_value out);
 
 int compare_key_pairs(const void* a, const void* b);
 
+// O(log n) for decoded tables of JSON_INDEX_MIN_KEYS or more keys.
 json_value json_get_table_value(json_value table, const char* key);
 
 json_value json_new_table(void);
@@ -148,6 +148,7 @@ int _preferences_save_to_disk(const char* filename, preferences_bitfield_t* leav
 #include "prefs.x"
 
     data.obj.n = pairs_count;
+    data.obj.index = NULL;
 
     if (preserved_all)
     {
@@ -0,0 +1,402 @@
+//
+//  rom_pager.c
+//  CrankBoy
+//
+
+#include "rom_pager.h"
+
+#include "../libs/lz4/lz4.h"
+#include "gbz.h"
+#include "userstack.h"
+#include "utility.h"
+
+#include <string.h>
+
+#define ROM_PAGER_MAX_BANKS 512  // 8 MiB
+#define ROM_PAGER_NO_SLOT 0xFF
+
+// prefetch list file: magic, u16 count, u16 banks[count]
+#define ROM_PAGER_PREFETCH_MAGIC "CBPF"
+
+// (never prefetch more than the cache can hold next to the mapped banks)
+#define ROM_PAGER_PREFETCH_MAX (ROM_PAGER_SLOT_COUNT - 2)
+
+struct CB_RomPager
+{
+    SDFile* file;
+    size_t rom_size;
+    unsigned bank_count;
+
+    // gbz v2 only: header + block index, and a buffer for one block
+    uint8_t* gbz_index;
+    GBZ_Header gbz;
+    uint8_t* gbz_block;
+
+    uint8_t* bank0;
+    uint8_t* slots;  // ROM_PAGER_SLOT_COUNT * ROM_PAGER_BANK_SIZE
+
+    // slot holding each bank, or ROM_PAGER_NO_SLOT
+    uint8_t bank_slot[ROM_PAGER_MAX_BANKS];
+
+    // bank held by each slot (0 if free; bank 0 is never in a slot)
+    uint16_t slot_bank[ROM_PAGER_SLOT_COUNT];
+    uint32_t slot_used[ROM_PAGER_SLOT_COUNT];
+    uint32_t clock;
+
+    // slot mapped into each region, which must not be evicted
+    uint8_t mapped_slot[2];
+
+    // banks in the order first mapped this session (the next prefetch list)
+    uint8_t touched[ROM_PAGER_MAX_BANKS / 8];
+    uint16_t touch_order[ROM_PAGER_PREFETCH_MAX];
+    unsigned touch_count;
+
+    // prefetch list learned from the previous session
+    uint16_t prefetch[ROM_PAGER_PREFETCH_MAX];
+    unsigned prefetch_count;
+    unsigned prefetch_next;
+
+    char* prefetch_path;
+
+    unsigned hits;
+    unsigned faults;
+};
+
+static bool rom_pager_read_gbz_bank(CB_RomPager* pager, unsigned bank, uint8_t* out)
+{
+    uint32_t offset, block_size;
+    int decoded = -1;
+    if (gbz_get_block(&pager->gbz, bank, &offset, &block_size) &&
+        playdate->file->seek(pager->file, offset, SEEK_SET) == 0 &&
+        playdate->file->read(pager->file, pager->gbz_block, block_size) == (int)block_size)
+    {
+        decoded = gbz_decompress_bank(
+            &pager->gbz, bank, pager->gbz_block, block_size, out, ROM_PAGER_BANK_SIZE
+        );
+    }
+
+    if (decoded < 0)
+    {
+        decoded = 0;
+    }
+
+    memset(out + decoded, 0xFF, ROM_PAGER_BANK_SIZE - decoded);
+    return decoded == (int)gbz_bank_size(&pager->gbz, bank);
+}
+
+static bool rom_pager_read_bank(CB_RomPager* pager, unsigned bank, uint8_t* out)
+{
+    if (pager->gbz_index)
+    {
+        return rom_pager_read_gbz_bank(pager, bank, out);
+    }
+
+    size_t offset = (size_t)bank * ROM_PAGER_BANK_SIZE;
+    int want = ROM_PAGER_BANK_SIZE;
+    if (offset + want > pager->rom_size)
+    {
+        want = (offset < pager->rom_size) ? (int)(pager->rom_size - offset) : 0;
+    }
+
+    int read = 0;
+    if (want > 0 && playdate->file->seek(pager->file, offset, SEEK_SET) == 0)
+    {
+        read = playdate->file->read(pager->file, out, want);
+    }
+
+    if (read < 0)
+    {
+        read = 0;
+    }
+
+    // open bus past the end of the image
+    memset(out + read, 0xFF, ROM_PAGER_BANK_SIZE - read);
+    return read == want;
+}
+
+static void rom_pager_load_prefetch_list(CB_RomPager* pager)
+{
+    size_t size;
+    uint8_t* data = cb_read_entire_file(pager->prefetch_path, &size, kFileReadData);
+    if (!data)
+    {
+        return;
+    }
+
+    if (size >= 6 && !memcmp(data, ROM_PAGER_PREFETCH_MAGIC, 4))
+    {
+        unsigned count = data[4] | (data[5] << 8);
+        if (count > ROM_PAGER_PREFETCH_MAX)
+        {
+            count = ROM_PAGER_PREFETCH_MAX;
+        }
+        if (6 + count * 2 <= size)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                unsigned bank = data[6 + 2 * i] | (data[7 + 2 * i] << 8);
+                if (bank > 0 && bank < pager->bank_count)
+                {
+                    pager->prefetch[pager->prefetch_count++] = bank;
+                }
+            }
+        }
+    }
+
+    cb_free(data);
+}
+
+static void rom_pager_save_prefetch_list(CB_RomPager* pager)
+{
+    if (pager->touch_count == 0)
+    {
+        return;
+    }
+
+    uint8_t data[6 + 2 * ROM_PAGER_PREFETCH_MAX];
+    memcpy(data, ROM_PAGER_PREFETCH_MAGIC, 4);
+    data[4] = pager->touch_count & 0xFF;
+    data[5] = pager->touch_count >> 8;
+    for (unsigned i = 0; i < pager->touch_count; ++i)
+    {
+        data[6 + 2 * i] = pager->touch_order[i] & 0xFF;
+        data[7 + 2 * i] = pager->touch_order[i] >> 8;
+    }
+
+    cb_write_entire_file(pager->prefetch_path, data, 6 + 2 * pager->touch_count);
+}
+
+// gbz v2: reads the header and block index, so banks can be decoded lazily.
+// (v1 is a single gzip stream, and can't be paged.)
+static bool rom_pager_open_gbz(CB_RomPager* pager, const uint8_t* head, size_t head_size)
+{
+    if (!gbz_parse_header(&pager->gbz, head, head_size) || pager->gbz.version != 2)
+    {
+        return false;
+    }
+
+    size_t index_end = gbz_index_end(&pager->gbz);
+    pager->gbz_index = cb_malloc(index_end);
+    pager->gbz_block = cb_malloc(LZ4_COMPRESSBOUND(ROM_PAGER_BANK_SIZE));
+    if (!pager->gbz_index || !pager->gbz_block ||
+        playdate->file->seek(pager->file, 0, SEEK_SET) != 0 ||
+        playdate->file->read(pager->file, pager->gbz_index, index_end) != (int)index_end ||
+        !gbz_parse_header(&pager->gbz, pager->gbz_index, index_end) || !pager->gbz.block_index)
+    {
+        return false;
+    }
+
+    pager->rom_size = pager->gbz.original_size;
+    return true;
+}
+
+CB_RomPager* cb_rom_pager_open(const char* rom_path, const char* prefetch_path)
+{
+    SDFile* file = playdate->file->open(rom_path, kFileReadDataOrBundle);
+    if (!file)
+    {
+        return NULL;
+    }
+
+    CB_RomPager* pager = allocz(CB_RomPager);
+    if (!pager)
+    {
+        playdate->file->close(file);
+        return NULL;
+    }
+
+    pager->file = file;
+    memset(pager->bank_slot, ROM_PAGER_NO_SLOT, sizeof(pager->bank_slot));
+    pager->mapped_slot[0] = pager->mapped_slot[1] = ROM_PAGER_NO_SLOT;
+
+    playdate->file->seek(file, 0, SEEK_END);
+    int file_size = playdate->file->tell(file);
+    playdate->file->seek(file, 0, SEEK_SET);
+    pager->rom_size = file_size > 0 ? file_size : 0;
+
+    uint8_t head[GBZ_INDEX_OFFSET];
+    bool is_gbz = playdate->file->read(file, head, sizeof(head)) == sizeof(head) &&
+                  !memcmp(head, GBZ_MAGIC, GBZ_MAGIC_LEN);
+
+    if ((is_gbz && !rom_pager_open_gbz(pager, head, sizeof(head))) ||
+        pager->rom_size < ROM_PAGER_MIN_ROM_SIZE ||
+        pager->rom_size > ROM_PAGER_MAX_BANKS * ROM_PAGER_BANK_SIZE)
+    {
+        cb_rom_pager_close(pager);
+        return NULL;
+    }
+
+    pager->bank_count = (pager->rom_size + ROM_PAGER_BANK_SIZE - 1) / ROM_PAGER_BANK_SIZE;
+    pager->bank0 = cb_malloc(ROM_PAGER_BANK_SIZE);
+    pager->slots = cb_malloc(ROM_PAGER_SLOT_COUNT * ROM_PAGER_BANK_SIZE);
+    pager->prefetch_path = cb_strdup(prefetch_path);
+
+    if (!pager->bank0 || !pager->slots || !pager->prefetch_path ||
+        !rom_pager_read_bank(pager, 0, pager->bank0))
+    {
+        cb_rom_pager_close(pager);
+        return NULL;
+    }
+
+    rom_pager_load_prefetch_list(pager);
+
+    playdate->system->logToConsole(
+        "Paging %sROM (%u banks, %u-bank cache, %u to prefetch)", is_gbz ? "compressed " : "",
+        pager->bank_count, ROM_PAGER_SLOT_COUNT, pager->prefetch_count
+    );
+
+    return pager;
+}
+
+void cb_rom_pager_close(CB_RomPager* pager)
+{
+    if (!pager)
+    {
+        return;
+    }
+
+    if (pager->prefetch_path && pager->slots)
+    {
+        playdate->system->logToConsole(
+            "ROM pager: %u hits, %u faults", pager->hits, pager->faults
+        );
+        rom_pager_save_prefetch_list(pager);
+    }
+
+    if (pager->file)
+    {
+        playdate->file->close(pager->file);
+    }
+
+    cb_free(pager->gbz_index);
+    cb_free(pager->gbz_block);
+    cb_free(pager->prefetch_path);
+    cb_free(pager->slots);
+    cb_free(pager->bank0);
+    cb_free(pager);
+}
+
+size_t cb_rom_pager_rom_size(const CB_RomPager* pager)
+{
+    return pager->rom_size;
+}
+
+uint8_t* cb_rom_pager_bank0(CB_RomPager* pager)
+{
+    return pager->bank0;
+}
+
+static unsigned rom_pager_victim(CB_RomPager* pager)
+{
+    unsigned victim = ROM_PAGER_NO_SLOT;
+    for (unsigned i = 0; i < ROM_PAGER_SLOT_COUNT; ++i)
+    {
+        if (i == pager->mapped_slot[0] || i == pager->mapped_slot[1])
+        {
+            continue;
+        }
+
+        // free slots first
+        if (pager->slot_bank[i] == 0)
+        {
+            return i;
+        }
+
+        if (victim == ROM_PAGER_NO_SLOT || pager->slot_used[i] < pager->slot_used[victim])
+        {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+// slow path; may do file I/O
+static void* rom_pager_fault_(CB_RomPager* pager, unsigned bank)
+{
+    unsigned slot = rom_pager_victim(pager);
+    CB_ASSERT(slot != ROM_PAGER_NO_SLOT);
+
+    if (pager->slot_bank[slot] != 0)
+    {
+        pager->bank_slot[pager->slot_bank[slot]] = ROM_PAGER_NO_SLOT;
+    }
+
+    uint8_t* data = pager->slots + slot * ROM_PAGER_BANK_SIZE;
+    if (!rom_pager_read_bank(pager, bank, data))
+    {
+        playdate->system->logToConsole("ROM pager: failed to read bank %u", bank);
+    }
+
+    pager->slot_bank[slot] = bank;
+    pager->bank_slot[bank] = slot;
+    ++pager->faults;
+
+    return (void*)(uintptr_t)slot;
+}
+
+static unsigned rom_pager_fault(CB_RomPager* pager, unsigned bank)
+{
+    // (this can be reached from the emulator core, on the user stack)
+    return (unsigned)(uintptr_t)call_with_main_stack_2(rom_pager_fault_, pager, bank);
+}
+
+uint8_t* cb_rom_pager_map(void* ud, unsigned bank, unsigned region)
+{
+    CB_RomPager* pager = ud;
+
+    if (bank >= pager->bank_count)
+    {
+        bank %= pager->bank_count;
+    }
+
+    if (!(pager->touched[bank / 8] & (1 << (bank % 8))))
+    {
+        pager->touched[bank / 8] |= 1 << (bank % 8);
+        if (bank != 0 && pager->touch_count < ROM_PAGER_PREFETCH_MAX)
+        {
+            pager->touch_order[pager->touch_count++] = bank;
+        }
+    }
+
+    if (bank == 0)
+    {
+        pager->mapped_slot[region] = ROM_PAGER_NO_SLOT;
+        return pager->bank0;
+    }
+
+    unsigned slot = pager->bank_slot[bank];
+    if (likely(slot != ROM_PAGER_NO_SLOT))
+    {
+        ++pager->hits;
+    }
+    else
+    {
+        // (the bank previously mapped here may be evicted now)
+        pager->mapped_slot[region] = ROM_PAGER_NO_SLOT;
+        slot = rom_pager_fault(pager, bank);
+    }
+
+    pager->slot_used[slot] = ++pager->clock;
+    pager->mapped_slot[region] = slot;
+    return pager->slots + slot * ROM_PAGER_BANK_SIZE;
+}
+
+bool cb_rom_pager_prefetch(CB_RomPager* pager, unsigned max_banks)
+{
+    while (max_banks > 0 && pager->prefetch_next < pager->prefetch_count)
+    {
+        unsigned bank = pager->prefetch[pager->prefetch_next++];
+        if (pager->bank_slot[bank] != ROM_PAGER_NO_SLOT)
+        {
+            continue;
+        }
+
+        unsigned slot = rom_pager_fault(pager, bank);
+
+        // least recently used until the game actually maps it
+        pager->slot_used[slot] = 0;
+        --max_banks;
+    }
+
+    return pager->prefetch_next < pager->prefetch_count;
+}
@@ -0,0 +1,56 @@
+//
+//  rom_pager.h
+//  CrankBoy
+//
+//  Paged ROM backend. Instead of reading the whole ROM into the heap before
+//  the first frame, banks are faulted in from the ROM file on demand into a
+//  fixed-size LRU cache of 16 KiB slots. Bank 0 is pinned. Block-compressed
+//  gbz (v2) files are paged too, decoding each bank as it is faulted in.
+//
+//  The order in which banks were first needed is remembered per game, and
+//  replayed as a prefetch list (a few banks at a time, when there is frame
+//  time to spare) in the next session.
+//
+
+#ifndef rom_pager_h
+#define rom_pager_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ROM_PAGER_BANK_SIZE 0x4000
+
+// smaller ROMs are simply read into memory
+#define ROM_PAGER_MIN_ROM_SIZE (2 * 1024 * 1024)
+
+// size of the bank cache (1 MiB)
+#define ROM_PAGER_SLOT_COUNT 64
+
+typedef struct CB_RomPager CB_RomPager;
+
+// Opens rom_path for paging; plain ROM images and gbz v2 are supported.
+// prefetch_path is where the learned prefetch list is kept.
+// Returns NULL on failure, or if the ROM is too small to be worth paging;
+// in which case the ROM should be loaded whole.
+CB_RomPager* cb_rom_pager_open(const char* rom_path, const char* prefetch_path);
+
+// Saves the prefetch list learned this session, and frees the pager.
+void cb_rom_pager_close(CB_RomPager* pager);
+
+size_t cb_rom_pager_rom_size(const CB_RomPager* pager);
+
+// pinned; valid for the lifetime of the pager.
+uint8_t* cb_rom_pager_bank0(CB_RomPager* pager);
+
+// Returns the 16 KiB of `bank`, faulting it in if needed, as mapped into
+// `region` (0 for 0x0000-0x3FFF, 1 for 0x4000-0x7FFF). The returned memory
+// stays valid for as long as the bank remains mapped in that region.
+// (signature matches gb_rom_bank_mapper; `pager` is a CB_RomPager*)
+uint8_t* cb_rom_pager_map(void* pager, unsigned bank, unsigned region);
+
+// Faults in up to max_banks banks from the prefetch list.
+// Returns false once the list is exhausted.
+bool cb_rom_pager_prefetch(CB_RomPager* pager, unsigned max_banks);
+
+#endif /* rom_pager_h */
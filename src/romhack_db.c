@@ -0,0 +1,468 @@
+//
+//  romhack_db.c
+//  CrankBoy
+//
+
+#include "romhack_db.h"
+
+#include "../libs/miniz/miniz.h"
+#include "crc32.h"
+#include "jparse.h"
+#include "utility.h"
+
+#define RHDB_MAGIC "CBRH"
+#define RHDB_VERSION 1
+#define RHDB_HEADER_SIZE 56
+#define RHDB_TITLE_ENTRY_SIZE 12
+#define RHDB_ROM_ENTRY_SIZE 8
+#define RHDB_GAME_ENTRY_SIZE 8
+#define RHDB_HACK_ENTRY_SIZE 28
+#define RHDB_MAX_STRING 1024
+#define RHDB_MAX_BLOB (256 * 1024)
+#define RHDB_MAX_TREE_DEPTH 16
+
+struct CB_RomhackDB
+{
+    SDFile* file;
+    uint32_t title_count;
+    uint32_t title_offset;
+    uint32_t rom_count;
+    uint32_t rom_offset;
+    uint32_t game_count;
+    uint32_t game_offset;
+    uint32_t list_offset;
+    uint32_t hack_count;
+    uint32_t hack_offset;
+    uint32_t pool_offset;
+    char* domain;
+    char* prefix;
+};
+
+static const char* const rhdb_hack_fields[] = {
+    "filekey", "title", "author", "reldate", "rominfo", "description",
+};
+
+static uint32_t rhdb_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool rhdb_read_at(CB_RomhackDB* db, uint32_t offset, void* buf, size_t size)
+{
+    return playdate->file->seek(db->file, offset, SEEK_SET) == 0 &&
+           playdate->file->read(db->file, buf, size) == (int)size;
+}
+
+// caller-freed; NULL if unreadable
+static char* rhdb_read_string(CB_RomhackDB* db, uint32_t offset)
+{
+    if (playdate->file->seek(db->file, db->pool_offset + offset, SEEK_SET) != 0)
+        return NULL;
+
+    char buf[64];
+    char* str = NULL;
+    size_t len = 0;
+    while (len < RHDB_MAX_STRING)
+    {
+        int n = playdate->file->read(db->file, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+
+        char* end = memchr(buf, '\0', n);
+        size_t chunk = end ? (size_t)(end - buf) : (size_t)n;
+
+        char* grown = cb_realloc(str, len + chunk + 1);
+        if (!grown)
+            break;
+        str = grown;
+        memcpy(str + len, buf, chunk);
+        len += chunk;
+        str[len] = '\0';
+
+        if (end)
+            return str;
+    }
+
+    cb_free(str);
+    return NULL;
+}
+
+// Index of the first entry of a table sorted by its leading uint32 whose key
+// is at least `key`, or count.
+static uint32_t rhdb_lower_bound(
+    CB_RomhackDB* db, uint32_t offset, uint32_t count, uint32_t entry_size, uint32_t key
+)
+{
+    uint32_t lo = 0;
+    uint32_t hi = count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint8_t entry_key[4];
+        if (!rhdb_read_at(db, offset + mid * entry_size, entry_key, sizeof(entry_key)))
+            return count;
+
+        if (rhdb_u32(entry_key) < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+CB_RomhackDB* cb_romhack_db_open(const char* path)
+{
+    SDFile* file = playdate->file->open(path, kFileRead | kFileReadData);
+    if (!file)
+        return NULL;
+
+    CB_RomhackDB* db = allocz(CB_RomhackDB);
+    if (!db)
+    {
+        playdate->file->close(file);
+        return NULL;
+    }
+    db->file = file;
+
+    uint8_t header[RHDB_HEADER_SIZE];
+    if (playdate->file->read(file, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, RHDB_MAGIC, 4) != 0 || rhdb_u32(header + 4) != RHDB_VERSION)
+    {
+        playdate->system->logToConsole("Romhack database %s is invalid.", path);
+        cb_romhack_db_close(db);
+        return NULL;
+    }
+
+    db->title_count = rhdb_u32(header + 8);
+    db->title_offset = rhdb_u32(header + 12);
+    db->rom_count = rhdb_u32(header + 16);
+    db->rom_offset = rhdb_u32(header + 20);
+    db->game_count = rhdb_u32(header + 24);
+    db->game_offset = rhdb_u32(header + 28);
+    db->list_offset = rhdb_u32(header + 32);
+    db->hack_count = rhdb_u32(header + 36);
+    db->hack_offset = rhdb_u32(header + 40);
+    db->pool_offset = rhdb_u32(header + 52);
+
+    db->domain = rhdb_read_string(db, rhdb_u32(header + 44));
+    db->prefix = rhdb_read_string(db, rhdb_u32(header + 48));
+    if (!db->domain || !db->prefix)
+    {
+        cb_romhack_db_close(db);
+        return NULL;
+    }
+
+    return db;
+}
+
+void cb_romhack_db_close(CB_RomhackDB* db)
+{
+    if (!db)
+        return;
+
+    playdate->file->close(db->file);
+    cb_free(db->domain);
+    cb_free(db->prefix);
+    cb_free(db);
+}
+
+const char* cb_romhack_db_domain(const CB_RomhackDB* db)
+{
+    return db->domain;
+}
+
+const char* cb_romhack_db_prefix(const CB_RomhackDB* db)
+{
+    return db->prefix;
+}
+
+static bool rhdb_push_hack(uint32_t** hacks, int* count, uint32_t hack)
+{
+    uint32_t* grown = cb_realloc(*hacks, (*count + 1) * sizeof(uint32_t));
+    if (!grown)
+        return false;
+    grown[(*count)++] = hack;
+    *hacks = grown;
+    return true;
+}
+
+static int compare_hack_indices(const void* a, const void* b)
+{
+    uint32_t ia = *(const uint32_t*)a;
+    uint32_t ib = *(const uint32_t*)b;
+    return (ia > ib) - (ia < ib);
+}
+
+// appends the hacks of the game listed under title
+static void rhdb_find_title_hacks(
+    CB_RomhackDB* db, const char* title, uint32_t** hacks, int* count
+)
+{
+    uint32_t crc = cb_crc32(title, strlen(title));
+    uint32_t i =
+        rhdb_lower_bound(db, db->title_offset, db->title_count, RHDB_TITLE_ENTRY_SIZE, crc);
+
+    for (; i < db->title_count; ++i)
+    {
+        uint8_t entry[RHDB_TITLE_ENTRY_SIZE];
+        if (!rhdb_read_at(db, db->title_offset + i * RHDB_TITLE_ENTRY_SIZE, entry, sizeof(entry)) ||
+            rhdb_u32(entry) != crc)
+            return;
+
+        // CRCs of different titles can collide
+        char* name = rhdb_read_string(db, rhdb_u32(entry + 4));
+        bool match = name && strcmp(name, title) == 0;
+        cb_free(name);
+        if (!match)
+            continue;
+
+        uint32_t game = rhdb_u32(entry + 8);
+        uint8_t game_entry[RHDB_GAME_ENTRY_SIZE];
+        if (game >= db->game_count ||
+            !rhdb_read_at(
+                db, db->game_offset + game * RHDB_GAME_ENTRY_SIZE, game_entry, sizeof(game_entry)
+            ))
+            return;
+
+        uint32_t first = rhdb_u32(game_entry);
+        uint32_t n = rhdb_u32(game_entry + 4);
+        if (n == 0 || n > db->hack_count)
+            return;
+
+        uint8_t* list = cb_malloc(n * 4);
+        if (list && rhdb_read_at(db, db->list_offset + first * 4, list, n * 4))
+        {
+            for (uint32_t j = 0; j < n; ++j)
+            {
+                uint32_t hack = rhdb_u32(list + j * 4);
+                if (hack < db->hack_count && !rhdb_push_hack(hacks, count, hack))
+                    break;
+            }
+        }
+        cb_free(list);
+        return;
+    }
+}
+
+// appends the hacks whose ROM info names rom_crc
+static void rhdb_find_rom_hacks(CB_RomhackDB* db, uint32_t rom_crc, uint32_t** hacks, int* count)
+{
+    uint32_t i = rhdb_lower_bound(db, db->rom_offset, db->rom_count, RHDB_ROM_ENTRY_SIZE, rom_crc);
+
+    for (; i < db->rom_count; ++i)
+    {
+        uint8_t entry[RHDB_ROM_ENTRY_SIZE];
+        if (!rhdb_read_at(db, db->rom_offset + i * RHDB_ROM_ENTRY_SIZE, entry, sizeof(entry)) ||
+            rhdb_u32(entry) != rom_crc)
+            return;
+
+        uint32_t hack = rhdb_u32(entry + 4);
+        if (hack < db->hack_count && !rhdb_push_hack(hacks, count, hack))
+            return;
+    }
+}
+
+uint32_t* cb_romhack_db_find_hacks(
+    CB_RomhackDB* db, const char* header_title, uint32_t rom_crc, int* o_count
+)
+{
+    uint32_t* hacks = NULL;
+    int count = 0;
+
+    if (header_title && header_title[0])
+        rhdb_find_title_hacks(db, header_title, &hacks, &count);
+    rhdb_find_rom_hacks(db, rom_crc, &hacks, &count);
+
+    // merge the two, in key order
+    qsort(hacks, count, sizeof(uint32_t), compare_hack_indices);
+    int unique = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (unique == 0 || hacks[unique - 1] != hacks[i])
+            hacks[unique++] = hacks[i];
+    }
+
+    *o_count = unique;
+    if (unique == 0)
+    {
+        cb_free(hacks);
+        return NULL;
+    }
+    return hacks;
+}
+
+static bool rhdb_read_hack_entry(
+    CB_RomhackDB* db, uint32_t hack, uint8_t entry[RHDB_HACK_ENTRY_SIZE]
+)
+{
+    return hack < db->hack_count &&
+           rhdb_read_at(
+               db, db->hack_offset + hack * RHDB_HACK_ENTRY_SIZE, entry, RHDB_HACK_ENTRY_SIZE
+           );
+}
+
+char* cb_romhack_db_hack_string(CB_RomhackDB* db, uint32_t hack, CB_RomhackField field)
+{
+    uint8_t entry[RHDB_HACK_ENTRY_SIZE];
+    if (!rhdb_read_hack_entry(db, hack, entry))
+        return NULL;
+
+    char* s = rhdb_read_string(db, rhdb_u32(entry + 4 + 4 * field));
+    if (s && !s[0])
+    {
+        cb_free(s);
+        return NULL;
+    }
+    return s;
+}
+
+typedef struct
+{
+    const uint8_t* p;
+    const uint8_t* end;
+} RhdbCursor;
+
+static const char* rhdb_take_string(RhdbCursor* c)
+{
+    const uint8_t* nul = memchr(c->p, '\0', c->end - c->p);
+    if (!nul)
+        return NULL;
+
+    const char* s = (const char*)c->p;
+    c->p = nul + 1;
+    return s;
+}
+
+static bool rhdb_take_tree(RhdbCursor* c, json_value* out, int depth)
+{
+    out->type = kJSONNull;
+    if (depth > RHDB_MAX_TREE_DEPTH || c->end - c->p < 2)
+        return false;
+
+    unsigned count = c->p[0] | (c->p[1] << 8);
+    c->p += 2;
+
+    // each entry takes at least a name terminator, a kind and a 2-byte count
+    if (count > (size_t)(c->end - c->p) / 4)
+        return false;
+
+    // the count is known up front, so the table is allocated once and filled
+    // in place, rather than grown per key by json_set_table_value
+    JsonObject* obj = cb_malloc(sizeof(JsonObject) + count * sizeof(TableKeyPair));
+    if (!obj)
+        return false;
+    obj->n = 0;
+    obj->index = NULL;
+    out->type = kJSONTable;
+    out->data.tableval = obj;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        const char* name = rhdb_take_string(c);
+        if (!name || c->p >= c->end)
+            return false;
+
+        uint8_t kind = *c->p++;
+        json_value value;
+        if (kind == 1)
+        {
+            if (!rhdb_take_tree(c, &value, depth + 1))
+            {
+                free_json_data(value);
+                return false;
+            }
+        }
+        else
+        {
+            if (c->end - c->p < 4)
+                return false;
+            uint32_t size = rhdb_u32(c->p);
+            c->p += 4;
+
+            // (unknown size)
+            if (size > INT32_MAX)
+                value.type = kJSONNull;
+            else
+                value = json_new_int((int)size);
+        }
+
+        char* key = cb_strdup(name);
+        if (!key)
+        {
+            free_json_data(value);
+            return false;
+        }
+        obj->data[obj->n].key = key;
+        obj->data[obj->n].value = value;
+        obj->n++;
+    }
+    return true;
+}
+
+bool cb_romhack_db_load_hack(
+    CB_RomhackDB* db, uint32_t hack, int* o_key, json_value* o_info, json_value* o_fs
+)
+{
+    o_info->type = kJSONNull;
+    o_fs->type = kJSONNull;
+
+    uint8_t entry[RHDB_HACK_ENTRY_SIZE];
+    if (!rhdb_read_hack_entry(db, hack, entry))
+        return false;
+
+    uint32_t offset = rhdb_u32(entry + 16);
+    uint32_t packed_size = rhdb_u32(entry + 20);
+    uint32_t size = rhdb_u32(entry + 24);
+    if (size > RHDB_MAX_BLOB || packed_size > size)
+        return false;
+
+    uint8_t* packed = cb_malloc(packed_size);
+    if (!packed)
+        return false;
+    if (!rhdb_read_at(db, offset, packed, packed_size))
+    {
+        cb_free(packed);
+        return false;
+    }
+
+    uint8_t* blob = packed;
+    if (packed_size != size)
+    {
+        blob = cb_malloc(size);
+        if (!blob ||
+            tinfl_decompress_mem_to_mem(blob, size, packed, packed_size, 0) != size)
+        {
+            cb_free(blob);
+            cb_free(packed);
+            return false;
+        }
+        cb_free(packed);
+    }
+
+    bool ok = true;
+    RhdbCursor c = {blob, blob + size};
+
+    *o_info = json_new_table();
+    for (size_t i = 0; ok && i < sizeof(rhdb_hack_fields) / sizeof(rhdb_hack_fields[0]); ++i)
+    {
+        // empty fields were null, and are left out
+        const char* s = rhdb_take_string(&c);
+        ok = s && (!s[0] || json_set_table_value(o_info, rhdb_hack_fields[i], json_new_string(s)));
+    }
+
+    ok = ok && rhdb_take_tree(&c, o_fs, 0);
+    cb_free(blob);
+
+    if (!ok)
+    {
+        free_json_data(*o_info);
+        free_json_data(*o_fs);
+        o_info->type = kJSONNull;
+        o_fs->type = kJSONNull;
+        return false;
+    }
+
+    if (o_key)
+        *o_key = (int)rhdb_u32(entry);
+    return true;
+}
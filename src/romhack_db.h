@@ -0,0 +1,56 @@
+//
+//  romhack_db.h
+//  CrankBoy
+//
+//  Binary romhack index (db/rhdb.bin), compiled from rhdb.json by
+//  scripts/create_rhdb_index.py (see there for the layout). Finding the hacks
+//  for a game takes a few small reads, and a hack's metadata and file list
+//  are only read once it is selected.
+//
+
+#ifndef romhack_db_h
+#define romhack_db_h
+
+#include "pd_api.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct CB_RomhackDB CB_RomhackDB;
+
+// Returns NULL if the file is missing or invalid.
+CB_RomhackDB* cb_romhack_db_open(const char* path);
+
+void cb_romhack_db_close(CB_RomhackDB* db);
+
+// Where patch files are downloaded from; valid for the lifetime of db.
+const char* cb_romhack_db_domain(const CB_RomhackDB* db);
+const char* cb_romhack_db_prefix(const CB_RomhackDB* db);
+
+// Hacks for a ROM: those listed under its header title, and those whose ROM
+// info names its CRC32. Returns a caller-freed array of hack indices (in key
+// order), or NULL if there are none.
+uint32_t* cb_romhack_db_find_hacks(
+    CB_RomhackDB* db, const char* header_title, uint32_t rom_crc, int* o_count
+);
+
+// fields kept in the hack table, for listing hacks without reading them whole
+typedef enum
+{
+    CB_ROMHACK_TITLE = 0,
+    CB_ROMHACK_AUTHOR = 1,
+    CB_ROMHACK_RELDATE = 2,
+} CB_RomhackField;
+
+// caller-freed; NULL if empty, or on failure
+char* cb_romhack_db_hack_string(CB_RomhackDB* db, uint32_t hack, CB_RomhackField field);
+
+// Reads one hack's record: o_info is a table of its title, author, reldate,
+// rominfo, description and filekey strings (those that aren't empty), and o_fs its file tree (names
+// mapping to sizes, or to subtables for directories), as they appear in
+// rhdb.json. Both are caller-freed with free_json_data.
+bool cb_romhack_db_load_hack(
+    CB_RomhackDB* db, uint32_t hack, int* o_key, json_value* o_info, json_value* o_fs
+);
+
+#endif /* romhack_db_h */
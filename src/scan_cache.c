@@ -0,0 +1,266 @@
+//
+//  scan_cache.c
+//  CrankBoy
+//
+
+#include "scan_cache.h"
+
+#include "crc32.h"
+#include "utility.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SCAN_CACHE_MAGIC "CBSC"
+#define SCAN_CACHE_VERSION 1
+#define SCAN_CACHE_HEADER_SIZE 12
+
+// compact once appended and stale records are this many, and a quarter of the file
+#define SCAN_CACHE_COMPACT_MIN 16
+
+struct CB_ScanCache
+{
+    char* path;
+
+    CB_ScanCacheRecord* records;  // as loaded
+    uint32_t count;
+    uint32_t sorted_count;
+    bool* live;
+
+    CB_ScanCacheRecord* pending;
+    uint32_t pending_count;
+    uint32_t pending_capacity;
+};
+
+static uint32_t scan_cache_hash(const char* filename)
+{
+    return cb_crc32(filename, strlen(filename));
+}
+
+// a record and how recently it was written, for compaction
+typedef struct
+{
+    CB_ScanCacheRecord record;
+    uint32_t age;
+} CB_ScanCacheSortItem;
+
+// by name hash, newest first
+static int compare_sort_items(const void* a, const void* b)
+{
+    const CB_ScanCacheSortItem* ia = a;
+    const CB_ScanCacheSortItem* ib = b;
+    uint32_t ha = ia->record.name_hash;
+    uint32_t hb = ib->record.name_hash;
+    if (ha != hb)
+        return (ha > hb) - (ha < hb);
+    return (ia->age > ib->age) - (ia->age < ib->age);
+}
+
+CB_ScanCache* cb_scan_cache_load(const char* path)
+{
+    CB_ScanCache* cache = allocz(CB_ScanCache);
+    if (!cache)
+        return NULL;
+
+    cache->path = cb_strdup(path);
+
+    size_t size;
+    uint8_t* data = (uint8_t*)cb_read_entire_file(path, &size, kFileReadData);
+    if (!data)
+        return cache;
+
+    uint16_t version, record_size;
+    uint32_t sorted_count;
+    if (size >= SCAN_CACHE_HEADER_SIZE && memcmp(data, SCAN_CACHE_MAGIC, 4) == 0)
+    {
+        memcpy(&version, data + 4, 2);
+        memcpy(&record_size, data + 6, 2);
+        memcpy(&sorted_count, data + 8, 4);
+
+        uint32_t count = (size - SCAN_CACHE_HEADER_SIZE) / sizeof(CB_ScanCacheRecord);
+        if (version == SCAN_CACHE_VERSION && record_size == sizeof(CB_ScanCacheRecord) &&
+            sorted_count <= count && count > 0)
+        {
+            cache->records = cb_malloc(count * sizeof(CB_ScanCacheRecord));
+            cache->live = cb_calloc(count, sizeof(bool));
+            if (cache->records && cache->live)
+            {
+                memcpy(
+                    cache->records, data + SCAN_CACHE_HEADER_SIZE,
+                    count * sizeof(CB_ScanCacheRecord)
+                );
+                cache->count = count;
+                cache->sorted_count = sorted_count;
+            }
+            else
+            {
+                cb_free(cache->records);
+                cb_free(cache->live);
+                cache->records = NULL;
+                cache->live = NULL;
+            }
+        }
+    }
+
+    cb_free(data);
+    return cache;
+}
+
+static int scan_cache_find_index(CB_ScanCache* cache, uint32_t hash)
+{
+    // appended records override the sorted ones; the latest wins
+    for (uint32_t i = cache->count; i > cache->sorted_count; --i)
+    {
+        if (cache->records[i - 1].name_hash == hash)
+            return i - 1;
+    }
+
+    uint32_t lo = 0, hi = cache->sorted_count;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (cache->records[mid].name_hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < cache->sorted_count && cache->records[lo].name_hash == hash)
+        return lo;
+    return -1;
+}
+
+const CB_ScanCacheRecord* cb_scan_cache_find(CB_ScanCache* cache, const char* filename)
+{
+    int i = scan_cache_find_index(cache, scan_cache_hash(filename));
+    if (i < 0)
+        return NULL;
+
+    cache->live[i] = true;
+    return &cache->records[i];
+}
+
+void cb_scan_cache_put(CB_ScanCache* cache, const char* filename, CB_ScanCacheRecord record)
+{
+    record.name_hash = scan_cache_hash(filename);
+
+    if (cache->pending_count == cache->pending_capacity)
+    {
+        uint32_t capacity = MAX(16, cache->pending_capacity * 2);
+        CB_ScanCacheRecord* pending =
+            cb_realloc(cache->pending, capacity * sizeof(CB_ScanCacheRecord));
+        if (!pending)
+            return;
+        cache->pending = pending;
+        cache->pending_capacity = capacity;
+    }
+
+    cache->pending[cache->pending_count++] = record;
+}
+
+static void scan_cache_write_header(uint8_t* header, uint32_t sorted_count)
+{
+    uint16_t version = SCAN_CACHE_VERSION;
+    uint16_t record_size = sizeof(CB_ScanCacheRecord);
+    memcpy(header, SCAN_CACHE_MAGIC, 4);
+    memcpy(header + 4, &version, 2);
+    memcpy(header + 6, &record_size, 2);
+    memcpy(header + 8, &sorted_count, 4);
+}
+
+static bool scan_cache_compact(CB_ScanCache* cache)
+{
+    uint32_t max_count = cache->count + cache->pending_count;
+    uint8_t* data = cb_malloc(SCAN_CACHE_HEADER_SIZE + max_count * sizeof(CB_ScanCacheRecord));
+    if (!data)
+        return false;
+
+    CB_ScanCacheSortItem* items = cb_malloc(max_count * sizeof(CB_ScanCacheSortItem));
+    if (!items)
+    {
+        cb_free(data);
+        return false;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = cache->pending_count; i > 0; --i)
+    {
+        items[n] = (CB_ScanCacheSortItem){cache->pending[i - 1], n};
+        n++;
+    }
+    for (uint32_t i = cache->count; i > 0; --i)
+    {
+        if (cache->live[i - 1])
+        {
+            items[n] = (CB_ScanCacheSortItem){cache->records[i - 1], n};
+            n++;
+        }
+    }
+
+    qsort(items, n, sizeof(CB_ScanCacheSortItem), compare_sort_items);
+
+    CB_ScanCacheRecord* records = (CB_ScanCacheRecord*)(data + SCAN_CACHE_HEADER_SIZE);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        if (unique == 0 || records[unique - 1].name_hash != items[i].record.name_hash)
+            records[unique++] = items[i].record;
+    }
+    cb_free(items);
+
+    scan_cache_write_header(data, unique);
+
+    char* tmp_path = aprintf("%s.tmp", cache->path);
+    bool ok = tmp_path &&
+              cb_write_entire_file(
+                  tmp_path, data, SCAN_CACHE_HEADER_SIZE + unique * sizeof(CB_ScanCacheRecord)
+              ) &&
+              playdate->file->rename(tmp_path, cache->path) == 0;
+
+    cb_free(tmp_path);
+    cb_free(data);
+    return ok;
+}
+
+bool cb_scan_cache_save(CB_ScanCache* cache)
+{
+    uint32_t stale = 0;
+    for (uint32_t i = 0; i < cache->count; ++i)
+    {
+        if (!cache->live[i])
+            stale++;
+    }
+
+    uint32_t unsorted = cache->count - cache->sorted_count + cache->pending_count + stale;
+    if (cache->count == 0 ||
+        (unsorted >= SCAN_CACHE_COMPACT_MIN && unsorted * 4 >= cache->count))
+    {
+        if (cache->pending_count == 0 && stale == 0 && cache->count == cache->sorted_count)
+            return true;
+        return scan_cache_compact(cache);
+    }
+
+    if (cache->pending_count == 0)
+        return true;
+
+    SDFile* file = playdate->file->open(cache->path, kFileAppend);
+    if (!file)
+        return false;
+
+    int bytes = cache->pending_count * sizeof(CB_ScanCacheRecord);
+    bool ok = playdate->file->write(file, cache->pending, bytes) == bytes;
+    playdate->file->close(file);
+    return ok;
+}
+
+void cb_scan_cache_free(CB_ScanCache* cache)
+{
+    if (!cache)
+        return;
+
+    cb_free(cache->path);
+    cb_free(cache->records);
+    cb_free(cache->live);
+    cb_free(cache->pending);
+    cb_free(cache);
+}
@@ -0,0 +1,59 @@
+//
+//  scan_cache.h
+//  CrankBoy
+//
+//  Remembers what the library scan learned about each ROM file (its CRC and
+//  header info), so unchanged files needn't be read again.
+//
+//  File layout (little-endian):
+//    [0:4]   magic "CBSC"
+//    [4:6]   version
+//    [6:8]   record size
+//    [8:12]  number of sorted records
+//    [12:]   sorted records (by name hash), then records appended since the
+//            last compaction (a later record overrides an earlier one)
+//
+//  Loading is a single read. New records are appended; the file is rewritten
+//  sorted (dropping files that have gone away) once enough have piled up.
+//
+
+#ifndef scan_cache_h
+#define scan_cache_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SCAN_CACHE_FILE "scan_cache.bin"
+
+typedef struct
+{
+    uint32_t name_hash;  // CRC32 of the file name
+    uint32_t crc32;      // of the ROM (for gbz, of the decompressed ROM)
+    uint32_t size;       // file size and mtime the entry is valid for
+    uint32_t m_time;
+    uint8_t cgb;
+    uint8_t sram;
+    uint16_t reserved;
+    char name_header[16];  // not NUL-terminated if all 16 are used
+} CB_ScanCacheRecord;
+
+typedef struct CB_ScanCache CB_ScanCache;
+
+// Never NULL except when out of memory; a missing or invalid file gives an
+// empty cache.
+CB_ScanCache* cb_scan_cache_load(const char* path);
+
+// Also marks the file as still present, so compaction keeps it.
+const CB_ScanCacheRecord* cb_scan_cache_find(CB_ScanCache* cache, const char* filename);
+
+// Queues a new or updated record for the file (name_hash is filled in).
+void cb_scan_cache_put(CB_ScanCache* cache, const char* filename, CB_ScanCacheRecord record);
+
+// Appends the queued records, or compacts the file if it's due.
+// Only files found or put this session survive a compaction.
+bool cb_scan_cache_save(CB_ScanCache* cache);
+
+void cb_scan_cache_free(CB_ScanCache* cache);
+
+#endif /* scan_cache_h */
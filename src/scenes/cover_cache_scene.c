@@ -1,12 +1,10 @@
 #include "cover_cache_scene.h"
 
-#include "../../libs/lz4/lz4.h"
 #include "../app.h"
+#include "../cover_atlas.h"
 #include "../utility.h"
 #include "library_scene.h"
 
-#define MAX_CACHE_SIZE_BYTES (3072 * 1024)  // 3MB
-
 void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt);
 void CB_CoverCacheScene_free(void* object);
 
@@ -36,21 +34,85 @@ CB_CoverCacheScene* CB_CoverCacheScene_new(void)
 
     cacheScene->state = kCoverCacheStateInit;
     cacheScene->current_index = 0;
-    cacheScene->cache_size_bytes = 0;
 
-    if (CB_App->coverCache == NULL)
+    if (CB_App->coverAtlas == NULL)
     {
-        CB_App->coverCache = array_new();
+        CB_App->coverAtlas = cb_cover_atlas_open();
     }
 
     cacheScene->available_covers = array_new();
     cacheScene->games_with_covers = array_new();
 
-    cacheScene->lz4_state = cb_malloc(LZ4_sizeofState());
-
     return cacheScene;
 }
 
+// Makes sure the atlas has an up-to-date thumbnail of the game's cover;
+// the cover is only decoded and scaled if it is new or has changed.
+static void cache_one_cover(CB_CoverCacheScene* cacheScene, CB_Game* game)
+{
+    FileStat stat;
+    if (playdate->file->stat(game->coverPath, &stat) != 0)
+    {
+        return;
+    }
+
+    struct PDDateTime dt = {
+        .year = stat.m_year,
+        .month = stat.m_month,
+        .day = stat.m_day,
+        .hour = stat.m_hour,
+        .minute = stat.m_minute,
+        .second = stat.m_second
+    };
+    uint32_t m_time_epoch = playdate->system->convertDateTimeToEpoch(&dt);
+    uint32_t crc = game->names->crc32;
+
+    if (cb_cover_atlas_validate(CB_App->coverAtlas, crc, m_time_epoch))
+    {
+        cacheScene->reused_count++;
+        return;
+    }
+
+    CB_LoadedCoverArt art = cb_load_and_scale_cover_art_from_path(
+        game->coverPath, THUMBNAIL_WIDTH, THUMBNAIL_HEIGHT
+    );
+    if (art.status == CB_COVER_ART_SUCCESS && art.bitmap)
+    {
+        if (cb_cover_atlas_add(CB_App->coverAtlas, crc, m_time_epoch, art.bitmap))
+        {
+            cacheScene->added_count++;
+        }
+    }
+    cb_free_loaded_cover_art_bitmap(&art);
+}
+
+// Redraws progress at most every CB_LOADING_PROGRESS_INTERVAL_MS.
+static void maybe_draw_progress(
+    CB_CoverCacheScene* cacheScene, uint32_t now, const char* message, int index, int total
+)
+{
+    if (cacheScene->progress_drawn_ms != 0 &&
+        now - cacheScene->progress_drawn_ms < CB_LOADING_PROGRESS_INTERVAL_MS)
+    {
+        return;
+    }
+    cacheScene->progress_drawn_ms = now;
+
+    char progress_suffix[20];
+    int percentage = (total > 0) ? ((float)index / total) * 100 : 99;
+
+    if (percentage >= 100)
+    {
+        percentage = 99;
+    }
+
+    snprintf(progress_suffix, sizeof(progress_suffix), "%d%%", percentage);
+
+    cb_draw_logo_screen_centered_split(
+        CB_App->subheadFont, message, progress_suffix, cacheScene->progress_max_width
+    );
+}
+
 void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
 {
     if (CB_App->pendingScene)
@@ -65,6 +127,8 @@ void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
     {
     case kCoverCacheStateInit:
     {
+        uint32_t init_start = playdate->system->getCurrentTimeMilliseconds();
+
         playdate->file->listfiles(
             cb_gb_directory_path(CB_coversPath), collect_cover_filenames_callback,
             cacheScene->available_covers, 0
@@ -78,6 +142,10 @@ void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
             );
         }
 
+        cacheScene->phase_start_ms = playdate->system->getCurrentTimeMilliseconds();
+        cacheScene->list_ms = cacheScene->phase_start_ms - init_start;
+        cacheScene->start_time_ms = cacheScene->phase_start_ms;
+
         if (CB_App->gameNameCache->length > 0)
         {
             cacheScene->progress_max_width =
@@ -98,33 +166,32 @@ void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
             array_reserve(CB_App->gameListCache, CB_App->gameNameCache->length);
         }
 
-        if (cacheScene->current_index < CB_App->gameNameCache->length)
+        uint32_t frame_start = playdate->system->getCurrentTimeMilliseconds();
+        uint32_t now = frame_start;
+        int total = CB_App->gameNameCache->length;
+
+        while (cacheScene->current_index < total &&
+               now - frame_start < CB_LOADING_FRAME_BUDGET_MS)
         {
             CB_GameName* cachedName = CB_App->gameNameCache->items[cacheScene->current_index];
             CB_Game* game = CB_Game_new(cachedName, cacheScene->available_covers);
             array_push(CB_App->gameListCache, game);
 
-            char progress_suffix[20];
-            int total = CB_App->gameNameCache->length;
-            int percentage = (total > 0) ? ((float)cacheScene->current_index / total) * 100 : 99;
-
-            if (percentage >= 100)
-            {
-                percentage = 99;
-            }
-
-            snprintf(progress_suffix, sizeof(progress_suffix), "%d%%", percentage);
+            cacheScene->current_index++;
+            now = playdate->system->getCurrentTimeMilliseconds();
+        }
 
-            cb_draw_logo_screen_centered_split(
-                CB_App->subheadFont, "Building Games List...", progress_suffix,
-                cacheScene->progress_max_width
+        if (cacheScene->current_index < total)
+        {
+            maybe_draw_progress(
+                cacheScene, now, "Building Games List...", cacheScene->current_index, total
             );
-
-            cacheScene->current_index++;
         }
         else
         {
             CB_App->gameListCacheIsSorted = false;
+            cacheScene->build_ms = now - cacheScene->phase_start_ms;
+            cacheScene->phase_start_ms = now;
             cacheScene->state = kCoverCacheStateSort;
         }
         break;
@@ -137,6 +204,7 @@ void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
         cacheScene->current_index = 0;
 
         cacheScene->start_time_ms = playdate->system->getCurrentTimeMilliseconds();
+        cacheScene->sort_ms = cacheScene->start_time_ms - cacheScene->phase_start_ms;
 
         array_clear(cacheScene->games_with_covers);
         array_reserve(cacheScene->games_with_covers, CB_App->gameListCache->length);
@@ -150,7 +218,7 @@ void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
             }
         }
 
-        if (cacheScene->games_with_covers->length > 0)
+        if (cacheScene->games_with_covers->length > 0 && CB_App->coverAtlas)
         {
             cacheScene->state = kCoverCacheStateCaching;
         }
@@ -164,120 +232,25 @@ void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
 
     case kCoverCacheStateCaching:
     {
-        if (cacheScene->current_index < cacheScene->games_with_covers->length &&
-            cacheScene->cache_size_bytes < MAX_CACHE_SIZE_BYTES)
+        uint32_t frame_start = playdate->system->getCurrentTimeMilliseconds();
+        uint32_t now = frame_start;
+        int total = cacheScene->games_with_covers->length;
+
+        while (cacheScene->current_index < total &&
+               now - frame_start < CB_LOADING_FRAME_BUDGET_MS)
         {
             CB_Game* game = cacheScene->games_with_covers->items[cacheScene->current_index];
+            cache_one_cover(cacheScene, game);
 
-            char progress_suffix[20];
-            int total = cacheScene->games_with_covers->length;
-            int percentage = (total > 0) ? ((float)cacheScene->current_index / total) * 100 : 99;
-
-            if (percentage >= 100)
-            {
-                percentage = 99;
-            }
-
-            snprintf(progress_suffix, sizeof(progress_suffix), "%d%%", percentage);
+            cacheScene->current_index++;
+            now = playdate->system->getCurrentTimeMilliseconds();
+        }
 
-            cb_draw_logo_screen_centered_split(
-                CB_App->subheadFont, "Caching Covers...", progress_suffix,
-                cacheScene->progress_max_width
+        if (cacheScene->current_index < total)
+        {
+            maybe_draw_progress(
+                cacheScene, now, "Caching Covers...", cacheScene->current_index, total
             );
-
-            const char* error = NULL;
-            LCDBitmap* coverBitmap = playdate->graphics->loadBitmap(game->coverPath, &error);
-
-            if (coverBitmap)
-            {
-                int width, height, rowbytes;
-                uint8_t *mask_data, *pixel_data;
-                playdate->graphics->getBitmapData(
-                    coverBitmap, &width, &height, &rowbytes, &mask_data, &pixel_data
-                );
-
-                bool has_mask = (mask_data != NULL);
-                size_t original_size = rowbytes * height;
-                if (has_mask)
-                {
-                    original_size *= 2;
-                }
-
-                int max_dst_size = LZ4_compressBound(original_size);
-                char* temp_compressed_buffer = cb_malloc(max_dst_size);
-
-                if (temp_compressed_buffer)
-                {
-                    uint8_t* uncompressed_buffer = cb_malloc(original_size);
-                    if (uncompressed_buffer)
-                    {
-                        memcpy(uncompressed_buffer, pixel_data, rowbytes * height);
-                        if (has_mask)
-                        {
-                            memcpy(
-                                uncompressed_buffer + (rowbytes * height), mask_data,
-                                rowbytes * height
-                            );
-                        }
-
-                        int compressed_size = LZ4_compress_fast_extState(
-                            cacheScene->lz4_state, (const char*)uncompressed_buffer,
-                            temp_compressed_buffer, original_size, max_dst_size, 1
-                        );
-
-                        cb_free(uncompressed_buffer);
-
-                        if (compressed_size > 0 &&
-                            (cacheScene->cache_size_bytes + compressed_size <=
-                             MAX_CACHE_SIZE_BYTES))
-                        {
-                            char* final_buffer = cb_malloc(compressed_size);
-                            if (final_buffer)
-                            {
-                                memcpy(final_buffer, temp_compressed_buffer, compressed_size);
-
-                                CB_CoverCacheEntry* entry = cb_malloc(sizeof(CB_CoverCacheEntry));
-                                if (!entry)
-                                {
-                                    cb_free(final_buffer);
-                                }
-                                else
-                                {
-                                    entry->rom_path = cb_strdup(game->fullpath);
-                                    if (!entry->rom_path)
-                                    {
-                                        cb_free(entry);
-                                        cb_free(final_buffer);
-                                    }
-                                    else
-                                    {
-                                        entry->compressed_data = final_buffer;
-                                        entry->compressed_size = compressed_size;
-                                        entry->original_size = original_size;
-                                        entry->width = width;
-                                        entry->height = height;
-                                        entry->rowbytes = rowbytes;
-                                        entry->has_mask = has_mask;
-
-                                        array_push(CB_App->coverCache, entry);
-                                        cacheScene->cache_size_bytes += compressed_size;
-                                    }
-                                }
-                            }
-                        }
-
-                        cb_free(temp_compressed_buffer);
-                    }
-                    else
-                    {
-                        cb_free(temp_compressed_buffer);
-                    }
-                }
-
-                playdate->graphics->freeBitmap(coverBitmap);
-            }
-
-            cacheScene->current_index++;
         }
         else
         {
@@ -291,10 +264,20 @@ void CB_CoverCacheScene_update(void* object, uint32_t u32enc_dt)
         uint32_t end_time_ms = playdate->system->getCurrentTimeMilliseconds();
         float duration = (end_time_ms - cacheScene->start_time_ms) / 1000.0f;
 
+        if (CB_App->coverAtlas && !cb_cover_atlas_save(CB_App->coverAtlas))
+        {
+            playdate->system->logToConsole("Failed to save the cover atlas.");
+        }
+
+        playdate->system->logToConsole(
+            "Cover Caching Complete: %d thumbnails reused, %d added, took %.2f seconds.",
+            cacheScene->reused_count, cacheScene->added_count, (double)duration
+        );
         playdate->system->logToConsole(
-            "Cover Caching Complete: %d covers cached, size: %lu bytes, took %.2f seconds.",
-            CB_App->coverCache->length, (unsigned long)cacheScene->cache_size_bytes,
-            (double)duration
+            "Cover Cache Phases: %d games, list %u ms, build %u ms, sort %u ms, caching %u ms.",
+            CB_App->gameNameCache->length, (unsigned)cacheScene->list_ms,
+            (unsigned)cacheScene->build_ms, (unsigned)cacheScene->sort_ms,
+            (unsigned)(end_time_ms - cacheScene->start_time_ms)
         );
 
         CB_LibraryScene* libraryScene = CB_LibraryScene_new();
@@ -322,11 +305,6 @@ void CB_CoverCacheScene_free(void* object)
         array_free(cacheScene->games_with_covers);
     }
 
-    if (cacheScene->lz4_state)
-    {
-        cb_free(cacheScene->lz4_state);
-    }
-
     CB_Scene_free(cacheScene->scene);
     cb_free(cacheScene);
 }
@@ -16,13 +16,20 @@ typedef struct CB_CoverCacheScene
 {
     CB_Scene* scene;
     int current_index;
-    size_t cache_size_bytes;
+    int reused_count;
+    int added_count;
     CoverCachingState state;
     CB_Array* available_covers;
     CB_Array* games_with_covers;
     uint32_t start_time_ms;
     int progress_max_width;
-    void* lz4_state;
+    uint32_t progress_drawn_ms;
+
+    // per-phase timing, logged when done
+    uint32_t phase_start_ms;
+    uint32_t list_ms;
+    uint32_t build_ms;
+    uint32_t sort_ms;
 } CB_CoverCacheScene;
 
 CB_CoverCacheScene* CB_CoverCacheScene_new(void);
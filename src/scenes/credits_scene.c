@@ -339,7 +339,7 @@ static void CB_CreditsScene_free(void* object)
     pgmusic_end();
     CB_CreditsScene* creditsScene = object;
     CB_Scene_free(creditsScene->scene);
-    free_json_data(creditsScene->jcred);
+    free_json_arena(creditsScene->jcred_arena);
     if (creditsScene->logo)
         playdate->graphics->freeBitmap(creditsScene->logo);
     cb_free(creditsScene->y_advance_by_item);
@@ -375,10 +375,11 @@ CB_CreditsScene* CB_CreditsScene_new(void)
     creditsScene->logo = playdate->graphics->loadBitmap("images/logo", NULL);
 
     json_value j;
-    int result = parse_json("./credits.json", &j, kFileRead | kFileReadData);
+    JsonArena* arena;
+    int result = parse_json_arena("./credits.json", &j, kFileRead | kFileReadData, NULL, &arena);
     if (!result || j.type != kJSONArray)
     {
-        free_json_data(j);
+        free_json_arena(arena);
         if (creditsScene->logo)
         {
             playdate->graphics->freeBitmap(creditsScene->logo);
@@ -388,6 +389,7 @@ CB_CreditsScene* CB_CreditsScene_new(void)
         return NULL;
     }
     creditsScene->jcred = j;
+    creditsScene->jcred_arena = arena;
 
     creditsScene->y_advance_by_item = cb_malloc(sizeof(int) * ((JsonArray*)j.data.tableval)->n);
     if (creditsScene->y_advance_by_item)
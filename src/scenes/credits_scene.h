@@ -14,6 +14,7 @@ typedef struct CB_CreditsScene
     CB_Scene* scene;
 
     json_value jcred;
+    struct JsonArena* jcred_arena;
     int* y_advance_by_item;
     float scroll;
     float time;
@@ -79,6 +79,29 @@ static bool copy_one_file(const char* full_path, const char* filename)
         playdate->system->logToConsole("Error: Failed to read from %s", full_path);
     }
 
+    if (success && !strcasecmp(extension, ".state"))
+    {
+        // "<base>.<slot>.state" -- the game's slot index is now stale
+        char* base = cb_strdup(filename);
+        char* dot = base ? strrchr(base, '.') : NULL;
+        if (dot)
+        {
+            *dot = 0;
+            dot = strrchr(base, '.');
+        }
+        if (dot)
+        {
+            *dot = 0;
+            char* index_path = aprintf("%s/%s.slots", cb_gb_directory_path(CB_statesPath), base);
+            if (index_path)
+            {
+                playdate->file->unlink(index_path, false);
+                cb_free(index_path);
+            }
+        }
+        cb_free(base);
+    }
+
     cb_free(dst_path);
     return success;
 }
@@ -3,6 +3,7 @@
 
 #include "../app.h"
 #include "../jparse.h"
+#include "../scan_cache.h"
 #include "../script.h"
 #include "../utility.h"
 #include "cover_cache_scene.h"
@@ -17,6 +18,54 @@ void CB_GameScanningScene_free(void* object);
 
 void collect_game_filenames_callback(const char* filename, void* userdata);
 
+static bool import_legacy_crc_entry(void* ud, const char* key, int index, json_value entry)
+{
+    CB_GameScanningScene* scanScene = ud;
+
+    json_value crc_val = json_get_table_value(entry, "crc32");
+    json_value size_val = json_get_table_value(entry, "size");
+    json_value mtime_val = json_get_table_value(entry, "m_time");
+    json_value header_val = json_get_table_value(entry, "name_header");
+    json_value battery_val = json_get_table_value(entry, "sram");
+    json_value cgb_val = json_get_table_value(entry, "cgb");
+
+    if (key && crc_val.type == kJSONInteger && size_val.type == kJSONInteger &&
+        mtime_val.type == kJSONInteger && header_val.type == kJSONString &&
+        battery_val.type == kJSONInteger && cgb_val.type == kJSONInteger)
+    {
+        CB_ScanCacheRecord record = {
+            .crc32 = (uint32_t)crc_val.data.intval,
+            .size = (uint32_t)size_val.data.intval,
+            .m_time = (uint32_t)mtime_val.data.intval,
+            .cgb = cgb_val.data.intval,
+            .sram = battery_val.data.intval,
+        };
+        strncpy(record.name_header, header_val.data.stringval, sizeof(record.name_header));
+        cb_scan_cache_put(scanScene->scan_cache, key, record);
+    }
+    return true;
+}
+
+// One-time migration from the JSON cache used by earlier versions, so
+// upgrading doesn't mean re-reading every ROM.
+static void import_legacy_crc_cache(CB_GameScanningScene* scanScene)
+{
+    // streamed an entry at a time; the legacy cache can be large
+    if (!cb_file_exists(CRC_CACHE_FILE, kFileReadData) ||
+        !parse_json_each(
+            CRC_CACHE_FILE, kFileReadData, "", NULL, import_legacy_crc_entry, scanScene
+        ))
+        return;
+
+    // write it out, then load it back as the sorted file
+    if (cb_scan_cache_save(scanScene->scan_cache))
+    {
+        cb_scan_cache_free(scanScene->scan_cache);
+        scanScene->scan_cache = cb_scan_cache_load(SCAN_CACHE_FILE);
+        playdate->file->unlink(CRC_CACHE_FILE, 0);
+    }
+}
+
 static void process_one_game(CB_GameScanningScene* scanScene, const char* filename)
 {
     CB_GameName* newName = allocz(CB_GameName);
@@ -56,53 +105,17 @@ static void process_one_game(CB_GameScanningScene* scanScene, const char* filena
     enum cgb_support_e cgb = 0;
     unsigned battery = false;
 
-    json_value cached_entry = {.type = kJSONNull};
-    if (scanScene->crc_cache.type == kJSONTable)
-    {
-        JsonObject* obj = scanScene->crc_cache.data.tableval;
-
-        TableKeyPair key_to_find;
-        key_to_find.key = (char*)filename;
-
-        TableKeyPair* found_pair = (TableKeyPair*)bsearch(
-            &key_to_find, obj->data, obj->n, sizeof(TableKeyPair), compare_key_pairs
-        );
-
-        if (found_pair)
-        {
-            cached_entry = found_pair->value;
-        }
-    }
-
-    if (cached_entry.type == kJSONTable)
+    const CB_ScanCacheRecord* cached = cb_scan_cache_find(scanScene->scan_cache, filename);
+    if (cached && cached->size == stat.size && cached->m_time == m_time_epoch)
     {
-        json_value cached_crc_val = json_get_table_value(cached_entry, "crc32");
-        json_value cached_size_val = json_get_table_value(cached_entry, "size");
-        json_value cached_mtime_val = json_get_table_value(cached_entry, "m_time");
-        json_value cached_header_val = json_get_table_value(cached_entry, "name_header");
-        json_value cached_battery = json_get_table_value(cached_entry, "sram");
-        json_value cached_cgb_val = json_get_table_value(cached_entry, "cgb");
-
-        if (cached_crc_val.type == kJSONInteger && cached_size_val.type == kJSONInteger &&
-            cached_mtime_val.type == kJSONInteger && cached_header_val.type == kJSONString &&
-            cached_battery.type == kJSONInteger && cached_cgb_val.type == kJSONInteger)
-        {
-            if ((uint32_t)cached_size_val.data.intval == stat.size &&
-                (uint32_t)cached_mtime_val.data.intval == m_time_epoch)
-            {
-                crc = (uint32_t)cached_crc_val.data.intval;
-                strncpy(
-                    header_name_buffer, cached_header_val.data.stringval,
-                    sizeof(header_name_buffer) - 1
-                );
-                battery = cached_battery.data.intval;
-                cgb = cached_cgb_val.data.intval;
-                needs_calculation = false;
-            }
-        }
+        crc = cached->crc32;
+        memcpy(header_name_buffer, cached->name_header, sizeof(cached->name_header));
+        battery = cached->sram;
+        cgb = cached->cgb;
+        needs_calculation = false;
     }
 
-    CB_FetchedNames fetched = {NULL, NULL, 0, true};
+    bool failed_to_open_rom = true;
 
     if (needs_calculation)
     {
@@ -140,75 +153,33 @@ static void process_one_game(CB_GameScanningScene* scanScene, const char* filena
 
         if (valid)
         {
-            fetched.failedToOpenROM = false;
-
-            json_value new_entry_val;
-            new_entry_val.type = kJSONTable;
-            JsonObject* obj = cb_calloc(1, sizeof(JsonObject));
-            new_entry_val.data.tableval = obj;
-
-            json_value crc_val = {.type = kJSONInteger, .data.intval = crc};
-            json_value size_val = {.type = kJSONInteger, .data.intval = stat.size};
-            json_value mtime_val = {.type = kJSONInteger, .data.intval = m_time_epoch};
-            json_value header_val = {
-                .type = kJSONString, .data.stringval = cb_strdup(header_name_buffer)
+            failed_to_open_rom = false;
+
+            CB_ScanCacheRecord record = {
+                .crc32 = crc,
+                .size = stat.size,
+                .m_time = m_time_epoch,
+                .cgb = cgb,
+                .sram = battery,
             };
-            json_value cgb_val = {.type = kJSONInteger, .data.intval = cgb};
-            json_value bat_val = {.type = kJSONInteger, .data.intval = battery};
-
-            json_set_table_value(&new_entry_val, "name_header", header_val);
-            json_set_table_value(&new_entry_val, "crc32", crc_val);
-            json_set_table_value(&new_entry_val, "size", size_val);
-            json_set_table_value(&new_entry_val, "m_time", mtime_val);
-            json_set_table_value(&new_entry_val, "sram", bat_val);
-            json_set_table_value(&new_entry_val, "cgb", cgb_val);
-
-            json_value* new_file_entry = cb_calloc(1, sizeof(json_value));
-            new_file_entry->type = kJSONTable;
-            JsonObject* file_obj = cb_calloc(1, sizeof(JsonObject));
-            new_file_entry->data.tableval = file_obj;
-
-            json_set_table_value(new_file_entry, filename, new_entry_val);
-
-            array_push(scanScene->new_cache_entries, new_file_entry);
-            scanScene->crc_cache_modified = true;
+            strncpy(record.name_header, header_name_buffer, sizeof(record.name_header));
+            cb_scan_cache_put(scanScene->scan_cache, filename, record);
         }
     }
     else
     {
-        fetched.failedToOpenROM = false;
+        failed_to_open_rom = false;
     }
 
     newName->name_header = cb_strdup(header_name_buffer);
 
-    if (!fetched.failedToOpenROM)
-    {
-        CB_FetchedNames names_from_db = cb_get_titles_from_db_by_crc(crc);
-        fetched.short_name = names_from_db.short_name;
-        fetched.detailed_name = names_from_db.detailed_name;
-    }
-
-    fetched.crc32 = crc;
-    newName->crc32 = fetched.crc32;
+    // database names are filled in for all games at once, after scanning
+    newName->crc32 = crc;
     newName->rom_cgb_support = cgb;
     newName->rom_has_battery = battery;
     cb_free(fullpath);
 
-    newName->name_database = (fetched.detailed_name) ? cb_strdup(fetched.detailed_name) : NULL;
-    newName->name_short =
-        (fetched.short_name) ? cb_strdup(fetched.short_name) : cb_strdup(newName->name_filename);
-    newName->name_detailed = (fetched.detailed_name) ? cb_strdup(fetched.detailed_name)
-                                                     : cb_strdup(newName->name_filename);
-
-    newName->name_short_leading_article = common_article_form(newName->name_short);
-    newName->name_detailed_leading_article = common_article_form(newName->name_detailed);
-
-    if (fetched.short_name)
-        cb_free(fetched.short_name);
-    if (fetched.detailed_name)
-        cb_free(fetched.detailed_name);
-
-    if (!fetched.failedToOpenROM)
+    if (!failed_to_open_rom)
     {
         array_push(CB_App->gameNameCache, newName);
     }
@@ -219,6 +190,52 @@ static void process_one_game(CB_GameScanningScene* scanScene, const char* filena
     }
 }
 
+// Looks up the database titles of every game added by this scan in one pass.
+static void apply_database_names(CB_GameScanningScene* scanScene)
+{
+    int first = scanScene->first_new_name;
+    int count = CB_App->gameNameCache->length - first;
+    if (count <= 0)
+        return;
+
+    uint32_t* crcs = cb_malloc(count * sizeof(uint32_t));
+    CB_FetchedNames* fetched = cb_calloc(count, sizeof(CB_FetchedNames));
+    if (crcs && fetched)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            CB_GameName* name = CB_App->gameNameCache->items[first + i];
+            crcs[i] = name->crc32;
+        }
+        cb_get_titles_from_db_by_crcs(crcs, fetched, count);
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        CB_GameName* newName = CB_App->gameNameCache->items[first + i];
+        const char* short_name = fetched ? fetched[i].short_name : NULL;
+        const char* detailed_name = fetched ? fetched[i].detailed_name : NULL;
+
+        newName->name_database = (detailed_name) ? cb_strdup(detailed_name) : NULL;
+        newName->name_short =
+            (short_name) ? cb_strdup(short_name) : cb_strdup(newName->name_filename);
+        newName->name_detailed =
+            (detailed_name) ? cb_strdup(detailed_name) : cb_strdup(newName->name_filename);
+
+        newName->name_short_leading_article = common_article_form(newName->name_short);
+        newName->name_detailed_leading_article = common_article_form(newName->name_detailed);
+
+        if (fetched)
+        {
+            cb_free(fetched[i].short_name);
+            cb_free(fetched[i].detailed_name);
+        }
+    }
+
+    cb_free(crcs);
+    cb_free(fetched);
+}
+
 static void checkForPngCallback(const char* filename, void* userdata)
 {
     if (filename_has_stbi_extension(filename))
@@ -240,12 +257,19 @@ void CB_GameScanningScene_update(void* object, uint32_t u32enc_dt)
     {
     case kScanningStateInit:
     {
+        uint32_t now = playdate->system->getCurrentTimeMilliseconds();
+        scanScene->start_time_ms = now;
+
         playdate->file->listfiles(
             cb_gb_directory_path(CB_gamesPath), collect_game_filenames_callback,
             scanScene->game_filenames, 0
         );
 
         array_reserve(CB_App->gameNameCache, scanScene->game_filenames->length);
+        scanScene->first_new_name = CB_App->gameNameCache->length;
+
+        scanScene->phase_start_ms = playdate->system->getCurrentTimeMilliseconds();
+        scanScene->list_ms = scanScene->phase_start_ms - now;
 
         if (scanScene->game_filenames->length == 0)
         {
@@ -264,13 +288,37 @@ void CB_GameScanningScene_update(void* object, uint32_t u32enc_dt)
 
     case kScanningStateScanning:
     {
-        if (scanScene->current_index < scanScene->game_filenames->length)
+        uint32_t frame_start = playdate->system->getCurrentTimeMilliseconds();
+        uint32_t now = frame_start;
+
+        do
         {
+            if (scanScene->current_index >= scanScene->game_filenames->length)
+            {
+                scanScene->scan_ms = now - scanScene->phase_start_ms;
+
+                apply_database_names(scanScene);
+
+                uint32_t end = playdate->system->getCurrentTimeMilliseconds();
+                scanScene->titles_ms = end - now;
+                scanScene->phase_start_ms = end;
+                scanScene->state = kScanningStateDone;
+                break;
+            }
+
             const char* filename = scanScene->game_filenames->items[scanScene->current_index];
+            process_one_game(scanScene, filename);
+            scanScene->current_index++;
+            now = playdate->system->getCurrentTimeMilliseconds();
+        } while (now - frame_start < CB_LOADING_FRAME_BUDGET_MS);
 
+        if (scanScene->state == kScanningStateScanning &&
+            (scanScene->progress_drawn_ms == 0 ||
+             now - scanScene->progress_drawn_ms >= CB_LOADING_PROGRESS_INTERVAL_MS))
+        {
             char progress_message[32];
             snprintf(
-                progress_message, sizeof(progress_message), "%d/%d", scanScene->current_index + 1,
+                progress_message, sizeof(progress_message), "%d/%d", scanScene->current_index,
                 scanScene->game_filenames->length
             );
 
@@ -278,47 +326,23 @@ void CB_GameScanningScene_update(void* object, uint32_t u32enc_dt)
                 CB_App->subheadFont, "Scanning Games... ", progress_message,
                 scanScene->progress_max_width
             );
-
-            process_one_game(scanScene, filename);
-            scanScene->current_index++;
-        }
-        else
-        {
-            scanScene->state = kScanningStateDone;
+            scanScene->progress_drawn_ms = now;
         }
         break;
     }
 
     case kScanningStateDone:
     {
-        if (scanScene->crc_cache_modified && scanScene->new_cache_entries->length > 0)
-        {
-            for (int i = 0; i < scanScene->new_cache_entries->length; i++)
-            {
-                json_value* file_entry = (json_value*)scanScene->new_cache_entries->items[i];
-                JsonObject* file_obj = file_entry->data.tableval;
-
-                const char* filename = file_obj->data[0].key;
-                json_value value = file_obj->data[0].value;
-                json_set_table_value(&scanScene->crc_cache, filename, value);
-
-                file_obj->data[0].value.type = kJSONNull;
-            }
-
-            JsonObject* obj = scanScene->crc_cache.data.tableval;
-            if (obj && obj->n > 1)
-            {
-                qsort(obj->data, obj->n, sizeof(TableKeyPair), compare_key_pairs);
-            }
-
-            char* path;
-            playdate->system->formatString(&path, "%s", CRC_CACHE_FILE);
-            if (path)
-            {
-                write_json_to_disk(path, scanScene->crc_cache);
-                cb_free(path);
-            }
-        }
+        cb_scan_cache_save(scanScene->scan_cache);
+
+        uint32_t end = playdate->system->getCurrentTimeMilliseconds();
+        playdate->system->logToConsole(
+            "Game Scan Complete: %d games in %u ms (list %u ms, scan %u ms, titles %u ms, "
+            "cache %u ms).",
+            scanScene->game_filenames->length, (unsigned)(end - scanScene->start_time_ms),
+            (unsigned)scanScene->list_ms, (unsigned)scanScene->scan_ms,
+            (unsigned)scanScene->titles_ms, (unsigned)(end - scanScene->phase_start_ms)
+        );
 
         bool png_found = false;
         playdate->file->listfiles(
@@ -353,22 +377,7 @@ void CB_GameScanningScene_free(void* object)
         array_free(scanScene->game_filenames);
     }
 
-    if (scanScene->new_cache_entries)
-    {
-        for (int i = 0; i < scanScene->new_cache_entries->length; i++)
-        {
-            json_value* item_to_free = (json_value*)scanScene->new_cache_entries->items[i];
-
-            if (item_to_free)
-            {
-                free_json_data(*item_to_free);
-                cb_free(item_to_free);
-            }
-        }
-        array_free(scanScene->new_cache_entries);
-    }
-
-    free_json_data(scanScene->crc_cache);
+    cb_scan_cache_free(scanScene->scan_cache);
     CB_Scene_free(scanScene->scene);
     cb_free(scanScene);
 }
@@ -385,35 +394,10 @@ CB_GameScanningScene* CB_GameScanningScene_new(void)
     scanScene->scene->use_user_stack = false;
 
     scanScene->game_filenames = array_new();
-    scanScene->new_cache_entries = array_new();
     scanScene->current_index = 0;
     scanScene->state = kScanningStateInit;
-    scanScene->crc_cache_modified = false;
-
-    char* path;
-    playdate->system->formatString(&path, "%s", CRC_CACHE_FILE);
-    if (path)
-    {
-        if (parse_json(path, &scanScene->crc_cache, kFileReadData))
-        {
-            if (scanScene->crc_cache.type == kJSONTable)
-            {
-                JsonObject* obj = scanScene->crc_cache.data.tableval;
-                if (obj && obj->n > 1)
-                {
-                    qsort(obj->data, obj->n, sizeof(TableKeyPair), compare_key_pairs);
-                }
-            }
-        }
-        else
-        {
-            scanScene->crc_cache.type = kJSONTable;
-            JsonObject* obj = cb_malloc(sizeof(JsonObject));
-            obj->n = 0;
-            scanScene->crc_cache.data.tableval = obj;
-        }
-        cb_free(path);
-    }
+    scanScene->scan_cache = cb_scan_cache_load(SCAN_CACHE_FILE);
+    import_legacy_crc_cache(scanScene);
 
     return scanScene;
 }
@@ -16,12 +16,19 @@ typedef struct CB_GameScanningScene
 {
     CB_Scene* scene;
     CB_Array* game_filenames;
-    CB_Array* new_cache_entries;
     int current_index;
+    int first_new_name;
     GameScanningState state;
-    json_value crc_cache;
-    bool crc_cache_modified;
+    struct CB_ScanCache* scan_cache;
     int progress_max_width;
+    uint32_t progress_drawn_ms;
+
+    // per-phase timing, logged when done
+    uint32_t start_time_ms;
+    uint32_t phase_start_ms;
+    uint32_t list_ms;
+    uint32_t scan_ms;
+    uint32_t titles_ms;
 } CB_GameScanningScene;
 
 CB_GameScanningScene* CB_GameScanningScene_new(void);
@@ -29,6 +29,7 @@ bool gbScreenRequiresFullRefresh;
 #include "../app.h"
 #include "../dtcm.h"
 #include "../preferences.h"
+#include "../rom_pager.h"
 #include "../script.h"
 #include "../softpatch.h"
 #include "../userstack.h"
@@ -49,6 +50,9 @@ bool gbScreenRequiresFullRefresh;
 // Upper bound on the number of audio samples we generate per frame.
 #define MAX_AUDIO_SAMPLES_PER_CHUNK ((44100 / 60) * 4)
 
+// Compressed ROMs are read and decoded this much at a time.
+#define ROM_READ_WINDOW (4 * 1024)
+
 // --- Parameters for the "Tendency Counter" Auto-Interlace System ---
 
 // The tendency counter's ceiling. Higher values add more inertia.
@@ -174,16 +178,26 @@ static bool CB_GameScene_lock(void* object);
 static uint8_t* read_rom_to_ram(
     const char* filename, CB_GameSceneError* sceneError, size_t* o_rom_size
 );
+static CB_RomPager* open_rom_pager(
+    CB_GameScene* gameScene, const char* rom_path, const SoftPatch* patches
+);
+static void rom_prefetch_tick(CB_GameSceneContext* context);
 
 // returns 0 if no pre-existing save data;
 // returns 1 if data found and loaded, but not RTC
 // returns 2 if data and RTC loaded
 // returns -1 on error
 static int read_cart_ram_file(const char* save_filename, gb_s* gb, unsigned int* last_save_time);
-static void write_cart_ram_file(const char* save_filename, gb_s* gb);
+
+// returns true if successful
+static bool write_cart_ram_file(const char* save_filename, gb_s* gb);
+static int replay_cart_ram_journal(
+    const char* save_filename, gb_s* gb, unsigned int* last_save_time
+);
 
 static void gb_error(gb_s* gb, const enum gb_error_e gb_err, const uint16_t val);
 static void gb_save_to_disk(gb_s* gb);
+static bool gb_save_to_journal(gb_s* gb);
 
 static const char* startButtonText = "start";
 static const char* selectButtonText = "select";
@@ -472,6 +486,18 @@ static bool CB_GameScene_complete_successful_init(CB_GameScene* gameScene)
     context->cart_ram = context->gb->gb_cart_ram;
     gameScene->save_data_loaded_successfully = true;
 
+    // what's on disk (.sav + journal); idle saves journal the difference.
+    if (gameScene->cartridge_has_battery && context->gb->gb_cart_ram_size > 0)
+    {
+        gameScene->sram_shadow = cb_malloc(context->gb->gb_cart_ram_size);
+        if (gameScene->sram_shadow)
+        {
+            memcpy(
+                gameScene->sram_shadow, context->gb->gb_cart_ram, context->gb->gb_cart_ram_size
+            );
+        }
+    }
+
     unsigned int now = playdate->system->getSecondsSinceEpoch(NULL);
     gameScene->rtc_time = now;
     gameScene->rtc_seconds_to_catch_up = 0;
@@ -719,35 +745,74 @@ CB_GameScene* CB_GameScene_new(const char* rom_filename, char* name_short, bool
 
     CB_GameSceneError romError;
     size_t rom_size;
-    uint8_t* rom = read_rom_to_ram(rom_filename, &romError, &rom_size);
+    uint8_t* rom;
+    SoftPatch* patches = list_patches(rom_filename, NULL);
+
+    // a cached patched ROM loads (and pages) like any other
+    char* patched_rom_path = patches ? find_patched_rom(rom_filename, patches) : NULL;
+    if (patched_rom_path)
+    {
+        playdate->system->logToConsole("Using cached patched ROM %s", patched_rom_path);
+    }
+    const char* load_path = patched_rom_path ? patched_rom_path : rom_filename;
+
+    context->rom_pager = open_rom_pager(gameScene, load_path, patched_rom_path ? NULL : patches);
+    if (context->rom_pager)
+    {
+        rom = cb_rom_pager_bank0(context->rom_pager);
+        rom_size = cb_rom_pager_rom_size(context->rom_pager);
+        context->rom_prefetch_pending = true;
+        gb_rom_bank_mapper = cb_rom_pager_map;
+        gb_rom_bank_mapper_ud = context->rom_pager;
+    }
+    else
+    {
+        rom = read_rom_to_ram(load_path, &romError, &rom_size);
+    }
+    bool patched_from_cache = (patched_rom_path != NULL);
+    cb_free(patched_rom_path);
     DTCM_VERIFY();
     if (rom)
     {
         playdate->system->logToConsole("Opened ROM.");
 
         // try patches
-        SoftPatch* patches = list_patches(rom_filename, NULL);
         if (patches)
         {
-            printf("softpatching ROM...\n");
-            bool result = call_with_main_stack_3(patch_rom, (void*)&rom, &rom_size, patches);
+            if (!context->rom_pager && !patched_from_cache)
+            {
+                printf("softpatching ROM...\n");
+                bool result = call_with_main_stack_3(patch_rom, (void*)&rom, &rom_size, patches);
+                if (result)
+                {
+                    save_patched_rom(rom_filename, patches, rom, rom_size);
+                }
+            }
             gameScene->patches_hash = patch_hash(patches);
 
             free_patches(patches);
         }
 
-        context->rom = rom;
+        context->rom = context->rom_pager ? NULL : rom;
         context->rom_size = rom_size;
 
-        static clalign uint8_t lcd[LCD_BUFFER_BYTES];
-        memset(lcd, 0, sizeof(lcd));
+        // one block for all emulated memory, aligned to a cache line
+        context->arena_alloc = cb_malloc(sizeof(gb_arena) + 31);
+        if (!context->arena_alloc)
+        {
+            playdate->system->logToConsole("Failed to allocate emulator memory.");
+            gameScene->state = CB_GameSceneStateError;
+            gameScene->error = CB_GameSceneErrorFatal;
+            return gameScene;
+        }
+        context->arena = (gb_arena*)(((uintptr_t)context->arena_alloc + 31) & ~(uintptr_t)31);
+        memset(context->arena, 0, sizeof(gb_arena));
 
         gameScene->cgb_compatible = (gb_get_models_supported(rom) & GB_SUPPORT_CGB);
         gameScene->dmg_compatible = (gb_get_models_supported(rom) & GB_SUPPORT_DMG);
 
         enum gb_init_error_e gb_ret = gb_init(
-            context->gb, context->wram, context->vram, lcd, rom, rom_size, gb_error, context,
-            cgb_mode
+            context->gb, context->arena, rom, rom_size, gb_error, context, cgb_mode
         );
 
         CB_ASSERT((((uintptr_t)context->gb->lcd) & 7) == 0);
@@ -792,6 +857,7 @@ CB_GameScene* CB_GameScene_new(const char* rom_filename, char* name_short, bool
     }
     else
     {
+        free_patches(patches);
         playdate->system->logToConsole("Failed to open ROM.");
         gameScene->state = CB_GameSceneStateError;
         gameScene->error = romError;
@@ -937,6 +1003,46 @@ static void CB_GameScene_selector_init(CB_GameScene* gameScene)
     gameScene->selector.selectPressed = false;
 }
 
+// Large ROMs are paged in from disk on demand rather than read whole
+// (see rom_pager.h), unless something needs to modify the whole image:
+// enabled softpatches, or a script (which may poke ROM or set breakpoints).
+static CB_RomPager* open_rom_pager(
+    CB_GameScene* gameScene, const char* rom_path, const SoftPatch* patches
+)
+{
+    for (const SoftPatch* patch = patches; patch && patch->fullpath; patch++)
+    {
+        if (patch->state == PATCH_ENABLED)
+            return NULL;
+    }
+
+    if (preferences_script_support)
+    {
+        ScriptInfo* scriptInfo = script_get_info_by_rom_path(gameScene->rom_filename);
+        bool has_script = scriptInfo != NULL;
+        script_info_free(scriptInfo);
+        if (has_script)
+            return NULL;
+    }
+
+    char* prefetch_path = aprintf(
+        "%s/%s.banks", cb_gb_directory_path(CB_settingsPath), gameScene->base_filename
+    );
+    CB_RomPager* pager = prefetch_path ? cb_rom_pager_open(rom_path, prefetch_path) : NULL;
+    cb_free(prefetch_path);
+    return pager;
+}
+
+// prefetches a bank from the learned list per frame, while there's time to spare.
+static void rom_prefetch_tick(CB_GameSceneContext* context)
+{
+    float target_dt = (1 + preferences_frame_skip) * CB_App->avg_dt_mult / 60.0f;
+    if (CB_App->avg_dt > target_dt)
+        return;
+
+    context->rom_prefetch_pending = cb_rom_pager_prefetch(context->rom_pager, 1);
+}
+
 /**
  * Returns a pointer to the allocated space containing the ROM. Must be freed.
  */
@@ -977,58 +1083,79 @@ static uint8_t* read_rom_to_ram(
     *o_rom_size = rom_size;
     playdate->file->seek(rom_file, 0, SEEK_SET);
 
-    uint8_t* rom = cb_malloc(rom_size);
-
-    if (!rom || playdate->file->read(rom_file, rom, rom_size) != rom_size)
-    {
-        playdate->system->logToConsole(
-            "%s:%i: Can't read rom file %s", __FILE__, __LINE__, filename
-        );
-
-        cb_free(rom);
-        playdate->file->close(rom_file);
-        *sceneError = CB_GameSceneErrorLoadingRom;
-        return NULL;
-    }
-
-    playdate->file->close(rom_file);
+    // read just the head first: a gbz is then inflated window by window
+    // straight into the ROM buffer, so it's never resident compressed too.
+    uint8_t head[GBZ_INDEX_OFFSET];
+    int head_size = playdate->file->read(rom_file, head, MIN(rom_size, (int)sizeof(head)));
 
     GBZ_Header gbz;
-    if (gbz_parse_header(&gbz, rom, rom_size))
+    if (head_size == (int)sizeof(head) && gbz_parse_header(&gbz, head, head_size))
     {
         uint8_t* decompressed_rom = cb_malloc(gbz.original_size);
-        if (!decompressed_rom)
+        GBZ_Stream* stream =
+            decompressed_rom ? gbz_stream_new(decompressed_rom, gbz.original_size, NULL, NULL)
+                             : NULL;
+        uint8_t* window = stream ? cb_malloc(ROM_READ_WINDOW) : NULL;
+        if (!window)
         {
             playdate->system->logToConsole(
                 "%s:%i: Can't decompress %s, out of memory", __FILE__, __LINE__, filename
             );
 
-            cb_free(rom);
+            gbz_stream_free(stream);
+            cb_free(decompressed_rom);
             playdate->file->close(rom_file);
             *sceneError = CB_GameSceneErrorLoadingRom;
+            return NULL;
         }
 
-        int status = gbz_decompress(rom, rom_size, decompressed_rom, gbz.original_size);
-        cb_free(rom);
-        if (status != gbz.original_size)
+        int status = gbz_stream_feed(stream, head, head_size);
+        while (status == GBZ_STREAM_MORE)
+        {
+            int n = playdate->file->read(rom_file, window, ROM_READ_WINDOW);
+            if (n <= 0)
+                break;
+            status = gbz_stream_feed(stream, window, n);
+        }
+
+        gbz_stream_free(stream);
+        cb_free(window);
+        playdate->file->close(rom_file);
+
+        if (status != GBZ_STREAM_DONE)
         {
             playdate->system->logToConsole(
                 "%s:%i: Failed to decompress %s: %d", __FILE__, __LINE__, filename, status
             );
             cb_free(decompressed_rom);
+            *sceneError = CB_GameSceneErrorLoadingRom;
             return NULL;
         }
-        else
-        {
-            playdate->system->logToConsole("Decompressed ROM: %s", filename);
-        }
 
+        playdate->system->logToConsole("Decompressed ROM: %s", filename);
+        *o_rom_size = gbz.original_size;
         return decompressed_rom;
     }
-    else
+
+    uint8_t* rom = cb_malloc(rom_size);
+
+    if (!rom || head_size != MIN(rom_size, (int)sizeof(head)) ||
+        playdate->file->read(rom_file, rom + head_size, rom_size - head_size) !=
+            rom_size - head_size)
     {
-        return rom;
+        playdate->system->logToConsole(
+            "%s:%i: Can't read rom file %s", __FILE__, __LINE__, filename
+        );
+
+        cb_free(rom);
+        playdate->file->close(rom_file);
+        *sceneError = CB_GameSceneErrorLoadingRom;
+        return NULL;
     }
+
+    memcpy(rom, head, head_size);
+    playdate->file->close(rom_file);
+    return rom;
 }
 
 static int read_cart_ram_file(const char* save_filename, gb_s* gb, unsigned int* last_save_time)
@@ -1085,135 +1212,683 @@ static int read_cart_ram_file(const char* save_filename, gb_s* gb, unsigned int*
     }
 
     playdate->file->close(f);
+
+    if (code == 2)
+    {
+        gameScene->sram_journal_base_time = *last_save_time;
+
+        int commits = replay_cart_ram_journal(save_filename, gb, last_save_time);
+        if (commits > 0)
+        {
+            playdate->system->logToConsole("Replayed %d save journal commit(s)", commits);
+        }
+    }
+
     return code;
 }
 
-static void write_cart_ram_file(const char* save_filename, gb_s* gb)
+// size of the data following cart ram in a .sav file
+#define SRAM_FOOTER_SIZE \
+    (sizeof(((gb_s*)0)->cart_rtc) + sizeof(unsigned int) + 2 * sizeof(uint32_t) + sizeof(uint64_t))
+
+// strictly increasing, so that a journal written on top of the previous
+// .sav can never be mistaken for one written on top of the next one.
+static unsigned int next_save_time(CB_GameScene* gameScene)
+{
+    unsigned int now = playdate->system->getSecondsSinceEpoch(NULL);
+    if (now <= gameScene->last_save_time)
+        now = gameScene->last_save_time + 1;
+    return now;
+}
+
+// rtc, timestamp, flags, patch hash, magic number.
+static void write_cart_ram_footer(gb_s* gb, unsigned int save_time, uint8_t* out)
+{
+    CB_GameSceneContext* context = gb->direct.priv;
+    CB_GameScene* gameScene = context->scene;
+
+    uint32_t flags = !!gameScene->script;
+    uint64_t magic = SRAM_MAGIC_NUMBER;
+
+    memcpy(out, gb->cart_rtc, sizeof(gb->cart_rtc));
+    out += sizeof(gb->cart_rtc);
+    memcpy(out, &save_time, sizeof(save_time));
+    out += sizeof(save_time);
+    memcpy(out, &flags, sizeof(flags));
+    out += sizeof(flags);
+    memcpy(out, &gameScene->patches_hash, sizeof(gameScene->patches_hash));
+    out += sizeof(gameScene->patches_hash);
+
+    // (must be at end of file)
+    memcpy(out, &magic, sizeof(magic));
+}
+
+// Generates .tmp and .bak filenames for the given .sav
+// returns false on allocation failure.
+static bool cart_ram_tmp_filenames(const char* save_filename, char** tmp_out, char** bak_out)
+{
+    size_t len = strlen(save_filename);
+    char* tmp_filename = cb_malloc(len + 5);
+    char* bak_filename = cb_malloc(len + 5);
+
+    if (!tmp_filename || !bak_filename)
+    {
+        playdate->system->logToConsole("Error: Failed to allocate memory for safe save filenames.");
+        if (tmp_filename)
+            cb_free(tmp_filename);
+        if (bak_filename)
+            cb_free(bak_filename);
+        return false;
+    }
+
+    strcpy(tmp_filename, save_filename);
+    strcpy(bak_filename, save_filename);
+
+    char* ext_tmp = strrchr(tmp_filename, '.');
+    if (ext_tmp && strcmp(ext_tmp, ".sav") == 0)
+    {
+        strcpy(ext_tmp, ".tmp");
+    }
+    else
+    {
+        strcat(tmp_filename, ".tmp");
+    }
+
+    char* ext_bak = strrchr(bak_filename, '.');
+    if (ext_bak && strcmp(ext_bak, ".sav") == 0)
+    {
+        strcpy(ext_bak, ".bak");
+    }
+    else
+    {
+        strcat(bak_filename, ".bak");
+    }
+
+    *tmp_out = tmp_filename;
+    *bak_out = bak_filename;
+    return true;
+}
+
+// Replaces the .sav with the fully-written .tmp, keeping the old one as .bak.
+// returns true if successful
+static bool commit_cart_ram_tmp_file(
+    const char* save_filename, const char* tmp_filename, const char* bak_filename
+)
+{
+    // Verify that the temporary file is not zero-bytes
+    FileStat stat;
+    if (playdate->file->stat(tmp_filename, &stat) != 0)
+    {
+        playdate->system->logToConsole(
+            "Error: Failed to stat temp save file %s. Aborting save.", tmp_filename
+        );
+        playdate->file->unlink(tmp_filename, false);
+        return false;
+    }
+
+    if (stat.size == 0)
+    {
+        playdate->system->logToConsole(
+            "Error: Wrote 0-byte temp save file %s. Aborting and deleting.", tmp_filename
+        );
+        playdate->file->unlink(tmp_filename, false);
+        return false;
+    }
+
+    // Rename files: .sav -> .bak, then .tmp -> .sav
+    playdate->system->logToConsole("Save successful, renaming files.");
+
+    playdate->file->unlink(bak_filename, false);
+    playdate->file->rename(save_filename, bak_filename);
+
+    if (playdate->file->rename(tmp_filename, save_filename) != 0)
+    {
+        playdate->system->logToConsole(
+            "CRITICAL: Failed to rename temp file to save file. Restoring "
+            "backup."
+        );
+        playdate->file->rename(bak_filename, save_filename);
+        return false;
+    }
+
+    return true;
+}
+
+static bool write_cart_ram_file(const char* save_filename, gb_s* gb)
 {
     // Get the size of the save RAM from the gb context.
     const size_t sram_len = gb_get_save_size(gb);
     CB_GameSceneContext* context = gb->direct.priv;
     CB_GameScene* gameScene = context->scene;
+    bool success = false;
 
     // If there is no battery, exit.
     if (!gameScene->cartridge_has_battery)
     {
-        return;
+        return false;
     }
 
-    // Generate .tmp and .bak filenames
+    char* tmp_filename;
+    char* bak_filename;
+    if (!cart_ram_tmp_filenames(save_filename, &tmp_filename, &bak_filename))
+    {
+        return false;
+    }
+
+    playdate->file->unlink(tmp_filename, false);
+
+    // Write data to the temporary file
+    playdate->system->logToConsole("Saving to temporary file: %s", tmp_filename);
+    SDFile* f = playdate->file->open(tmp_filename, kFileWrite);
+    if (f == NULL)
+    {
+        playdate->system->logToConsole(
+            "Error: Can't open temp save file for writing: %s", tmp_filename
+        );
+        goto cleanup;
+    }
+
+    if (sram_len > 0 && gb->gb_cart_ram != NULL)
+    {
+        playdate->file->write(f, gb->gb_cart_ram, (unsigned int)sram_len);
+    }
+
+    unsigned int now = next_save_time(gameScene);
+    gameScene->last_save_time = now;
+
+    uint8_t footer[SRAM_FOOTER_SIZE];
+    write_cart_ram_footer(gb, now, footer);
+    playdate->file->write(f, footer, sizeof(footer));
+
+    playdate->file->close(f);
+
+    success = commit_cart_ram_tmp_file(save_filename, tmp_filename, bak_filename);
+
+cleanup:
+    cb_free(tmp_filename);
+    cb_free(bak_filename);
+    return success;
+}
+
+// Idle saves append only the changed parts of cart RAM to a small journal
+// next to the .sav, rather than rewriting the whole file. The journal is
+// folded back into the .sav (compacted) on quit/lock, or once it grows large.
+//
+// Layout: SRAMJournalHeader, then a sequence of SRAMJournalRecords each
+// followed by `length` bytes. A record with length 0 is a commit, and is
+// followed by cart_rtc and the save timestamp. On load, only records up to
+// the last intact commit are applied, so a torn append is simply dropped.
+#define SRAM_JOURNAL_MAGIC 0x4A53424B  // "KBSJ"
+#define SRAM_JOURNAL_BLOCK_SIZE 64
+#define SRAM_JOURNAL_MAX_SIZE (32 * 1024)
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sram_len;
+
+    // timestamp of the .sav this journal applies on top of
+    uint32_t base_time;
+} SRAMJournalHeader;
+
+typedef struct
+{
+    uint32_t offset;
+    uint32_t length;
+    uint32_t crc;
+} SRAMJournalRecord;
+
+typedef struct
+{
+    uint8_t cart_rtc[5];
+    uint32_t timestamp;
+} SRAMJournalCommit;
+
+static char* sram_journal_filename(const char* save_filename)
+{
     size_t len = strlen(save_filename);
-    char* tmp_filename = cb_malloc(len + 2);
-    char* bak_filename = cb_malloc(len + 2);
+    char* journal_filename = cb_malloc(len + 5);
+    if (!journal_filename)
+        return NULL;
 
-    if (!tmp_filename || !bak_filename)
+    strcpy(journal_filename, save_filename);
+    char* ext = strrchr(journal_filename, '.');
+    if (ext && strcmp(ext, ".sav") == 0)
     {
-        playdate->system->logToConsole("Error: Failed to allocate memory for safe save filenames.");
+        strcpy(ext, ".jnl");
+    }
+    else
+    {
+        strcat(journal_filename, ".jnl");
+    }
+    return journal_filename;
+}
+
+// Applies the journal (if any) written on top of the .sav just loaded.
+// returns the number of commits applied.
+static int replay_cart_ram_journal(
+    const char* save_filename, gb_s* gb, unsigned int* last_save_time
+)
+{
+    CB_GameSceneContext* context = gb->direct.priv;
+    CB_GameScene* gameScene = context->scene;
+
+    char* journal_filename = sram_journal_filename(save_filename);
+    if (!journal_filename)
+        return 0;
+
+    int commits = 0;
+    uint8_t* journal = NULL;
+    SDFile* f = playdate->file->open(journal_filename, kFileReadData);
+    if (!f)
         goto cleanup;
+
+    playdate->file->seek(f, 0, SEEK_END);
+    int journal_size = playdate->file->tell(f);
+    playdate->file->seek(f, 0, SEEK_SET);
+
+    if (journal_size < (int)sizeof(SRAMJournalHeader))
+        goto stale;
+
+    journal = cb_malloc(journal_size);
+    if (!journal || playdate->file->read(f, journal, journal_size) != journal_size)
+    {
+        playdate->system->logToConsole("Failed to read save journal %s", journal_filename);
+        goto stale;
     }
 
-    strcpy(tmp_filename, save_filename);
-    strcpy(bak_filename, save_filename);
+    const SRAMJournalHeader* header = (const void*)journal;
+    if (header->magic != SRAM_JOURNAL_MAGIC || header->sram_len != gb->gb_cart_ram_size ||
+        header->base_time != *last_save_time)
+    {
+        playdate->system->logToConsole("Discarding stale save journal %s", journal_filename);
+        goto stale;
+    }
 
-    char* ext_tmp = strrchr(tmp_filename, '.');
-    if (ext_tmp && strcmp(ext_tmp, ".sav") == 0)
+    // first pass: find the end of the last intact commit
+    size_t committed_end = sizeof(SRAMJournalHeader);
+    for (size_t pos = sizeof(SRAMJournalHeader); pos + sizeof(SRAMJournalRecord) <= journal_size;)
+    {
+        SRAMJournalRecord record;
+        memcpy(&record, journal + pos, sizeof(record));
+        pos += sizeof(record);
+
+        size_t length = record.length ? record.length : sizeof(SRAMJournalCommit);
+        if (length > journal_size - pos ||
+            (record.length && (record.offset > header->sram_len ||
+                               record.length > header->sram_len - record.offset)) ||
+            crc32_for_buffer(journal + pos, length) != record.crc)
+        {
+            break;
+        }
+        pos += length;
+
+        if (record.length == 0)
+            committed_end = pos;
+    }
+
+    // second pass: apply
+    for (size_t pos = sizeof(SRAMJournalHeader); pos < committed_end;)
+    {
+        SRAMJournalRecord record;
+        memcpy(&record, journal + pos, sizeof(record));
+        pos += sizeof(record);
+
+        if (record.length)
+        {
+            memcpy(gb->gb_cart_ram + record.offset, journal + pos, record.length);
+            pos += record.length;
+        }
+        else
+        {
+            SRAMJournalCommit commit;
+            memcpy(&commit, journal + pos, sizeof(commit));
+            pos += sizeof(commit);
+
+            memcpy(gb->cart_rtc, commit.cart_rtc, sizeof(gb->cart_rtc));
+            *last_save_time = commit.timestamp;
+            ++commits;
+        }
+    }
+
+    gameScene->sram_journal_size = committed_end;
+    if (committed_end != journal_size)
+    {
+        // torn tail; appending after it would be unreadable, so compact instead.
+        playdate->system->logToConsole("Save journal %s has a torn tail", journal_filename);
+        gameScene->sram_journal_size = SRAM_JOURNAL_MAX_SIZE;
+    }
+
+    playdate->file->close(f);
+    goto cleanup;
+
+stale:
+    playdate->file->close(f);
+    playdate->file->unlink(journal_filename, false);
+
+cleanup:
+    if (journal)
+        cb_free(journal);
+    cb_free(journal_filename);
+    return commits;
+}
+
+// returns false if the journal can't be used, in which case the caller
+// should fall back to compacting (a full write_cart_ram_file).
+static bool append_cart_ram_journal(gb_s* gb)
+{
+    CB_GameSceneContext* context = gb->direct.priv;
+    CB_GameScene* gameScene = context->scene;
+
+    const size_t sram_len = gb->gb_cart_ram_size;
+    const uint8_t* sram = gb->gb_cart_ram;
+    uint8_t* shadow = gameScene->sram_shadow;
+
+    // a journal needs a timestamped .sav to apply on top of.
+    if (!shadow || !gameScene->save_filename || gameScene->sram_journal_base_time == 0 ||
+        gameScene->sram_journal_size >= SRAM_JOURNAL_MAX_SIZE)
+    {
+        return false;
+    }
+
+    char* journal_filename = sram_journal_filename(gameScene->save_filename);
+    if (!journal_filename)
+        return false;
+
+    bool success = false;
+    size_t journal_size = gameScene->sram_journal_size;
+    SDFile* f;
+    if (journal_size == 0)
+    {
+        f = playdate->file->open(journal_filename, kFileWrite);
+        if (f)
+        {
+            SRAMJournalHeader header = {
+                .magic = SRAM_JOURNAL_MAGIC,
+                .sram_len = sram_len,
+                .base_time = gameScene->sram_journal_base_time,
+            };
+            if (playdate->file->write(f, &header, sizeof(header)) != sizeof(header))
+                goto cleanup;
+            journal_size += sizeof(header);
+        }
+    }
+    else
+    {
+        f = playdate->file->open(journal_filename, kFileAppend);
+    }
+
+    if (!f)
+    {
+        playdate->system->logToConsole(
+            "Error: Can't open save journal %s: %s", journal_filename, playdate->file->geterr()
+        );
+        cb_free(journal_filename);
+        return false;
+    }
+
+    for (size_t start = 0; start < sram_len;)
+    {
+        size_t block = MIN(SRAM_JOURNAL_BLOCK_SIZE, sram_len - start);
+        if (!memcmp(sram + start, shadow + start, block))
+        {
+            start += block;
+            continue;
+        }
+
+        // extend over adjacent changed blocks
+        size_t end = start + block;
+        while (end < sram_len)
+        {
+            block = MIN(SRAM_JOURNAL_BLOCK_SIZE, sram_len - end);
+            if (!memcmp(sram + end, shadow + end, block))
+                break;
+            end += block;
+        }
+
+        SRAMJournalRecord record = {
+            .offset = start,
+            .length = end - start,
+            .crc = crc32_for_buffer(sram + start, end - start),
+        };
+        if (playdate->file->write(f, &record, sizeof(record)) != sizeof(record) ||
+            playdate->file->write(f, sram + start, record.length) != record.length)
+        {
+            goto cleanup;
+        }
+        journal_size += sizeof(record) + record.length;
+
+        memcpy(shadow + start, sram + start, record.length);
+        start = end;
+    }
+
+    SRAMJournalCommit commit;
+    memset(&commit, 0, sizeof(commit));
+    memcpy(commit.cart_rtc, gb->cart_rtc, sizeof(commit.cart_rtc));
+    commit.timestamp = next_save_time(gameScene);
+
+    SRAMJournalRecord record = {
+        .offset = 0,
+        .length = 0,
+        .crc = crc32_for_buffer((const void*)&commit, sizeof(commit)),
+    };
+    if (playdate->file->write(f, &record, sizeof(record)) != sizeof(record) ||
+        playdate->file->write(f, &commit, sizeof(commit)) != sizeof(commit))
+    {
+        goto cleanup;
+    }
+    journal_size += sizeof(record) + sizeof(commit);
+
+    gameScene->last_save_time = commit.timestamp;
+    success = true;
+
+cleanup:
+    playdate->file->close(f);
+    cb_free(journal_filename);
+
+    // on failure, the shadow may be ahead of the journal; force compaction.
+    gameScene->sram_journal_size = success ? journal_size : SRAM_JOURNAL_MAX_SIZE;
+    return success;
+}
+
+// called after the .sav has been fully rewritten with the given cart ram.
+static void discard_cart_ram_journal(CB_GameScene* gameScene, const uint8_t* persisted_sram)
+{
+    char* journal_filename = sram_journal_filename(gameScene->save_filename);
+    if (journal_filename)
     {
-        strcpy(ext_tmp, ".tmp");
+        playdate->file->unlink(journal_filename, false);
+        cb_free(journal_filename);
     }
-    else
+
+    gameScene->sram_journal_size = 0;
+    gameScene->sram_journal_base_time = gameScene->last_save_time;
+    if (gameScene->sram_shadow)
     {
-        strcat(tmp_filename, ".tmp");
+        memcpy(
+            gameScene->sram_shadow, persisted_sram, gameScene->context->gb->gb_cart_ram_size
+        );
     }
+}
 
-    char* ext_bak = strrchr(bak_filename, '.');
-    if (ext_bak && strcmp(ext_bak, ".sav") == 0)
+// Background .sav write, used for idle saves when the journal can't be.
+// Cart RAM is snapshotted into a staging buffer when the idle condition is
+// hit; the staging buffer is then written to the .tmp a slice per frame,
+// and only renamed over the .sav once complete.
+#define SRAM_FLUSH_SLICE_SIZE (4 * 1024)
+
+// slices are deferred while the frame time exceeds the target by this factor,
+// but never for more than SRAM_FLUSH_MAX_DEFERRED_FRAMES in a row.
+#define SRAM_FLUSH_BEHIND_FACTOR 1.1f
+#define SRAM_FLUSH_MAX_DEFERRED_FRAMES 30
+
+typedef struct CB_SRAMFlush
+{
+    // cart ram followed by the .sav footer
+    uint8_t* staging;
+    size_t size;
+    size_t written;
+    unsigned int save_time;
+    int frames_deferred;
+
+    SDFile* file;
+    char* tmp_filename;
+    char* bak_filename;
+} CB_SRAMFlush;
+
+static void sram_flush_free(CB_GameScene* gameScene)
+{
+    CB_SRAMFlush* flush = gameScene->sram_flush;
+    if (!flush)
+        return;
+
+    if (flush->file)
+        playdate->file->close(flush->file);
+    cb_free(flush->staging);
+    cb_free(flush->tmp_filename);
+    cb_free(flush->bak_filename);
+    cb_free(flush);
+    gameScene->sram_flush = NULL;
+}
+
+// returns true if a flush was started.
+static bool sram_flush_begin(gb_s* gb)
+{
+    CB_GameSceneContext* context = gb->direct.priv;
+    CB_GameScene* gameScene = context->scene;
+    const size_t sram_len = gb->gb_cart_ram_size;
+
+    if (gameScene->sram_flush || !gameScene->save_filename || !gameScene->cartridge_has_battery)
     {
-        strcpy(ext_bak, ".bak");
+        return false;
     }
-    else
+
+    CB_SRAMFlush* flush = allocz(CB_SRAMFlush);
+    if (!flush)
+        return false;
+    gameScene->sram_flush = flush;
+
+    flush->size = sram_len + SRAM_FOOTER_SIZE;
+    flush->staging = cb_malloc(flush->size);
+    if (!flush->staging || !cart_ram_tmp_filenames(
+                               gameScene->save_filename, &flush->tmp_filename, &flush->bak_filename
+                           ))
     {
-        strcat(bak_filename, ".bak");
+        sram_flush_free(gameScene);
+        return false;
     }
 
-    playdate->file->unlink(tmp_filename, false);
-
-    // Write data to the temporary file
-    playdate->system->logToConsole("Saving to temporary file: %s", tmp_filename);
-    SDFile* f = playdate->file->open(tmp_filename, kFileWrite);
-    if (f == NULL)
+    playdate->file->unlink(flush->tmp_filename, false);
+    flush->file = playdate->file->open(flush->tmp_filename, kFileWrite);
+    if (!flush->file)
     {
         playdate->system->logToConsole(
-            "Error: Can't open temp save file for writing: %s", tmp_filename
+            "Error: Can't open temp save file for writing: %s", flush->tmp_filename
         );
-        goto cleanup;
+        sram_flush_free(gameScene);
+        return false;
     }
 
-    if (sram_len > 0 && gb->gb_cart_ram != NULL)
-    {
-        playdate->file->write(f, gb->gb_cart_ram, (unsigned int)sram_len);
-    }
+    // snapshot; writes from here on mark sram dirty again.
+    flush->save_time = next_save_time(gameScene);
+    if (sram_len > 0)
+        memcpy(flush->staging, gb->gb_cart_ram, sram_len);
+    write_cart_ram_footer(gb, flush->save_time, flush->staging + sram_len);
+    gb->direct.sram_dirty = false;
 
-    // write rtc
-    playdate->file->write(f, gb->cart_rtc, sizeof(gb->cart_rtc));
+    return true;
+}
 
-    // write timestamp
-    unsigned int now = playdate->system->getSecondsSinceEpoch(NULL);
-    gameScene->last_save_time = now;
-    playdate->file->write(f, &now, sizeof(now));
+// writes up to max_bytes of the pending flush, and commits it once complete.
+// returns true once no flush is pending.
+static bool sram_flush_step(gb_s* gb, size_t max_bytes)
+{
+    CB_GameSceneContext* context = gb->direct.priv;
+    CB_GameScene* gameScene = context->scene;
+    CB_SRAMFlush* flush = gameScene->sram_flush;
 
-    // write flags
-    uint32_t flags = !!gameScene->script;
-    playdate->file->write(f, &flags, sizeof(flags));
+    if (!flush)
+        return true;
 
-    // write patch hash
-    playdate->file->write(f, &gameScene->patches_hash, sizeof(gameScene->patches_hash));
+    size_t len = MIN(max_bytes, flush->size - flush->written);
+    if (len > 0)
+    {
+        int written =
+            playdate->file->write(flush->file, flush->staging + flush->written, (unsigned)len);
+        if (written != (int)len)
+        {
+            playdate->system->logToConsole(
+                "Error writing temp save file %s: %s", flush->tmp_filename,
+                playdate->file->geterr()
+            );
+            playdate->file->close(flush->file);
+            flush->file = NULL;
+            playdate->file->unlink(flush->tmp_filename, false);
+
+            // try again later.
+            gb->direct.sram_dirty = true;
+            sram_flush_free(gameScene);
+            return true;
+        }
+        flush->written += len;
+    }
 
-    // write magic number (must be at end of file)
-    uint64_t magic = SRAM_MAGIC_NUMBER;
-    playdate->file->write(f, &magic, sizeof(magic));
+    if (flush->written < flush->size)
+        return false;
 
-    playdate->file->close(f);
+    playdate->file->close(flush->file);
+    flush->file = NULL;
 
-    // Verify that the temporary file is not zero-bytes
-    FileStat stat;
-    if (playdate->file->stat(tmp_filename, &stat) != 0)
+    if (commit_cart_ram_tmp_file(
+            gameScene->save_filename, flush->tmp_filename, flush->bak_filename
+        ))
     {
-        playdate->system->logToConsole(
-            "Error: Failed to stat temp save file %s. Aborting save.", tmp_filename
-        );
-        playdate->file->unlink(tmp_filename, false);
-        goto cleanup;
+        gameScene->last_save_time = flush->save_time;
+        discard_cart_ram_journal(gameScene, flush->staging);
     }
-
-    if (stat.size == 0)
+    else
     {
-        playdate->system->logToConsole(
-            "Error: Wrote 0-byte temp save file %s. Aborting and deleting.", tmp_filename
-        );
-        playdate->file->unlink(tmp_filename, false);
-        goto cleanup;
+        gb->direct.sram_dirty = true;
     }
 
-    // Rename files: .sav -> .bak, then .tmp -> .sav
-    playdate->system->logToConsole("Save successful, renaming files.");
+    sram_flush_free(gameScene);
+    return true;
+}
 
-    playdate->file->unlink(bak_filename, false);
-    playdate->file->rename(save_filename, bak_filename);
+// called once per frame; defers while emulation is behind.
+static void sram_flush_tick(gb_s* gb)
+{
+    CB_GameSceneContext* context = gb->direct.priv;
+    CB_SRAMFlush* flush = context->scene->sram_flush;
 
-    if (playdate->file->rename(tmp_filename, save_filename) != 0)
+    if (!flush)
+        return;
+
+    float target_dt = (1 + preferences_frame_skip) * CB_App->avg_dt_mult / 60.0f;
+    if (CB_App->avg_dt > target_dt * SRAM_FLUSH_BEHIND_FACTOR &&
+        flush->frames_deferred < SRAM_FLUSH_MAX_DEFERRED_FRAMES)
     {
-        playdate->system->logToConsole(
-            "CRITICAL: Failed to rename temp file to save file. Restoring "
-            "backup."
-        );
-        playdate->file->rename(bak_filename, save_filename);
+        flush->frames_deferred++;
+        return;
     }
 
-cleanup:
-    if (tmp_filename)
-        cb_free(tmp_filename);
-    if (bak_filename)
-        cb_free(bak_filename);
+    flush->frames_deferred = 0;
+    call_with_main_stack_2(sram_flush_step, gb, SRAM_FLUSH_SLICE_SIZE);
+}
+
+bool CB_GameScene_hasPendingSave(CB_GameScene* gameScene)
+{
+    return gameScene->sram_flush != NULL;
+}
+
+// completes any pending background save immediately.
+void CB_GameScene_drainPendingSave(CB_GameScene* gameScene)
+{
+    if (gameScene->sram_flush)
+    {
+        playdate->system->logToConsole("Draining pending save");
+        call_with_main_stack_2(sram_flush_step, gameScene->context->gb, SIZE_MAX);
+    }
 }
 
 static void gb_save_to_disk_(gb_s* gb)
@@ -1229,7 +1904,11 @@ static void gb_save_to_disk_(gb_s* gb)
         return;
     }
 
-    if (!context->gb->direct.sram_dirty)
+    // finish any background save first; it writes the same .tmp file.
+    CB_GameScene_drainPendingSave(gameScene);
+
+    // (a pending journal is compacted into the .sav even if nothing new changed)
+    if (!context->gb->direct.sram_dirty && gameScene->sram_journal_size == 0)
     {
         return;
     }
@@ -1238,7 +1917,10 @@ static void gb_save_to_disk_(gb_s* gb)
 
     if (gameScene->save_filename)
     {
-        write_cart_ram_file(gameScene->save_filename, context->gb);
+        if (write_cart_ram_file(gameScene->save_filename, context->gb))
+        {
+            discard_cart_ram_journal(gameScene, context->gb->gb_cart_ram);
+        }
     }
     else
     {
@@ -1257,6 +1939,34 @@ static void gb_save_to_disk(gb_s* gb)
     call_with_main_stack_1(gb_save_to_disk_, gb);
 }
 
+static bool gb_save_to_journal_(gb_s* gb)
+{
+    CB_GameSceneContext* context = gb->direct.priv;
+    CB_GameScene* gameScene = context->scene;
+
+    if (gameScene->isCurrentlySaving)
+    {
+        return false;
+    }
+
+    gameScene->isCurrentlySaving = true;
+    bool success = append_cart_ram_journal(gb);
+    if (success)
+    {
+        gb->direct.sram_dirty = false;
+    }
+    gameScene->isCurrentlySaving = false;
+
+    return success;
+}
+
+// returns false if the journal is unavailable (e.g. full), in which case
+// nothing is saved.
+static bool gb_save_to_journal(gb_s* gb)
+{
+    return (bool)call_with_main_stack_1(gb_save_to_journal_, gb);
+}
+
 /**
  * Handles an error reported by the emulator. The emulator context may be used
  * to better understand why the error given in gb_err was reported.
@@ -2304,6 +3014,11 @@ __section__(".text.tick") __space static void CB_GameScene_update(void* object,
                 save_check(context->gb);
             }
 
+            if (context->rom_prefetch_pending)
+            {
+                rom_prefetch_tick(context);
+            }
+
             // --- Conditional Screen Update (Drawing) Logic ---
             uint8_t* current_lcd = context->gb->lcd;
             uint8_t* previous_lcd = context->previous_lcd;
@@ -2838,11 +3553,33 @@ __section__(".text.tick") __space static void save_check(gb_s* gb)
         frames_since_sram_update++;
     }
 
-    if (gb->cart_battery && gb->direct.sram_dirty && !gb->direct.sram_updated)
+    CB_GameSceneContext* context = gb->direct.priv;
+    if (context->scene->sram_flush)
+    {
+        // a background save is in progress; don't journal on top of the old .sav.
+        sram_flush_tick(gb);
+    }
+    else if (
+        gb->cart_battery && gb->direct.sram_dirty && !gb->direct.sram_updated &&
+        frames_since_sram_update >= CB_IDLE_FRAMES_BEFORE_SAVE
+    )
     {
-        // With audio sync enabled, idle-saving can cause audio under-runs.
+        // Journaled saves only write what changed, so they are cheap enough
+        // to run even with audio sync enabled.
+        if (gb_save_to_journal(gb))
+        {
+            playdate->system->logToConsole("Saving to journal (idle detected)");
+        }
+
+        // Otherwise, write the whole .sav in the background, a slice per frame.
+        else if (call_with_main_stack_1(sram_flush_begin, gb))
+        {
+            playdate->system->logToConsole("Saving in background (idle detected)");
+        }
+
+        // With audio sync enabled, a blocking save can cause audio under-runs.
         // In this case, we rely on saving when the menu is opened or the system is locked.
-        if (preferences_audio_sync != 1 && frames_since_sram_update >= CB_IDLE_FRAMES_BEFORE_SAVE)
+        else if (preferences_audio_sync != 1)
         {
             playdate->system->logToConsole("Saving (idle detected)");
             gb_save_to_disk(gb);
@@ -3278,35 +4015,172 @@ static void CB_GameScene_generateBitmask(void)
     }
 }
 
-__section__(".rare") static unsigned get_save_state_timestamp_(
-    CB_GameScene* gameScene, unsigned slot
-)
+// Per-ROM index of the save state slots (timestamp, flags, size and
+// thumbnail), so that the slot browser costs a single read instead of
+// opening every slot's .state and .thumb. Rebuilt lazily from those if
+// missing, and rewritten (atomically) whenever a state is saved.
+#define STATE_SLOT_INDEX_MAGIC "CBSI"
+#define STATE_SLOT_INDEX_VERSION 1
+
+#define STATE_SLOT_CGB (1 << 0)
+#define STATE_SLOT_SCRIPT (1 << 1)
+#define STATE_SLOT_THUMBNAIL (1 << 2)
+
+typedef struct
 {
-    char* path;
-    playdate->system->formatString(
-        &path, "%s/%s.%u.state", cb_gb_directory_path(CB_statesPath), gameScene->base_filename, slot
+    // 0 if slot is empty (or state predates timestamps)
+    uint32_t timestamp;
+    uint32_t size;
+    uint32_t flags;
+    uint8_t thumbnail[SAVE_STATE_THUMBNAIL_BYTES];
+} CB_StateSlotInfo;
+
+typedef struct CB_StateSlotIndex
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t slot_count;
+    CB_StateSlotInfo slots[SAVE_STATE_SLOT_COUNT];
+} CB_StateSlotIndex;
+
+static char* state_slot_index_filename(CB_GameScene* gameScene)
+{
+    return aprintf(
+        "%s/%s.slots", cb_gb_directory_path(CB_statesPath), gameScene->base_filename
     );
+}
 
-    SDFile* file = playdate->file->open(path, kFileReadData);
+// (tmp + rename, so a crash never leaves a torn index behind)
+__section__(".rare") static void write_state_slot_index(
+    CB_GameScene* gameScene, const CB_StateSlotIndex* index
+)
+{
+    char* path = state_slot_index_filename(gameScene);
+    char* tmp_path = aprintf("%s.tmp", path);
+
+    if (path && tmp_path && cb_write_entire_file(tmp_path, index, sizeof(*index)))
+    {
+        playdate->file->unlink(path, false);
+        if (playdate->file->rename(tmp_path, path) != 0)
+        {
+            playdate->system->logToConsole("Failed to rename state slot index %s", tmp_path);
+            playdate->file->unlink(tmp_path, false);
+        }
+    }
+
+    cb_free(path);
+    cb_free(tmp_path);
+}
 
+__section__(".rare") static void read_state_slot_info_from_files(
+    CB_GameScene* gameScene, unsigned slot, CB_StateSlotInfo* info
+)
+{
+    memset(info, 0, sizeof(*info));
+
+    char* path = aprintf(
+        "%s/%s.%u.state", cb_gb_directory_path(CB_statesPath), gameScene->base_filename, slot
+    );
+    SDFile* file = playdate->file->open(path, kFileReadData);
     cb_free(path);
 
     if (!file)
     {
-        return 0;
+        return;
     }
 
     struct StateHeader header;
     int read = playdate->file->read(file, &header, sizeof(header));
+    playdate->file->seek(file, 0, SEEK_END);
+    int size = playdate->file->tell(file);
     playdate->file->close(file);
-    if (read < sizeof(header))
+
+    if (read < (int)sizeof(header))
     {
-        return 0;
+        return;
     }
-    else
+
+    info->timestamp = header.timestamp;
+    info->size = size > 0 ? size : 0;
+    info->flags = (header.cgb ? STATE_SLOT_CGB : 0) | (header.script ? STATE_SLOT_SCRIPT : 0);
+
+    path = aprintf(
+        "%s/%s.%u.thumb", cb_gb_directory_path(CB_statesPath), gameScene->base_filename, slot
+    );
+    file = playdate->file->open(path, kFileReadData);
+    cb_free(path);
+
+    if (file)
+    {
+        if (playdate->file->read(file, info->thumbnail, SAVE_STATE_THUMBNAIL_BYTES) ==
+            SAVE_STATE_THUMBNAIL_BYTES)
+        {
+            info->flags |= STATE_SLOT_THUMBNAIL;
+        }
+        playdate->file->close(file);
+    }
+}
+
+// returns the cached index, loading (or rebuilding) it if needed.
+__section__(".rare") static CB_StateSlotIndex* get_state_slot_index_(CB_GameScene* gameScene)
+{
+    if (gameScene->state_slot_index)
+    {
+        return gameScene->state_slot_index;
+    }
+
+    CB_StateSlotIndex* index = cb_malloc(sizeof(CB_StateSlotIndex));
+    if (!index)
+    {
+        return NULL;
+    }
+
+    char* path = state_slot_index_filename(gameScene);
+    SDFile* file = playdate->file->open(path, kFileReadData);
+    cb_free(path);
+
+    bool valid = false;
+    if (file)
+    {
+        valid = playdate->file->read(file, index, sizeof(*index)) == sizeof(*index) &&
+                !memcmp(index->magic, STATE_SLOT_INDEX_MAGIC, sizeof(index->magic)) &&
+                index->version == STATE_SLOT_INDEX_VERSION &&
+                index->slot_count == SAVE_STATE_SLOT_COUNT;
+        playdate->file->close(file);
+    }
+
+    if (!valid)
+    {
+        playdate->system->logToConsole("Rebuilding state slot index");
+
+        memset(index, 0, sizeof(*index));
+        memcpy(index->magic, STATE_SLOT_INDEX_MAGIC, sizeof(index->magic));
+        index->version = STATE_SLOT_INDEX_VERSION;
+        index->slot_count = SAVE_STATE_SLOT_COUNT;
+
+        for (unsigned slot = 0; slot < SAVE_STATE_SLOT_COUNT; ++slot)
+        {
+            read_state_slot_info_from_files(gameScene, slot, &index->slots[slot]);
+        }
+
+        write_state_slot_index(gameScene, index);
+    }
+
+    gameScene->state_slot_index = index;
+    return index;
+}
+
+__section__(".rare") static unsigned get_save_state_timestamp_(
+    CB_GameScene* gameScene, unsigned slot
+)
+{
+    CB_StateSlotIndex* index = get_state_slot_index_(gameScene);
+    if (!index || slot >= SAVE_STATE_SLOT_COUNT)
     {
-        return header.timestamp;
+        return 0;
     }
+
+    return index->slots[slot].timestamp;
 }
 
 __section__(".rare") unsigned get_save_state_timestamp(CB_GameScene* gameScene, unsigned slot)
@@ -3442,6 +4316,15 @@ __section__(".rare") static bool save_state_(CB_GameScene* gameScene, unsigned s
         }
     }
 
+    CB_StateSlotIndex* index = success ? get_state_slot_index_(gameScene) : NULL;
+    CB_StateSlotInfo* info = index ? &index->slots[slot] : NULL;
+    if (info)
+    {
+        info->timestamp = header->timestamp;
+        info->size = save_size;
+        info->flags = (header->cgb ? STATE_SLOT_CGB : 0) | (header->script ? STATE_SLOT_SCRIPT : 0);
+    }
+
     // we check playtime nonzero so that LCD has been updated at least once
     uint8_t* lcd = context->gb->lcd;
     if (success && lcd && gameScene->playtime > 1)
@@ -3449,6 +4332,7 @@ __section__(".rare") static bool save_state_(CB_GameScene* gameScene, unsigned s
         // save thumbnail, too
         // (inessential, so we don't take safety precautions)
         SDFile* file = playdate->file->open(thumb_name, kFileWrite);
+        uint8_t* thumb = info ? info->thumbnail : NULL;
 
         static const uint8_t dither_pattern[5] = {
             0b00000000 ^ 0xFF, 0b01000100 ^ 0xFF, 0b10101010 ^ 0xFF,
@@ -3502,10 +4386,29 @@ __section__(".rare") static bool save_state_(CB_GameScene* gameScene, unsigned s
                 }
 
                 playdate->file->write(file, thumbline, sizeof(thumbline));
+                if (thumb)
+                {
+                    memcpy(thumb + y * sizeof(thumbline), thumbline, sizeof(thumbline));
+                }
+            }
+
+            playdate->file->close(file);
+
+            if (info)
+            {
+                info->flags |= STATE_SLOT_THUMBNAIL;
             }
         }
+    }
+    else if (success)
+    {
+        // a stale thumbnail would no longer match this state
+        playdate->file->unlink(thumb_name, false);
+    }
 
-        playdate->file->close(file);
+    if (index)
+    {
+        write_state_slot_index(gameScene, index);
     }
 
 cleanup:
@@ -3537,25 +4440,15 @@ __section__(".rare") bool load_state_thumbnail_(
     CB_GameScene* gameScene, unsigned slot, uint8_t* out
 )
 {
-    char* path;
-    playdate->system->formatString(
-        &path, "%s/%s.%u.thumb", cb_gb_directory_path(CB_statesPath), gameScene->base_filename, slot
-    );
-
-    SDFile* file = playdate->file->open(path, kFileReadData);
-
-    cb_free(path);
-
-    if (!file)
+    CB_StateSlotIndex* index = get_state_slot_index_(gameScene);
+    if (!index || slot >= SAVE_STATE_SLOT_COUNT ||
+        !(index->slots[slot].flags & STATE_SLOT_THUMBNAIL))
     {
-        return 0;
+        return false;
     }
 
-    int count = SAVE_STATE_THUMBNAIL_H * ((SAVE_STATE_THUMBNAIL_W + 7) / 8);
-    int read = playdate->file->read(file, out, count);
-    playdate->file->close(file);
-
-    return read == count;
+    memcpy(out, index->slots[slot].thumbnail, SAVE_STATE_THUMBNAIL_BYTES);
+    return true;
 }
 
 // returns true if successful
@@ -3778,7 +4671,9 @@ __section__(".rare") static void CB_GameScene_event(void* object, PDSystemEvent
         // fall-through
     case kEventTerminate:
         DTCM_VERIFY();
-        if (context->gb->direct.sram_dirty && gameScene->save_data_loaded_successfully)
+        if ((context->gb->direct.sram_dirty || gameScene->sram_journal_size ||
+             CB_GameScene_hasPendingSave(gameScene)) &&
+            gameScene->save_data_loaded_successfully)
         {
             playdate->system->logToConsole("saving (system event)");
             gb_save_to_disk(context->gb);
@@ -3937,11 +4832,31 @@ static void CB_GameScene_free(void* object)
         cb_free(context->rom);
     }
 
+    if (context->rom_pager)
+    {
+        gb_rom_bank_mapper = NULL;
+        gb_rom_bank_mapper_ud = NULL;
+        cb_rom_pager_close(context->rom_pager);
+    }
+
     if (context->cart_ram)
     {
         cb_free(context->cart_ram);
     }
 
+    // (gb_save_to_disk above has drained any background save)
+    sram_flush_free(gameScene);
+
+    if (gameScene->sram_shadow)
+    {
+        cb_free(gameScene->sram_shadow);
+    }
+
+    if (gameScene->state_slot_index)
+    {
+        cb_free(gameScene->state_slot_index);
+    }
+
     if (gameScene->script)
     {
         script_end(gameScene->script, gameScene);
@@ -3951,6 +4866,11 @@ static void CB_GameScene_free(void* object)
     cb_free(gameScene->audio_temp_left);
     cb_free(gameScene->audio_temp_right);
 
+    if (context->arena_alloc)
+    {
+        cb_free(context->arena_alloc);
+    }
+
     cb_free(context);
     cb_free(gameScene);
 
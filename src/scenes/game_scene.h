@@ -70,11 +70,14 @@ typedef struct CB_GameSceneContext
     CB_GameScene* scene;
 #ifdef PEANUT_GB_H
     gb_s* gb;
+    gb_arena* arena;  // wram, vram, xram, lcd, breakpoints (cache-line aligned)
 #else
     void* gb;
+    void* arena;
 #endif
-    uint8_t wram[WRAM_SIZE_CGB];
-    uint8_t vram[VRAM_SIZE_CGB];
+    void* arena_alloc;  // unaligned allocation backing arena
+    struct CB_RomPager* rom_pager;  // if set, rom is paged in (and `rom` is NULL)
+    bool rom_prefetch_pending;
     uint8_t* rom;
     size_t rom_size;
     bool cgb_mode;
@@ -163,6 +166,17 @@ typedef struct CB_GameScene
     uint8_t previous_joypad_state;
     uint32_t patches_hash;
 
+    // cart RAM as last persisted (.sav + journal), for journaled idle saves
+    uint8_t* sram_shadow;
+    size_t sram_journal_size;
+    unsigned int sram_journal_base_time;
+
+    // background (time-sliced) save in progress, if any
+    struct CB_SRAMFlush* sram_flush;
+
+    // save state slot index (timestamps + thumbnails), loaded on first use
+    struct CB_StateSlotIndex* state_slot_index;
+
     // Cached interlacing threshold to avoid recalculation every frame
     int cached_line_threshold;
     uint8_t cached_dynamic_level;
@@ -178,6 +192,11 @@ void reconfigure_audio_source(CB_GameScene* gameScene, int headphones);
 unsigned get_save_state_timestamp(CB_GameScene* gameScene, unsigned slot);
 bool load_state_thumbnail(CB_GameScene* gameScene, unsigned slot, uint8_t* out);
 
+// a background save may be pending after an idle save;
+// drain it before anything that must see the .sav up to date.
+bool CB_GameScene_hasPendingSave(CB_GameScene* gameScene);
+void CB_GameScene_drainPendingSave(CB_GameScene* gameScene);
+
 struct CB_Game;
 void show_game_script_info(const char* rompath, const char* name_short);
 
@@ -2,6 +2,7 @@
 
 #include "../app.h"
 #include "../http.h"
+#include "../http_sched.h"
 #include "../jparse.h"
 #include "../userstack.h"
 #include "../utility.h"
@@ -23,6 +24,10 @@
 #define HEADER_ANIMATION_RATE 2.8f
 #define HEADER_HEIGHT 18
 
+// search results either side of the selection whose screenshots are fetched
+// ahead of the rest of the page
+#define HB_PREFETCH_ROWS 2
+
 typedef struct
 {
     CB_HomebrewHubScene* hbs;
@@ -39,6 +44,24 @@ static const char* hb_platforms[] = {
     "GBC",
 };
 
+// the parts of a search response we use; descriptions, tags etc. are skipped
+static const char* hb_search_keep[] = {
+    "page_total",
+    "page_current",
+    "entries/*/title",
+    "entries/*/developer",
+    "entries/*/platform",
+    "entries/*/date",
+    "entries/*/firstadded_date",
+    "entries/*/slug",
+    "entries/*/basepath",
+    "entries/*/screenshots",
+    "entries/*/files/*/filename",
+    "entries/*/files/*/playable",
+    "entries/*/files/*/default",
+    NULL,
+};
+
 static bool push_list_search(CB_HomebrewHubScene* hbs, const char* platform);
 static bool push_list_files(CB_HomebrewHubScene* hbs, const json_value* entry);
 
@@ -50,7 +73,80 @@ static void user_quit(void* ud, int selected)
     }
 }
 
-// callback when rom is downloaded
+#define HB_HEADER_END 0x150
+#define HB_COPY_CHUNK 4096
+
+// Clears the 'requires CGB' flag in a downloaded ROM's header, which many
+// homebrew erroneously set, fixing up the checksums. The ROM is already on
+// disk, so it is rewritten through a temporary file a chunk at a time.
+// Returns true if the header was changed.
+static bool doctor_header_cgb_flag(const char* path)
+{
+    uint8_t header[HB_HEADER_END];
+
+    SDFile* in = playdate->file->open(path, kFileReadData);
+    if (!in)
+        return false;
+
+    if (playdate->file->read(in, header, sizeof(header)) != sizeof(header) ||
+        header[0x0143] != 0xC0)
+    {
+        playdate->file->close(in);
+        return false;
+    }
+
+    header[0x0143] = 0x80;
+
+    uint8_t checksum = header[0x14D];
+    uint8_t nc = 0;
+    // update header checksum
+    for (unsigned i = 0x134; i <= 0x14C; ++i)
+    {
+        nc = nc - header[i] - 1;
+    }
+
+    header[0x14D] = nc;
+    playdate->system->logToConsole("Header checksum: %02X -> %02X", checksum, nc);
+
+    uint16_t gcheck = ((uint16_t)header[0x14E] << 8) | ((uint16_t)header[0x14F] << 0);
+    gcheck -= checksum;
+    gcheck += nc;
+    header[0x14E] = (gcheck >> 8);
+    header[0x14F] = gcheck & 0xFF;
+
+    char* tmp_path = aprintf("%s.tmp", path);
+    char* buf = cb_malloc(HB_COPY_CHUNK);
+    SDFile* out = (tmp_path && buf) ? playdate->file->open(tmp_path, kFileWrite) : NULL;
+
+    bool ok = out && playdate->file->write(out, header, sizeof(header)) == sizeof(header);
+    while (ok)
+    {
+        int n = playdate->file->read(in, buf, HB_COPY_CHUNK);
+        if (n <= 0)
+        {
+            ok = n == 0;
+            break;
+        }
+        ok = playdate->file->write(out, buf, n) == n;
+    }
+
+    playdate->file->close(in);
+    if (out)
+        playdate->file->close(out);
+
+    ok = ok && playdate->file->rename(tmp_path, path) == 0;
+    if (!ok && tmp_path)
+        playdate->file->unlink(tmp_path, 0);
+
+    cb_free(buf);
+    cb_free(tmp_path);
+
+    if (ok)
+        playdate->system->logToConsole("Doctored header.");
+    return ok;
+}
+
+// callback when rom is downloaded (to target_rom_path)
 static void rom_get_cb(unsigned flags, char* data, size_t data_len, CB_HomebrewHubScene* hbs)
 {
     hbs->active_download_type = HB_DL_NONE;
@@ -68,95 +164,69 @@ static void rom_get_cb(unsigned flags, char* data, size_t data_len, CB_HomebrewH
         {
             msg = cb_strdup("Network permission was denied.");
         }
+        else if (flags & HTTP_FILE_ERROR)
+        {
+            msg = cb_strdup("Filesystem error, failed to save ROM.");
+        }
         else
         {
             msg = aprintf("A network error occurred. (0x%03x)", flags);
         }
         CB_presentModal(CB_Modal_new(msg, NULL, NULL, NULL)->scene);
         cb_free(msg);
+        return;
     }
-    else if (!data || !data_len)
+    else if (!data_len)
     {
         CB_presentModal(CB_Modal_new("ROM empty", NULL, NULL, NULL)->scene);
         return;
     }
 
-    // doctor header to remove 'requires CGB' flag,
-    // which many homebrew erroneously set.
+    playdate->system->logToConsole(
+        "Saved ROM %s (%u bytes, CRC32 %08x)", hbs->target_rom_path,
+        (unsigned)hbs->rom_sink.size, (unsigned)hbs->rom_sink.crc32
+    );
+
     bool did_doctor = false;
-    if (hbs->doctor_header_cgb_flag && data_len >= 0x200 && (uint8_t)data[0x0143] == 0xC0)
+    if (hbs->doctor_header_cgb_flag && data_len >= 0x200)
     {
-        data[0x0143] = 0x80;
-        did_doctor = true;
-        playdate->system->logToConsole("Doctored header.");
-
-        uint8_t checksum = data[0x14D];
-        uint8_t nc = 0;
-        // update header checksum
-        for (unsigned i = 0x134; i <= 0x14C; ++i)
-        {
-            nc = nc - (uint8_t)data[i] - 1;
-        }
-
-        data[0x14D] = nc;
-        playdate->system->logToConsole("Header checksum: %02X -> %02X", checksum, nc);
-
-        uint16_t gcheck =
-            ((uint16_t)(uint8_t)data[0x14E] << 8) | ((uint16_t)(uint8_t)data[0x14F] << 0);
-        gcheck -= checksum;
-        gcheck += nc;
-        data[0x14E] = (gcheck >> 8);
-        data[0x14F] = gcheck & 0xFF;
+        did_doctor = doctor_header_cgb_flag(hbs->target_rom_path);
     }
 
-    // save rom
-    if (!cb_write_entire_file(hbs->target_rom_path, data, data_len))
-    {
-        CB_presentModal(
-            CB_Modal_new("Filesystem error, failed to save ROM.", NULL, NULL, NULL)->scene
-        );
-    }
-    else
+    // try saving the cover art as well.
+    // NOTE: race condition -- if rom downloads first, cover art will not be saved.
+    if (hbs->target_cover_art_path && hbs->cover_art_data && hbs->cover_art_len)
     {
-        // try saving the cover art as well.
-        // NOTE: race condition -- if rom downloads first, cover art will not be saved.
-        if (hbs->target_cover_art_path && hbs->cover_art_data && hbs->cover_art_len)
+        if (!cb_write_entire_file(
+                hbs->target_cover_art_path, hbs->cover_art_data, hbs->cover_art_len
+            ))
         {
-            if (!cb_write_entire_file(
-                    hbs->target_cover_art_path, hbs->cover_art_data, hbs->cover_art_len
-                ))
-            {
-                playdate->system->logToConsole("Failed to save cover art.");
-            }
-            else
-            {
-                playdate->system->logToConsole(
-                    "Saved cover art to: %s", hbs->target_cover_art_path
-                );
-            }
+            playdate->system->logToConsole("Failed to save cover art.");
+        }
+        else
+        {
+            playdate->system->logToConsole("Saved cover art to: %s", hbs->target_cover_art_path);
         }
+    }
 
-        // save as 'last selected' for library view
-        cb_write_entire_file(
-            LAST_SELECTED_FILE, hbs->target_rom_path, strlen(hbs->target_rom_path)
-        );
+    // save as 'last selected' for library view
+    cb_write_entire_file(LAST_SELECTED_FILE, hbs->target_rom_path, strlen(hbs->target_rom_path));
 
-        const char* options[] = {"Restart", "Do Not", NULL};
+    const char* options[] = {"Restart", "Do Not", NULL};
 
-        char* s = aprintf(
-            "ROM downloaded successfully; you must restart CrankBoy for it to appear.%s",
-            did_doctor ? "\n\nThe ROM header was altered to indicate that it is DMG-compatible."
-                       : ""
-        );
+    char* s = aprintf(
+        "ROM downloaded successfully; you must restart CrankBoy for it to appear.%s",
+        did_doctor ? "\n\nThe ROM header was altered to indicate that it is DMG-compatible."
+                   : ""
+    );
 
-        CB_Modal* modal = CB_Modal_new(s, options, user_quit, NULL);
-        modal->width = 330;
-        modal->height = did_doctor ? 210 : 110;
-        modal->height += 34;
-        CB_presentModal(modal->scene);
+    CB_Modal* modal = CB_Modal_new(s, options, user_quit, NULL);
+    modal->width = 330;
+    modal->height = did_doctor ? 210 : 110;
+    modal->height += 34;
+    CB_presentModal(modal->scene);
 
-        cb_free(s);
-    }
+    cb_free(s);
 }
 
 static char* context_list_files_hint(CB_HomebrewHubScene* hbs, HomebrewHubContext* context)
@@ -352,10 +422,14 @@ static void confirm_download(CB_HomebrewHubScene* hbs, int option)
     // download file
     if (option == 1)
     {
+        // no screenshots are fetched during the download (see context_list_files_update)
+        http_sched_cancel_group(hbs);
+
         hbs->active_download_type = HB_DL_ROM;
-        http_safe_replace_get(
+        hbs->rom_sink.path = hbs->target_rom_path;
+        http_safe_replace_get_to_file(
             hbs->active_http_connection, CB_App->hbApiDomain, hbs->urlpath,
-            "to download the selected ROM", (void*)rom_get_cb, 59 * 1001, hbs
+            "to download the selected ROM", &hbs->rom_sink, (void*)rom_get_cb, 59 * 1001, hbs
         );
     }
     cb_free(hbs->urlpath);
@@ -371,7 +445,7 @@ static void context_list_files_update(
 
     if (a_pressed)
     {
-        if (http_safe_in_progress(hbs->active_http_connection_2))
+        if (http_sched_in_flight(hbs))
         {
             // this seems to prevent a crash that occurs when two downloads are happening
             // simultaneously
@@ -456,7 +530,7 @@ static void context_top_level_update(
         if (context->list->selectedItem == 2)
         {
             http_safe_cancel(hbs->active_http_connection);
-            http_safe_cancel(hbs->active_http_connection_2);
+            http_sched_cancel_group(hbs);
             CB_ParentalLockScene* plScene = CB_ParentalLockScene_new();
             CB_presentModal(plScene->scene);
         }
@@ -501,41 +575,179 @@ const char* get_best_screenshot(JsonArray* screenshots)
     return json_as_string(screenshots->data[bestidx]);
 }
 
-static void cover_art_cb(unsigned flags, char* data, size_t data_len, CB_HomebrewHubScene* hbs)
+static void screenshot_cb(
+    unsigned flags, char* data, size_t data_len, HomebrewHubScreenshot* screenshot
+)
 {
-    if (flags & (~HTTP_ENABLE_ASKED))
+    screenshot->request = 0;
+
+    if (flags & HTTP_CANCELLED)
+        return;
+
+    if ((flags & ~HTTP_ENABLE_ASKED) || !data || data_len == 0)
     {
+        screenshot->failed = true;
         return;
     }
-    else
+
+    screenshot->data = cb_malloc(data_len);
+    if (!screenshot->data)
     {
-        size_t pdi_size;
-        void* pdi_data = png_to_pdi(
-            hbs->download_image_name, data, data_len, &pdi_size, LCD_COLUMNS - kDividerX, 160
+        screenshot->failed = true;
+        return;
+    }
+    memcpy(screenshot->data, data, data_len);
+    screenshot->size = data_len;
+}
+
+static void clear_screenshots(CB_HomebrewHubScene* hbs)
+{
+    http_sched_cancel_group(hbs);
+
+    for (int i = 0; i < hbs->screenshot_count; ++i)
+    {
+        cb_free(hbs->screenshots[i].data);
+    }
+    cb_free(hbs->screenshots);
+    hbs->screenshots = NULL;
+    hbs->screenshot_count = 0;
+    hbs->download_image_index = -1;
+}
+
+// one slot per entry of the search results just received
+static void reset_screenshots(CB_HomebrewHubScene* hbs)
+{
+    clear_screenshots(hbs);
+
+    json_value jentries = json_get_table_value(hbs->jsearch, "entries");
+    if (jentries.type != kJSONArray)
+        return;
+
+    JsonArray* array = jentries.data.arrayval;
+    if (array->n == 0)
+        return;
+
+    hbs->screenshots = cb_calloc(array->n, sizeof(HomebrewHubScreenshot));
+    if (!hbs->screenshots)
+        return;
+    hbs->screenshot_count = array->n;
+
+    for (int i = 0; i < array->n; ++i)
+    {
+        HomebrewHubScreenshot* screenshot = &hbs->screenshots[i];
+        screenshot->hbs = hbs;
+
+        json_value jscreenshots = json_get_table_value(array->data[i], "screenshots");
+        const char* slug = json_as_string(json_get_table_value(array->data[i], "slug"));
+        if (jscreenshots.type == kJSONArray && slug)
+        {
+            screenshot->name = get_best_screenshot(jscreenshots.data.arrayval);
+        }
+        screenshot->failed = (screenshot->name == NULL);
+    }
+}
+
+// Queues the page's screenshots, or updates their priority: the selected
+// entry's first, then its neighbours', then the rest in the background, so
+// that moving through the list rarely has to wait.
+static void prioritize_screenshots(CB_HomebrewHubScene* hbs, int selected)
+{
+    json_value jentries = json_get_table_value(hbs->jsearch, "entries");
+    if (jentries.type != kJSONArray)
+        return;
+    JsonArray* array = jentries.data.arrayval;
+
+    for (int i = 0; i < hbs->screenshot_count && i < array->n; ++i)
+    {
+        HomebrewHubScreenshot* screenshot = &hbs->screenshots[i];
+        if (screenshot->data || screenshot->failed)
+            continue;
+
+        int distance = abs(i - selected);
+        HTTPPriority priority = HTTP_PRIORITY_BACKGROUND;
+        if (distance == 0)
+            priority = HTTP_PRIORITY_VISIBLE;
+        else if (distance <= HB_PREFETCH_ROWS)
+            priority = HTTP_PRIORITY_NEXT;
+
+        if (screenshot->request)
+        {
+            http_sched_set_priority(screenshot->request, priority);
+            continue;
+        }
+
+        json_value je = array->data[i];
+        const char* slug = json_as_string(json_get_table_value(je, "slug"));
+        const char* base = json_as_string(json_get_table_value(je, "basepath"));
+        char* urlpath =
+            aprintf("%s/%s/entries/%s/%s", CB_App->hbStaticPath, base, slug, screenshot->name);
+
+        screenshot->request = http_sched_get_cached(
+            CB_App->hbApiDomain, urlpath, "to retrieve cover art", priority, 12 * 1000, hbs,
+            (void*)screenshot_cb, screenshot
         );
-        cb_free(hbs->cover_art_data);
-        hbs->cover_art_data = png_to_pdi(
-            hbs->download_image_name, data, data_len, &hbs->cover_art_len, 240, 240
-        ); /* 240 x 240 is the preferred cover art dimensions */
-        if (pdi_data && pdi_size)
+
+        cb_free(urlpath);
+    }
+}
+
+// Converts the selected entry's screenshot for display, and as cover art to
+// save alongside the ROM if it is downloaded. Run on the main stack.
+static void show_screenshot(CB_HomebrewHubScene* hbs, int selected)
+{
+    if (selected < 0 || selected >= hbs->screenshot_count)
+        return;
+
+    HomebrewHubScreenshot* screenshot = &hbs->screenshots[selected];
+    if (!screenshot->data || screenshot->failed)
+        return;
+
+    size_t pdi_size;
+    void* pdi_data = png_to_pdi(
+        screenshot->name, screenshot->data, screenshot->size, &pdi_size, LCD_COLUMNS - kDividerX,
+        160
+    );
+    cb_free(hbs->cover_art_data);
+    hbs->cover_art_data = png_to_pdi(
+        screenshot->name, screenshot->data, screenshot->size, &hbs->cover_art_len, 240, 240
+    ); /* 240 x 240 is the preferred cover art dimensions */
+    if (pdi_data && pdi_size)
+    {
+        if (pdi_size < (1 << 16))
         {
-            if (pdi_size < (1 << 16))
-            {
-                cb_write_entire_file(DISK_IMAGE, pdi_data, pdi_size);
-                playdate->system->logToConsole("successfully retrieved image");
-            }
-            else
+            if (cb_write_entire_file(DISK_IMAGE, pdi_data, pdi_size))
             {
-                playdate->system->logToConsole(
-                    "Not saving " DISK_IMAGE " because file size is too big (%u bytes)",
-                    (unsigned)pdi_size
-                );
+                hbs->download_image = playdate->graphics->loadBitmap(DISK_IMAGE, NULL);
+                playdate->file->unlink(DISK_IMAGE, false);
             }
         }
-
-        if (pdi_data)
-            cb_free(pdi_data);
+        else
+        {
+            playdate->system->logToConsole(
+                "Not showing %s because file size is too big (%u bytes)", screenshot->name,
+                (unsigned)pdi_size
+            );
+        }
     }
+
+    if (pdi_data)
+        cb_free(pdi_data);
+
+    // don't try again every frame
+    if (!hbs->download_image)
+        screenshot->failed = true;
+}
+
+static bool selected_screenshot_ready(CB_HomebrewHubScene* hbs, int selected)
+{
+    return selected >= 0 && selected < hbs->screenshot_count &&
+           hbs->screenshots[selected].data && !hbs->screenshots[selected].failed;
+}
+
+static bool selected_screenshot_pending(CB_HomebrewHubScene* hbs, int selected)
+{
+    return selected >= 0 && selected < hbs->screenshot_count &&
+           hbs->screenshots[selected].request != 0;
 }
 
 static void clear_page(CB_HomebrewHubScene* hbs, HomebrewHubContext* context);
@@ -579,8 +791,7 @@ static void context_list_search_update(
         context->show_image = true;
         int selected = context->list->selectedItem - 1;
         unsigned dlii = (context->i << 16) | selected;
-        if ((dlii != hbs->download_image_index ||
-             (!http_safe_in_progress(hbs->active_http_connection_2) && !hbs->download_image)))
+        if (dlii != hbs->download_image_index)
         {
             hbs->download_image_index = dlii;
             if (hbs->download_image)
@@ -589,54 +800,17 @@ static void context_list_search_update(
                 hbs->download_image = NULL;
             }
 
-            hbs->download_image =
-                call_with_main_stack_2(playdate->graphics->loadBitmap, DISK_IMAGE, NULL);
-            if (hbs->download_image)
-            {
-                playdate->file->unlink(DISK_IMAGE, false);
-            }
-            else
-            {
-                json_value jentries = json_get_table_value(hbs->jsearch, "entries");
-                if (jentries.type == kJSONArray)
-                {
-                    JsonArray* array = jentries.data.arrayval;
+            // TODO: associate cover art with slug, to be extra sure it matches
+            // when ROM download completes later.
+            cb_free(hbs->cover_art_data);
+            hbs->cover_art_data = NULL;
 
-                    if (selected < array->n)
-                    {
-                        json_value je = array->data[selected];
-                        json_value jscreenshots = json_get_table_value(je, "screenshots");
-                        const char* slug = json_as_string(json_get_table_value(je, "slug"));
-                        const char* base = json_as_string(json_get_table_value(je, "basepath"));
-                        if (jscreenshots.type == kJSONArray && slug)
-                        {
-                            JsonArray* screenshots = jscreenshots.data.arrayval;
-                            const char* screenshot = get_best_screenshot(screenshots);
-                            if (screenshot)
-                            {
-                                char* urlpath = aprintf(
-                                    "%s/%s/entries/%s/%s", CB_App->hbStaticPath, base, slug,
-                                    screenshot
-                                );
-                                hbs->download_image_name = screenshot;
-
-                                // TODO: associate cover art with slug, to be extra sure it matches
-                                // when ROM download completes later.
-                                cb_free(hbs->cover_art_data);
-                                hbs->cover_art_data = NULL;
-
-                                // get image
-                                http_safe_replace_get(
-                                    hbs->active_http_connection_2, CB_App->hbApiDomain, urlpath,
-                                    "to retrieve cover art", (void*)cover_art_cb, 12 * 1000, hbs
-                                );
-
-                                cb_free(urlpath);
-                            }
-                        }
-                    }
-                }
-            }
+            prioritize_screenshots(hbs, selected);
+        }
+
+        if (!hbs->download_image && selected_screenshot_ready(hbs, selected))
+        {
+            call_with_main_stack_2(show_screenshot, hbs, selected);
         }
 
         if (a_pressed)
@@ -662,8 +836,10 @@ static void context_list_search_update(
 
 static void clear_search(CB_HomebrewHubScene* hbs, HomebrewHubContext* context)
 {
+    clear_screenshots(hbs);
     hbs->max_pages = 0;
-    free_json_data(hbs->jsearch);
+    free_json_arena(hbs->jsearch_arena);
+    hbs->jsearch_arena = NULL;
     hbs->jsearch.type = kJSONNull;
 }
 
@@ -820,13 +996,15 @@ static void http_search_cb(unsigned flags, char* data, size_t data_len, CB_Homeb
         HomebrewHubContext* context = getFirstMatchingContext(hbs, HBSCT_LIST_SEARCH);
         if (context)
         {
-            free_json_data(hbs->jsearch);
+            clear_screenshots(hbs);
+            free_json_arena(hbs->jsearch_arena);
             hbs->jsearch.type = kJSONNull;
-            if (parse_json_string(data, &hbs->jsearch) == 0)
+            if (!parse_json_string_arena(data, &hbs->jsearch, hb_search_keep, &hbs->jsearch_arena))
             {
                 goto err_invalid_json;
             }
 
+            reset_screenshots(hbs);
             populate_search_listing(hbs, context);
         }
     }
@@ -850,7 +1028,7 @@ static void http_search(CB_HomebrewHubScene* hbs, int page_index, const char* pl
     }
 
     hbs->active_download_type = HB_DL_LIST;
-    http_safe_replace_get(
+    http_safe_replace_get_cached(
         hbs->active_http_connection, CB_App->hbApiDomain, urlpath, "to browse homebrew",
         (void*)http_search_cb, 15 * 1000, hbs
     );
@@ -895,6 +1073,10 @@ static bool push_list_files(CB_HomebrewHubScene* hbs, const json_value* entry)
     context->j = entry;
     context->show_image = true;
 
+    // the page's screenshot prefetch would hold up a download (see
+    // context_list_files_update); only a fetch already running is waited on
+    http_sched_cancel_queued(hbs);
+
     int n = 0;
     for (int i = 0; i < a->n; ++i)
     {
@@ -1136,11 +1318,12 @@ void CB_HomebrewHubScene_update(CB_HomebrewHubScene* hbs, uint32_t u32enc_dt)
             LCD_ROWS - h, kBitmapUnflipped
         );
     }
-    else if (http_safe_in_progress(hbs->active_http_connection_2))
+    else
     {
         // Cover art loading - show spinner in lower right only if not on page entry
         HomebrewHubContext* current_context = &hbs->context[hbs->context_depth - 1];
-        if (current_context->list && current_context->list->selectedItem > 0)
+        if (current_context->type == HBSCT_LIST_SEARCH && current_context->list &&
+            selected_screenshot_pending(hbs, current_context->list->selectedItem - 1))
         {
             draw_spinny((kDividerX + LCD_COLUMNS) / 2, 180, 34);
         }
@@ -1223,7 +1406,7 @@ void CB_HomebrewHubScene_update(CB_HomebrewHubScene* hbs, uint32_t u32enc_dt)
 void CB_HomebrewHubScene_free(CB_HomebrewHubScene* hbs)
 {
     http_safe_free(hbs->active_http_connection);
-    http_safe_free(hbs->active_http_connection_2);
+    clear_screenshots(hbs);
     playdate->system->setAutoLockDisabled(false);
 
     CB_Scene_free(hbs->scene);
@@ -1236,7 +1419,7 @@ void CB_HomebrewHubScene_free(CB_HomebrewHubScene* hbs)
     if (hbs->download_image)
         playdate->graphics->freeBitmap(hbs->download_image);
     cb_free(hbs->cached_hint);
-    free_json_data(hbs->jsearch);
+    free_json_arena(hbs->jsearch_arena);
     cb_free(hbs);
 }
 
@@ -1276,7 +1459,6 @@ CB_HomebrewHubScene* CB_HomebrewHubScene_new(float initial_header_p, const char*
     scene->managedObject = hbs;
 
     hbs->active_http_connection = http_safe_new();
-    hbs->active_http_connection_2 = http_safe_new();
     hbs->active_download_type = HB_DL_NONE;
 
     hbs->cached_hint_key = -2;
@@ -26,6 +26,17 @@ typedef enum HomebrewHubDownloadType
     HB_DL_LIST,
 } HomebrewHubDownloadType;
 
+// a search result's screenshot, fetched ahead of time through http_sched
+typedef struct HomebrewHubScreenshot
+{
+    struct CB_HomebrewHubScene* hbs;
+    const char* name;  // in jsearch; NULL if the entry has none
+    uint32_t request;  // while being fetched
+    char* data;        // the image file, once fetched
+    size_t size;
+    bool failed;
+} HomebrewHubScreenshot;
+
 typedef struct HomebrewHubContext
 {
     HomebrewHubSceneContextType type;
@@ -51,7 +62,6 @@ typedef struct CB_HomebrewHubScene
     bool is_dismissing;
 
     HTTPSafe* active_http_connection;
-    HTTPSafe* active_http_connection_2;
     HomebrewHubDownloadType active_download_type;
 
     int max_pages;
@@ -60,6 +70,7 @@ typedef struct CB_HomebrewHubScene
 
     char* target_rom_path;
     char* target_cover_art_path;
+    HTTPFileSink rom_sink;  // the ROM is streamed to target_rom_path
     char* urlpath;  // temporary; only for callbacks
 
     void* cover_art_data;
@@ -67,7 +78,10 @@ typedef struct CB_HomebrewHubScene
 
     LCDBitmap* download_image;
     int download_image_index;
-    const char* download_image_name;
+
+    // for the current page of search results
+    HomebrewHubScreenshot* screenshots;
+    int screenshot_count;
 
     int context_depth;
     int target_context_depth;
@@ -77,7 +91,9 @@ typedef struct CB_HomebrewHubScene
     uint32_t cached_hint_key;
     float option_hold_time;
 
+    // read-only; freed with its arena
     json_value jsearch;
+    struct JsonArena* jsearch_arena;
 
     HomebrewHubContext context[CB_HBH_STACK_MAX_DEPTH];
 
@@ -8,10 +8,10 @@
 
 #include "library_scene.h"
 
-#include "../../libs/lz4/lz4.h"
 #include "../app.h"
+#include "../cover_atlas.h"
 #include "../http.h"
-#include "../http_safe.h"
+#include "../http_sched.h"
 #include "../preferences.h"
 #include "../revcheck.h"
 #include "../scenes/modal.h"
@@ -46,6 +46,7 @@ typedef struct
 {
     CB_LibraryScene* libraryScene;
     CB_Game* game;
+    uint32_t request;
 } CoverDownloadUserdata;
 
 static void save_last_selected_index(const char* rompath)
@@ -114,6 +115,17 @@ static void on_cover_download_finished(unsigned flags, char* data, size_t data_l
     CB_LibraryScene* libraryScene = userdata->libraryScene;
     CB_Game* game = userdata->game;
 
+    if (flags & HTTP_CANCELLED)
+    {
+        cb_free(userdata);
+        return;
+    }
+
+    if (libraryScene->coverDownloadRequest == userdata->request)
+    {
+        libraryScene->coverDownloadRequest = 0;
+    }
+
     int currentSelectedIndex = libraryScene->listView->selectedItem;
     CB_Game* currentlySelectedGame = NULL;
     if (currentSelectedIndex >= 0 && currentSelectedIndex < libraryScene->games->length)
@@ -197,6 +209,12 @@ static void on_cover_download_finished(unsigned flags, char* data, size_t data_l
         }
         game->coverPath = cb_strdup(cover_dest_path);
 
+        // the atlas picks the new cover up on the next launch
+        if (CB_App->coverAtlas)
+        {
+            cb_cover_atlas_remove(CB_App->coverAtlas, game->names->crc32);
+        }
+
         if (stillOnSameGame)
         {
             cb_clear_global_cover_cache();
@@ -226,11 +244,6 @@ cleanup:
         cb_free(rom_basename_no_ext);
     }
 
-    if (data)
-    {
-        cb_free(data);
-    }
-
     cb_free(userdata);
 }
 
@@ -306,22 +319,22 @@ static void CB_LibraryScene_startCoverDownload(CB_LibraryScene* libraryScene)
     coverDownloadAnimationStep = 0;
     libraryScene->scene->forceFullRefresh = true;
 
-    CoverDownloadUserdata* userdata = cb_malloc(sizeof(CoverDownloadUserdata));
+    CoverDownloadUserdata* userdata = allocz(CoverDownloadUserdata);
     userdata->libraryScene = libraryScene;
     userdata->game = game;
 
-    if (libraryScene->activeCoverDownloadConnection)
+    // the id is only known once queued; on a memory error, the callback has
+    // already run and freed userdata
+    uint32_t request = http_sched_get(
+        "github.com", url_path, "to download missing cover art", HTTP_PRIORITY_VISIBLE, 15000,
+        libraryScene, on_cover_download_finished, userdata
+    );
+    if (request)
     {
-        http_safe_free(libraryScene->activeCoverDownloadConnection);
+        userdata->request = request;
+        libraryScene->coverDownloadRequest = request;
     }
 
-    libraryScene->activeCoverDownloadConnection = http_safe_new();
-
-    http_safe_replace_get(
-        libraryScene->activeCoverDownloadConnection, "github.com", url_path,
-        "to download missing cover art", on_cover_download_finished, 15000, userdata
-    );
-
     cb_free(url_path);
 }
 
@@ -339,20 +352,9 @@ static void CB_LibraryScene_deleteCoverConfirmed(void* ud, int option)
             cb_free(game->coverPath);
             game->coverPath = NULL;
 
-            if (CB_App->coverCache)
+            if (CB_App->coverAtlas)
             {
-                for (int i = CB_App->coverCache->length - 1; i >= 0; i--)
-                {
-                    CB_CoverCacheEntry* entry = CB_App->coverCache->items[i];
-                    if (strcmp(entry->rom_path, game->fullpath) == 0)
-                    {
-                        array_remove_at(CB_App->coverCache, i);
-                        cb_free(entry->rom_path);
-                        cb_free(entry->compressed_data);
-                        cb_free(entry);
-                        break;
-                    }
-                }
+                cb_cover_atlas_remove(CB_App->coverAtlas, game->names->crc32);
             }
 
             cb_clear_global_cover_cache();
@@ -979,7 +981,7 @@ CB_LibraryScene* CB_LibraryScene_new(void)
     libraryScene->last_display_name_mode = combined_display_mode();
     libraryScene->initialLoadComplete = false;
     libraryScene->coverDownloadState = COVER_DOWNLOAD_IDLE;
-    libraryScene->activeCoverDownloadConnection = NULL;
+    libraryScene->coverDownloadRequest = 0;
     libraryScene->showCrc = false;
     libraryScene->isReloading = library_was_initialized_once;
     library_was_initialized_once = true;
@@ -987,8 +989,6 @@ CB_LibraryScene* CB_LibraryScene_new(void)
     libraryScene->deleteCoverModalShown = false;
     libraryScene->update_modal_shown = false;
     libraryScene->migration_modal_shown = false;
-    libraryScene->decompression_buffer = NULL;
-    libraryScene->decompression_buffer_size = 0;
 
     cb_clear_global_cover_cache();
 
@@ -1389,14 +1389,14 @@ static void CB_LibraryScene_update(void* object, uint32_t u32enc_dt)
         {
             libraryScene->showCrc = false;
 
-            // Reset download state when user navigates away
-            if (libraryScene->activeCoverDownloadConnection)
+            // Reset download state when user navigates away; the download
+            // carries on in the background, and its cover is still saved
+            if (libraryScene->coverDownloadRequest)
             {
-                http_safe_free(libraryScene->activeCoverDownloadConnection);
-                libraryScene->activeCoverDownloadConnection = NULL;
-                playdate->system->logToConsole(
-                    "Selection changed, closing active cover download connection."
+                http_sched_set_priority(
+                    libraryScene->coverDownloadRequest, HTTP_PRIORITY_BACKGROUND
                 );
+                libraryScene->coverDownloadRequest = 0;
             }
 
             if (libraryScene->coverDownloadState != COVER_DOWNLOAD_IDLE)
@@ -1420,98 +1420,40 @@ static void CB_LibraryScene_update(void* object, uint32_t u32enc_dt)
                 CB_Game* selectedGame = libraryScene->games->items[selectedIndex];
 
                 bool foundInCache = false;
-                if (CB_App->coverCache)
+                if (CB_App->coverAtlas && selectedGame->coverPath != NULL)
                 {
-                    for (int i = 0; i < CB_App->coverCache->length; i++)
+                    LCDBitmap* thumbnail =
+                        cb_cover_atlas_load(CB_App->coverAtlas, selectedGame->names->crc32);
+                    if (thumbnail)
                     {
-                        CB_CoverCacheEntry* entry = CB_App->coverCache->items[i];
-                        if (strcmp(entry->rom_path, selectedGame->fullpath) == 0)
-                        {
-                            if (libraryScene->decompression_buffer_size < entry->original_size)
-                            {
-                                libraryScene->decompression_buffer = cb_realloc(
-                                    libraryScene->decompression_buffer, entry->original_size
-                                );
-                                libraryScene->decompression_buffer_size = entry->original_size;
-                            }
+                        int width, height;
+                        playdate->graphics->getBitmapData(
+                            thumbnail, &width, &height, NULL, NULL, NULL
+                        );
 
-                            char* decompressed_buffer = libraryScene->decompression_buffer;
-                            if (decompressed_buffer)
+                        CB_App->coverArtCache.art.bitmap = thumbnail;
+                        CB_App->coverArtCache.art.original_width = width;
+                        CB_App->coverArtCache.art.original_height = height;
+                        CB_App->coverArtCache.art.scaled_width = width;
+                        CB_App->coverArtCache.art.scaled_height = height;
+                        CB_App->coverArtCache.art.status = CB_COVER_ART_SUCCESS;
+                        CB_App->coverArtCache.rom_path = cb_strdup(selectedGame->fullpath);
+                        foundInCache = true;
+                    }
+
+                    // keep the neighbours' thumbnails resident for scrolling
+                    for (int d = -COVER_ATLAS_PREFETCH_ROWS; d <= COVER_ATLAS_PREFETCH_ROWS; ++d)
+                    {
+                        int i = selectedIndex + d;
+                        if (d != 0 && i >= 0 && i < libraryScene->games->length)
+                        {
+                            CB_Game* neighbour = libraryScene->games->items[i];
+                            if (neighbour->coverPath)
                             {
-                                int decompressed_size = LZ4_decompress_safe(
-                                    entry->compressed_data, decompressed_buffer,
-                                    entry->compressed_size, entry->original_size
+                                cb_cover_atlas_prefetch(
+                                    CB_App->coverAtlas, neighbour->names->crc32
                                 );
-                                if (decompressed_size == entry->original_size)
-                                {
-                                    LCDBitmap* new_bitmap = NULL;
-                                    if (entry->has_mask)
-                                    {
-                                        new_bitmap = playdate->graphics->newBitmap(
-                                            entry->width, entry->height, kColorClear
-                                        );
-                                    }
-                                    else
-                                    {
-                                        new_bitmap = playdate->graphics->newBitmap(
-                                            entry->width, entry->height, kColorWhite
-                                        );
-                                    }
-
-                                    if (new_bitmap)
-                                    {
-                                        int new_rowbytes;
-                                        uint8_t *new_pixel_data, *new_mask_data;
-                                        playdate->graphics->getBitmapData(
-                                            new_bitmap, NULL, NULL, &new_rowbytes, &new_mask_data,
-                                            &new_pixel_data
-                                        );
-                                        size_t copy_bytes = (entry->rowbytes < (size_t)new_rowbytes)
-                                                                ? entry->rowbytes
-                                                                : (size_t)new_rowbytes;
-
-                                        uint8_t* src_ptr = (uint8_t*)decompressed_buffer;
-                                        uint8_t* dst_ptr = new_pixel_data;
-
-                                        for (int y = 0; y < entry->height; ++y)
-                                        {
-                                            memcpy(dst_ptr, src_ptr, copy_bytes);
-                                            src_ptr += entry->rowbytes;
-                                            dst_ptr += new_rowbytes;
-                                        }
-
-                                        if (entry->has_mask && new_mask_data)
-                                        {
-                                            dst_ptr = new_mask_data;
-                                            for (int y = 0; y < entry->height; ++y)
-                                            {
-                                                memcpy(dst_ptr, src_ptr, copy_bytes);
-                                                src_ptr += entry->rowbytes;
-                                                dst_ptr += new_rowbytes;
-                                            }
-                                        }
-
-                                        CB_App->coverArtCache.art.bitmap = new_bitmap;
-                                        CB_App->coverArtCache.art.original_width = entry->width;
-                                        CB_App->coverArtCache.art.original_height = entry->height;
-                                        CB_App->coverArtCache.art.scaled_width = entry->width;
-                                        CB_App->coverArtCache.art.scaled_height = entry->height;
-                                        CB_App->coverArtCache.art.status = CB_COVER_ART_SUCCESS;
-                                        CB_App->coverArtCache.rom_path =
-                                            cb_strdup(selectedGame->fullpath);
-                                        foundInCache = true;
-                                    }
-                                }
-                                else
-                                {
-                                    playdate->system->logToConsole(
-                                        "LZ4 decompression failed for %s", entry->rom_path
-                                    );
-                                }
                             }
-
-                            if (foundInCache)
-                                break;
                         }
                     }
                 }
@@ -2105,16 +2047,7 @@ static void CB_LibraryScene_free(void* object)
         cb_free(libraryScene->coverDownloadMessage);
     }
 
-    if (libraryScene->activeCoverDownloadConnection)
-    {
-        http_safe_free(libraryScene->activeCoverDownloadConnection);
-        libraryScene->activeCoverDownloadConnection = NULL;
-    }
-
-    if (libraryScene->decompression_buffer)
-    {
-        cb_free(libraryScene->decompression_buffer);
-    }
+    http_sched_cancel_group(libraryScene);
 
     cb_free(libraryScene);
 }
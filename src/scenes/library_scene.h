@@ -10,7 +10,6 @@
 
 #include "../app.h"
 #include "../array.h"
-#include "../http_safe.h"
 #include "../listview.h"
 #include "../scene.h"
 #include "game_scene.h"
@@ -77,7 +76,7 @@ typedef struct CB_LibraryScene
 
     CoverDownloadState coverDownloadState;
     char* coverDownloadMessage;
-    HTTPSafe* activeCoverDownloadConnection;
+    uint32_t coverDownloadRequest;  // http_sched request id, 0 if none
 
     bool showCrc;
     bool isReloading;
@@ -86,9 +85,6 @@ typedef struct CB_LibraryScene
     bool deleteCoverModalShown;
     bool update_modal_shown;
     bool migration_modal_shown;
-
-    void* decompression_buffer;
-    size_t decompression_buffer_size;
 } CB_LibraryScene;
 
 CB_LibraryScene* CB_LibraryScene_new(void);
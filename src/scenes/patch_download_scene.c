@@ -2,6 +2,7 @@
 
 #include "../http.h"
 #include "../jparse.h"
+#include "../romhack_db.h"
 #include "../softpatch.h"
 #include "../userstack.h"
 #include "../utility.h"
@@ -33,7 +34,17 @@ static const uint8_t white_transparent_dither[16] = {
 typedef struct
 {
     CB_PatchDownloadScene* pds;
+
+    // patches are streamed straight to their place in the patches directory
+    char* patch_path;
+    HTTPFileSink sink;
 } PatchDownloadUD;
+
+static void free_download_ud(PatchDownloadUD* pud)
+{
+    cb_free(pud->patch_path);
+    cb_free(pud);
+}
 typedef void (*context_update_fn)(
     CB_PatchDownloadScene* pds, PatchDownloadContext* context, float dt
 );
@@ -184,27 +195,26 @@ static void draw_common(
     CB_ListView_draw(context->list);
 }
 
-static json_value get_nth_patch_for_game(CB_PatchDownloadScene* pds, int n, int* o_hackkey)
+static void free_selected_hack(CB_PatchDownloadScene* pds)
 {
-    json_value jv = {.type = kJSONNull};
-    JsonArray* arr = (pds->game_hacks.type == kJSONArray) ? pds->game_hacks.data.arrayval : NULL;
-    if (arr && n < arr->n)
-    {
-        const char* s = NULL;
-        json_value j = arr->data[n];
-        if (j.type == kJSONInteger)
-        {
-            if (o_hackkey)
-                *o_hackkey = j.data.intval;
-            char* hackkey_str = aprintf("%d", j.data.intval);
-            json_value hacks = json_get_table_value(pds->rhdb, "hacks");
-            json_value hack = json_get_table_value(hacks, hackkey_str);
-            cb_free(hackkey_str);
-            return hack;
-        }
-    }
+    free_json_data(pds->selected_hack);
+    free_json_data(pds->hack_fs);
+    pds->selected_hack.type = kJSONNull;
+    pds->hack_fs.type = kJSONNull;
+    pds->filekey = NULL;
+}
 
-    return jv;
+// reads the nth hack's info and file tree into selected_hack and hack_fs
+static bool load_nth_patch_for_game(CB_PatchDownloadScene* pds, int n)
+{
+    free_selected_hack(pds);
+    if (!pds->rhdb || n < 0 || n >= pds->game_hack_count)
+        return false;
+
+    return cb_romhack_db_load_hack(
+        pds->rhdb, pds->game_hacks[n], &pds->selected_hack_key, &pds->selected_hack,
+        &pds->hack_fs
+    );
 }
 
 static void on_permission_granted_for_download(unsigned flags, void* ud)
@@ -242,19 +252,21 @@ static void on_permission_granted_for_download(unsigned flags, void* ud)
         return;
     }
 
-    PatchDownloadUD* userdata = cb_malloc(sizeof(PatchDownloadUD));
+    PatchDownloadUD* userdata = allocz(PatchDownloadUD);
     userdata->pds = pds;
 
     if (pds->pending_download_type == PD_PATCH)
     {
-        pds->active_http_connection = http_get(
-            pds->domain, pds->pending_http_path, "to download this patch file", on_get_patch, 15000,
-            userdata
+        userdata->patch_path = aprintf("%s/%s", pds->patches_dir_path, pds->basename);
+        userdata->sink.path = userdata->patch_path;
+        pds->active_http_connection = http_get_to_file(
+            pds->domain, pds->pending_http_path, "to download this patch file", &userdata->sink,
+            on_get_patch, 15000, userdata
         );
     }
     else if (pds->pending_download_type == PD_TEXTFILE)
     {
-        pds->active_http_connection = http_get(
+        pds->active_http_connection = http_get_cached(
             pds->domain, pds->pending_http_path, "to download this text file", on_get_textfile,
             15000, userdata
         );
@@ -435,14 +447,10 @@ static void context_patch_list_update(
     if (CB_App->buttons_pressed & kButtonA)
     {
         cb_play_ui_sound(CB_UISound_Confirm);
-        pds->selected_hack =
-            get_nth_patch_for_game(pds, context->list->selectedItem, &pds->selected_hack_key);
+        load_nth_patch_for_game(pds, context->list->selectedItem);
         json_value jfilekey = json_get_table_value(pds->selected_hack, "filekey");
         const char* filekey = (jfilekey.type == kJSONString) ? jfilekey.data.stringval : "x";
         pds->filekey = filekey;
-        char* fs_path = aprintf("z%s", filekey);
-        pds->hack_fs = json_get_table_value(json_get_table_value(pds->rhdb, "fs"), fs_path);
-        cb_free(fs_path);
 
         if (pds->hack_fs.type != kJSONTable || pds->selected_hack.type != kJSONTable)
         {
@@ -491,18 +499,20 @@ static void on_get_patch(unsigned flags, char* data, size_t data_len, void* ud)
 
     if (!pds->http_in_progress)
     {
-        cb_free(pud);
+        free_download_ud(pud);
         return;
     }
 
     pds->http_in_progress = 0;
 
-    if ((flags & ~HTTP_ENABLE_ASKED) || !data || data_len == 0)
+    if ((flags & ~HTTP_ENABLE_ASKED) || data_len == 0)
     {
         if (flags & HTTP_NOT_FOUND)
             pds->post_download_command = PDC_DOWNLOAD_FAILED_NOT_FOUND;
         else if (flags & HTTP_WIFI_NOT_AVAILABLE)
             pds->post_download_command = PDC_DOWNLOAD_FAILED_WIFI;
+        else if (flags & HTTP_FILE_ERROR)
+            pds->post_download_command = PDC_SAVE_FAILED;
         else
         {
             pds->post_download_command = PDC_DOWNLOAD_FAILED_OTHER;
@@ -513,56 +523,50 @@ static void on_get_patch(unsigned flags, char* data, size_t data_len, void* ud)
     {
         pds->pending_download_type = PD_PROCESSING;
 
-        char* path = aprintf("%s/%s", pds->patches_dir_path, pds->basename);
-        bool success = call_with_main_stack_3(cb_write_entire_file, path, data, data_len);
-        cb_free(path);
+        playdate->system->logToConsole(
+            "Saved patch %s (%u bytes, CRC32 %08x)", pud->patch_path, (unsigned)pud->sink.size,
+            (unsigned)pud->sink.crc32
+        );
 
-        if (!success)
-        {
-            pds->post_download_command = PDC_SAVE_FAILED;
-        }
-        else
-        {
-            // Add the newly downloaded file to the local files list for immediate UI update
-            pds->local_files->count++;
-            pds->local_files->files =
-                cb_realloc(pds->local_files->files, sizeof(char*) * pds->local_files->count);
-            pds->local_files->files[pds->local_files->count - 1] = cb_strdup(pds->basename);
+        // Add the newly downloaded file to the local files list for immediate UI update
+        pds->local_files->count++;
+        pds->local_files->files =
+            cb_realloc(pds->local_files->files, sizeof(char*) * pds->local_files->count);
+        pds->local_files->files[pds->local_files->count - 1] = cb_strdup(pds->basename);
 
-            if (pds->context_depth > 0)
+        if (pds->context_depth > 0)
+        {
+            PatchDownloadContext* context = &pds->context[pds->context_depth - 1];
+            if (context->type == PDSCT_PATCH_FILES_BROWSE)
             {
-                PatchDownloadContext* context = &pds->context[pds->context_depth - 1];
-                if (context->type == PDSCT_PATCH_FILES_BROWSE)
+                for (int i = 0; i < context->list->items->length; i++)
                 {
-                    for (int i = 0; i < context->list->items->length; i++)
+                    CB_ListItemButton* button = context->list->items->items[i];
+                    if (strcmp(button->title, pds->basename) == 0)
                     {
-                        CB_ListItemButton* button = context->list->items->items[i];
-                        if (strcmp(button->title, pds->basename) == 0)
-                        {
-                            button->ud.uint |= FT_DOWNLOADED_BIT;
-                            pds->cached_hint_key = -1;
-                            break;
-                        }
+                        button->ud.uint |= FT_DOWNLOADED_BIT;
+                        pds->cached_hint_key = -1;
+                        break;
                     }
                 }
             }
+        }
 
-            if (!pds->has_local_patches)
+        if (!pds->has_local_patches)
+        {
+            pds->has_local_patches = true;
+            if (pds->context[0].type == PDSCT_TOP_LEVEL)
             {
-                pds->has_local_patches = true;
-                if (pds->context[0].type == PDSCT_TOP_LEVEL)
-                {
-                    CB_ListItemButton* manage_button = pds->context[0].list->items->items[0];
-                    manage_button->ud.uint = 0;  // enabled
-                }
+                CB_ListItemButton* manage_button = pds->context[0].list->items->items[0];
+                manage_button->ud.uint = 0;  // enabled
             }
-
-            pds->post_download_command = PDC_DOWNLOAD_SUCCESS;
         }
+
+        pds->post_download_command = PDC_DOWNLOAD_SUCCESS;
     }
 
     pds->pending_download_type = PD_NONE;
-    cb_free(pud);
+    free_download_ud(pud);
 }
 
 static void on_get_textfile(unsigned flags, char* data, size_t data_len, void* ud)
@@ -573,7 +577,7 @@ static void on_get_textfile(unsigned flags, char* data, size_t data_len, void* u
 
     if (!pds->http_in_progress)
     {
-        cb_free(pud);
+        free_download_ud(pud);
         return;
     }
 
@@ -595,16 +599,16 @@ static void on_get_textfile(unsigned flags, char* data, size_t data_len, void* u
     else
     {
         pds->pending_download_type = PD_PROCESSING;
-        data[data_len] = 0;  // Null-terminate
+        // already NUL-terminated; keep the response buffer rather than copying it
         if (pds->post_download_text_data)
         {
             cb_free(pds->post_download_text_data);
         }
-        pds->post_download_text_data = cb_strdup(data);
+        pds->post_download_text_data = data;
         pds->post_download_command = PDC_TEXTFILE_SUCCESS;
     }
 
-    cb_free(pud);
+    free_download_ud(pud);
 }
 
 static bool hash_match(json_value jhack, CB_Game* game)
@@ -861,42 +865,32 @@ static void context_top_level_update(
             else if (!CB_App->rhdb_present)
             {
                 CB_presentModal(CB_Modal_new(
-                                    "Unable to download patches:\nrhdb.json missing.", NULL, NULL,
+                                    "Unable to download patches:\nrhdb.bin missing.", NULL, NULL,
                                     NULL
                 )
                                     ->scene);
             }
             else
             {
-                if (pds->rhdb.type == kJSONNull)
+                if (!pds->rhdb)
                 {
-                    // rhdb takes a while to parse, so we put a message here
-                    cb_draw_logo_screen_and_display(CB_App->subheadFont, "Loading...");
-                    parse_json(ROMHACK_DB_FILE, &pds->rhdb, kFileRead | kFileReadData);
-
-                    // load entry for game
-                    json_value lookup = json_get_table_value(pds->rhdb, "lookup");
-                    json_value gamekey = json_get_table_value(lookup, pds->header_name);
-                    if (gamekey.type == kJSONString)
+                    // only this game's records are read
+                    pds->rhdb = cb_romhack_db_open(ROMHACK_DB_FILE);
+                    if (pds->rhdb)
                     {
-                        pds->gamekey = gamekey.data.stringval;
-                        json_value g2h = json_get_table_value(pds->rhdb, "g2h");
-                        pds->game_hacks = json_get_table_value(g2h, pds->gamekey);
+                        pds->game_hacks = cb_romhack_db_find_hacks(
+                            pds->rhdb, pds->header_name, pds->game->names->crc32,
+                            &pds->game_hack_count
+                        );
                     }
                 }
 
                 pds->prefix = NULL;
-                json_value jprefix = json_get_table_value(pds->rhdb, "prefix");
-                if (jprefix.type == kJSONString)
-                {
-                    pds->prefix = jprefix.data.stringval;
-                }
-
                 pds->domain = NULL;
-                json_value jdomain = json_get_table_value(pds->rhdb, "domain");
-                if (jdomain.type == kJSONString)
+                if (pds->rhdb && cb_romhack_db_domain(pds->rhdb)[0])
                 {
-                    pds->domain = jdomain.data.stringval;
+                    pds->prefix = cb_romhack_db_prefix(pds->rhdb);
+                    pds->domain = cb_romhack_db_domain(pds->rhdb);
                     if (push_patch_list(pds))
                     {
                         pds->context_depth_p = pds->target_context_depth;
@@ -905,7 +899,7 @@ static void context_top_level_update(
                 else
                 {
                     CB_Modal* modal = CB_Modal_new(
-                        "Failed to determine patch host.\n \n(Is rhdb.json present?)", NULL, NULL,
+                        "Failed to determine patch host.\n \n(Is rhdb.bin present?)", NULL, NULL,
                         NULL
                     );
                     CB_presentModal(modal->scene);
@@ -1199,26 +1193,26 @@ static char* context_patch_choose_interaction_hint(
 
 static char* context_hack_list_hint(CB_PatchDownloadScene* pds, PatchDownloadContext* context)
 {
-    json_value hack = get_nth_patch_for_game(pds, context->list->selectedItem, NULL);
-    json_value jauthor = json_get_table_value(hack, "author");
-    const char* author = NULL;
-    if (jauthor.type == kJSONString)
-        author = jauthor.data.stringval;
-
-    json_value jdate = json_get_table_value(hack, "reldate");
-    const char* date = NULL;
-    if (jdate.type == kJSONString)
-        date = jdate.data.stringval;
-
-    json_value jtitle = json_get_table_value(hack, "title");
-    const char* title = NULL;
-    if (jtitle.type == kJSONString)
-        title = jtitle.data.stringval;
+    char* author = NULL;
+    char* date = NULL;
+    char* title = NULL;
 
-    return aprintf(
+    int n = context->list->selectedItem;
+    if (pds->rhdb && n >= 0 && n < pds->game_hack_count)
+    {
+        author = cb_romhack_db_hack_string(pds->rhdb, pds->game_hacks[n], CB_ROMHACK_AUTHOR);
+        date = cb_romhack_db_hack_string(pds->rhdb, pds->game_hacks[n], CB_ROMHACK_RELDATE);
+        title = cb_romhack_db_hack_string(pds->rhdb, pds->game_hacks[n], CB_ROMHACK_TITLE);
+    }
+
+    char* hint = aprintf(
         "Author: %s\n\nRelease Date: %s\n\nTitle: %s", author ? author : "?", date ? date : "?",
         title ? title : "?"
     );
+    cb_free(author);
+    cb_free(date);
+    cb_free(title);
+    return hint;
 }
 
 static char* context_top_level_hint(CB_PatchDownloadScene* pds, PatchDownloadContext* context)
@@ -1377,7 +1371,9 @@ void CB_PatchDownloadScene_free(CB_PatchDownloadScene* pds)
         cb_free(pds->local_files);
     }
 
-    free_json_data(pds->rhdb);
+    free_selected_hack(pds);
+    cb_free(pds->game_hacks);
+    cb_romhack_db_close(pds->rhdb);
 
     cb_free(pds);
 }
@@ -1724,7 +1720,8 @@ void CB_PatchDownloadScene_update(CB_PatchDownloadScene* pds, uint32_t u32enc_dt
 
 static bool push_patch_list(CB_PatchDownloadScene* pds)
 {
-    if (!pds->header_name[0])
+    // without a header title, only hacks naming the ROM's CRC32 can be found
+    if (!pds->header_name[0] && pds->game_hack_count == 0)
     {
         CB_Modal* modal = CB_Modal_new(
             "ROM lacks a title in its header, so CrankBoy cannot match it to any patch database",
@@ -1734,9 +1731,8 @@ static bool push_patch_list(CB_PatchDownloadScene* pds)
         CB_presentModal(modal->scene);
         return false;
     }
-    else if (pds->game_hacks.type != kJSONArray)
+    else if (!pds->game_hacks || pds->game_hack_count == 0)
     {
-    missing_entry:;
         pds->list_fetch_error_message = cb_strdup("No patches found.");
         return false;
     }
@@ -1745,43 +1741,17 @@ static bool push_patch_list(CB_PatchDownloadScene* pds)
     if (!context)
         return false;
 
-    JsonArray* arr = (pds->game_hacks.type == kJSONArray) ? pds->game_hacks.data.arrayval : NULL;
-    if (arr)
+    for (int i = 0; i < pds->game_hack_count; ++i)
     {
-        if (arr->n == 0)
-        {
-            pds->list_fetch_error_message = cb_strdup("No patches found.");
-            return false;
-        }
-
-        for (int i = 0; i < arr->n; ++i)
-        {
-            const char* s = NULL;
-            json_value j = arr->data[i];
-            if (j.type == kJSONInteger)
-            {
-                char* hackkey_str = aprintf("%d", j.data.intval);
-                json_value hacks = json_get_table_value(pds->rhdb, "hacks");
-                json_value hack = json_get_table_value(hacks, hackkey_str);
-                cb_free(hackkey_str);
-                json_value title = json_get_table_value(hack, "title");
-                if (title.type == kJSONString)
-                {
-                    s = title.data.stringval;
-                    decode_numeric_escapes((char*)s);
-                }
-            }
+        char* s = cb_romhack_db_hack_string(pds->rhdb, pds->game_hacks[i], CB_ROMHACK_TITLE);
+        if (s)
+            decode_numeric_escapes(s);
 
-            CB_ListItemButton* itemButton;
+        CB_ListItemButton* itemButton;
 
-            itemButton = CB_ListItemButton_new(s ? s : "?");
-            array_push(context->list->items, itemButton);
-        }
-    }
-    else
-    {
-        // seems unlikely; we're already guarding
-        goto missing_entry;
+        itemButton = CB_ListItemButton_new(s ? s : "?");
+        array_push(context->list->items, itemButton);
+        cb_free(s);
     }
 
     CB_ListView_reload(context->list);
@@ -2041,7 +2011,8 @@ CB_PatchDownloadScene* CB_PatchDownloadScene_new(
     pds->started_without_header = (initial_header_p < 1.0f);
     pds->option_hold_time = 0.0f;
     pds->is_dismissing = false;
-    pds->rhdb.type = kJSONNull;
+    pds->selected_hack.type = kJSONNull;
+    pds->hack_fs.type = kJSONNull;
     scene->managedObject = pds;
 
     pds->post_download_command = PDC_NONE;
@@ -7,6 +7,7 @@
 #define CB_PATCHDOWNLOAD_STACK_MAX_DEPTH 10
 
 struct CB_SettingsScene;
+struct CB_RomhackDB;
 
 typedef enum PatchDownloadSceneContextType
 {
@@ -69,7 +70,6 @@ typedef struct CB_PatchDownloadScene
     char* patches_dir_path;
     char* cached_hint;
 
-    const char* gamekey;
     const char* prefix;
     const char* filekey;
     const char* domain;
@@ -79,13 +79,17 @@ typedef struct CB_PatchDownloadScene
         const char* basename;
     };
 
-    json_value game_hacks;
+    // hack indices in the romhack database
+    uint32_t* game_hacks;
+    int game_hack_count;
+
+    // read from the database when selected; owned
     json_value hack_fs;
     json_value selected_hack;
     int selected_hack_key;
 
     uint32_t cached_hint_key;
-    json_value rhdb;
+    struct CB_RomhackDB* rhdb;
     CB_LocalFileSet* local_files;
 
     PendingDownloadType pending_download_type;
@@ -53,7 +53,7 @@ typedef struct CB_SettingsScene
     // animation for settings header, ranges 0-1
     float header_animation_p;
 
-    uint8_t thumbnail[SAVE_STATE_THUMBNAIL_H * ((SAVE_STATE_THUMBNAIL_W + 7) / 8)];
+    uint8_t thumbnail[SAVE_STATE_THUMBNAIL_BYTES];
 } CB_SettingsScene;
 
 CB_SettingsScene* CB_SettingsScene_new(
@@ -1,6 +1,7 @@
 #include "serial.h"
 
 #include "app.h"
+#include "bx.h"
 #include "ft.h"
 #include "scenes/library_scene.h"
 #include "scenes/sft_modal.h"
@@ -19,8 +20,9 @@
 
 // Main ft (file transfer) command handler
 // Commands:
-//   ft:b:<filename>:<size>:<crc32>    Begin transfer
+//   ft:b:<filename>:<size>:<crc32>    Begin transfer (see ft.c for the optional fields)
 //   ft:c:<seq>:<base64>               Send chunk (seq = 4-digit hex)
+//   ft:p:<seq>:<base85>               Send packed chunk
 //   ft:e:<crc32>                      End transfer
 //   ft:s                              Query status
 static bool serial_ft_handler(const char* const* tokens)
@@ -35,13 +37,20 @@ static bool serial_ft_handler(const char* const* tokens)
     // ft:b - Begin transfer
     if (strcmp(subcmd, "b") == 0)
     {
-        // ft:b:<filename>:<size>:<crc32>[:<original_filename>:<original_crc>]
+        // ft:b:<filename>:<size>:<crc32>[:<original_filename>:<original_crc>][:<flags>]
         if (!tokens[2] || !tokens[3] || !tokens[4])
         {
             return false;
         }
-        // Optional original filename and CRC (tokens[5] and tokens[6])
-        return ft_handle_begin(tokens[2], tokens[3], tokens[4], tokens[5], tokens[6]);
+        // Optional original filename and CRC (tokens[5] and tokens[6]), and
+        // flags after them; with no original filename, flags are tokens[5]
+        if (tokens[6])
+        {
+            return ft_handle_begin(
+                tokens[2], tokens[3], tokens[4], tokens[5], tokens[6], tokens[7]
+            );
+        }
+        return ft_handle_begin(tokens[2], tokens[3], tokens[4], NULL, NULL, tokens[5]);
     }
     // ft:c - Send chunk
     else if (strcmp(subcmd, "c") == 0)
@@ -53,6 +62,16 @@ static bool serial_ft_handler(const char* const* tokens)
         }
         return ft_handle_chunk(tokens[2], tokens[3], tokens[4]);
     }
+    // ft:p - Send packed chunk
+    else if (strcmp(subcmd, "p") == 0)
+    {
+        // ft:p:<seq>:<crc16>:<base85data>
+        if (!tokens[2] || !tokens[3] || !tokens[4])
+        {
+            return false;
+        }
+        return ft_handle_packed_chunk(tokens[2], tokens[3], tokens[4]);
+    }
     // ft:e - End transfer
     else if (strcmp(subcmd, "e") == 0)
     {
@@ -72,6 +91,68 @@ static bool serial_ft_handler(const char* const* tokens)
     return false;
 }
 
+// bx (bulk export) command handler
+// Commands:
+//   bx:l:<dir>[:<dir>...]             List files below the directories
+//   bx:o:<path>:<offset>              Open a file and stream it from offset
+//   bx:a:<seq>                        Cumulative ACK
+//   bx:r:<seq>                        Resend from seq
+//   bx:c                              Close
+static bool serial_bx_handler(const char* const* tokens)
+{
+    if (!tokens[1])
+    {
+        return false;
+    }
+
+    const char* subcmd = tokens[1];
+
+    // bx:l - List
+    if (strcmp(subcmd, "l") == 0)
+    {
+        if (!tokens[2])
+        {
+            return false;
+        }
+        return bx_handle_list(tokens + 2);
+    }
+    // bx:o - Open
+    else if (strcmp(subcmd, "o") == 0)
+    {
+        // bx:o:<path>:<offset>
+        if (!tokens[2] || !tokens[3])
+        {
+            return false;
+        }
+        return bx_handle_open(tokens[2], tokens[3]);
+    }
+    // bx:a - ACK
+    else if (strcmp(subcmd, "a") == 0)
+    {
+        if (!tokens[2])
+        {
+            return false;
+        }
+        return bx_handle_ack(tokens[2]);
+    }
+    // bx:r - Resend
+    else if (strcmp(subcmd, "r") == 0)
+    {
+        if (!tokens[2])
+        {
+            return false;
+        }
+        return bx_handle_resend(tokens[2]);
+    }
+    // bx:c - Close
+    else if (strcmp(subcmd, "c") == 0)
+    {
+        return bx_handle_close();
+    }
+
+    return false;
+}
+
 static bool serial_pd_simulate_button_press(const char* const* tokens)
 {
     // token 1: the playdate button(s) to press
@@ -691,6 +772,7 @@ typedef struct Command
 static Command commands[] = {
     {.opcode = "pd", .handler = serial_pd_simulate_button_press},
     {.opcode = "ft", .handler = serial_ft_handler},
+    {.opcode = "bx", .handler = serial_bx_handler},
     {.opcode = "cb", .handler = serial_cb_handler},
 
     // terminator
@@ -737,23 +819,47 @@ static void CB_serial_command(char* command)
  *   example: ft:b:game.gbz:69120:D57F85C8:game.gb:A1B2C3D4
  * ft:c:<seq>:<crc16>:<base64>                              (send chunk)
  *   example: ft:c:0000:C3D4:SGVsbG8gV29ybGQ=
+ * ft:p:<seq>:<crc16>:<base85>                              (send packed chunk)
+ *   example: ft:p:0000:B156:NM&qnZy;B1a%^M
  * ft:e:<crc32>                                             (end transfer)
  *   example: ft:e:D57F85C8
  * ft:s                                                     (query status)
  *   example: ft:s
  *
  * Device responses:
- *   ft:r:<WWCC>        - Ready (WW=window size, CC=chunk size)
- *                        example: ft:r:10B1 (window=16, chunk=177)
+ *   ft:r:<WWCC>        - Ready (WW=window size, CC=chunk size), preceded by
+ *                        packed window, packed chunk size and capability flags
+ *                        example: ft:r:20BC0110B1 (window=16, chunk=177;
+ *                                 packed window=32, chunk=188)
  *   ft:a:<seq>         - ACK, example: ft:a:0000
  *   ft:n:<seq>:<code>  - NACK with error code, example: ft:n:0000:crc
  *                        codes: crc, seq, write, size
  *   ft:d:<base>:<bitmap> - Status (window_base + bitmap of received chunks)
- *                        example: ft:d:0010:FFFE
+ *                        example: ft:d:0010:0000FFFE
  *   ft:o:<filename>    - OK (decompressed name for GBZ), example: ft:o:game.gb
  *   ft:x:<code>        - Error, example: ft:x:crc
  *                        codes: busy, size, filename, extension, toobig, write, crc, nomem,
  *                               gbz_header, decompress, orig_crc, notransfer
+ *
+ * bx:l:<dir>[:<dir>...]                                    (list files for backup)
+ *   example: bx:l:saves:states:covers
+ * bx:o:<path>:<offset>                                     (stream a file from offset)
+ *   example: bx:o:saves%2FTetris.sav:0
+ * bx:a:<seq>                                               (cumulative ACK)
+ *   example: bx:a:001F
+ * bx:r:<seq>                                               (resend from seq)
+ *   example: bx:r:0010
+ * bx:c                                                     (close)
+ *
+ * Device responses:
+ *   bx:i:<size>:<path>  - File, example: bx:i:32768:saves/Tetris.sav
+ *   bx:omit             - File whose path didn't fit
+ *   bx:k:<count>        - End of listing, example: bx:k:12
+ *   bx:h:<size>:<WWCC>  - Header (WW=window, CC=chunk size), example: bx:h:32768:20BC
+ *   bx:d:<seq>:<crc16>:<base85> - Chunk, example: bx:d:0000:B156:NM&qnZy;B1a%^M
+ *   bx:t:<crc32>        - Trailer (whole-file CRC), example: bx:t:1A2B3C4D
+ *   bx:x:<code>         - Error, example: bx:x:notfound
+ *                        codes: filename, offset, notfound, io, nomem
  */
 void CB_on_serial_message(const char* data)
 {
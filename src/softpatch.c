@@ -1,6 +1,7 @@
 #include "softpatch.h"
 
 #include "app.h"
+#include "crc32.h"
 #include "jparse.h"
 #include "userstack.h"
 #include "utility.h"
@@ -260,54 +261,209 @@ static uint32_t read_littleendian_u32(const uint8_t* p)
     return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
 }
 
+/*
+ * Patch files are read through a small window instead of being loaded
+ * whole, and applied to the ROM in place wherever the format allows; only
+ * BPS may need a second ROM-sized buffer (see apply_bps_patch).
+ */
+
+#define PATCH_READ_WINDOW 4096
+
+typedef struct
+{
+    SDFile* file;
+    uint8_t* window;
+    size_t window_pos;
+    size_t window_len;
+    size_t file_pos;   // of the end of the window
+    size_t body_size;  // file size, minus the footer
+    uint8_t footer[12];
+    CB_CRC32 crc;  // of the body bytes read so far
+} PatchReader;
+
+// working memory used while patching, beyond the ROM itself
+typedef struct
+{
+    size_t current;
+    size_t peak;
+} PatchMemory;
+
+static void patch_memory_add(PatchMemory* mem, size_t bytes)
+{
+    mem->current += bytes;
+    mem->peak = MAX(mem->peak, mem->current);
+}
+
+static void patch_memory_sub(PatchMemory* mem, size_t bytes)
+{
+    mem->current -= bytes;
+}
+
+static bool patch_reader_open(
+    PatchReader* r, const char* path, size_t footer_size, PatchMemory* mem
+)
+{
+    memset(r, 0, sizeof(*r));
+
+    r->file = playdate->file->open(path, kFileReadData);
+    if (!r->file)
+        return false;
+
+    playdate->file->seek(r->file, 0, SEEK_END);
+    int size = playdate->file->tell(r->file);
+    if (size < (int)footer_size)
+        goto fail;
+    r->body_size = size - footer_size;
+
+    if (playdate->file->seek(r->file, r->body_size, SEEK_SET) != 0 ||
+        playdate->file->read(r->file, r->footer, footer_size) != (int)footer_size ||
+        playdate->file->seek(r->file, 0, SEEK_SET) != 0)
+    {
+        goto fail;
+    }
+
+    r->window = cb_malloc(PATCH_READ_WINDOW);
+    if (!r->window)
+        goto fail;
+    patch_memory_add(mem, PATCH_READ_WINDOW);
+
+    cb_crc32_init(&r->crc);
+    return true;
+
+fail:
+    playdate->file->close(r->file);
+    r->file = NULL;
+    return false;
+}
+
+static void patch_reader_close(PatchReader* r, PatchMemory* mem)
+{
+    if (r->window)
+    {
+        cb_free(r->window);
+        patch_memory_sub(mem, PATCH_READ_WINDOW);
+    }
+    if (r->file)
+    {
+        playdate->file->close(r->file);
+    }
+    r->window = NULL;
+    r->file = NULL;
+}
+
+static bool patch_reader_rewind(PatchReader* r)
+{
+    r->window_pos = r->window_len = r->file_pos = 0;
+    cb_crc32_init(&r->crc);
+    return playdate->file->seek(r->file, 0, SEEK_SET) == 0;
+}
+
+static size_t patch_reader_remaining(const PatchReader* r)
+{
+    return r->body_size - r->file_pos + (r->window_len - r->window_pos);
+}
+
+static bool patch_reader_fill(PatchReader* r)
+{
+    size_t n = MIN((size_t)PATCH_READ_WINDOW, r->body_size - r->file_pos);
+    if (n == 0 || playdate->file->read(r->file, r->window, n) != (int)n)
+        return false;
+
+    cb_crc32_update(&r->crc, r->window, n);
+    r->file_pos += n;
+    r->window_pos = 0;
+    r->window_len = n;
+    return true;
+}
+
+// Returns the next byte, or -1 at the end of the body.
+static inline int patch_reader_byte(PatchReader* r)
+{
+    if (r->window_pos == r->window_len && !patch_reader_fill(r))
+        return -1;
+    return r->window[r->window_pos++];
+}
+
+// Reads n bytes into dst (or skips them, if dst is NULL).
+static bool patch_reader_read(PatchReader* r, void* dst, size_t n)
+{
+    while (n > 0)
+    {
+        if (r->window_pos == r->window_len && !patch_reader_fill(r))
+            return false;
+
+        size_t chunk = MIN(n, r->window_len - r->window_pos);
+        if (dst)
+        {
+            memcpy(dst, r->window + r->window_pos, chunk);
+            dst = (uint8_t*)dst + chunk;
+        }
+        r->window_pos += chunk;
+        n -= chunk;
+    }
+    return true;
+}
+
+// UPS and BPS: checks the CRC of the whole patch (which covers the footer
+// but its last 4 bytes), then rewinds for the real pass.
+static bool patch_reader_verify(PatchReader* r)
+{
+    r->window_pos = r->window_len;
+    while (r->file_pos < r->body_size)
+    {
+        if (!patch_reader_fill(r))
+            return false;
+    }
+
+    CB_CRC32 crc = r->crc;
+    cb_crc32_update(&crc, r->footer, 8);
+    bool ok = cb_crc32_final(&crc) == read_littleendian_u32(r->footer + 8);
+
+    return patch_reader_rewind(r) && ok;
+}
+
+static void log_patch_memory(const SoftPatch* patch, const PatchMemory* mem, size_t romsize)
+{
+    playdate->system->logToConsole(
+        "Applied %s: peak memory %u bytes beyond the %u-byte ROM", patch->basename,
+        (unsigned)mem->peak, (unsigned)romsize
+    );
+}
+
 #define IPS_MAGIC "PATCH"
 #define IPS_EOF 0x454F46 /* "EOF" */
 
 static bool apply_ips_patch(void** rom, size_t* romsize, const SoftPatch* patch)
 {
-    size_t ips_len;
-    void* ips_original_buffer =
-        call_with_main_stack_3(cb_read_entire_file, patch->fullpath, &ips_len, kFileReadData);
-
-    if (!ips_original_buffer)
+    PatchMemory mem = {0};
+    PatchReader r;
+    if (!patch_reader_open(&r, patch->fullpath, 0, &mem))
     {
         playdate->system->error("Unable to open IPS patch \"%s\"", patch->fullpath);
         return false;
     }
 
-    void* ips = ips_original_buffer;
-
-#define ADVANCE(X)          \
-    do                      \
-    {                       \
-        unsigned __x = (X); \
-        ips += __x;         \
-        ips_len -= __x;     \
-    } while (0)
-#define CHECKLEN(l)        \
-    do                     \
-    {                      \
-        if (ips_len < (l)) \
-            goto err;      \
-    } while (0)
+    size_t original_romsize = *romsize;
+    uint8_t buf[5];
 
-    if (memcmp(ips, IPS_MAGIC, 5))
+    if (!patch_reader_read(&r, buf, 5) || memcmp(buf, IPS_MAGIC, 5))
     {
         goto err;
     }
-    ADVANCE(5);
 
-    while (ips_len > 0)
+    while (patch_reader_remaining(&r) > 0)
     {
-        CHECKLEN(3);
-        unsigned offset = read_bigendian(ips, 3);
-        ADVANCE(3);
+        if (!patch_reader_read(&r, buf, 3))
+            goto err;
+        unsigned offset = read_bigendian(buf, 3);
 
         if (offset == IPS_EOF)
         {
-            if (ips_len == 3)
+            if (patch_reader_remaining(&r) == 3)
             {
-                unsigned new_size = read_bigendian(ips, 3);
+                if (!patch_reader_read(&r, buf, 3))
+                    goto err;
+                unsigned new_size = read_bigendian(buf, 3);
                 if (new_size < *romsize)
                 {
                     void* resized_rom = cb_realloc(*rom, new_size);
@@ -316,7 +472,7 @@ static bool apply_ips_patch(void** rom, size_t* romsize, const SoftPatch* patch)
                         playdate->system->error(
                             "IPS patch failed to truncate ROM: not enough memory."
                         );
-                        cb_free(ips_original_buffer);
+                        patch_reader_close(&r, &mem);
                         return false;
                     }
                     *rom = resized_rom;
@@ -327,57 +483,59 @@ static bool apply_ips_patch(void** rom, size_t* romsize, const SoftPatch* patch)
         }
 
         bool rle = false;
-        CHECKLEN(2);
-        unsigned length = read_bigendian(ips, 2);
-        ADVANCE(2);
+        if (!patch_reader_read(&r, buf, 2))
+            goto err;
+        unsigned length = read_bigendian(buf, 2);
 
         if (length == 0)
         {
-            CHECKLEN(2);
-            length = read_bigendian(ips, 2);
-            ADVANCE(2);
+            if (!patch_reader_read(&r, buf, 2))
+                goto err;
+            length = read_bigendian(buf, 2);
             rle = true;
         }
 
         if (offset + length > *romsize)
         {
-            *romsize = offset + length;
-            *rom = cb_realloc(*rom, *romsize);
-            if (!*rom)
+            void* resized_rom = cb_realloc(*rom, offset + length);
+            if (!resized_rom)
             {
                 playdate->system->error(
                     "IPS patch requires ROM to be resized, but there was not enough memory."
                 );
-                cb_free(ips_original_buffer);
+                patch_reader_close(&r, &mem);
                 return false;
             }
+            *rom = resized_rom;
+            *romsize = offset + length;
+            mem.peak = MAX(mem.peak, mem.current + *romsize - original_romsize);
         }
 
         if (rle)
         {
             // run-length encoded hunk
-            CHECKLEN(1);
-            unsigned v = read_bigendian(ips, 1);
-            ADVANCE(1);
+            int v = patch_reader_byte(&r);
+            if (v < 0)
+                goto err;
 
             // RLE record
             memset((uint8_t*)*rom + offset, v, length);
         }
         else
         {
-            CHECKLEN(length);
-            // Standard record
-            memcpy((uint8_t*)*rom + offset, ips, length);
-            ADVANCE(length);
+            // Standard record, read straight into the ROM
+            if (!patch_reader_read(&r, (uint8_t*)*rom + offset, length))
+                goto err;
         }
     }
 
-    cb_free(ips_original_buffer);
+    patch_reader_close(&r, &mem);
+    log_patch_memory(patch, &mem, original_romsize);
     return true;
 
 err:
     playdate->system->error("Error applying IPS patch \"%s\"", patch->fullpath);
-    cb_free(ips_original_buffer);
+    patch_reader_close(&r, &mem);
     return false;
 }
 
@@ -397,16 +555,13 @@ err:
 
 #define UPS_MAGIC "UPS1"
 
-static uint64_t read_ups_vlq(const uint8_t** data, size_t* size)
+static uint64_t read_ups_vlq(PatchReader* r)
 {
     uint64_t result = 0;
     uint64_t shift = 0;
-    while (*size > 0)
+    int byte;
+    while ((byte = patch_reader_byte(r)) >= 0)
     {
-        uint8_t byte = **data;
-        (*data)++;
-        (*size)--;
-
         uint64_t part = byte & 0x7F;
         result += part << shift;
 
@@ -421,45 +576,73 @@ static uint64_t read_ups_vlq(const uint8_t** data, size_t* size)
     return (uint64_t)-1;
 }
 
+// Reads the UPS header; returns false if it is invalid.
+static bool read_ups_header(PatchReader* r, uint64_t* o_input_size, uint64_t* o_output_size)
+{
+    uint8_t magic[4];
+    if (!patch_reader_read(r, magic, 4) || memcmp(magic, UPS_MAGIC, 4) != 0)
+        return false;
+
+    *o_input_size = read_ups_vlq(r);
+    *o_output_size = read_ups_vlq(r);
+    return *o_input_size != (uint64_t)-1 && *o_output_size != (uint64_t)-1;
+}
+
+// XORs the patch into rom, in place. As XOR is its own inverse, running
+// this a second time undoes it.
+static bool ups_xor_pass(PatchReader* r, uint8_t* rom, size_t output_size)
+{
+    uint64_t input_size, ignored_size;
+    if (!patch_reader_rewind(r) || !read_ups_header(r, &input_size, &ignored_size))
+        return false;
+
+    size_t current_pos = 0;
+
+    while (patch_reader_remaining(r) > 0)
+    {
+        uint64_t relative_offset = read_ups_vlq(r);
+        if (relative_offset == (uint64_t)-1)
+            return false;
+        current_pos += relative_offset;
+
+        int xor_byte;
+        while ((xor_byte = patch_reader_byte(r)) > 0)
+        {
+            if (current_pos >= output_size)
+                return false;
+
+            rom[current_pos] ^= xor_byte;
+            current_pos++;
+        }
+        if (xor_byte == 0)
+        {
+            current_pos++;
+        }
+    }
+    return true;
+}
+
 static bool apply_ups_patch(void** rom, size_t* romsize, const SoftPatch* patch)
 {
-    size_t ups_len;
-    uint8_t* ups_data = (uint8_t*)call_with_main_stack_3(
-        cb_read_entire_file, patch->fullpath, &ups_len, kFileReadData
-    );
-    if (!ups_data)
+    PatchMemory mem = {0};
+    PatchReader r;
+    if (!patch_reader_open(&r, patch->fullpath, 12, &mem))
     {
         playdate->system->error("Unable to open UPS patch \"%s\"", patch->fullpath);
         return false;
     }
 
-    const uint8_t* ups_ptr = ups_data;
-    size_t ups_remaining = ups_len;
-    uint8_t* new_rom = NULL;
     bool success = false;
-
-    if (ups_remaining < 16)
-        goto err_corrupt;
+    size_t original_romsize = *romsize;
 
     // Verify patch
-    uint32_t patch_checksum_from_file = read_littleendian_u32(ups_data + ups_len - 4);
-    uint32_t calculated_patch_checksum = crc32_for_buffer(ups_data, ups_len - 4);
-    if (patch_checksum_from_file != calculated_patch_checksum)
+    uint64_t input_size_from_patch, output_size_from_patch;
+    if (r.body_size < 4 || !patch_reader_verify(&r) ||
+        !read_ups_header(&r, &input_size_from_patch, &output_size_from_patch))
     {
         goto err_corrupt;
     }
 
-    if (memcmp(ups_ptr, UPS_MAGIC, 4) != 0)
-        goto err_corrupt;
-    ups_ptr += 4;
-    ups_remaining -= 4;
-
-    uint64_t input_size_from_patch = read_ups_vlq(&ups_ptr, &ups_remaining);
-    uint64_t output_size_from_patch = read_ups_vlq(&ups_ptr, &ups_remaining);
-
-    if (input_size_from_patch == (uint64_t)-1 || output_size_from_patch == (uint64_t)-1)
-        goto err_corrupt;
-
     // Verify input ROM
     size_t effective_rom_size = *romsize;
     if (input_size_from_patch != *romsize)
@@ -482,7 +665,7 @@ static bool apply_ups_patch(void** rom, size_t* romsize, const SoftPatch* patch)
         }
     }
 
-    uint32_t input_checksum_from_patch = read_littleendian_u32(ups_data + ups_len - 12);
+    uint32_t input_checksum_from_patch = read_littleendian_u32(r.footer);
     uint32_t calculated_input_checksum = crc32_for_buffer(*rom, effective_rom_size);
 
     if (input_checksum_from_patch != calculated_input_checksum)
@@ -491,77 +674,70 @@ static bool apply_ups_patch(void** rom, size_t* romsize, const SoftPatch* patch)
         goto cleanup;
     }
 
-    new_rom = cb_malloc(output_size_from_patch);
-    if (!new_rom)
+    // the output is patched over the input, grown (zero-filled) if needed
+    size_t output_size = output_size_from_patch;
+    if (output_size > *romsize)
     {
-        playdate->system->error("Failed to allocate memory for patched ROM.");
-        goto cleanup;
+        uint8_t* grown_rom = cb_realloc(*rom, output_size);
+        if (!grown_rom)
+        {
+            playdate->system->error("Failed to allocate memory for patched ROM.");
+            goto cleanup;
+        }
+        memset(grown_rom + *romsize, 0, output_size - *romsize);
+        *rom = grown_rom;
+        patch_memory_add(&mem, output_size - *romsize);
     }
 
-    size_t copy_len = (*romsize < output_size_from_patch) ? *romsize : output_size_from_patch;
-    memcpy(new_rom, *rom, copy_len);
-    if (output_size_from_patch > *romsize)
+    size_t buffer_size = MAX(output_size, *romsize);
+    if (!ups_xor_pass(&r, *rom, output_size))
     {
-        memset(new_rom + *romsize, 0, output_size_from_patch - *romsize);
-    }
-
-    size_t current_pos = 0;
-
-    while (ups_remaining > 12)
-    {
-        uint64_t relative_offset = read_ups_vlq(&ups_ptr, &ups_remaining);
-        current_pos += relative_offset;
-
-        while (ups_remaining > 12)
-        {
-            uint8_t xor_byte = *ups_ptr++;
-            ups_remaining--;
-
-            if (xor_byte == 0)
-            {
-                current_pos++;
-                break;
-            }
-
-            if (current_pos >= output_size_from_patch)
-                goto err_bounds;
-
-            new_rom[current_pos] ^= xor_byte;
-            current_pos++;
-        }
+        // only the part already applied is undone
+        ups_xor_pass(&r, *rom, output_size);
+        goto err_bounds;
     }
 
     // Verify output ROM
-    uint32_t output_checksum_from_patch = read_littleendian_u32(ups_data + ups_len - 8);
-    uint32_t calculated_output_checksum = crc32_for_buffer(new_rom, output_size_from_patch);
+    uint32_t output_checksum_from_patch = read_littleendian_u32(r.footer + 4);
+    uint32_t calculated_output_checksum = crc32_for_buffer(*rom, output_size);
 
     if (output_checksum_from_patch != calculated_output_checksum)
     {
         playdate->system->error("UPS error: Output ROM checksum mismatch. Patching failed.");
-        cb_free(new_rom);
-        goto cleanup;
+        ups_xor_pass(&r, *rom, output_size);
+        goto restore_size;
     }
 
-    cb_free(*rom);
-    *rom = new_rom;
-    *romsize = output_size_from_patch;
+    if (output_size < buffer_size)
+    {
+        void* shrunk_rom = cb_realloc(*rom, output_size);
+        if (shrunk_rom)
+            *rom = shrunk_rom;
+    }
+    *romsize = output_size;
     success = true;
     goto cleanup;
 
 err_bounds:
     playdate->system->error("UPS error: Patch tried to write out of bounds.");
-    if (new_rom)
-        cb_free(new_rom);
-    goto cleanup;
+    goto restore_size;
 
 err_corrupt:
     playdate->system->error("UPS error: Patch file is corrupt or invalid.");
-    if (new_rom)
-        cb_free(new_rom);
+    goto cleanup;
+
+restore_size:
+    if (buffer_size > original_romsize)
+    {
+        void* shrunk_rom = cb_realloc(*rom, original_romsize);
+        if (shrunk_rom)
+            *rom = shrunk_rom;
+    }
 
 cleanup:
-    if (ups_data)
-        cb_free(ups_data);
+    patch_reader_close(&r, &mem);
+    if (success)
+        log_patch_memory(patch, &mem, original_romsize);
     return success;
 }
 
@@ -585,14 +761,12 @@ cleanup:
 #define BPS_ACTION_SOURCE_COPY 2
 #define BPS_ACTION_TARGET_COPY 3
 
-static uint64_t read_bps_vlq(const uint8_t** data, size_t* size)
+static uint64_t read_bps_vlq(PatchReader* r)
 {
     uint64_t result = 0, shift = 1;
-    while (*size > 0)
+    int x;
+    while ((x = patch_reader_byte(r)) >= 0)
     {
-        uint8_t x = **data;
-        (*data)++;
-        (*size)--;
         result += (x & 0x7f) * shift;
         if (x & 0x80)
             break;
@@ -602,168 +776,321 @@ static uint64_t read_bps_vlq(const uint8_t** data, size_t* size)
     return result;
 }
 
-static bool apply_bps_patch(void** rom, size_t* romsize, const SoftPatch* patch)
-{
-    size_t bps_len;
-    uint8_t* bps_data = (uint8_t*)call_with_main_stack_3(
-        cb_read_entire_file, patch->fullpath, &bps_len, kFileReadData
-    );
-    if (!bps_data)
-    {
-        playdate->system->error("Unable to open BPS patch \"%s\"", patch->fullpath);
-        return false;
-    }
-
-    const uint8_t* bps_ptr = bps_data;
-    size_t bps_remaining = bps_len;
-    uint8_t* new_rom = NULL;
-    bool success = false;
+#define BPS_OK 0
+#define BPS_ERR_CORRUPT -1
+#define BPS_ERR_BOUNDS -2
+#define BPS_ERR_MEMORY -3
 
-    if (bps_remaining < 16)
-        goto err_corrupt;
+// Target ranges overwritten with something other than the same source
+// bytes (sorted, as the output only moves forward).
+typedef struct
+{
+    uint32_t (*ranges)[2];
+    size_t count;
+    size_t capacity;
+    PatchMemory* mem;
+} BpsWrites;
 
-    uint32_t patch_checksum_from_file = read_littleendian_u32(bps_data + bps_len - 4);
-    uint32_t calculated_patch_checksum = crc32_for_buffer(bps_data, bps_len - 4);
-    if (patch_checksum_from_file != calculated_patch_checksum)
+static bool bps_writes_add(BpsWrites* w, uint32_t start, uint32_t end)
+{
+    if (w->count > 0 && w->ranges[w->count - 1][1] == start)
     {
-        goto err_corrupt;
+        w->ranges[w->count - 1][1] = end;
+        return true;
     }
 
-    if (memcmp(bps_ptr, BPS_MAGIC, 4) != 0)
-        goto err_corrupt;
-    bps_ptr += 4;
-    bps_remaining -= 4;
-
-    uint64_t source_size_from_patch = read_bps_vlq(&bps_ptr, &bps_remaining);
-    uint64_t target_size_from_patch = read_bps_vlq(&bps_ptr, &bps_remaining);
-    uint64_t metadata_len = read_bps_vlq(&bps_ptr, &bps_remaining);
-
-    if (metadata_len > bps_remaining)
-        goto err_corrupt;
-    bps_ptr += metadata_len;
-    bps_remaining -= metadata_len;
-
-    if (source_size_from_patch != *romsize)
+    if (w->count == w->capacity)
     {
-        playdate->system->error(
-            "BPS error: Input ROM size mismatch. Expected %llu, got %zu.", source_size_from_patch,
-            *romsize
-        );
-        goto cleanup;
+        size_t capacity = MAX(w->capacity * 2, 64);
+        void* ranges = cb_realloc(w->ranges, capacity * sizeof(*w->ranges));
+        if (!ranges)
+            return false;
+        patch_memory_add(w->mem, (capacity - w->capacity) * sizeof(*w->ranges));
+        w->ranges = ranges;
+        w->capacity = capacity;
     }
 
-    uint32_t source_checksum_from_patch = read_littleendian_u32(bps_data + bps_len - 12);
-    uint32_t calculated_source_checksum = crc32_for_buffer(*rom, *romsize);
-    if (source_checksum_from_patch != calculated_source_checksum)
-    {
-        playdate->system->error("BPS error: Input ROM checksum mismatch.");
-        goto cleanup;
-    }
+    w->ranges[w->count][0] = start;
+    w->ranges[w->count][1] = end;
+    w->count++;
+    return true;
+}
 
-    new_rom = cb_malloc(target_size_from_patch);
-    if (!new_rom)
+static bool bps_writes_overlap(const BpsWrites* w, uint32_t start, uint32_t end)
+{
+    // first range ending after start
+    size_t lo = 0, hi = w->count;
+    while (lo < hi)
     {
-        playdate->system->error("BPS error: Failed to allocate memory for patched ROM.");
-        goto cleanup;
+        size_t mid = lo + (hi - lo) / 2;
+        if (w->ranges[mid][1] <= start)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
+    return lo < w->count && w->ranges[lo][0] < end;
+}
 
+// Runs the BPS commands. Without a target, only validates them, and
+// records in *o_in_place whether the target could be built over the source.
+// target may be the same buffer as source if that is the case.
+static int bps_run(
+    PatchReader* r, const uint8_t* source, size_t source_size, uint8_t* target,
+    size_t target_size, BpsWrites* writes, bool* o_in_place
+)
+{
     size_t output_offset = 0;
-    size_t source_linear_offset = 0;
     int64_t source_relative_offset = 0;
     int64_t target_relative_offset = 0;
 
-    while (bps_remaining > 12)
+    while (patch_reader_remaining(r) > 0)
     {
-        uint64_t data = read_bps_vlq(&bps_ptr, &bps_remaining);
+        uint64_t data = read_bps_vlq(r);
         uint32_t command = data & 3;
         uint64_t length = (data >> 2) + 1;
 
-        if (output_offset + length > target_size_from_patch)
-            goto err_bounds;
+        if (output_offset + length > target_size)
+            return BPS_ERR_BOUNDS;
 
         switch (command)
         {
         case BPS_ACTION_SOURCE_READ:
         {
-            if (output_offset + length > *romsize)
-                goto err_bounds;
-            memcpy(new_rom + output_offset, (uint8_t*)*rom + output_offset, length);
+            if (output_offset + length > source_size)
+                return BPS_ERR_BOUNDS;
+            if (target && target != source)
+                memcpy(target + output_offset, source + output_offset, length);
             output_offset += length;
-            break;
+            continue;
         }
         case BPS_ACTION_TARGET_READ:
         {
-            if (length > bps_remaining)
-                goto err_corrupt;
-            memcpy(new_rom + output_offset, bps_ptr, length);
-            bps_ptr += length;
-            bps_remaining -= length;
-            output_offset += length;
+            if (length > patch_reader_remaining(r))
+                return BPS_ERR_CORRUPT;
+            if (!patch_reader_read(r, target ? target + output_offset : NULL, length))
+                return BPS_ERR_CORRUPT;
             break;
         }
         case BPS_ACTION_SOURCE_COPY:
         {
-            uint64_t offset_data = read_bps_vlq(&bps_ptr, &bps_remaining);
+            uint64_t offset_data = read_bps_vlq(r);
             int64_t relative_offset = (offset_data & 1 ? -1 : 1) * (offset_data >> 1);
 
             source_relative_offset += relative_offset;
             if (source_relative_offset < 0 ||
-                (uint64_t)(source_relative_offset + length) > *romsize)
-                goto err_bounds;
+                (uint64_t)(source_relative_offset + length) > source_size)
+                return BPS_ERR_BOUNDS;
 
-            memcpy(new_rom + output_offset, (uint8_t*)*rom + source_relative_offset, length);
+            if (target)
+            {
+                // may overlap when in place; the source bytes are still unmodified
+                memmove(target + output_offset, source + source_relative_offset, length);
+            }
+            else if (*o_in_place &&
+                     bps_writes_overlap(
+                         writes, source_relative_offset, source_relative_offset + length
+                     ))
+            {
+                *o_in_place = false;
+            }
 
             source_relative_offset += length;
-            output_offset += length;
             break;
         }
         case BPS_ACTION_TARGET_COPY:
         {
-            uint64_t offset_data = read_bps_vlq(&bps_ptr, &bps_remaining);
+            uint64_t offset_data = read_bps_vlq(r);
             int64_t relative_offset = (offset_data & 1 ? -1 : 1) * (offset_data >> 1);
 
             target_relative_offset += relative_offset;
             if (target_relative_offset < 0 || (uint64_t)target_relative_offset >= output_offset)
-                goto err_bounds;
+                return BPS_ERR_BOUNDS;
 
-            for (uint64_t i = 0; i < length; i++)
+            if (target)
+            {
+                for (uint64_t i = 0; i < length; i++)
+                {
+                    target[output_offset + i] = target[target_relative_offset++];
+                }
+            }
+            else
             {
-                new_rom[output_offset++] = new_rom[target_relative_offset++];
+                target_relative_offset += length;
             }
             break;
         }
         }
+
+        if (!target && *o_in_place &&
+            !bps_writes_add(writes, output_offset, output_offset + length))
+            return BPS_ERR_MEMORY;
+        output_offset += length;
+    }
+
+    return BPS_OK;
+}
+
+static bool read_bps_header(PatchReader* r, uint64_t* o_source_size, uint64_t* o_target_size)
+{
+    uint8_t magic[4];
+    if (!patch_reader_read(r, magic, 4) || memcmp(magic, BPS_MAGIC, 4) != 0)
+        return false;
+
+    *o_source_size = read_bps_vlq(r);
+    *o_target_size = read_bps_vlq(r);
+    uint64_t metadata_len = read_bps_vlq(r);
+
+    return metadata_len <= patch_reader_remaining(r) && patch_reader_read(r, NULL, metadata_len);
+}
+
+// A first pass over the patch validates it, and works out whether any
+// SourceCopy reads source bytes that an earlier command has already
+// overwritten. If none does (the common case), the target is built over
+// the source in the ROM buffer; otherwise it gets a buffer of its own.
+static bool apply_bps_patch(void** rom, size_t* romsize, const SoftPatch* patch)
+{
+    PatchMemory mem = {0};
+    PatchReader r;
+    if (!patch_reader_open(&r, patch->fullpath, 12, &mem))
+    {
+        playdate->system->error("Unable to open BPS patch \"%s\"", patch->fullpath);
+        return false;
+    }
+
+    BpsWrites writes = {.mem = &mem};
+    uint8_t* new_rom = NULL;
+    bool success = false;
+    bool in_place = true;
+    size_t original_romsize = *romsize;
+    int result;
+
+    uint64_t source_size_from_patch, target_size_from_patch;
+    if (r.body_size < 4 || !patch_reader_verify(&r) ||
+        !read_bps_header(&r, &source_size_from_patch, &target_size_from_patch))
+    {
+        goto err_corrupt;
+    }
+
+    if (source_size_from_patch != *romsize)
+    {
+        playdate->system->error(
+            "BPS error: Input ROM size mismatch. Expected %llu, got %zu.", source_size_from_patch,
+            *romsize
+        );
+        goto cleanup;
+    }
+
+    uint32_t source_checksum_from_patch = read_littleendian_u32(r.footer);
+    uint32_t calculated_source_checksum = crc32_for_buffer(*rom, *romsize);
+    if (source_checksum_from_patch != calculated_source_checksum)
+    {
+        playdate->system->error("BPS error: Input ROM checksum mismatch.");
+        goto cleanup;
+    }
+
+    size_t target_size = target_size_from_patch;
+    result = bps_run(&r, *rom, *romsize, NULL, target_size, &writes, &in_place);
+    cb_free(writes.ranges);
+    patch_memory_sub(&mem, writes.capacity * sizeof(*writes.ranges));
+
+    if (result == BPS_ERR_MEMORY)
+    {
+        // couldn't track the writes; validate again for a separate target
+        in_place = false;
+        if (!patch_reader_rewind(&r) ||
+            !read_bps_header(&r, &source_size_from_patch, &target_size_from_patch))
+        {
+            goto err_corrupt;
+        }
+        result = bps_run(&r, *rom, *romsize, NULL, target_size, NULL, &in_place);
+    }
+
+    if (result == BPS_ERR_BOUNDS)
+        goto err_bounds;
+    else if (result != BPS_OK)
+        goto err_corrupt;
+
+    if (!patch_reader_rewind(&r) ||
+        !read_bps_header(&r, &source_size_from_patch, &target_size_from_patch))
+    {
+        goto err_corrupt;
+    }
+
+    if (in_place)
+    {
+        if (target_size > *romsize)
+        {
+            uint8_t* grown_rom = cb_realloc(*rom, target_size);
+            if (!grown_rom)
+            {
+                playdate->system->error("BPS error: Failed to allocate memory for patched ROM.");
+                goto cleanup;
+            }
+            *rom = grown_rom;
+            *romsize = target_size;
+            patch_memory_add(&mem, target_size - original_romsize);
+        }
+        new_rom = *rom;
+    }
+    else
+    {
+        new_rom = cb_malloc(target_size);
+        if (!new_rom)
+        {
+            playdate->system->error("BPS error: Failed to allocate memory for patched ROM.");
+            goto cleanup;
+        }
+        patch_memory_add(&mem, target_size);
     }
 
-    uint32_t target_checksum_from_patch = read_littleendian_u32(bps_data + bps_len - 8);
-    uint32_t calculated_target_checksum = crc32_for_buffer(new_rom, target_size_from_patch);
+    // already validated; this can't fail
+    bps_run(&r, *rom, original_romsize, new_rom, target_size, NULL, NULL);
+
+    uint32_t target_checksum_from_patch = read_littleendian_u32(r.footer + 4);
+    uint32_t calculated_target_checksum = crc32_for_buffer(new_rom, target_size);
     if (target_checksum_from_patch != calculated_target_checksum)
     {
+        // (if patched in place, the ROM is no longer usable either way)
         playdate->system->error("BPS error: Output ROM checksum mismatch. Patching failed.");
-        cb_free(new_rom);
+        if (!in_place)
+            cb_free(new_rom);
         goto cleanup;
     }
 
-    cb_free(*rom);
-    *rom = new_rom;
-    *romsize = target_size_from_patch;
+    if (in_place)
+    {
+        if (target_size < *romsize)
+        {
+            void* shrunk_rom = cb_realloc(*rom, target_size);
+            if (shrunk_rom)
+                *rom = shrunk_rom;
+        }
+    }
+    else
+    {
+        cb_free(*rom);
+        *rom = new_rom;
+    }
+    *romsize = target_size;
     success = true;
     goto cleanup;
 
 err_bounds:
     playdate->system->error("BPS error: Patch tried to write out of bounds.");
-    if (new_rom)
-        cb_free(new_rom);
     goto cleanup;
 
 err_corrupt:
     playdate->system->error("BPS error: Patch file is corrupt or invalid.");
-    if (new_rom)
-        cb_free(new_rom);
 
 cleanup:
-    if (bps_data)
-        cb_free(bps_data);
+    patch_reader_close(&r, &mem);
+    if (success)
+    {
+        playdate->system->logToConsole(
+            "BPS patch applied %s", in_place ? "in place" : "into a separate buffer"
+        );
+        log_patch_memory(patch, &mem, original_romsize);
+    }
     return success;
 }
 
@@ -817,3 +1144,222 @@ bool patch_rom(void** rom, size_t* romsize, const SoftPatch* patchlist)
     }
     return success;
 }
+
+/*
+ * Patched ROM cache. The key file records what the cached ROM was built
+ * from: the base ROM's size and mtime, and each enabled patch (in order)
+ * by name, size and mtime; followed by the patched ROM's size.
+ */
+
+#define PATCH_CACHE_MAGIC "CBPC"
+#define PATCH_CACHE_VERSION 1
+
+typedef struct
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t hash;
+    uint32_t rom_size;
+    uint32_t rom_mtime;
+    uint32_t patch_count;
+} PatchCacheHeader;
+
+typedef struct
+{
+    uint32_t name_crc;
+    uint32_t size;
+    uint32_t mtime;
+} PatchCacheEntry;
+
+static bool stat_size_mtime(const char* path, uint32_t* o_size, uint32_t* o_mtime)
+{
+    FileStat stat;
+    if (playdate->file->stat(path, &stat) != 0)
+        return false;
+
+    struct PDDateTime dt = {
+        .year = stat.m_year,
+        .month = stat.m_month,
+        .day = stat.m_day,
+        .hour = stat.m_hour,
+        .minute = stat.m_minute,
+        .second = stat.m_second
+    };
+    *o_size = stat.size;
+    *o_mtime = playdate->system->convertDateTimeToEpoch(&dt);
+    return true;
+}
+
+// Returns the expected contents of the key file, minus the trailing size.
+static void* patch_cache_key(const char* rom_path, const SoftPatch* patchlist, size_t* o_size)
+{
+    uint32_t count = 0;
+    for (const SoftPatch* patch = patchlist; patch && patch->fullpath; patch++)
+    {
+        if (patch->state == PATCH_ENABLED)
+            ++count;
+    }
+    if (count == 0)
+        return NULL;
+
+    size_t size = sizeof(PatchCacheHeader) + count * sizeof(PatchCacheEntry);
+    uint8_t* key = cb_calloc(1, size);
+    if (!key)
+        return NULL;
+
+    PatchCacheHeader* header = (PatchCacheHeader*)key;
+    memcpy(header->magic, PATCH_CACHE_MAGIC, 4);
+    header->version = PATCH_CACHE_VERSION;
+    header->hash = patch_hash((SoftPatch*)patchlist);
+    header->patch_count = count;
+    if (!stat_size_mtime(rom_path, &header->rom_size, &header->rom_mtime))
+        goto fail;
+
+    PatchCacheEntry* entry = (PatchCacheEntry*)(key + sizeof(PatchCacheHeader));
+    for (const SoftPatch* patch = patchlist; patch && patch->fullpath; patch++)
+    {
+        if (patch->state != PATCH_ENABLED)
+            continue;
+
+        entry->name_crc = crc32_for_string(patch->basename);
+        if (!stat_size_mtime(patch->fullpath, &entry->size, &entry->mtime))
+            goto fail;
+        entry++;
+    }
+
+    *o_size = size;
+    return key;
+
+fail:
+    cb_free(key);
+    return NULL;
+}
+
+static char* patch_cache_path(const char* rom_path, uint32_t hash, const char* extension)
+{
+    char* dir = get_patches_directory(rom_path);
+    char* path = aprintf("%s/%s%08lX%s", dir, PATCH_CACHE_PREFIX, (unsigned long)hash, extension);
+    cb_free(dir);
+    return path;
+}
+
+char* find_patched_rom(const char* rom_path, const SoftPatch* patchlist)
+{
+    size_t key_size;
+    uint8_t* key = patch_cache_key(rom_path, patchlist, &key_size);
+    if (!key)
+        return NULL;
+
+    uint32_t hash = ((PatchCacheHeader*)key)->hash;
+    char* key_path = patch_cache_path(rom_path, hash, ".key");
+    char* cached_path = patch_cache_path(rom_path, hash, ".rom");
+
+    size_t stored_size;
+    uint8_t* stored = key_path ? cb_read_entire_file(key_path, &stored_size, kFileReadData) : NULL;
+
+    bool valid = false;
+    uint32_t patched_size, patched_mtime, cached_size;
+    if (stored && stored_size == key_size + sizeof(uint32_t) &&
+        memcmp(stored, key, key_size) == 0 && cached_path &&
+        stat_size_mtime(cached_path, &cached_size, &patched_mtime))
+    {
+        memcpy(&patched_size, stored + key_size, sizeof(uint32_t));
+        valid = (patched_size == cached_size);
+    }
+
+    cb_free(stored);
+    cb_free(key_path);
+    cb_free(key);
+
+    if (!valid)
+    {
+        cb_free(cached_path);
+        return NULL;
+    }
+    return cached_path;
+}
+
+struct PatchCacheCleanup
+{
+    const char* dir;
+    const char* keep_rom;
+    const char* keep_key;
+};
+
+static void remove_stale_patch_cache_cb(const char* filename, void* ud)
+{
+    struct PatchCacheCleanup* cleanup = ud;
+    if (!startswith(filename, PATCH_CACHE_PREFIX) || !strcmp(filename, cleanup->keep_rom) ||
+        !strcmp(filename, cleanup->keep_key))
+    {
+        return;
+    }
+
+    char* path = aprintf("%s/%s", cleanup->dir, filename);
+    if (path)
+    {
+        playdate->file->unlink(path, 0);
+        cb_free(path);
+    }
+}
+
+bool save_patched_rom(
+    const char* rom_path, const SoftPatch* patchlist, const void* rom, size_t romsize
+)
+{
+    size_t key_size;
+    uint8_t* key = patch_cache_key(rom_path, patchlist, &key_size);
+    if (!key)
+        return false;
+
+    uint8_t* stored = cb_realloc(key, key_size + sizeof(uint32_t));
+    if (!stored)
+    {
+        cb_free(key);
+        return false;
+    }
+    key = stored;
+
+    uint32_t patched_size = romsize;
+    memcpy(key + key_size, &patched_size, sizeof(uint32_t));
+
+    uint32_t hash = ((PatchCacheHeader*)key)->hash;
+    char* key_path = patch_cache_path(rom_path, hash, ".key");
+    char* cached_path = patch_cache_path(rom_path, hash, ".rom");
+    bool ok = key_path && cached_path;
+
+    if (ok)
+    {
+        // the key is only written once the ROM is complete
+        playdate->file->unlink(key_path, 0);
+        ok = cb_write_entire_file(cached_path, rom, romsize) &&
+             cb_write_entire_file(key_path, key, key_size + sizeof(uint32_t));
+    }
+
+    if (ok)
+    {
+        // only the most recent patch combination is kept
+        char* dir = get_patches_directory(rom_path);
+        char* keep_rom = cb_basename(cached_path, false);
+        char* keep_key = cb_basename(key_path, false);
+        if (dir && keep_rom && keep_key)
+        {
+            struct PatchCacheCleanup cleanup = {dir, keep_rom, keep_key};
+            playdate->file->listfiles(dir, remove_stale_patch_cache_cb, &cleanup, true);
+        }
+        cb_free(keep_key);
+        cb_free(keep_rom);
+        cb_free(dir);
+    }
+    else
+    {
+        playdate->system->logToConsole("Failed to cache patched ROM for %s", rom_path);
+        if (cached_path)
+            playdate->file->unlink(cached_path, 0);
+    }
+
+    cb_free(key);
+    cb_free(key_path);
+    cb_free(cached_path);
+    return ok;
+}
@@ -40,3 +40,15 @@ void free_patches(SoftPatch* patchlist);
 uint32_t patch_hash(SoftPatch* patches);
 
 bool patch_rom(void** io_rom, size_t* io_romsize, const SoftPatch* patchlist);
+
+// The patched ROM is cached in the patches directory (only for the most
+// recent combination of enabled patches), and rebuilt if the base ROM or any
+// enabled patch file changes.
+#define PATCH_CACHE_PREFIX "patched-"
+
+// Returns the path of an up-to-date patched copy of the ROM, or NULL.
+char* find_patched_rom(const char* rom_path, const SoftPatch* patchlist);
+
+bool save_patched_rom(
+    const char* rom_path, const SoftPatch* patchlist, const void* rom, size_t romsize
+);
@@ -10,6 +10,7 @@
 
 #include "../libs/miniz/mini_gzip.h"
 #include "app.h"
+#include "crc32.h"
 #include "jparse.h"
 #include "preferences.h"
 #include "scenes/library_scene.h"
@@ -231,68 +232,18 @@ char* en_human_time(unsigned secondsAgo)
     return tr;
 }
 
-// CRC32 implementation
-static uint32_t crc32_table[256];
-static int crc32_table_generated = 0;
-
-static void generate_crc32_table(void)
-{
-    uint32_t c;
-    for (int n = 0; n < 256; n++)
-    {
-        c = (uint32_t)n;
-        for (int k = 0; k < 8; k++)
-        {
-            if (c & 1)
-            {
-                c = 0xedb88320L ^ (c >> 1);
-            }
-            else
-            {
-                c = c >> 1;
-            }
-        }
-        crc32_table[n] = c;
-    }
-    crc32_table_generated = 1;
-}
-
-static uint32_t update_crc32(uint32_t crc, const unsigned char* buf, size_t len)
-{
-    if (!crc32_table_generated)
-    {
-        generate_crc32_table();
-    }
-    for (size_t i = 0; i < len; i++)
-    {
-        crc = crc32_table[(crc ^ buf[i]) & 0xff] ^ (crc >> 8);
-    }
-    return crc;
-}
-
 uint32_t crc32_for_buffer(const unsigned char* buf, size_t len)
 {
-    if (!crc32_table_generated)
-    {
-        generate_crc32_table();
-    }
-    uint32_t crc = 0xffffffffL;
-    crc = update_crc32(crc, buf, len);
-    return crc ^ 0xffffffffL;
+    return cb_crc32(buf, len);
 }
 
 uint32_t crc32_for_string(const char* str)
 {
-    return crc32_for_buffer((const unsigned char*)str, strlen(str));
+    return cb_crc32(str, strlen(str));
 }
 
 bool cb_calculate_crc32(const char* filepath, FileOptions fopts, uint32_t* o_crc)
 {
-    if (!crc32_table_generated)
-    {
-        generate_crc32_table();
-    }
-
     SDFile* file = playdate->file->open(filepath, fopts);
     if (!file)
     {
@@ -302,8 +253,11 @@ bool cb_calculate_crc32(const char* filepath, FileOptions fopts, uint32_t* o_crc
         return false;
     }
 
-    uint32_t crc = 0xffffffffL;
-    const int buffer_size = 4096;
+    CB_CRC32 crc;
+    cb_crc32_init(&crc);
+
+    // larger reads: fewer filesystem calls per ROM while scanning
+    const int buffer_size = 16 * 1024;
     unsigned char* buffer = cb_malloc(buffer_size);
     if (!buffer)
     {
@@ -315,13 +269,13 @@ bool cb_calculate_crc32(const char* filepath, FileOptions fopts, uint32_t* o_crc
     int bytes_read;
     while ((bytes_read = playdate->file->read(file, buffer, buffer_size)) > 0)
     {
-        crc = update_crc32(crc, buffer, bytes_read);
+        cb_crc32_update(&crc, buffer, bytes_read);
     }
 
     cb_free(buffer);
     playdate->file->close(file);
 
-    *o_crc = crc ^ 0xffffffffL;
+    *o_crc = cb_crc32_final(&crc);
     return true;
 }
 
@@ -1565,60 +1519,202 @@ char* cb_url_encode_for_github_raw(const char* str)
     return encoded;
 }
 
-#define DB_CRC_MASK 0xFC /* should match what's in create_rom_list.py */
+// Binary title database, written by scripts/create_rom_list.py (see there for
+// the layout): a header with a 256-way fanout on the CRC's top byte, entries
+// sorted by CRC, and a string pool. A lookup reads one bucket of entries.
+#define TITLE_DB_PATH "db/titles.bin"
+#define TITLE_DB_MAGIC "CBTD"
+#define TITLE_DB_VERSION 1
+#define TITLE_DB_FANOUT_COUNT 257
+#define TITLE_DB_HEADER_SIZE (16 + 4 * TITLE_DB_FANOUT_COUNT)
+#define TITLE_DB_ENTRY_SIZE 12
+#define TITLE_DB_MAX_STRING 1024
 
-CB_FetchedNames cb_get_titles_from_db_by_crc(uint32_t crc)
+typedef struct
 {
-    CB_FetchedNames names = {NULL, NULL, 0, false};
+    SDFile* file;
+    uint32_t count;
+    uint32_t pool_offset;
+    uint32_t fanout[TITLE_DB_FANOUT_COUNT];
+} CB_TitleDB;
 
-    char crc_string_upper[9];
-    snprintf(crc_string_upper, sizeof(crc_string_upper), "%08lX", (unsigned long)crc);
+typedef struct
+{
+    uint32_t crc;
+    size_t index;
+} CB_TitleQuery;
 
-    char db_filename[32];
-    snprintf(
-        db_filename, sizeof(db_filename), "db/%02lx.json",
-        (unsigned long)((crc >> 24) & DB_CRC_MASK)
-    );
-    char db_filename_compressed[36];
-    snprintf(db_filename_compressed, sizeof(db_filename_compressed), "%s.lz4", db_filename);
+static uint32_t title_db_u32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
-    char* json_string = NULL;
-    json_string =
-        cb_read_entire_file_maybe_compressed(db_filename, NULL, kFileRead | kFileReadData);
+static bool title_db_open(CB_TitleDB* db)
+{
+    db->file = playdate->file->open(TITLE_DB_PATH, kFileRead | kFileReadData);
+    if (!db->file)
+        return false;
 
-    if (!json_string)
+    uint8_t header[TITLE_DB_HEADER_SIZE];
+    if (playdate->file->read(db->file, header, sizeof(header)) != sizeof(header) ||
+        memcmp(header, TITLE_DB_MAGIC, 4) != 0 || title_db_u32(header + 4) != TITLE_DB_VERSION)
     {
-        return names;
+        playdate->system->logToConsole("Title database %s is invalid.", TITLE_DB_PATH);
+        playdate->file->close(db->file);
+        db->file = NULL;
+        return false;
     }
 
-    json_value db_json;
-    if (!parse_json_string(json_string, &db_json))
+    db->count = title_db_u32(header + 8);
+    db->pool_offset = title_db_u32(header + 12);
+    for (int i = 0; i < TITLE_DB_FANOUT_COUNT; ++i)
     {
-        cb_free(json_string);
-        return names;
+        db->fanout[i] = title_db_u32(header + 16 + 4 * i);
     }
-    cb_free(json_string);
+    return db->fanout[TITLE_DB_FANOUT_COUNT - 1] == db->count;
+}
 
-    if (db_json.type == kJSONTable)
+// caller-freed; NULL if empty or unreadable
+static char* title_db_read_string(CB_TitleDB* db, uint32_t offset)
+{
+    if (playdate->file->seek(db->file, db->pool_offset + offset, SEEK_SET) != 0)
+        return NULL;
+
+    char buf[128];
+    char* str = NULL;
+    size_t len = 0;
+    while (len < TITLE_DB_MAX_STRING)
     {
-        json_value game_entry = json_get_table_value(db_json, crc_string_upper);
-        if (game_entry.type == kJSONTable)
+        int n = playdate->file->read(db->file, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+
+        char* end = memchr(buf, '\0', n);
+        size_t chunk = end ? (size_t)(end - buf) : (size_t)n;
+
+        char* grown = cb_realloc(str, len + chunk + 1);
+        if (!grown)
+            break;
+        str = grown;
+        memcpy(str + len, buf, chunk);
+        len += chunk;
+        str[len] = '\0';
+
+        if (end)
         {
-            json_value short_val = json_get_table_value(game_entry, "short");
-            if (short_val.type == kJSONString && short_val.data.stringval)
+            if (len > 0)
+                return str;
+            break;
+        }
+    }
+
+    cb_free(str);
+    return NULL;
+}
+
+static int compare_title_queries(const void* a, const void* b)
+{
+    uint32_t crc_a = ((const CB_TitleQuery*)a)->crc;
+    uint32_t crc_b = ((const CB_TitleQuery*)b)->crc;
+    return (crc_a > crc_b) - (crc_a < crc_b);
+}
+
+void cb_get_titles_from_db_by_crcs(const uint32_t* crcs, CB_FetchedNames* o_names, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        o_names[i] = (CB_FetchedNames){NULL, NULL, crcs[i], false};
+    }
+
+    if (count == 0)
+        return;
+
+    CB_TitleDB db;
+    if (!title_db_open(&db))
+    {
+        if (db.file)
+            playdate->file->close(db.file);
+        return;
+    }
+
+    // resolve in CRC order, so each bucket is read only once
+    CB_TitleQuery* queries = cb_malloc(count * sizeof(CB_TitleQuery));
+    if (!queries)
+    {
+        playdate->file->close(db.file);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        queries[i] = (CB_TitleQuery){crcs[i], i};
+    }
+    qsort(queries, count, sizeof(CB_TitleQuery), compare_title_queries);
+
+    uint8_t* bucket = NULL;
+    uint32_t bucket_size = 0;
+    uint32_t bucket_capacity = 0;
+    int bucket_loaded = -1;
+
+    for (size_t q = 0; q < count; ++q)
+    {
+        uint32_t crc = queries[q].crc;
+        int b = crc >> 24;
+
+        if (b != bucket_loaded)
+        {
+            bucket_loaded = b;
+            bucket_size = db.fanout[b + 1] > db.fanout[b] ? db.fanout[b + 1] - db.fanout[b] : 0;
+
+            if (bucket_size > bucket_capacity)
             {
-                names.short_name = cb_strdup(short_val.data.stringval);
+                uint8_t* grown = cb_realloc(bucket, bucket_size * TITLE_DB_ENTRY_SIZE);
+                if (!grown)
+                {
+                    bucket_size = 0;
+                    continue;
+                }
+                bucket = grown;
+                bucket_capacity = bucket_size;
             }
 
-            json_value long_val = json_get_table_value(game_entry, "long");
-            if (long_val.type == kJSONString && long_val.data.stringval)
+            int bytes = bucket_size * TITLE_DB_ENTRY_SIZE;
+            uint32_t offset = TITLE_DB_HEADER_SIZE + db.fanout[b] * TITLE_DB_ENTRY_SIZE;
+            if (bucket_size && (playdate->file->seek(db.file, offset, SEEK_SET) != 0 ||
+                                playdate->file->read(db.file, bucket, bytes) != bytes))
             {
-                names.detailed_name = cb_strdup(long_val.data.stringval);
+                bucket_size = 0;
             }
         }
+
+        // binary search the bucket
+        uint32_t lo = 0, hi = bucket_size;
+        while (lo < hi)
+        {
+            uint32_t mid = lo + (hi - lo) / 2;
+            uint32_t mid_crc = title_db_u32(bucket + mid * TITLE_DB_ENTRY_SIZE);
+            if (mid_crc < crc)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if (lo == bucket_size || title_db_u32(bucket + lo * TITLE_DB_ENTRY_SIZE) != crc)
+            continue;
+
+        const uint8_t* entry = bucket + lo * TITLE_DB_ENTRY_SIZE;
+        CB_FetchedNames* names = &o_names[queries[q].index];
+        names->short_name = title_db_read_string(&db, title_db_u32(entry + 4));
+        names->detailed_name = title_db_read_string(&db, title_db_u32(entry + 8));
     }
 
-    free_json_data(db_json);
+    cb_free(bucket);
+    cb_free(queries);
+    playdate->file->close(db.file);
+}
+
+CB_FetchedNames cb_get_titles_from_db_by_crc(uint32_t crc)
+{
+    CB_FetchedNames names;
+    cb_get_titles_from_db_by_crcs(&crc, &names, 1);
     return names;
 }
 
@@ -1952,6 +2048,100 @@ int base64_encode(const uint8_t* in, size_t in_len, char* out, size_t out_size)
     return (int)j;
 }
 
+// Base85 decode, with the RFC 1924 alphabet (as Python's base64.b85encode),
+// which has neither ':' nor ' ' and so fits in a serial command token. Each
+// group of 5 characters holds 4 bytes, big-endian; a final group of n + 1
+// characters holds n bytes. Returns decoded length or -1 on error.
+int base85_decode(const char* in, size_t in_len, uint8_t* out, size_t out_max)
+{
+    static const char alphabet[] =
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz!#$%&()*+-;<=>?@^_`{|}~";
+    static uint8_t table[256];
+
+    // entry 0 is only 0 before the table is built
+    if (table[0] == 0)
+    {
+        memset(table, 0xFF, sizeof(table));
+        for (int i = 0; i < 85; i++)
+        {
+            table[(uint8_t)alphabet[i]] = i;
+        }
+    }
+
+    if (in_len % 5 == 1)
+    {
+        return -1;  // a lone character can't hold a byte
+    }
+
+    size_t out_len = 0;
+    for (size_t i = 0; i < in_len; i += 5)
+    {
+        size_t n = MIN(in_len - i, 5);
+
+        // a short group is padded with the highest digit, then truncated
+        uint64_t v = 0;
+        for (size_t k = 0; k < 5; k++)
+        {
+            uint8_t digit = k < n ? table[(uint8_t)in[i + k]] : 84;
+            if (digit >= 85)
+            {
+                return -1;
+            }
+            v = v * 85 + digit;
+        }
+
+        if (v > 0xFFFFFFFF || out_len + n - 1 > out_max)
+        {
+            return -1;
+        }
+
+        for (size_t k = 0; k < n - 1; k++)
+        {
+            out[out_len++] = (v >> (24 - 8 * k)) & 0xFF;
+        }
+    }
+
+    return (int)out_len;
+}
+
+// Base85 encode, the inverse of base85_decode. Returns the encoded length or
+// -1 if out_size can't hold it (and the terminating NUL).
+int base85_encode(const uint8_t* in, size_t in_len, char* out, size_t out_size)
+{
+    static const char alphabet[] =
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz!#$%&()*+-;<=>?@^_`{|}~";
+
+    size_t need = in_len / 4 * 5 + (in_len % 4 ? in_len % 4 + 1 : 0);
+    if (out_size <= need)
+    {
+        return -1;
+    }
+
+    size_t j = 0;
+    for (size_t i = 0; i < in_len; i += 4)
+    {
+        size_t n = MIN(in_len - i, 4);
+
+        // a short group is padded with zeros, then truncated
+        uint32_t v = 0;
+        for (size_t k = 0; k < 4; k++)
+        {
+            v = (v << 8) | (k < n ? in[i + k] : 0);
+        }
+
+        char group[5];
+        for (int k = 4; k >= 0; k--)
+        {
+            group[k] = alphabet[v % 85];
+            v /= 85;
+        }
+        memcpy(out + j, group, n + 1);
+        j += n + 1;
+    }
+    out[j] = '\0';
+    return (int)j;
+}
+
 // URL decode: convert %XX to character, returns decoded length or -1 on error
 int url_decode(const char* in, char* out, size_t out_size)
 {
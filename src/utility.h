@@ -60,6 +60,7 @@ extern const uint8_t lcdp_t_50[16];  // transparent white 50%
 #define CB_MAX(x, y) (((x) > (y)) ? (x) : (y))
 #define CB_MIN(x, y) (((x) < (y)) ? (x) : (y))
 
+// legacy scan cache; imported into SCAN_CACHE_FILE once, then removed
 #define CRC_CACHE_FILE "crc_cache.json"
 
 #define LOGO_TEXT_VERTICAL_GAP 20
@@ -112,6 +113,11 @@ typedef enum
     PROGRESS_STYLE_FRACTION
 } CB_ProgressStyle;
 
+// Loading scenes (scanning, cover caching) process as many items per frame
+// as fit in this budget, and redraw their progress at most this often.
+#define CB_LOADING_FRAME_BUDGET_MS 25
+#define CB_LOADING_PROGRESS_INTERVAL_MS 100
+
 char* cb_strdup(const char* string);
 char* cb_memdup(const char* buff, int len);
 
@@ -196,9 +202,11 @@ bool cb_calculate_crc32(const char* filepath, FileOptions fopts, uint32_t* crc);
 uint32_t crc32_for_buffer(const unsigned char* buf, size_t len);
 uint32_t crc32_for_string(const char* str);
 
-// Base64 and URL decoding (used by ft protocol)
+// Base64, base85 and URL coding (used by the ft and bx protocols)
 int base64_decode(const char* in, size_t in_len, uint8_t* out, size_t out_max);
 int base64_encode(const uint8_t* in, size_t in_len, char* out, size_t out_size);
+int base85_decode(const char* in, size_t in_len, uint8_t* out, size_t out_max);
+int base85_encode(const uint8_t* in, size_t in_len, char* out, size_t out_size);
 int url_decode(const char* in, char* out, size_t out_size);
 
 // percent-encode special chars. returned string is caller-owned (cb_free).
@@ -279,6 +287,10 @@ static FORCE_INLINE uint32_t reverse_bits_in_each_byte_conditional_u16(uint16_t
 void draw_spinny(int x, int y, int radius);
 
 CB_FetchedNames cb_get_titles_from_db_by_crc(uint32_t crc);
+
+// Looks up many games at once, opening the title database only once.
+// o_names[i] receives the (caller-freed) names for crcs[i].
+void cb_get_titles_from_db_by_crcs(const uint32_t* crcs, CB_FetchedNames* o_names, size_t count);
 char* cb_url_encode_for_github_raw(const char* str);
 
 char* cb_game_config_path(const char* rom_filename);